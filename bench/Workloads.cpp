@@ -0,0 +1,149 @@
+// 文件: Workloads.cpp
+// 功能: 生成嵌套循环、数组遍历、深递归、密集输出与超大源码等工作负载
+#include "Workloads.hpp"
+
+#include <sstream>
+
+#include "pl0/Generator.hpp"
+
+namespace pl0::bench {
+
+namespace {
+
+// 函数: 双重循环累加, 迭代次数为 (100 * scale)^2
+std::string nested_loops(int scale) {
+  std::ostringstream out;
+  out << "const n = " << 100 * scale << ";\n"
+      << "var i, j, sum;\n"
+      << "begin\n"
+      << "  i := 0; sum := 0;\n"
+      << "  while i < n do\n"
+      << "  begin\n"
+      << "    j := 0;\n"
+      << "    while j < n do\n"
+      << "    begin\n"
+      << "      sum := sum + i * j % 7;\n"
+      << "      j := j + 1\n"
+      << "    end;\n"
+      << "    i := i + 1\n"
+      << "  end;\n"
+      << "  write(sum)\n"
+      << "end.\n";
+  return out.str();
+}
+
+// 函数: 反复填充并求和 256 元数组, 遍历次数为 20 * scale
+std::string array_sweep(int scale) {
+  std::ostringstream out;
+  out << "const size = 256, sweeps = " << 20 * scale << ";\n"
+      << "var a[256], i, k, sum;\n"
+      << "begin\n"
+      << "  k := 0; sum := 0;\n"
+      << "  while k < sweeps do\n"
+      << "  begin\n"
+      << "    i := 0;\n"
+      << "    while i < size do\n"
+      << "    begin\n"
+      << "      a[i] := i + k;\n"
+      << "      i := i + 1\n"
+      << "    end;\n"
+      << "    i := 0;\n"
+      << "    while i < size do\n"
+      << "    begin\n"
+      << "      sum := sum + a[i];\n"
+      << "      i := i + 1\n"
+      << "    end;\n"
+      << "    k := k + 1\n"
+      << "  end;\n"
+      << "  write(sum)\n"
+      << "end.\n";
+  return out.str();
+}
+
+// 函数: 非尾递归的深调用链与树形递归
+std::string deep_recursion(int scale) {
+  std::ostringstream out;
+  out << "var k, total;\n"
+      << "function depth(n);\n"
+      << "begin\n"
+      << "  if n = 0 then depth := 0 else depth := depth(n - 1) + 1\n"
+      << "end;\n"
+      << "function fib(n);\n"
+      << "begin\n"
+      << "  if n < 2 then fib := n else fib := fib(n - 1) + fib(n - 2)\n"
+      << "end;\n"
+      << "begin\n"
+      << "  k := 0; total := 0;\n"
+      << "  while k < " << 4 * scale << " do\n"
+      << "  begin\n"
+      << "    total := total + depth(2000);\n"
+      << "    k := k + 1\n"
+      << "  end;\n"
+      << "  write(total + fib(" << 14 + scale << "))\n"
+      << "end.\n";
+  return out.str();
+}
+
+// 函数: 密集输出, 写出 2000 * scale 行
+std::string io_heavy(int scale) {
+  std::ostringstream out;
+  out << "var i;\n"
+      << "begin\n"
+      << "  i := 0;\n"
+      << "  while i < " << 2000 * scale << " do\n"
+      << "  begin\n"
+      << "    write(i); write(i * i); writeln();\n"
+      << "    i := i + 1\n"
+      << "  end\n"
+      << "end.\n";
+  return out.str();
+}
+
+// 函数: 超大源码, 含 200 * scale 个过程, 主要考察前端
+std::string huge_source(int scale) {
+  const int procedures = 200 * scale;
+  std::ostringstream out;
+  out << "var total;\n";
+  for (int p = 0; p < procedures; ++p) {
+    out << "procedure p" << p << "(a, b);\n"
+        << "var x, y;\n"
+        << "begin\n"
+        << "  x := a * " << p % 13 + 1 << " + b;\n"
+        << "  y := x - " << p % 7 << ";\n"
+        << "  if odd x then total := total + y else total := total - y;\n"
+        << "  while x > 0 do x := x - " << p % 5 + 1 << "\n"
+        << "end;\n";
+  }
+  out << "begin\n  total := 0;\n";
+  for (int p = 0; p < procedures; ++p) {
+    out << "  call p" << p << "(" << p << ", " << procedures - p << ");\n";
+  }
+  out << "  write(total)\nend.\n";
+  return out.str();
+}
+
+// 函数: 由 pl0gen 同款生成器产生的深嵌套大程序, 含 25 * scale 个顶层过程
+std::string generated(int scale) {
+  GeneratorOptions options;
+  options.procedures = 25 * scale;
+  options.depth = 8;
+  options.array_size = 4096;
+  options.expression_terms = 24;
+  return generate_program(options).source;
+}
+
+}  // namespace
+
+// 函数: 按规模生成全部工作负载
+std::vector<Workload> make_workloads(int scale) {
+  return {
+      {"nested_loops", nested_loops(scale)},
+      {"array_sweep", array_sweep(scale)},
+      {"deep_recursion", deep_recursion(scale)},
+      {"io_heavy", io_heavy(scale)},
+      {"huge_source", huge_source(scale)},
+      {"generated", generated(scale)},
+  };
+}
+
+}  // namespace pl0::bench
@@ -0,0 +1,19 @@
+// 文件: Workloads.hpp
+// 功能: 声明基准测试使用的可伸缩 PL/0 工作负载
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace pl0::bench {
+
+// 结构: 单个工作负载, 源码规模随 scale 线性或平方增长
+struct Workload {
+  std::string name;
+  std::string source;
+};
+
+// 函数: 按规模生成全部工作负载 (scale >= 1)
+std::vector<Workload> make_workloads(int scale);
+
+}  // namespace pl0::bench
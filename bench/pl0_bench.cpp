@@ -0,0 +1,407 @@
+// 文件: pl0_bench.cpp
+// 功能: 编译器各阶段与虚拟机的基准测试, 输出吞吐量、分配次数与可选的 JSON 报告
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Workloads.hpp"
+#include "pl0/Codegen.hpp"
+#include "pl0/Incremental.hpp"
+#include "pl0/Lexer.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/ParallelParser.hpp"
+#include "pl0/Parser.hpp"
+#include "pl0/Scheduler.hpp"
+#include "pl0/SourceBuffer.hpp"
+#include "pl0/VM.hpp"
+
+namespace {
+
+// 全局分配计数, 由下方替换的 operator new 维护
+std::atomic<std::uint64_t> g_allocations{0};
+std::atomic<std::uint64_t> g_allocated_bytes{0};
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+    return pointer;
+  }
+  throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+void operator delete[](void* pointer) noexcept { std::free(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { std::free(pointer); }
+// std::stable_sort 等通过 nothrow 版本申请临时缓冲, 必须与上面的释放函数配对
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  try {
+    return ::operator new(size);
+  } catch (const std::bad_alloc&) {
+    return nullptr;
+  }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept {
+  return ::operator new(size, tag);
+}
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { std::free(pointer); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 结构: 命令行选项
+struct BenchOptions {
+  int scale = 1;
+  int repeat = 5;
+  std::string filter;
+  std::string json_output;
+};
+
+// 结构: 单项基准结果, 耗时与分配均为每次迭代的数值
+struct Measurement {
+  std::string name;
+  std::string unit;  // 吞吐量的工作单位: bytes 或 instructions
+  double work = 0;   // 每次迭代处理的工作量
+  int iterations = 0;
+  double min_ns = 0;
+  double median_ns = 0;
+  double mean_ns = 0;
+  std::uint64_t allocations = 0;
+  std::uint64_t allocated_bytes = 0;
+
+  [[nodiscard]] double throughput() const { return min_ns > 0 ? work * 1e9 / min_ns : 0.0; }
+};
+
+// 类: 丢弃所有输出的流缓冲, 避免终端 I/O 干扰执行计时
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int ch) override { return ch; }
+  std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+// 函数: 预热一次后重复执行并统计耗时与分配
+Measurement measure(std::string name, std::string unit, double work, int repeat,
+                    const std::function<void()>& body) {
+  body();
+  std::vector<double> samples;
+  Measurement measurement{std::move(name), std::move(unit), work};
+  for (int i = 0; i < repeat; ++i) {
+    const auto allocations = g_allocations.load(std::memory_order_relaxed);
+    const auto bytes = g_allocated_bytes.load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+    body();
+    const auto stop = Clock::now();
+    measurement.allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+    measurement.allocated_bytes = g_allocated_bytes.load(std::memory_order_relaxed) - bytes;
+    samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  measurement.iterations = repeat;
+  measurement.min_ns = samples.front();
+  measurement.median_ns = samples[samples.size() / 2];
+  measurement.mean_ns =
+      std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+  return measurement;
+}
+
+// 函数: 编译期错误即视为基准本身有误
+void require_clean(const pl0::DiagnosticSink& diagnostics, const std::string& name) {
+  if (diagnostics.has_errors()) {
+    for (const auto& diagnostic : diagnostics.diagnostics()) {
+      std::cerr << name << ": " << diagnostic << '\n';
+    }
+    throw std::runtime_error("workload " + name + " failed to compile");
+  }
+}
+
+// 函数: 对单个工作负载运行全部阶段的基准
+void bench_workload(const pl0::bench::Workload& workload, const BenchOptions& options,
+                    std::vector<Measurement>& results) {
+  auto selected = [&](const std::string& name) {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+  };
+  const std::string& source = workload.source;
+  const auto source_bytes = static_cast<double>(source.size());
+  const pl0::CompilerOptions compiler_options;
+
+  // 先完整编译一次, 供后续阶段复用
+  pl0::DiagnosticSink diagnostics;
+  pl0::Lexer lexer(source, diagnostics);
+  pl0::Parser parser(lexer, diagnostics);
+  auto program = parser.parse_program();
+  require_clean(diagnostics, workload.name);
+  pl0::SymbolTable symbols;
+  pl0::InstructionSequence code;
+  pl0::CodeGenerator generator(symbols, code, diagnostics, compiler_options);
+  generator.emit_program(*program);
+  require_clean(diagnostics, workload.name);
+
+  const pl0::SourceBuffer borrowed(source);
+  std::string name = workload.name + "/lex";
+  if (selected(name)) {
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      pl0::Lexer bench_lexer(borrowed, sink);
+      while (bench_lexer.next().kind != pl0::TokenKind::EndOfFile) {
+      }
+    }));
+  }
+
+  // 与 compile_file 相同的读入路径: 映射文件后直接扫描
+  name = workload.name + "/lex-file";
+  if (selected(name)) {
+    const auto path =
+        std::filesystem::temp_directory_path() / ("pl0_bench_" + workload.name + ".pl0");
+    {
+      std::ofstream out(path, std::ios::binary);
+      out << source;
+    }
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      const auto file = pl0::SourceBuffer::open(path);
+      pl0::Lexer bench_lexer(file, sink);
+      while (bench_lexer.next().kind != pl0::TokenKind::EndOfFile) {
+      }
+    }));
+    std::filesystem::remove(path);
+  }
+
+  name = workload.name + "/parse";
+  if (selected(name)) {
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      pl0::Lexer bench_lexer(borrowed, sink);
+      pl0::Parser bench_parser(bench_lexer, sink);
+      auto parsed = bench_parser.parse_program();
+    }));
+  }
+
+  // 预先扫描好 Token, 顶层过程在各核心上并行解析
+  name = workload.name + "/parse-parallel";
+  if (selected(name)) {
+    std::vector<pl0::Token> tokens;
+    {
+      pl0::DiagnosticSink sink;
+      pl0::Lexer bench_lexer(borrowed, sink);
+      do {
+        tokens.push_back(bench_lexer.next());
+      } while (tokens.back().kind != pl0::TokenKind::EndOfFile);
+    }
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      auto parsed = pl0::parse_program_parallel(tokens, sink, 0);
+    }));
+  }
+
+  // 在源码中部插入再删除一个空格, 衡量编辑器每次按键后的增量重解析
+  name = workload.name + "/reparse-edit";
+  if (selected(name)) {
+    pl0::IncrementalParser incremental;
+    incremental.reset(source);
+    const std::size_t middle = source.find('\n', source.size() / 2);
+    const std::size_t offset = middle == std::string::npos ? 0 : middle + 1;
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      incremental.apply({offset, 0, " "});
+      incremental.apply({offset, 1, ""});
+    }));
+    if (!incremental.diagnostics().empty()) {
+      throw std::runtime_error("workload " + workload.name + " failed to reparse");
+    }
+  }
+
+  name = workload.name + "/codegen";
+  if (selected(name)) {
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      pl0::SymbolTable table;
+      pl0::InstructionSequence output;
+      pl0::CodeGenerator bench_generator(table, output, sink, compiler_options);
+      bench_generator.emit_program(*program);
+    }));
+  }
+
+  // 顶层过程在各核心上生成片段后链接; 不足约 4096 行的程序仍顺序生成
+  name = workload.name + "/codegen-parallel";
+  if (selected(name)) {
+    pl0::CompilerOptions parallel_options;
+    parallel_options.threads = 0;
+    results.push_back(measure(name, "bytes", source_bytes, options.repeat, [&] {
+      pl0::DiagnosticSink sink;
+      pl0::SymbolTable table;
+      pl0::InstructionSequence output;
+      pl0::CodeGenerator bench_generator(table, output, sink, parallel_options);
+      bench_generator.emit_program(*program);
+    }));
+  }
+
+  name = workload.name + "/deserialize";
+  if (selected(name)) {
+    std::ostringstream serialized;
+    pl0::serialize_instructions(code, serialized);
+    const std::string text = serialized.str();
+    results.push_back(
+        measure(name, "bytes", static_cast<double>(text.size()), options.repeat, [&] {
+          std::istringstream in(text);
+          auto loaded = pl0::deserialize_instructions(in);
+        }));
+  }
+
+  name = workload.name + "/execute";
+  if (selected(name)) {
+    NullBuffer null_buffer;
+    std::ostream null_output(&null_buffer);
+    // 计数版本只用于确定工作量, 计时使用无插桩版本
+    pl0::RunnerOptions counting;
+    counting.count_instructions = true;
+    pl0::DiagnosticSink sink;
+    pl0::VirtualMachine counter(sink, counting);
+    counter.set_io(std::cin, null_output);
+    const auto instructions = static_cast<double>(counter.execute(code).instructions);
+    const pl0::RunnerOptions runner_options;
+    results.push_back(measure(name, "instructions", instructions, options.repeat, [&] {
+      pl0::DiagnosticSink run_sink;
+      pl0::VirtualMachine vm(run_sink, runner_options);
+      vm.set_io(std::cin, null_output);
+      vm.execute(code);
+    }));
+    require_clean(sink, workload.name);
+  }
+
+  // 每个核心运行一份独立副本, 衡量多程序调度的总吞吐
+  name = workload.name + "/execute-parallel";
+  if (selected(name)) {
+    const std::size_t copies = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    pl0::Scheduler scheduler(copies);
+    pl0::ProgramJob counting{code, "", {}};
+    counting.options.count_instructions = true;
+    scheduler.submit(std::move(counting));
+    auto probe = scheduler.run();
+    require_clean(probe.front().diagnostics, workload.name);
+    const auto instructions = static_cast<double>(probe.front().result.instructions * copies);
+    results.push_back(measure(name, "instructions", instructions, options.repeat, [&] {
+      for (std::size_t i = 0; i < copies; ++i) {
+        scheduler.submit({code, "", {}});
+      }
+      scheduler.run();
+    }));
+  }
+}
+
+// 函数: 以表格形式打印结果
+void print_table(const std::vector<Measurement>& results, std::ostream& out) {
+  out << std::left << std::setw(34) << "benchmark" << std::right << std::setw(12) << "min ms"
+      << std::setw(12) << "median ms" << std::setw(16) << "throughput" << std::setw(12)
+      << "allocs" << std::setw(14) << "alloc bytes" << '\n';
+  for (const auto& result : results) {
+    const bool instructions = result.unit == "instructions";
+    const double rate = result.throughput() / 1e6;
+    std::ostringstream throughput;
+    throughput << std::fixed << std::setprecision(1) << rate
+               << (instructions ? " Minstr/s" : " MB/s");
+    out << std::left << std::setw(34) << result.name << std::right << std::fixed
+        << std::setprecision(3) << std::setw(12) << result.min_ns / 1e6 << std::setw(12)
+        << result.median_ns / 1e6 << std::setw(16) << throughput.str() << std::setw(12)
+        << result.allocations << std::setw(14) << result.allocated_bytes << '\n';
+  }
+}
+
+// 函数: 输出供回归跟踪使用的 JSON 报告
+void write_json(const std::vector<Measurement>& results, const BenchOptions& options,
+                std::ostream& out) {
+  out << "{\n  \"scale\": " << options.scale << ",\n  \"repeat\": " << options.repeat
+      << ",\n  \"benchmarks\": [\n";
+  out << std::fixed << std::setprecision(1);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    out << "    {\"name\": \"" << result.name << "\", \"unit\": \"" << result.unit
+        << "\", \"work\": " << result.work << ", \"iterations\": " << result.iterations
+        << ", \"min_ns\": " << result.min_ns << ", \"median_ns\": " << result.median_ns
+        << ", \"mean_ns\": " << result.mean_ns << ", \"throughput_per_s\": "
+        << result.throughput() << ", \"allocations\": " << result.allocations
+        << ", \"allocated_bytes\": " << result.allocated_bytes << "}"
+        << (i + 1 < results.size() ? "," : "") << '\n';
+  }
+  out << "  ]\n}\n";
+}
+
+// 函数: 解析正整数参数
+bool parse_positive(const std::string& text, int& value) {
+  try {
+    std::size_t used = 0;
+    int parsed = std::stoi(text, &used);
+    if (used != text.size() || parsed <= 0) {
+      return false;
+    }
+    value = parsed;
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+void print_usage() {
+  std::cerr << "Usage: pl0_bench [--scale N] [--repeat N] [--filter text] [--json out.json]\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  BenchOptions options;
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    if (arg == "--scale" && has_value && parse_positive(args[i + 1], options.scale)) {
+      ++i;
+    } else if (arg == "--repeat" && has_value && parse_positive(args[i + 1], options.repeat)) {
+      ++i;
+    } else if (arg == "--filter" && has_value) {
+      options.filter = args[++i];
+    } else if (arg == "--json" && has_value) {
+      options.json_output = args[++i];
+    } else {
+      print_usage();
+      return 1;
+    }
+  }
+
+  std::vector<Measurement> results;
+  try {
+    for (const auto& workload : pl0::bench::make_workloads(options.scale)) {
+      bench_workload(workload, options, results);
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << '\n';
+    return 1;
+  }
+
+  print_table(results, std::cout);
+  if (!options.json_output.empty()) {
+    std::ofstream json(options.json_output);
+    if (!json) {
+      std::cerr << "Failed to open " << options.json_output << '\n';
+      return 1;
+    }
+    write_json(results, options, json);
+  }
+  return 0;
+}
@@ -0,0 +1,314 @@
+#include "AstDiagramView.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QFontMetricsF>
+#include <QImage>
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPen>
+#include <QResizeEvent>
+#include <QScrollBar>
+
+namespace {
+
+constexpr double kHorizontalSpacing = 48.0;
+constexpr double kVerticalSpacing = 90.0;
+constexpr double kMargin = 48.0;
+constexpr double kPaddingX = 28.0;
+constexpr double kPaddingY = 20.0;
+// 图块边长 (逻辑像素); 缓存上限约 64 MB, 足够覆盖数屏的滚动范围
+constexpr int kTileSize = 512;
+constexpr int kTileCacheKilobytes = 64 * 1024;
+// 导出 PNG 的像素总数上限, 更大的图按比例缩小, 避免分配失败
+constexpr double kMaxExportPixels = 64.0 * 1024.0 * 1024.0;
+
+quint64 mixHash(quint64 hash, quint64 value) {
+  return (hash ^ value) * 1099511628211ULL;
+}
+
+std::size_t hashSubtree(const DiagramNode& node, std::vector<quint64>& hashes,
+                        std::vector<std::size_t>& sizes) {
+  const std::size_t index = hashes.size();
+  hashes.push_back(0);
+  sizes.push_back(0);
+  quint64 hash = mixHash(14695981039346656037ULL, static_cast<quint64>(qHash(node.label)));
+  hash = mixHash(hash, static_cast<quint64>(node.children.size()));
+  for (const auto& child : node.children) {
+    hash = mixHash(hash, hashes[hashSubtree(child, hashes, sizes)]);
+  }
+  hashes[index] = hash;
+  sizes[index] = hashes.size() - index;
+  return index;
+}
+
+}  // namespace
+
+AstDiagramView::AstDiagramView(QWidget* parent) : QAbstractScrollArea(parent) {
+  setFrameShape(QFrame::NoFrame);
+  viewport()->setBackgroundRole(QPalette::Base);
+  viewport()->setAutoFillBackground(false);
+  horizontalScrollBar()->setSingleStep(40);
+  verticalScrollBar()->setSingleStep(40);
+  tileCache_.setMaxCost(kTileCacheKilobytes);
+  font_ = font();
+}
+
+void AstDiagramView::setTree(DiagramNode root) {
+  root_ = std::move(root);
+  hasTree_ = true;
+  layoutDirty_ = true;
+  tileCache_.clear();
+  viewport()->update();
+}
+
+void AstDiagramView::clear() {
+  // 保留布局缓存: 修正一次编译错误后, 未改动的子树仍可复用
+  root_ = DiagramNode{};
+  hasTree_ = false;
+  layoutDirty_ = false;
+  layout_.reset();
+  tileCache_.clear();
+  updateScrollBars();
+  viewport()->update();
+}
+
+void AstDiagramView::setDiagramFont(const QFont& font) {
+  if (font == font_) {
+    return;
+  }
+  font_ = font;
+  layoutCache_.clear();
+  tileCache_.clear();
+  layout_.reset();
+  layoutDirty_ = hasTree_;
+  viewport()->update();
+}
+
+bool AstDiagramView::exportImage(const QString& path, double* appliedScale) {
+  ensureLayout();
+  if (!layout_) {
+    return false;
+  }
+  const QSizeF size = sceneSize();
+  const double scale =
+      std::min(1.0, std::sqrt(kMaxExportPixels / (size.width() * size.height())));
+  QImage image(QSize(static_cast<int>(std::ceil(size.width() * scale)),
+                     static_cast<int>(std::ceil(size.height() * scale))),
+               QImage::Format_ARGB32_Premultiplied);
+  if (image.isNull()) {
+    return false;
+  }
+  image.fill(Qt::transparent);
+  {
+    QPainter painter(&image);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+    painter.scale(scale, scale);
+    painter.setFont(font_);
+    drawBox(painter, *layout_, QPointF(kMargin, kMargin), QRectF(QPointF(0, 0), size));
+  }
+  if (appliedScale) {
+    *appliedScale = scale;
+  }
+  return image.save(path, "PNG");
+}
+
+void AstDiagramView::paintEvent(QPaintEvent* event) {
+  ensureLayout();
+  QPainter painter(viewport());
+  painter.fillRect(event->rect(), palette().color(QPalette::Base));
+  if (!layout_) {
+    return;
+  }
+  const QPoint origin = sceneOrigin();
+  const QRectF visible =
+      QRectF(event->rect()).translated(-origin) & QRectF(QPointF(0, 0), sceneSize());
+  if (visible.isEmpty()) {
+    return;
+  }
+  const int firstColumn = static_cast<int>(visible.left()) / kTileSize;
+  const int lastColumn = static_cast<int>(std::ceil(visible.right())) / kTileSize;
+  const int firstRow = static_cast<int>(visible.top()) / kTileSize;
+  const int lastRow = static_cast<int>(std::ceil(visible.bottom())) / kTileSize;
+  for (int row = firstRow; row <= lastRow; ++row) {
+    for (int column = firstColumn; column <= lastColumn; ++column) {
+      if (const QPixmap* pixmap = tile(column, row)) {
+        painter.drawPixmap(origin + QPoint(column * kTileSize, row * kTileSize), *pixmap);
+      }
+    }
+  }
+}
+
+void AstDiagramView::resizeEvent(QResizeEvent* event) {
+  QAbstractScrollArea::resizeEvent(event);
+  updateScrollBars();
+}
+
+void AstDiagramView::ensureLayout() {
+  if (!layoutDirty_) {
+    return;
+  }
+  layoutDirty_ = false;
+  std::vector<quint64> hashes;
+  std::vector<std::size_t> sizes;
+  hashSubtree(root_, hashes, sizes);
+  std::vector<SubtreeKey> keys(hashes.size());
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    keys[i] = {hashes[i], sizes[i]};
+  }
+  QHash<quint64, LayoutPtr> current;
+  std::size_t cursor = 0;
+  layout_ = layoutSubtree(root_, keys, cursor, current);
+  // 只保留本次用到的子树, 缓存大小随当前语法树而不是历史累积
+  layoutCache_ = std::move(current);
+  tileCache_.clear();
+  updateScrollBars();
+}
+
+AstDiagramView::LayoutPtr AstDiagramView::layoutSubtree(const DiagramNode& node,
+                                                        const std::vector<SubtreeKey>& keys,
+                                                        std::size_t& cursor,
+                                                        QHash<quint64, LayoutPtr>& current) {
+  const SubtreeKey key = keys[cursor];
+  auto matches = [&](const LayoutPtr& cached) {
+    return cached && cached->label == node.label &&
+           cached->children.size() == node.children.size();
+  };
+  LayoutPtr cached = current.value(key.hash);
+  if (!matches(cached)) {
+    cached = layoutCache_.value(key.hash);
+  }
+  if (matches(cached)) {
+    cursor += key.size;
+    current.insert(key.hash, cached);
+    return cached;
+  }
+  ++cursor;
+
+  auto box = std::make_shared<LayoutBox>();
+  box->label = node.label;
+  const QSizeF textSize = QFontMetricsF(font_).size(Qt::TextSingleLine, node.label);
+  box->rect.setSize(QSizeF(textSize.width() + kPaddingX, textSize.height() + kPaddingY));
+
+  std::vector<LayoutPtr> children;
+  children.reserve(node.children.size());
+  double combinedWidth = 0.0;
+  for (const auto& child : node.children) {
+    children.push_back(layoutSubtree(child, keys, cursor, current));
+    combinedWidth += children.back()->width;
+  }
+  if (!children.empty()) {
+    combinedWidth += kHorizontalSpacing * static_cast<double>(children.size() - 1);
+  }
+  box->width = std::max(box->rect.width(), combinedWidth);
+  box->height = box->rect.height();
+  box->rect.moveTo((box->width - box->rect.width()) / 2.0, 0.0);
+
+  double left = (box->width - combinedWidth) / 2.0;
+  const double childTop = box->rect.bottom() + kVerticalSpacing;
+  box->children.reserve(children.size());
+  for (auto& child : children) {
+    box->height = std::max(box->height, childTop + child->height);
+    const double width = child->width;
+    box->children.emplace_back(QPointF(left, childTop), std::move(child));
+    left += width + kHorizontalSpacing;
+  }
+  current.insert(key.hash, box);
+  return box;
+}
+
+QSizeF AstDiagramView::sceneSize() const {
+  if (!layout_) {
+    return QSizeF();
+  }
+  return QSizeF(layout_->width + kMargin * 2, layout_->height + kMargin * 2);
+}
+
+QPoint AstDiagramView::sceneOrigin() const {
+  // 图比视口小时居中显示, 否则跟随滚动条
+  const QSize scene = sceneSize().toSize();
+  const QSize view = viewport()->size();
+  const int x = scene.width() < view.width() ? (view.width() - scene.width()) / 2
+                                             : -horizontalScrollBar()->value();
+  const int y = scene.height() < view.height() ? (view.height() - scene.height()) / 2
+                                               : -verticalScrollBar()->value();
+  return QPoint(x, y);
+}
+
+void AstDiagramView::updateScrollBars() {
+  const QSize scene = sceneSize().toSize();
+  const QSize view = viewport()->size();
+  horizontalScrollBar()->setPageStep(view.width());
+  horizontalScrollBar()->setRange(0, std::max(0, scene.width() - view.width()));
+  verticalScrollBar()->setPageStep(view.height());
+  verticalScrollBar()->setRange(0, std::max(0, scene.height() - view.height()));
+}
+
+const QPixmap* AstDiagramView::tile(int column, int row) {
+  const quint64 key = (static_cast<quint64>(column) << 32) | static_cast<quint32>(row);
+  if (const QPixmap* cached = tileCache_.object(key)) {
+    return cached;
+  }
+  const qreal ratio = devicePixelRatioF();
+  auto* pixmap = new QPixmap(QSize(static_cast<int>(std::ceil(kTileSize * ratio)),
+                                   static_cast<int>(std::ceil(kTileSize * ratio))));
+  pixmap->setDevicePixelRatio(ratio);
+  pixmap->fill(palette().color(QPalette::Base));
+  {
+    QPainter painter(pixmap);
+    painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
+    painter.setFont(font_);
+    const QPointF tileOrigin(column * kTileSize, row * kTileSize);
+    painter.translate(-tileOrigin);
+    drawBox(painter, *layout_, QPointF(kMargin, kMargin),
+            QRectF(tileOrigin, QSizeF(kTileSize, kTileSize)));
+  }
+  const int cost = std::max(1, pixmap->width() * pixmap->height() * 4 / 1024);
+  tileCache_.insert(key, pixmap, cost);
+  return tileCache_.object(key);
+}
+
+void AstDiagramView::drawBox(QPainter& painter, const LayoutBox& box, QPointF origin,
+                             const QRectF& clip) const {
+  const QRectF rect = box.rect.translated(origin);
+  if (rect.intersects(clip)) {
+    painter.setPen(QPen(QColor(153, 169, 205), 1.2, Qt::SolidLine, Qt::RoundCap));
+    painter.setBrush(QColor(244, 247, 255, 235));
+    painter.drawRoundedRect(rect, 10, 10);
+    painter.setPen(QColor(40, 53, 85));
+    painter.drawText(rect, Qt::AlignCenter, box.label);
+  }
+  if (box.children.empty()) {
+    return;
+  }
+
+  // 连线只出现在父结点底边与子结点顶边之间的水平带内, 该带可见时才逐条检查
+  const double childTop = origin.y() + box.children.front().first.y();
+  if (clip.top() <= childTop && clip.bottom() >= rect.bottom()) {
+    painter.setPen(QPen(QColor(185, 196, 221), 1.0, Qt::SolidLine, Qt::RoundCap));
+    const QPointF from(rect.center().x(), rect.bottom());
+    for (const auto& [offset, child] : box.children) {
+      const QPointF to(origin.x() + offset.x() + child->rect.center().x(), childTop);
+      if (QRectF(from, to).normalized().adjusted(-1, -1, 1, 1).intersects(clip)) {
+        painter.drawLine(from, to);
+      }
+    }
+  }
+
+  // 子树按横坐标排列, 二分找到第一棵可能可见的子树后顺序处理到裁剪区右侧为止
+  auto first = std::partition_point(
+      box.children.begin(), box.children.end(), [&](const auto& entry) {
+        return origin.x() + entry.first.x() + entry.second->width < clip.left();
+      });
+  for (auto it = first; it != box.children.end(); ++it) {
+    const QPointF childOrigin = origin + it->first;
+    if (childOrigin.x() > clip.right()) {
+      break;
+    }
+    const LayoutBox& child = *it->second;
+    if (QRectF(childOrigin, QSizeF(child.width, child.height)).intersects(clip)) {
+      drawBox(painter, child, childOrigin, clip);
+    }
+  }
+}
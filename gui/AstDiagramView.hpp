@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <QAbstractScrollArea>
+#include <QCache>
+#include <QFont>
+#include <QHash>
+#include <QPixmap>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+
+class QPainter;
+
+// 语法树图中的一个结点, 只保存显示文本, 由主窗口从 AST 转换而来
+struct DiagramNode {
+  QString label;
+  std::vector<DiagramNode> children;
+};
+
+// 语法树图视图: 布局推迟到首次绘制时进行, 只为可见区域渲染固定大小的图块并缓存,
+// 结构未变化的子树在两次编译之间复用已测量的布局, 不再一次性生成整张位图
+class AstDiagramView : public QAbstractScrollArea {
+  Q_OBJECT
+
+ public:
+  explicit AstDiagramView(QWidget* parent = nullptr);
+
+  // 替换显示的语法树, 布局在下一次绘制或导出时才计算
+  void setTree(DiagramNode root);
+  void clear();
+  bool hasTree() const { return hasTree_; }
+
+  // 字体变化会使布局缓存失效; 与当前字体相同时什么也不做
+  void setDiagramFont(const QFont& font);
+
+  // 把整张图渲染为 PNG; 超出像素上限时按比例缩小, 返回实际使用的缩放比例
+  bool exportImage(const QString& path, double* appliedScale = nullptr);
+
+ protected:
+  void paintEvent(QPaintEvent* event) override;
+  void resizeEvent(QResizeEvent* event) override;
+
+ private:
+  // 以子树左上角为原点的布局; 子结点以共享指针引用, 未改变的子树可以整体复用
+  struct LayoutBox {
+    QString label;
+    QRectF rect;  // 本结点方框, 相对子树原点
+    double width = 0.0;
+    double height = 0.0;
+    std::vector<std::pair<QPointF, std::shared_ptr<const LayoutBox>>> children;
+  };
+  using LayoutPtr = std::shared_ptr<const LayoutBox>;
+
+  // 先序遍历中每棵子树的结构哈希与结点数, 命中缓存时据此跳过整棵子树
+  struct SubtreeKey {
+    quint64 hash = 0;
+    std::size_t size = 0;
+  };
+
+  void ensureLayout();
+  LayoutPtr layoutSubtree(const DiagramNode& node, const std::vector<SubtreeKey>& keys,
+                          std::size_t& cursor, QHash<quint64, LayoutPtr>& current);
+  QSizeF sceneSize() const;
+  QPoint sceneOrigin() const;
+  void updateScrollBars();
+  const QPixmap* tile(int column, int row);
+  void drawBox(QPainter& painter, const LayoutBox& box, QPointF origin, const QRectF& clip) const;
+
+  DiagramNode root_;
+  bool hasTree_ = false;
+  bool layoutDirty_ = false;
+  QFont font_;
+  LayoutPtr layout_;
+  // 上一次布局中出现过的子树, 以结构哈希为键
+  QHash<quint64, LayoutPtr> layoutCache_;
+  // 已渲染的图块, 键为 (列 << 32 | 行), 代价按千字节计
+  QCache<quint64, QPixmap> tileCache_;
+};
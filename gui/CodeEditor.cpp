@@ -1,8 +1,29 @@
 #include "CodeEditor.hpp"
 
+#include <algorithm>
+#include <cstddef>
+
+#include <QHelpEvent>
 #include <QPaintEvent>
 #include <QPainter>
+#include <QStringList>
 #include <QTextBlock>
+#include <QTextDocument>
+#include <QToolTip>
+
+namespace {
+
+// 最多标记的诊断数, 错误成片时避免重绘拖慢输入
+constexpr std::size_t kMaxDiagnosticMarks = 200;
+
+// 把块内的 UTF-8 字节列换算为 QString 下标
+int byteColumnToIndex(const QTextBlock& block, int column) {
+  const QByteArray bytes = block.text().toUtf8();
+  const int prefix = std::clamp(column - 1, 0, static_cast<int>(bytes.size()));
+  return static_cast<int>(QString::fromUtf8(bytes.constData(), prefix).size());
+}
+
+}  // namespace
 
 CodeEditor::CodeEditor(QWidget* parent) : QPlainTextEdit(parent) {
   lineNumberArea_ = new LineNumberArea(this);
@@ -64,9 +85,71 @@ void CodeEditor::highlightCurrentLine() {
     extraSelections.append(selection);
   }
 
+  extraSelections.append(diagnosticSelections_);
   setExtraSelections(extraSelections);
 }
 
+void CodeEditor::setDiagnosticMarks(const std::vector<DiagnosticMark>& marks) {
+  diagnosticSelections_.clear();
+  diagnosticMessages_.clear();
+  QTextDocument* doc = document();
+  for (const auto& mark : marks) {
+    if (static_cast<std::size_t>(diagnosticSelections_.size()) >= kMaxDiagnosticMarks) {
+      break;
+    }
+    const QTextBlock beginBlock = doc->findBlockByNumber(mark.line - 1);
+    if (!beginBlock.isValid()) {
+      continue;
+    }
+    QTextBlock endBlock = doc->findBlockByNumber(mark.endLine - 1);
+    if (!endBlock.isValid()) {
+      endBlock = doc->lastBlock();
+    }
+    int begin = beginBlock.position() + byteColumnToIndex(beginBlock, mark.column);
+    int end = endBlock.position() + byteColumnToIndex(endBlock, mark.endColumn);
+    // Token 的起点包含前导空白, 标记从第一个可见字符开始
+    while (begin < end && doc->characterAt(begin).isSpace()) {
+      ++begin;
+    }
+    if (end <= begin) {
+      // 空区间 (如缺少的符号) 至少标出一个字符
+      end = begin + 1;
+    }
+
+    QTextEdit::ExtraSelection selection;
+    selection.format.setUnderlineStyle(QTextCharFormat::WaveUnderline);
+    selection.format.setUnderlineColor(mark.error ? QColor(220, 50, 47) : QColor(203, 140, 20));
+    selection.cursor = QTextCursor(doc);
+    selection.cursor.setPosition(std::min(begin, doc->characterCount() - 1));
+    selection.cursor.setPosition(std::min(end, doc->characterCount() - 1), QTextCursor::KeepAnchor);
+    diagnosticSelections_.append(selection);
+    diagnosticMessages_.append(mark.message);
+  }
+  highlightCurrentLine();
+}
+
+bool CodeEditor::viewportEvent(QEvent* event) {
+  if (event->type() == QEvent::ToolTip) {
+    auto* help = static_cast<QHelpEvent*>(event);
+    const int position = cursorForPosition(help->pos()).position();
+    QStringList messages;
+    for (int i = 0; i < diagnosticSelections_.size(); ++i) {
+      const QTextCursor& cursor = diagnosticSelections_[i].cursor;
+      if (position >= cursor.selectionStart() && position <= cursor.selectionEnd()) {
+        messages.append(diagnosticMessages_[i]);
+      }
+    }
+    if (messages.isEmpty()) {
+      QToolTip::hideText();
+      event->ignore();
+    } else {
+      QToolTip::showText(help->globalPos(), messages.join(QLatin1Char('\n')), viewport());
+    }
+    return true;
+  }
+  return QPlainTextEdit::viewportEvent(event);
+}
+
 void CodeEditor::resizeEvent(QResizeEvent* event) {
   QPlainTextEdit::resizeEvent(event);
 
@@ -1,9 +1,24 @@
 #pragma once
 
+#include <vector>
+
+#include <QList>
 #include <QPlainTextEdit>
+#include <QString>
+#include <QTextEdit>
 
 class LineNumberArea;
 
+// 编辑器中的一处诊断标记, 行列从 1 开始, 列按 UTF-8 字节计 (与编译器的 SourceLoc 一致)
+struct DiagnosticMark {
+  int line = 1;
+  int column = 1;
+  int endLine = 1;
+  int endColumn = 1;
+  bool error = true;
+  QString message;
+};
+
 class CodeEditor : public QPlainTextEdit {
   Q_OBJECT
 
@@ -14,8 +29,12 @@ class CodeEditor : public QPlainTextEdit {
   void setLineNumberFont(const QFont& font);
   void paintLineNumbers(QPaintEvent* event);
 
+  // 以波浪线标出诊断区间, 鼠标悬停时显示消息; 标记随后续编辑移动, 直到下一次设置
+  void setDiagnosticMarks(const std::vector<DiagnosticMark>& marks);
+
  protected:
   void resizeEvent(QResizeEvent* event) override;
+  bool viewportEvent(QEvent* event) override;
 
  private Q_SLOTS:
   void updateLineNumberAreaWidth(int newBlockCount = 0);
@@ -25,6 +44,8 @@ class CodeEditor : public QPlainTextEdit {
  private:
   QWidget* lineNumberArea_ = nullptr;
   QFont lineNumberFont_;
+  QList<QTextEdit::ExtraSelection> diagnosticSelections_;
+  QList<QString> diagnosticMessages_;
 };
 
 class LineNumberArea : public QWidget {
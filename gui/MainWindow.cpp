@@ -1,12 +1,13 @@
 #include "MainWindow.hpp"
+#include "AstDiagramView.hpp"
 #include "CodeEditor.hpp"
+#include "ResultModels.hpp"
 
 #include <QAbstractItemView>
 #include <QAction>
 #include <QApplication>
 #include <QCoreApplication>
 #include <QDateTime>
-#include <QDebug>
 #include <QDir>
 #include <QDockWidget>
 #include <QFile>
@@ -22,53 +23,59 @@
 #include <QPainter>
 #include <QLinearGradient>
 #include <QPlainTextEdit>
+#include <QProgressBar>
 #include <QResizeEvent>
 #include <QRegularExpression>
-#include <QScrollArea>
 #include <QSplitter>
 #include <QStatusBar>
 #include <QTabWidget>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QTextCursor>
+#include <QTableView>
 #include <QTextStream>
+#include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
 #include <QStringList>
 #include <QStandardPaths>
 
 #include <algorithm>
-#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <memory>
 #include <sstream>
 #include <type_traits>
 
 #include "pl0/AST.hpp"
 #include "pl0/Driver.hpp"
+#include "pl0/Incremental.hpp"
 #include "pl0/SymbolTable.hpp"
 #include "pl0/Token.hpp"
 
 namespace {
 
-struct TreeNode {
-  QString label;
-  std::vector<TreeNode> children;
-};
+// 工作线程每执行这么多条指令检查一次停止请求并取走新输出
+constexpr std::uint64_t kRunSlice = 1 << 16;
+// 向界面推送输出与进度的最短间隔, 避免事件队列被大量小块输出淹没
+constexpr std::chrono::milliseconds kOutputFlushInterval{50};
+// 最后一次按键后等待这么久再做实时语法检查
+constexpr std::chrono::milliseconds kLiveCheckDelay{200};
 
 QString binaryOpName(pl0::BinaryOp op);
 QString unaryOpName(pl0::UnaryOp op);
 QString assignmentOpName(pl0::AssignmentOperator op);
 
-TreeNode buildExpressionTree(const pl0::Expression& expr);
-TreeNode buildStatementTree(const pl0::Statement& stmt);
-TreeNode buildBlockTree(const pl0::Block& block);
-TreeNode buildProgramTree(const pl0::Program& program) {
-  TreeNode root;
+DiagramNode buildExpressionTree(const pl0::Expression& expr);
+DiagramNode buildStatementTree(const pl0::Statement& stmt);
+DiagramNode buildBlockTree(const pl0::Block& block);
+DiagramNode buildProgramTree(const pl0::Program& program) {
+  DiagramNode root;
   root.label = QObject::tr("Program");
   root.children.push_back(buildBlockTree(program.block));
   return root;
 }
 
-TreeNode buildExpressionTree(const pl0::Expression& expr) {
-  TreeNode node;
+DiagramNode buildExpressionTree(const pl0::Expression& expr) {
+  DiagramNode node;
   std::visit(
       [&](const auto& value) {
         using T = std::decay_t<decltype(value)>;
@@ -118,17 +125,17 @@ QString assignmentOpName(pl0::AssignmentOperator op) {
   return QObject::tr(":=");
 }
 
-TreeNode buildStatementTree(const pl0::Statement& stmt) {
+DiagramNode buildStatementTree(const pl0::Statement& stmt) {
   return std::visit(
-      [&](const auto& value) -> TreeNode {
+      [&](const auto& value) -> DiagramNode {
         using T = std::decay_t<decltype(value)>;
-        TreeNode node;
+        DiagramNode node;
         if constexpr (std::is_same_v<T, pl0::AssignmentStmt>) {
           node.label = QObject::tr("赋值(%1): %2")
                            .arg(assignmentOpName(value.op),
                                 QString::fromStdString(value.target));
           if (value.index) {
-            TreeNode indexNode;
+            DiagramNode indexNode;
             indexNode.label = QObject::tr("索引");
             indexNode.children.push_back(buildExpressionTree(*value.index));
             node.children.push_back(std::move(indexNode));
@@ -142,18 +149,18 @@ TreeNode buildStatementTree(const pl0::Statement& stmt) {
           }
         } else if constexpr (std::is_same_v<T, pl0::IfStmt>) {
           node.label = QObject::tr("条件语句");
-          TreeNode cond;
+          DiagramNode cond;
           cond.label = QObject::tr("条件");
           cond.children.push_back(buildExpressionTree(*value.condition));
           node.children.push_back(std::move(cond));
-          TreeNode thenNode;
+          DiagramNode thenNode;
           thenNode.label = QObject::tr("Then");
           for (const auto& s : value.then_branch) {
             thenNode.children.push_back(buildStatementTree(*s));
           }
           node.children.push_back(std::move(thenNode));
           if (!value.else_branch.empty()) {
-            TreeNode elseNode;
+            DiagramNode elseNode;
             elseNode.label = QObject::tr("Else");
             for (const auto& s : value.else_branch) {
               elseNode.children.push_back(buildStatementTree(*s));
@@ -162,11 +169,11 @@ TreeNode buildStatementTree(const pl0::Statement& stmt) {
           }
         } else if constexpr (std::is_same_v<T, pl0::WhileStmt>) {
           node.label = QObject::tr("当型循环");
-          TreeNode cond;
+          DiagramNode cond;
           cond.label = QObject::tr("条件");
           cond.children.push_back(buildExpressionTree(*value.condition));
           node.children.push_back(std::move(cond));
-          TreeNode body;
+          DiagramNode body;
           body.label = QObject::tr("循环体");
           for (const auto& s : value.body) {
             body.children.push_back(buildStatementTree(*s));
@@ -174,20 +181,20 @@ TreeNode buildStatementTree(const pl0::Statement& stmt) {
           node.children.push_back(std::move(body));
         } else if constexpr (std::is_same_v<T, pl0::RepeatStmt>) {
           node.label = QObject::tr("重复循环");
-          TreeNode body;
+          DiagramNode body;
           body.label = QObject::tr("循环体");
           for (const auto& s : value.body) {
             body.children.push_back(buildStatementTree(*s));
           }
           node.children.push_back(std::move(body));
-          TreeNode until;
+          DiagramNode until;
           until.label = QObject::tr("直到");
           until.children.push_back(buildExpressionTree(*value.condition));
           node.children.push_back(std::move(until));
         } else if constexpr (std::is_same_v<T, pl0::ReadStmt>) {
           node.label = QObject::tr("读入");
           for (const auto& target : value.targets) {
-            TreeNode child;
+            DiagramNode child;
             child.label = QString::fromStdString(target);
             node.children.push_back(std::move(child));
           }
@@ -198,7 +205,7 @@ TreeNode buildStatementTree(const pl0::Statement& stmt) {
             node.children.push_back(buildExpressionTree(*exprPtr));
           }
           if (value.newline) {
-            TreeNode newlineNode;
+            DiagramNode newlineNode;
             newlineNode.label = QObject::tr("换行");
             node.children.push_back(std::move(newlineNode));
           }
@@ -213,39 +220,40 @@ TreeNode buildStatementTree(const pl0::Statement& stmt) {
       stmt.value);
 }
 
-TreeNode buildBlockTree(const pl0::Block& block) {
-  TreeNode node;
+DiagramNode buildBlockTree(const pl0::Block& block) {
+  DiagramNode node;
   node.label = QObject::tr("Block");
   if (!block.consts.empty()) {
-    TreeNode constNode;
+    DiagramNode constNode;
     constNode.label = QObject::tr("常量");
     for (const auto& c : block.consts) {
-      TreeNode child;
+      DiagramNode child;
       child.label = QString::fromStdString(c.name + " = " + std::to_string(c.value));
       constNode.children.push_back(std::move(child));
     }
     node.children.push_back(std::move(constNode));
   }
   if (!block.vars.empty()) {
-    TreeNode varNode;
+    DiagramNode varNode;
     varNode.label = QObject::tr("变量");
     for (const auto& v : block.vars) {
       QString label = QString::fromStdString(v.name);
       if (v.array_size) {
         label += QStringLiteral("[%1]").arg(static_cast<unsigned>(*v.array_size));
       }
-      TreeNode child;
+      DiagramNode child;
       child.label = label;
       varNode.children.push_back(std::move(child));
     }
     node.children.push_back(std::move(varNode));
   }
   if (!block.procedures.empty()) {
-    TreeNode procNode;
+    DiagramNode procNode;
     procNode.label = QObject::tr("过程");
     for (const auto& proc : block.procedures) {
-      TreeNode child;
-      child.label = QObject::tr("过程: %1").arg(QString::fromStdString(proc.name));
+      DiagramNode child;
+      child.label = (proc.is_function ? QObject::tr("函数: %1") : QObject::tr("过程: %1"))
+                        .arg(QString::fromStdString(proc.name));
       if (proc.body) {
         child.children.push_back(buildBlockTree(*proc.body));
       }
@@ -254,7 +262,7 @@ TreeNode buildBlockTree(const pl0::Block& block) {
     node.children.push_back(std::move(procNode));
   }
   if (!block.statements.empty()) {
-    TreeNode stmts;
+    DiagramNode stmts;
     stmts.label = QObject::tr("语句");
     for (const auto& stmt : block.statements) {
       stmts.children.push_back(buildStatementTree(*stmt));
@@ -264,85 +272,6 @@ TreeNode buildBlockTree(const pl0::Block& block) {
   return node;
 }
 
-struct LayoutNode {
-  TreeNode data;
-  std::vector<LayoutNode> children;
-  double subtreeWidth = 0.0;
-  QRectF rect;
-};
-
-double prepareLayout(LayoutNode& layout, const TreeNode& node,
-                     const QFontMetrics& metrics, double hSpacing,
-                     double vSpacing) {
-  layout.data = node;
-  layout.children.resize(node.children.size());
-  const double paddingX = 28.0;
-  const double paddingY = 20.0;
-  const QSize textSize = metrics.size(Qt::TextSingleLine, node.label);
-  layout.rect.setSize(QSizeF(textSize.width() + paddingX,
-                             textSize.height() + paddingY));
-
-  if (layout.children.empty()) {
-    layout.subtreeWidth = layout.rect.width();
-    return layout.subtreeWidth;
-  }
-
-  double totalChildrenWidth = 0.0;
-  for (std::size_t i = 0; i < node.children.size(); ++i) {
-    totalChildrenWidth += prepareLayout(layout.children[i], node.children[i],
-                                        metrics, hSpacing, vSpacing);
-  }
-  if (!layout.children.empty()) {
-    totalChildrenWidth += hSpacing * (layout.children.size() - 1);
-  }
-  layout.subtreeWidth = std::max(layout.rect.width(), totalChildrenWidth);
-  return layout.subtreeWidth;
-}
-
-double assignPositions(LayoutNode& layout, double left, double top,
-                       double hSpacing, double vSpacing) {
-  layout.rect.moveTo(left + (layout.subtreeWidth - layout.rect.width()) / 2.0,
-                     top);
-  double bottom = layout.rect.bottom();
-
-  if (layout.children.empty()) {
-    return bottom;
-  }
-
-  double combinedWidth = 0.0;
-  for (const auto& child : layout.children) {
-    combinedWidth += child.subtreeWidth;
-  }
-  combinedWidth += hSpacing * (layout.children.size() - 1);
-
-  double currentLeft = left + (layout.subtreeWidth - combinedWidth) / 2.0;
-  const double childTop = layout.rect.bottom() + vSpacing;
-  for (auto& child : layout.children) {
-    bottom = std::max(
-        bottom, assignPositions(child, currentLeft, childTop, hSpacing, vSpacing));
-    currentLeft += child.subtreeWidth + hSpacing;
-  }
-  return bottom;
-}
-
-void drawLayout(QPainter& painter, const LayoutNode& layout, const QFont& font) {
-  painter.setPen(QPen(QColor(153, 169, 205), 1.2, Qt::SolidLine, Qt::RoundCap));
-  painter.setBrush(QColor(244, 247, 255, 235));
-  QRectF rect = layout.rect;
-  painter.drawRoundedRect(rect, 10, 10);
-  painter.setPen(QColor(40, 53, 85));
-  painter.setFont(font);
-  painter.drawText(rect, Qt::AlignCenter, layout.data.label);
-
-  painter.setPen(QPen(QColor(185, 196, 221), 1.0, Qt::SolidLine, Qt::RoundCap));
-  for (const auto& child : layout.children) {
-    QPointF from(rect.center().x(), rect.bottom());
-    QPointF to(child.rect.center().x(), child.rect.top());
-    painter.drawLine(from, to);
-    drawLayout(painter, child, font);
-  }
-}
-
 QString diagnosticLevelToString(pl0::DiagnosticLevel level) {
   switch (level) {
     case pl0::DiagnosticLevel::Error:
@@ -355,12 +284,6 @@ QString diagnosticLevelToString(pl0::DiagnosticLevel level) {
   return QObject::tr("未知");
 }
 
-QString sourceRangeToString(const pl0::SourceRange& range) {
-  return QString::asprintf("%zu:%zu-%zu:%zu", range.begin.line,
-                           range.begin.column, range.end.line,
-                           range.end.column);
-}
-
 QString binaryOpName(pl0::BinaryOp op) {
   using pl0::BinaryOp;
   switch (op) {
@@ -409,17 +332,20 @@ QString unaryOpName(pl0::UnaryOp op) {
   return QObject::tr("未知一元操作");
 }
 
-class StreamRedirector {
- public:
-  StreamRedirector(std::ios& stream, std::streambuf* new_buffer)
-      : stream_(stream), old_buffer_(stream.rdbuf(new_buffer)) {}
-
-  ~StreamRedirector() { stream_.rdbuf(old_buffer_); }
-
- private:
-  std::ios& stream_;
-  std::streambuf* old_buffer_ = nullptr;
-};
+// 只读的虚拟化表格: 固定行高, 视图无需逐行测量即可滚动到任意位置
+QTableView* createResultTable(QAbstractItemModel* model, QWidget* parent) {
+  auto* table = new QTableView(parent);
+  table->setModel(model);
+  table->horizontalHeader()->setStretchLastSection(true);
+  table->verticalHeader()->setVisible(false);
+  table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  table->setSelectionBehavior(QAbstractItemView::SelectRows);
+  table->setAlternatingRowColors(true);
+  table->setWordWrap(false);
+  table->setStyleSheet(QStringLiteral("QTableView { alternate-background-color: #f2f5ff; }"));
+  return table;
+}
 
 }  // namespace
 
@@ -428,6 +354,18 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent) {
   setupMenus();
   setupConnections();
   updateWindowTitle();
+  setBusy(false, false);
+}
+
+MainWindow::~MainWindow() {
+  // 工作线程持有 this, 必须在成员析构前结束; 运行中的程序在下一个分片处停止
+  cancelRun_ = true;
+  if (runWorker_.joinable()) {
+    runWorker_.join();
+  }
+  if (compileWorker_.joinable()) {
+    compileWorker_.join();
+  }
 }
 
 void MainWindow::setupUi() {
@@ -444,7 +382,7 @@ void MainWindow::setupUi() {
   setStyleSheet(QStringLiteral(
       "QMainWindow { background-color: #ffffff; color: #2f2f2f; }\n"
       "QPlainTextEdit { background-color: rgba(255,255,255,0.92); color: #1d1d1d; border: 1px solid #d8dbe8; border-radius: 6px; padding: 8px; }\n"
-      "QTableWidget { background-color: rgba(255,255,255,0.9); color: #1d1d1d; gridline-color: #e5e7f2; selection-background-color: #d2e1ff; selection-color: #142952; }\n"
+      "QTableView { background-color: rgba(255,255,255,0.9); color: #1d1d1d; gridline-color: #e5e7f2; selection-background-color: #d2e1ff; selection-color: #142952; }\n"
       "QTreeWidget { background-color: rgba(255,255,255,0.9); color: #1d1d1d; border: 1px solid #d8dbe8; border-radius: 6px; }\n"
       "QHeaderView::section { background-color: #f5f7ff; color: #20243a; border: 1px solid #e2e4f0; padding: 6px; font-weight: 600; }\n"
       "QStatusBar { background-color: rgba(245,245,249,0.88); color: #2f2f2f; border-top: 1px solid #e6e7ef; }\n"
@@ -511,46 +449,20 @@ void MainWindow::setupUi() {
   rightTabs_ = new QTabWidget(splitter);
   rightTabs_->setElideMode(Qt::ElideRight);
 
-  tokensTable_ = new QTableWidget(rightTabs_);
-  tokensTable_->setColumnCount(5);
-  tokensTable_->setHorizontalHeaderLabels(
-      {tr("索引"), tr("类型"), tr("词素"), tr("范围"), tr("值")});
-  tokensTable_->horizontalHeader()->setStretchLastSection(true);
-  tokensTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
-  tokensTable_->setSelectionBehavior(QAbstractItemView::SelectRows);
-  tokensTable_->setAlternatingRowColors(true);
-  tokensTable_->setStyleSheet(tokensTable_->styleSheet() +
-                              "QTableWidget { alternate-background-color: #f2f5ff; }");
+  tokensModel_ = new TokenTableModel(this);
+  tokensTable_ = createResultTable(tokensModel_, rightTabs_);
   rightTabs_->addTab(tokensTable_, tr("词法单元"));
 
-  astImageScroll_ = new QScrollArea(rightTabs_);
-  astImageScroll_->setWidgetResizable(true);
-  astImageScroll_->setFrameShape(QFrame::NoFrame);
-  astImageLabel_ = new QLabel(astImageScroll_);
-  astImageLabel_->setAlignment(Qt::AlignCenter);
-  astImageLabel_->setBackgroundRole(QPalette::Base);
-  astImageLabel_->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
-  astImageScroll_->setWidget(astImageLabel_);
-  rightTabs_->addTab(astImageScroll_, tr("语法树图"));
-
-  symbolsTable_ = new QTableWidget(rightTabs_);
-  symbolsTable_->setColumnCount(7);
-  symbolsTable_->setHorizontalHeaderLabels(
-      {tr("名称"), tr("种类"), tr("类型"), tr("层次"), tr("地址"),
-       tr("大小"), tr("传值")});
-  symbolsTable_->horizontalHeader()->setStretchLastSection(true);
-  symbolsTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
-  symbolsTable_->setSelectionBehavior(QAbstractItemView::SelectRows);
-  symbolsTable_->setAlternatingRowColors(true);
-  symbolsTable_->setStyleSheet(symbolsTable_->styleSheet() +
-                               "QTableWidget { alternate-background-color: #f2f5ff; }");
+  astView_ = new AstDiagramView(rightTabs_);
+  rightTabs_->addTab(astView_, tr("语法树图"));
+
+  symbolsModel_ = new SymbolTableModel(this);
+  symbolsTable_ = createResultTable(symbolsModel_, rightTabs_);
   rightTabs_->addTab(symbolsTable_, tr("符号表"));
 
-  pcodeEdit_ = new CodeEditor(rightTabs_);
-  pcodeEdit_->setReadOnly(true);
-  pcodeEdit_->setFont(baseMonospaceFont_);
-  pcodeEdit_->setLineNumberFont(baseMonospaceFont_);
-  rightTabs_->addTab(pcodeEdit_, tr("P-Code"));
+  pcodeModel_ = new PCodeTableModel(this);
+  pcodeTable_ = createResultTable(pcodeModel_, rightTabs_);
+  rightTabs_->addTab(pcodeTable_, tr("P-Code"));
 
   diagnosticsEdit_ = new CodeEditor(rightTabs_);
   diagnosticsEdit_->setReadOnly(true);
@@ -596,6 +508,19 @@ void MainWindow::setupUi() {
   backgroundLabel_->setPixmap(backgroundPixmap_.scaled(backgroundLabel_->size(), Qt::KeepAspectRatio,
                                                        Qt::SmoothTransformation));
 
+  progressBar_ = new QProgressBar(this);
+  progressBar_->setRange(0, 0);
+  progressBar_->setMaximumWidth(160);
+  progressBar_->setTextVisible(false);
+  statusBar()->addPermanentWidget(progressBar_);
+  liveStatusLabel_ = new QLabel(this);
+  statusBar()->addPermanentWidget(liveStatusLabel_);
+
+  liveParser_ = std::make_unique<pl0::IncrementalParser>();
+  liveCheckTimer_ = new QTimer(this);
+  liveCheckTimer_->setSingleShot(true);
+  liveCheckTimer_->setInterval(kLiveCheckDelay);
+
   statusBar()->showMessage(tr("准备就绪"));
   updateFonts();
   relayoutOverlays();
@@ -609,6 +534,7 @@ void MainWindow::setupMenus() {
   saveAction_->setShortcut(QKeySequence::Save);
   saveAsAction_ = fileMenu_->addAction(tr("另存为..."));
   saveAsAction_->setShortcut(QKeySequence::SaveAs);
+  exportAstAction_ = fileMenu_->addAction(tr("导出语法树图..."));
   fileMenu_->addSeparator();
   exitAction_ = fileMenu_->addAction(tr("退出"));
 
@@ -619,6 +545,8 @@ void MainWindow::setupMenus() {
   runAction_->setShortcut(Qt::CTRL | Qt::Key_R);
   compileRunAction_ = buildMenu_->addAction(tr("编译并运行"));
   compileRunAction_->setShortcut(Qt::CTRL | Qt::Key_E);
+  stopAction_ = buildMenu_->addAction(tr("停止运行"));
+  stopAction_->setShortcut(Qt::CTRL | Qt::Key_Period);
 
   optionsMenu_ = menuBar()->addMenu(tr("选项"));
   boundsCheckAction_ = optionsMenu_->addAction(tr("启用数组越界检查"));
@@ -634,13 +562,14 @@ void MainWindow::setupMenus() {
   mainToolBar_->addAction(compileAction_);
   mainToolBar_->addAction(runAction_);
   mainToolBar_->addAction(compileRunAction_);
+  mainToolBar_->addAction(stopAction_);
   mainToolBar_->addSeparator();
   mainToolBar_->addAction(boundsCheckAction_);
   mainToolBar_->addAction(traceVmAction_);
 
   toolbarWidgets_.clear();
   for (QAction* action :
-       {openAction_, saveAction_, compileAction_, runAction_, compileRunAction_,
+       {openAction_, saveAction_, compileAction_, runAction_, compileRunAction_, stopAction_,
         boundsCheckAction_, traceVmAction_}) {
     if (QWidget* w = mainToolBar_->widgetForAction(action)) {
       toolbarWidgets_.append(w);
@@ -650,16 +579,43 @@ void MainWindow::setupMenus() {
   connect(openAction_, &QAction::triggered, this, &MainWindow::openFile);
   connect(saveAction_, &QAction::triggered, this, &MainWindow::saveFile);
   connect(saveAsAction_, &QAction::triggered, this, &MainWindow::saveFileAs);
+  connect(exportAstAction_, &QAction::triggered, this, &MainWindow::exportAstImage);
   connect(exitAction_, &QAction::triggered, this, &QWidget::close);
   connect(compileAction_, &QAction::triggered, this, &MainWindow::compileSource);
   connect(runAction_, &QAction::triggered, this, &MainWindow::runProgram);
   connect(compileRunAction_, &QAction::triggered, this, &MainWindow::compileAndRun);
+  connect(stopAction_, &QAction::triggered, this, &MainWindow::stopExecution);
   updateFonts();
 }
 
 void MainWindow::setupConnections() {
   connect(sourceEdit_, &QPlainTextEdit::textChanged, this,
           &MainWindow::markDocumentDirty);
+  connect(sourceEdit_, &QPlainTextEdit::textChanged, liveCheckTimer_,
+          qOverload<>(&QTimer::start));
+  connect(liveCheckTimer_, &QTimer::timeout, this, &MainWindow::refreshLiveDiagnostics);
+}
+
+void MainWindow::refreshLiveDiagnostics() {
+  // 与上一次的文本比较得出编辑区间, 只重新扫描受影响的 Token 并重解析所在语句或过程
+  liveParser_->update(sourceEdit_->toPlainText().toStdString());
+  std::vector<DiagnosticMark> marks;
+  std::size_t errors = 0;
+  for (const auto& diag : liveParser_->diagnostics()) {
+    const bool isError = diag.level == pl0::DiagnosticLevel::Error;
+    errors += isError ? 1 : 0;
+    DiagnosticMark mark;
+    mark.line = static_cast<int>(diag.range.begin.line);
+    mark.column = static_cast<int>(diag.range.begin.column);
+    mark.endLine = static_cast<int>(diag.range.end.line);
+    mark.endColumn = static_cast<int>(diag.range.end.column);
+    mark.error = isError;
+    mark.message = QString::fromStdString(diag.message);
+    marks.push_back(std::move(mark));
+  }
+  sourceEdit_->setDiagnosticMarks(marks);
+  liveStatusLabel_->setText(errors == 0 ? tr("语法检查通过")
+                                        : tr("语法错误 %1 处").arg(errors));
 }
 
 void MainWindow::updateFonts() {
@@ -674,8 +630,6 @@ void MainWindow::updateFonts() {
   mono.setPointSizeF(std::max(18.0, baseMonospaceFont_.pointSizeF() * scale));
   sourceEdit_->setFont(mono);
   sourceEdit_->setLineNumberFont(mono);
-  pcodeEdit_->setFont(mono);
-  pcodeEdit_->setLineNumberFont(mono);
   diagnosticsEdit_->setFont(mono);
   diagnosticsEdit_->setLineNumberFont(mono);
   vmOutputEdit_->setFont(mono);
@@ -692,9 +646,17 @@ void MainWindow::updateFonts() {
   tokensTable_->horizontalHeader()->setFont(ui);
   symbolsTable_->setFont(tableFont);
   symbolsTable_->horizontalHeader()->setFont(ui);
-  if (astImageLabel_) {
-    astImageLabel_->setFont(ui);
+  pcodeTable_->setFont(mono);
+  pcodeTable_->horizontalHeader()->setFont(ui);
+  // 固定行高依赖字体, 字体变化后重新设定
+  for (QTableView* table : {tokensTable_, symbolsTable_, pcodeTable_}) {
+    table->verticalHeader()->setDefaultSectionSize(table->fontMetrics().height() + 8);
   }
+  // 语法树图字体只在字号实际变化时更新, 避免窗口拖动时反复重新布局
+  QFont diagramFont = baseUiFont_;
+  diagramFont.setPointSizeF(
+      std::round(std::max(12.0, baseUiFont_.pointSizeF() * scale) * 2.0) / 2.0);
+  astView_->setDiagramFont(diagramFont);
 
   QFont menuFont = originalUiFont_;
   menuFont.setPointSize(originalUiFont_.pointSize() + 2);
@@ -714,8 +676,8 @@ void MainWindow::updateFonts() {
       widget->setFont(menuFont);
     }
   }
-  for (QAction* action : {openAction_, saveAction_, saveAsAction_, exitAction_,
-                          compileAction_, runAction_, compileRunAction_,
+  for (QAction* action : {openAction_, saveAction_, saveAsAction_, exportAstAction_,
+                          exitAction_, compileAction_, runAction_, compileRunAction_,
                           boundsCheckAction_, traceVmAction_}) {
     if (action) {
       action->setFont(menuFont);
@@ -729,10 +691,6 @@ void MainWindow::updateFonts() {
     watermarkLabel_->adjustSize();
   }
 
-  if (lastResult_ && lastResult_->program) {
-    updateAstDiagram(*lastResult_->program);
-  }
-
   relayoutOverlays();
 }
 
@@ -770,80 +728,44 @@ void MainWindow::relayoutOverlays() {
 }
 
 void MainWindow::updateAstDiagram(const pl0::Program& program) {
-  if (!astImageLabel_) {
-    return;
-  }
-  QFont diagramFont = baseUiFont_;
-  diagramFont.setPointSizeF(std::max(12.0, baseUiFont_.pointSizeF() *
-                                             std::clamp(static_cast<double>(width()) /
-                                                            static_cast<double>(initialWindowSize_.width()),
-                                                        0.85, 1.5)));
-  QPixmap pixmap = createAstPixmap(program, diagramFont);
-  if (!pixmap.isNull()) {
-    astImageLabel_->setPixmap(pixmap);
-    astImageLabel_->setMinimumSize(pixmap.size());
-    exportAstImage(pixmap);
-  } else {
-    astImageLabel_->clear();
-    astImageLabel_->setMinimumSize(QSize(0, 0));
-  }
-}
-
-QPixmap MainWindow::createAstPixmap(const pl0::Program& program,
-                                    const QFont& font) const {
-  TreeNode root = buildProgramTree(program);
-  LayoutNode layout;
-  const double hSpacing = 48.0;
-  const double vSpacing = 90.0;
-  const double margin = 48.0;
-  QFontMetrics metrics(font);
-  prepareLayout(layout, root, metrics, hSpacing, vSpacing);
-  double bottom = assignPositions(layout, 0.0, 0.0, hSpacing, vSpacing);
-  const QSizeF imageSize(layout.subtreeWidth + margin * 2,
-                         bottom + metrics.height() + margin * 2);
-  QPixmap pixmap(imageSize.toSize());
-  pixmap.fill(Qt::transparent);
-
-  QPainter painter(&pixmap);
-  painter.setRenderHints(QPainter::Antialiasing | QPainter::TextAntialiasing);
-  painter.translate(margin, margin);
-  drawLayout(painter, layout, font);
-  return pixmap;
+  astView_->setTree(buildProgramTree(program));
 }
 
-void MainWindow::exportAstImage(const QPixmap& pixmap) const {
-  if (pixmap.isNull()) {
+void MainWindow::exportAstImage() {
+  if (!astView_->hasTree()) {
+    QMessageBox::information(this, tr("无法导出"), tr("请先成功编译程序。"));
     return;
   }
-  QString outputPath;
+  QString suggested;
   if (!currentFilePath_.isEmpty()) {
     QFileInfo info(currentFilePath_);
-    if (info.absolutePath().isEmpty()) {
-      return;
-    }
-    outputPath =
-        info.absolutePath() + QLatin1Char('/') + info.completeBaseName() + QStringLiteral(".png");
+    suggested = info.absolutePath() + QLatin1Char('/') + info.completeBaseName() +
+                QStringLiteral(".png");
   } else {
     QString basePath = QStandardPaths::writableLocation(QStandardPaths::PicturesLocation);
     if (basePath.isEmpty()) {
       basePath = QDir::homePath();
     }
-    QDir exportDir(basePath);
-    if (!exportDir.exists(QStringLiteral("PL0_AST"))) {
-      exportDir.mkpath(QStringLiteral("PL0_AST"));
-    }
-    const QString fallbackName =
-        QStringLiteral("ast_%1").arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss")));
-    outputPath = exportDir.filePath(QStringLiteral("PL0_AST/%1.png").arg(fallbackName));
+    suggested = QDir(basePath).filePath(
+        QStringLiteral("ast_%1.png")
+            .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd_HHmmss"))));
   }
-  if (pixmap.save(outputPath, "PNG")) {
-    if (auto* status = const_cast<MainWindow*>(this)->statusBar()) {
-      status->showMessage(tr("已导出语法树图: %1").arg(QDir::toNativeSeparators(outputPath)), 5000);
-    }
-    qInfo() << "AST exported to" << QDir::toNativeSeparators(outputPath);
-  } else {
-    qWarning() << "Failed to export AST image to" << outputPath;
+  const QString outputPath = QFileDialog::getSaveFileName(
+      this, tr("导出语法树图"), suggested, tr("PNG 图片 (*.png)"));
+  if (outputPath.isEmpty()) {
+    return;
+  }
+  double scale = 1.0;
+  if (!astView_->exportImage(outputPath, &scale)) {
+    QMessageBox::warning(this, tr("导出失败"),
+                         tr("无法写入 %1").arg(QDir::toNativeSeparators(outputPath)));
+    return;
+  }
+  QString message = tr("已导出语法树图: %1").arg(QDir::toNativeSeparators(outputPath));
+  if (scale < 1.0) {
+    message += tr(" (图像过大, 已缩放至 %1%)").arg(qRound(scale * 100.0));
   }
+  statusBar()->showMessage(message, 5000);
 }
 
 void MainWindow::resizeEvent(QResizeEvent* event) {
@@ -928,64 +850,100 @@ bool MainWindow::promptToSave() {
 }
 
 void MainWindow::compileSource() {
-  compileInternal(false);
+  startCompile(false);
 }
 
 void MainWindow::compileAndRun() {
-  if (compileInternal(false)) {
-    executeCompiledProgram();
-  }
+  startCompile(true);
 }
 
 void MainWindow::runProgram() {
   if (!lastResult_ || !lastResult_->code.size()) {
-    if (!compileInternal(false)) {
-      return;
-    }
+    startCompile(true);
+    return;
   }
   executeCompiledProgram();
 }
 
-bool MainWindow::compileInternal(bool quiet) {
-  pl0::CompilerOptions options;
-  options.enable_bounds_check = boundsCheckAction_->isChecked();
+void MainWindow::stopExecution() {
+  if (running_) {
+    cancelRun_ = true;
+    statusBar()->showMessage(tr("正在停止..."));
+  }
+}
 
-  pl0::DiagnosticSink diagnostics;
-  const std::string source = sourceEdit_->toPlainText().toStdString();
-  const std::string name = currentFilePath_.isEmpty()
-                               ? std::string("<memory>")
-                               : currentFilePath_.toStdString();
+void MainWindow::setBusy(bool compiling, bool running) {
+  compiling_ = compiling;
+  running_ = running;
+  const bool busy = compiling || running;
+  compileAction_->setEnabled(!busy);
+  runAction_->setEnabled(!busy);
+  compileRunAction_->setEnabled(!busy);
+  stopAction_->setEnabled(running);
+  progressBar_->setVisible(busy);
+}
 
-  pl0::CompileResult result =
-      pl0::compile_source_text(name, source, options, diagnostics);
+void MainWindow::startCompile(bool runAfterCompile) {
+  if (compiling_ || running_) {
+    return;
+  }
+  // 上一次编译的线程已经投递完结果, 这里只回收
+  if (compileWorker_.joinable()) {
+    compileWorker_.join();
+  }
 
+  pl0::CompilerOptions options;
+  options.enable_bounds_check = boundsCheckAction_->isChecked();
+  std::string source = sourceEdit_->toPlainText().toStdString();
+  std::string name = currentFilePath_.isEmpty() ? std::string("<memory>")
+                                                : currentFilePath_.toStdString();
+
+  setBusy(true, false);
+  statusBar()->showMessage(tr("正在编译..."));
+  compileWorker_ = std::thread([this, options, source = std::move(source),
+                                name = std::move(name), runAfterCompile] {
+    auto diagnostics = std::make_shared<pl0::DiagnosticSink>();
+    auto result = std::make_shared<pl0::CompileResult>();
+    try {
+      *result = pl0::compile_source_text(name, source, options, *diagnostics);
+    } catch (const std::exception& ex) {
+      diagnostics->report({pl0::DiagnosticLevel::Error, pl0::DiagnosticCode::InternalError,
+                           ex.what(), {}});
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, result, diagnostics, runAfterCompile] {
+          setBusy(false, false);
+          if (applyCompileResult(std::move(*result), *diagnostics) && runAfterCompile) {
+            executeCompiledProgram();
+          }
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+bool MainWindow::applyCompileResult(pl0::CompileResult result,
+                                    const pl0::DiagnosticSink& diagnostics) {
   populateDiagnostics(diagnostics);
-  populateTokens(result.tokens);
+  auto shared = std::make_shared<const pl0::CompileResult>(std::move(result));
+  tokensModel_->setResult(shared);
 
   if (diagnostics.has_errors()) {
-    lastResult_ = std::move(result);
+    lastResult_ = std::move(shared);
     displayCompileFailure();
-    if (!quiet) {
-      statusBar()->showMessage(tr("编译失败"), 5000);
-    }
-    if (astImageLabel_) {
-      astImageLabel_->clear();
-      astImageLabel_->setMinimumSize(QSize(0, 0));
-    }
+    statusBar()->showMessage(tr("编译失败"), 5000);
     return false;
   }
 
-  if (result.program) {
-    updateAstDiagram(*result.program);
+  if (shared->program) {
+    updateAstDiagram(*shared->program);
   }
-  populateSymbols(result.symbols);
-  populatePCode(result.code);
+  symbolsModel_->setResult(shared);
+  pcodeModel_->setResult(shared);
   vmOutputEdit_->clear();
 
-  lastResult_ = std::move(result);
-  if (!quiet) {
-    statusBar()->showMessage(tr("编译成功"), 4000);
-  }
+  lastResult_ = std::move(shared);
+  statusBar()->showMessage(tr("编译成功"), 4000);
   return true;
 }
 
@@ -994,21 +952,85 @@ void MainWindow::executeCompiledProgram() {
     QMessageBox::information(this, tr("无法运行"), tr("当前程序尚未成功编译。"));
     return;
   }
+  if (compiling_ || running_) {
+    return;
+  }
+  if (runWorker_.joinable()) {
+    runWorker_.join();
+  }
 
   pl0::RunnerOptions runOptions;
   runOptions.trace_vm = traceVmAction_->isChecked();
   runOptions.enable_bounds_check = boundsCheckAction_->isChecked();
 
-  pl0::DiagnosticSink runtimeDiagnostics;
-  std::istringstream input(stdinEdit_->toPlainText().toStdString());
-  std::ostringstream output;
+  // 运行期间可能重新编译, 工作线程共享持有本次编译结果
+  std::shared_ptr<const pl0::CompileResult> compiled = lastResult_;
+  std::string input = stdinEdit_->toPlainText().toStdString();
 
-  StreamRedirector cinRedirect(std::cin, input.rdbuf());
-  StreamRedirector coutRedirect(std::cout, output.rdbuf());
+  vmOutputEdit_->clear();
+  cancelRun_ = false;
+  setBusy(false, true);
+  statusBar()->showMessage(tr("正在运行..."));
+  runWorker_ = std::thread([this, compiled, input = std::move(input), runOptions] {
+    auto diagnostics = std::make_shared<pl0::DiagnosticSink>();
+    std::istringstream in(input);
+    std::ostringstream out;
+    pl0::VirtualMachine vm(*diagnostics, runOptions);
+    vm.set_io(in, out);
+    vm.start(compiled->code);
+
+    std::string output;
+    std::string pending;
+    auto lastFlush = std::chrono::steady_clock::now();
+    pl0::VirtualMachine::Result result;
+    bool cancelled = false;
+    while (true) {
+      result = vm.run_for(kRunSlice);
+      std::string chunk = out.str();
+      out.str(std::string());
+      output += chunk;
+      pending += chunk;
+      if (result.status != pl0::VirtualMachine::Result::Status::Suspended) {
+        break;
+      }
+      if (cancelRun_) {
+        cancelled = true;
+        break;
+      }
+      const auto now = std::chrono::steady_clock::now();
+      if (now - lastFlush >= kOutputFlushInterval) {
+        lastFlush = now;
+        QMetaObject::invokeMethod(
+            this,
+            [this, chunk = std::move(pending), instructions = result.instructions] {
+              appendVmOutput(chunk, instructions);
+            },
+            Qt::QueuedConnection);
+        pending.clear();
+      }
+    }
+    QMetaObject::invokeMethod(
+        this,
+        [this, output = std::move(output), diagnostics, result, cancelled] {
+          finishExecution(output, *diagnostics, result, cancelled);
+        },
+        Qt::QueuedConnection);
+  });
+}
 
-  auto vmResult = pl0::run_instructions(lastResult_->code, runtimeDiagnostics, runOptions);
+void MainWindow::appendVmOutput(const std::string& chunk, std::uint64_t instructions) {
+  if (!chunk.empty()) {
+    vmOutputEdit_->moveCursor(QTextCursor::End);
+    vmOutputEdit_->insertPlainText(QString::fromStdString(chunk));
+  }
+  statusBar()->showMessage(tr("正在运行... 已执行 %1 条指令").arg(instructions));
+}
 
-  populateVmOutput(output.str());
+void MainWindow::finishExecution(const std::string& output,
+                                 const pl0::DiagnosticSink& runtimeDiagnostics,
+                                 const pl0::VirtualMachine::Result& vmResult, bool cancelled) {
+  setBusy(false, false);
+  populateVmOutput(output);
 
   if (!runtimeDiagnostics.diagnostics().empty()) {
     QString text = diagnosticsEdit_->toPlainText();
@@ -1030,7 +1052,9 @@ void MainWindow::executeCompiledProgram() {
   diagnosticsEdit_->setPlainText(resultText);
   }
 
-  if (vmResult.success) {
+  if (cancelled) {
+    statusBar()->showMessage(tr("运行已停止，已执行 %1 条指令").arg(vmResult.instructions), 5000);
+  } else if (vmResult.success) {
     statusBar()->showMessage(tr("运行完成，最后结果 = %1").arg(vmResult.last_value),
                              4000);
   } else {
@@ -1039,66 +1063,10 @@ void MainWindow::executeCompiledProgram() {
 }
 
 void MainWindow::displayCompileFailure() {
-  symbolsTable_->setRowCount(0);
-  pcodeEdit_->clear();
+  symbolsModel_->setResult(nullptr);
+  pcodeModel_->setResult(nullptr);
   vmOutputEdit_->clear();
-  if (astImageLabel_) {
-    astImageLabel_->clear();
-    astImageLabel_->setMinimumSize(QSize(0, 0));
-  }
-}
-
-void MainWindow::populateTokens(const std::vector<pl0::Token>& tokens) {
-  tokensTable_->setRowCount(static_cast<int>(tokens.size()));
-  for (int row = 0; row < static_cast<int>(tokens.size()); ++row) {
-    const auto& token = tokens[static_cast<std::size_t>(row)];
-    tokensTable_->setItem(row, 0,
-                          new QTableWidgetItem(QString::number(row)));
-    tokensTable_->setItem(row, 1,
-                          new QTableWidgetItem(tokenKindToString(token.kind)));
-    tokensTable_->setItem(row, 2,
-                          new QTableWidgetItem(QString::fromStdString(token.lexeme)));
-    tokensTable_->setItem(row, 3,
-                          new QTableWidgetItem(sourceRangeToString(token.range)));
-    QString value;
-    if (token.number) {
-      value = QString::number(*token.number);
-    } else if (token.boolean) {
-      value = *token.boolean ? tr("true") : tr("false");
-    }
-    tokensTable_->setItem(row, 4, new QTableWidgetItem(value));
-  }
-}
-
-void MainWindow::populateSymbols(const std::vector<pl0::Symbol>& symbols) {
-  symbolsTable_->setRowCount(static_cast<int>(symbols.size()));
-  for (int row = 0; row < static_cast<int>(symbols.size()); ++row) {
-    const auto& symbol = symbols[static_cast<std::size_t>(row)];
-    symbolsTable_->setItem(row, 0,
-                           new QTableWidgetItem(QString::fromStdString(symbol.name)));
-    symbolsTable_->setItem(row, 1,
-                           new QTableWidgetItem(symbolKindToString(symbol.kind)));
-    symbolsTable_->setItem(row, 2,
-                           new QTableWidgetItem(varTypeToString(symbol.type)));
-    symbolsTable_->setItem(row, 3,
-                           new QTableWidgetItem(QString::number(symbol.level)));
-    symbolsTable_->setItem(row, 4,
-                           new QTableWidgetItem(QString::number(symbol.address)));
-    symbolsTable_->setItem(row, 5,
-                           new QTableWidgetItem(QString::number(symbol.size)));
-    symbolsTable_->setItem(row, 6,
-                           new QTableWidgetItem(symbol.by_value ? tr("值传递")
-                                                               : tr("引用")));
-  }
-}
-
-void MainWindow::populatePCode(const pl0::InstructionSequence& code) {
-  QStringList lines;
-  lines.reserve(static_cast<int>(code.size()));
-  for (const auto& instr : code) {
-    lines.append(QString::fromStdString(pl0::to_string(instr)));
-  }
-  pcodeEdit_->setPlainText(lines.join(QStringLiteral("\n")));
+  astView_->clear();
 }
 
 void MainWindow::populateDiagnostics(const pl0::DiagnosticSink& diagnostics) {
@@ -1166,36 +1134,6 @@ void MainWindow::populateVmOutput(const std::string& output) {
   vmOutputEdit_->setPlainText(processed.join(QStringLiteral("\n")).trimmed());
 }
 
-QString MainWindow::tokenKindToString(pl0::TokenKind kind) const {
-  return QString::fromStdString(pl0::to_string(kind));
-}
-
-QString MainWindow::symbolKindToString(pl0::SymbolKind kind) const {
-  switch (kind) {
-    case pl0::SymbolKind::Constant:
-      return tr("常量");
-    case pl0::SymbolKind::Variable:
-      return tr("变量");
-    case pl0::SymbolKind::Procedure:
-      return tr("过程");
-    case pl0::SymbolKind::Parameter:
-      return tr("参数");
-    case pl0::SymbolKind::Array:
-      return tr("数组");
-  }
-  return tr("未知");
-}
-
-QString MainWindow::varTypeToString(pl0::VarType type) const {
-  switch (type) {
-    case pl0::VarType::Integer:
-      return tr("整数");
-    case pl0::VarType::Boolean:
-      return tr("布尔");
-  }
-  return tr("未知");
-}
-
 void MainWindow::markDocumentDirty() {
   documentDirty_ = true;
   lastResult_.reset();
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <QPlainTextEdit>
@@ -18,19 +21,25 @@ class QAction;
 class QCheckBox;
 class QSplitter;
 class QStatusBar;
-class QTableWidget;
+class QTableView;
 class QTabWidget;
 class QLabel;
-class QScrollArea;
+class QProgressBar;
+class QTimer;
 QT_END_NAMESPACE
 
+class AstDiagramView;
 class CodeEditor;
+class PCodeTableModel;
+class SymbolTableModel;
+class TokenTableModel;
 
 namespace pl0 {
 struct Token;
 struct Program;
 struct Block;
 struct Expression;
+class IncrementalParser;
 }
 
 class QGraphicsOpacityEffect;
@@ -40,6 +49,7 @@ class MainWindow : public QMainWindow {
 
  public:
   explicit MainWindow(QWidget* parent = nullptr);
+  ~MainWindow() override;
 
  private:
   void resizeEvent(QResizeEvent* event) override;
@@ -51,6 +61,9 @@ class MainWindow : public QMainWindow {
   void compileSource();
   void runProgram();
   void compileAndRun();
+  void stopExecution();
+  void exportAstImage();
+  void refreshLiveDiagnostics();
 
  private:
   void setupUi();
@@ -60,24 +73,21 @@ class MainWindow : public QMainWindow {
   void markDocumentDirty();
   void updateFonts();
   void updateAstDiagram(const pl0::Program& program);
-  void exportAstImage(const QPixmap& pixmap) const;
-  QPixmap createAstPixmap(const pl0::Program& program, const QFont& font) const;
   void relayoutOverlays();
 
-  void populateTokens(const std::vector<pl0::Token>& tokens);
-  void populateSymbols(const std::vector<pl0::Symbol>& symbols);
-  void populatePCode(const pl0::InstructionSequence& code);
   void populateDiagnostics(const pl0::DiagnosticSink& diagnostics);
   void populateVmOutput(const std::string& output);
 
-  bool compileInternal(bool quiet = false);
+  // 编译与运行在工作线程上进行, 结果经排队调用回到界面线程
+  void startCompile(bool runAfterCompile);
+  bool applyCompileResult(pl0::CompileResult result, const pl0::DiagnosticSink& diagnostics);
   void executeCompiledProgram();
+  void appendVmOutput(const std::string& chunk, std::uint64_t instructions);
+  void finishExecution(const std::string& output, const pl0::DiagnosticSink& diagnostics,
+                       const pl0::VirtualMachine::Result& result, bool cancelled);
+  void setBusy(bool compiling, bool running);
   void displayCompileFailure();
 
-  QString tokenKindToString(pl0::TokenKind kind) const;
-  QString symbolKindToString(pl0::SymbolKind kind) const;
-  QString varTypeToString(pl0::VarType type) const;
-
   bool promptToSave();
   bool saveToPath(const QString& path);
 
@@ -86,22 +96,26 @@ class MainWindow : public QMainWindow {
 
   class CodeEditor* sourceEdit_ = nullptr;
   class CodeEditor* stdinEdit_ = nullptr;
-  class CodeEditor* pcodeEdit_ = nullptr;
   class CodeEditor* diagnosticsEdit_ = nullptr;
   class CodeEditor* vmOutputEdit_ = nullptr;
-  QTableWidget* tokensTable_ = nullptr;
-  QTableWidget* symbolsTable_ = nullptr;
+  QTableView* tokensTable_ = nullptr;
+  QTableView* symbolsTable_ = nullptr;
+  QTableView* pcodeTable_ = nullptr;
+  TokenTableModel* tokensModel_ = nullptr;
+  SymbolTableModel* symbolsModel_ = nullptr;
+  PCodeTableModel* pcodeModel_ = nullptr;
   QTabWidget* rightTabs_ = nullptr;
-  QScrollArea* astImageScroll_ = nullptr;
-  QLabel* astImageLabel_ = nullptr;
+  AstDiagramView* astView_ = nullptr;
 
   QAction* boundsCheckAction_ = nullptr;
   QAction* traceVmAction_ = nullptr;
   QAction* compileAction_ = nullptr;
   QAction* runAction_ = nullptr;
   QAction* compileRunAction_ = nullptr;
+  QAction* stopAction_ = nullptr;
   QAction* openAction_ = nullptr;
   QAction* saveAsAction_ = nullptr;
+  QAction* exportAstAction_ = nullptr;
   QAction* exitAction_ = nullptr;
   QAction* saveAction_ = nullptr;
   QMenu* fileMenu_ = nullptr;
@@ -109,7 +123,17 @@ class MainWindow : public QMainWindow {
   QMenu* optionsMenu_ = nullptr;
   QToolBar* mainToolBar_ = nullptr;
 
-  std::optional<pl0::CompileResult> lastResult_;
+  std::shared_ptr<const pl0::CompileResult> lastResult_;
+  std::thread compileWorker_;
+  std::thread runWorker_;
+  std::atomic<bool> cancelRun_{false};
+  bool compiling_ = false;
+  bool running_ = false;
+  QProgressBar* progressBar_ = nullptr;
+  // 输入停顿后增量重解析, 在编辑器中即时标出词法与语法错误
+  std::unique_ptr<pl0::IncrementalParser> liveParser_;
+  QTimer* liveCheckTimer_ = nullptr;
+  QLabel* liveStatusLabel_ = nullptr;
   QLabel* watermarkLabel_ = nullptr;
   QLabel* backgroundLabel_ = nullptr;
   QGraphicsOpacityEffect* backgroundOpacityEffect_ = nullptr;
@@ -0,0 +1,173 @@
+#include "ResultModels.hpp"
+
+#include <limits>
+#include <utility>
+
+namespace {
+
+QString symbolKindToString(pl0::SymbolKind kind) {
+  switch (kind) {
+    case pl0::SymbolKind::Constant:
+      return QObject::tr("常量");
+    case pl0::SymbolKind::Variable:
+      return QObject::tr("变量");
+    case pl0::SymbolKind::Procedure:
+      return QObject::tr("过程");
+    case pl0::SymbolKind::Function:
+      return QObject::tr("函数");
+    case pl0::SymbolKind::Parameter:
+      return QObject::tr("参数");
+    case pl0::SymbolKind::Array:
+      return QObject::tr("数组");
+  }
+  return QObject::tr("未知");
+}
+
+QString varTypeToString(pl0::VarType type) {
+  switch (type) {
+    case pl0::VarType::Integer:
+      return QObject::tr("整数");
+    case pl0::VarType::Boolean:
+      return QObject::tr("布尔");
+  }
+  return QObject::tr("未知");
+}
+
+}  // namespace
+
+QString sourceRangeToString(const pl0::SourceRange& range) {
+  return QString::asprintf("%zu:%zu-%zu:%zu", range.begin.line,
+                           range.begin.column, range.end.line,
+                           range.end.column);
+}
+
+CompileResultModel::CompileResultModel(QStringList headers, QObject* parent)
+    : QAbstractTableModel(parent), headers_(std::move(headers)) {}
+
+void CompileResultModel::setResult(std::shared_ptr<const pl0::CompileResult> result) {
+  beginResetModel();
+  result_ = std::move(result);
+  endResetModel();
+}
+
+int CompileResultModel::rowCount(const QModelIndex& parent) const {
+  if (parent.isValid() || !result_) {
+    return 0;
+  }
+  const std::size_t count = rows(*result_);
+  return count > static_cast<std::size_t>(std::numeric_limits<int>::max())
+             ? std::numeric_limits<int>::max()
+             : static_cast<int>(count);
+}
+
+int CompileResultModel::columnCount(const QModelIndex& parent) const {
+  return parent.isValid() ? 0 : static_cast<int>(headers_.size());
+}
+
+QVariant CompileResultModel::data(const QModelIndex& index, int role) const {
+  if (role != Qt::DisplayRole || !index.isValid() || !result_) {
+    return {};
+  }
+  return cell(*result_, static_cast<std::size_t>(index.row()), index.column());
+}
+
+QVariant CompileResultModel::headerData(int section, Qt::Orientation orientation,
+                                        int role) const {
+  if (role != Qt::DisplayRole) {
+    return {};
+  }
+  if (orientation == Qt::Horizontal) {
+    return section >= 0 && section < headers_.size() ? headers_.at(section) : QVariant();
+  }
+  return section;
+}
+
+TokenTableModel::TokenTableModel(QObject* parent)
+    : CompileResultModel({tr("索引"), tr("类型"), tr("词素"), tr("范围"), tr("值")}, parent) {}
+
+std::size_t TokenTableModel::rows(const pl0::CompileResult& result) const {
+  return result.tokens.size();
+}
+
+QString TokenTableModel::cell(const pl0::CompileResult& result, std::size_t row,
+                              int column) const {
+  const auto& token = result.tokens[row];
+  switch (column) {
+    case 0:
+      return QString::number(row);
+    case 1:
+      return QString::fromStdString(pl0::to_string(token.kind));
+    case 2:
+      return QString::fromStdString(token.lexeme);
+    case 3:
+      return sourceRangeToString(token.range);
+    case 4:
+      if (token.number) {
+        return QString::number(*token.number);
+      }
+      if (token.boolean) {
+        return *token.boolean ? tr("true") : tr("false");
+      }
+      return {};
+  }
+  return {};
+}
+
+SymbolTableModel::SymbolTableModel(QObject* parent)
+    : CompileResultModel({tr("名称"), tr("种类"), tr("类型"), tr("层次"), tr("地址"),
+                          tr("大小"), tr("传值")},
+                         parent) {}
+
+std::size_t SymbolTableModel::rows(const pl0::CompileResult& result) const {
+  return result.symbols.size();
+}
+
+QString SymbolTableModel::cell(const pl0::CompileResult& result, std::size_t row,
+                               int column) const {
+  const auto& symbol = result.symbols[row];
+  switch (column) {
+    case 0:
+      return QString::fromStdString(symbol.name);
+    case 1:
+      return symbolKindToString(symbol.kind);
+    case 2:
+      return varTypeToString(symbol.type);
+    case 3:
+      return QString::number(symbol.level);
+    case 4:
+      return QString::number(symbol.address);
+    case 5:
+      return QString::number(symbol.size);
+    case 6:
+      return symbol.by_value ? tr("值传递") : tr("引用");
+  }
+  return {};
+}
+
+PCodeTableModel::PCodeTableModel(QObject* parent)
+    : CompileResultModel({tr("地址"), tr("操作码"), tr("层差"), tr("参数")}, parent) {}
+
+std::size_t PCodeTableModel::rows(const pl0::CompileResult& result) const {
+  return result.code.size();
+}
+
+QString PCodeTableModel::cell(const pl0::CompileResult& result, std::size_t row,
+                              int column) const {
+  const auto& instr = result.code[row];
+  switch (column) {
+    case 0:
+      return QString::number(row);
+    case 1:
+      return QString::fromStdString(pl0::to_string(instr.op));
+    case 2:
+      return QString::number(instr.op == pl0::Op::LDC ? 0 : instr.level);
+    case 3:
+      if (instr.op == pl0::Op::LDC) {
+        return QString::number(pl0::literal_value(instr));
+      }
+      return instr.op == pl0::Op::OPR
+                 ? QString::fromStdString(pl0::to_string(static_cast<pl0::Opr>(instr.argument)))
+                 : QString::number(instr.argument);
+  }
+  return {};
+}
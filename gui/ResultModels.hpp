@@ -0,0 +1,70 @@
+#pragma once
+
+#include <memory>
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QStringList>
+
+#include "pl0/Driver.hpp"
+
+QString sourceRangeToString(const pl0::SourceRange& range);
+
+// 编译结果面板的表格模型基类: 共享持有一次编译结果, 视图只为可见行调用 data(),
+// 不再为每个单元格预先分配 QTableWidgetItem
+class CompileResultModel : public QAbstractTableModel {
+  Q_OBJECT
+
+ public:
+  explicit CompileResultModel(QStringList headers, QObject* parent = nullptr);
+
+  // 切换到新的编译结果 (可为空), 视图随之整体刷新
+  void setResult(std::shared_ptr<const pl0::CompileResult> result);
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+
+ protected:
+  virtual std::size_t rows(const pl0::CompileResult& result) const = 0;
+  virtual QString cell(const pl0::CompileResult& result, std::size_t row, int column) const = 0;
+
+ private:
+  QStringList headers_;
+  std::shared_ptr<const pl0::CompileResult> result_;
+};
+
+class TokenTableModel : public CompileResultModel {
+  Q_OBJECT
+
+ public:
+  explicit TokenTableModel(QObject* parent = nullptr);
+
+ protected:
+  std::size_t rows(const pl0::CompileResult& result) const override;
+  QString cell(const pl0::CompileResult& result, std::size_t row, int column) const override;
+};
+
+class SymbolTableModel : public CompileResultModel {
+  Q_OBJECT
+
+ public:
+  explicit SymbolTableModel(QObject* parent = nullptr);
+
+ protected:
+  std::size_t rows(const pl0::CompileResult& result) const override;
+  QString cell(const pl0::CompileResult& result, std::size_t row, int column) const override;
+};
+
+class PCodeTableModel : public CompileResultModel {
+  Q_OBJECT
+
+ public:
+  explicit PCodeTableModel(QObject* parent = nullptr);
+
+ protected:
+  std::size_t rows(const pl0::CompileResult& result) const override;
+  QString cell(const pl0::CompileResult& result, std::size_t row, int column) const override;
+};
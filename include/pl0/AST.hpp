@@ -6,6 +6,7 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <type_traits>
 #include <utility>
 #include <variant>
 #include <vector>
@@ -87,12 +88,36 @@ struct CallExpr {
 };
 
 // 结构: 表达式统一封装
+//   析构不递归: 长运算链构成的左深树可达数十万层, 逐层递归释放会耗尽调用栈
 struct Expression {
   SourceRange range;
   std::variant<NumberLiteral, BooleanLiteral, IdentifierExpr, ArrayAccessExpr,
                BinaryExpr, UnaryExpr, CallExpr>
       value;
-};
+
+  Expression() = default;
+  Expression(Expression&&) noexcept = default;
+  Expression& operator=(Expression&&) noexcept = default;
+  ~Expression();
+};
+
+// 函数: 按求值顺序访问表达式的直接子节点 (可能为空指针), expr 可为 const
+template <typename Expr, typename Fn>
+  requires std::is_same_v<std::remove_const_t<Expr>, Expression>
+void for_each_child(Expr& expr, Fn&& fn) {
+  if (auto* binary = std::get_if<BinaryExpr>(&expr.value)) {
+    fn(binary->lhs);
+    fn(binary->rhs);
+  } else if (auto* unary = std::get_if<UnaryExpr>(&expr.value)) {
+    fn(unary->operand);
+  } else if (auto* access = std::get_if<ArrayAccessExpr>(&expr.value)) {
+    fn(access->index);
+  } else if (auto* call = std::get_if<CallExpr>(&expr.value)) {
+    for (auto& argument : call->arguments) {
+      fn(argument);
+    }
+  }
+}
 
 // 枚举: 赋值运算符种类
 enum class AssignmentOperator {
@@ -179,17 +204,29 @@ struct VarDecl {
   std::optional<std::size_t> array_size;
 };
 
-// 结构: 过程声明节点
+// 结构: 过程/函数声明节点, 函数通过给自身名字赋值设置返回值
 struct ProcedureDecl {
   SourceRange range;
   std::string name;
+  bool is_function = false;
   std::vector<VarDecl> parameters;
   std::unique_ptr<Block> body;
 };
 
+// 结构: 外部声明节点, 引用其他目标文件导出的全局变量或过程, 链接时解析
+struct ExternDecl {
+  enum class Kind : std::uint8_t { Variable, Procedure, Function };
+  SourceRange range;
+  std::string name;
+  Kind kind = Kind::Procedure;
+  std::optional<std::size_t> array_size;  // 变量: 数组长度
+  std::size_t arity = 0;                  // 过程/函数: 参数个数
+};
+
 // 结构: 作用域块节点
 struct Block {
   std::vector<ConstDecl> consts;
+  std::vector<ExternDecl> externs;
   std::vector<VarDecl> vars;
   std::vector<ProcedureDecl> procedures;
   std::vector<StmtPtr> statements;
@@ -3,6 +3,8 @@
 #pragma once
 
 #include <cstdint>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "pl0/AST.hpp"
@@ -13,6 +15,31 @@
 
 namespace pl0 {
 
+// 结构: 片段或目标文件中需要在链接时修正参数的指令
+//   Local: JMP/JPC/CAL 的目标为片段内地址, 加上片段起点即可;
+//   Procedure: CAL 调用外层的顶层过程, 参数暂存其过程编号 (声明顺序), 链接时换成入口地址;
+//   Data: 访问本模块全局变量的 LOD/STO/LDA, 加上本模块全局区在程序帧中的偏移;
+//   Import: 引用 extern 符号的 CAL/LOD/STO/LDA, 参数暂存导入序号;
+//   FrameSize: 主程序的 INT, 换成链接后全部全局变量所需的帧大小
+struct Relocation {
+  enum class Kind : std::uint8_t { Local, Procedure, Data, Import, FrameSize };
+  Kind kind = Kind::Local;
+  std::size_t index = 0;
+};
+
+// 结构: 单个顶层过程生成的可重定位代码片段, 过程入口位于片段起点
+struct CodeFragment {
+  InstructionSequence code;
+  std::vector<Relocation> relocations;
+  std::vector<Symbol> symbols;  // 过程体内声明的符号, 其中过程入口相对片段起点
+  std::vector<Diagnostic> diagnostics;
+};
+
+// 函数: 把片段追加到 output 末尾并修正地址, 片段符号重定位后追加到 symbols;
+//   procedure_addresses 按过程编号给出入口, 片段引用到的过程须已确定地址; 返回片段起点
+int link_fragment(const CodeFragment& fragment, const std::vector<int>& procedure_addresses,
+                  InstructionSequence& output, std::vector<Symbol>& symbols);
+
 // 类: 遍历 AST 并生成对应的 P-Code 指令流
 class CodeGenerator {
  public:
@@ -22,38 +49,67 @@ class CodeGenerator {
 
   // 函数: 处理完整程序节点
   void emit_program(const Program& program);
+  // 函数: 按目标文件方式生成: 允许 extern 声明, 记录全部待重定位的指令, 不做并行生成
+  void emit_module(const Program& program, std::vector<Relocation>& relocations);
 
   [[nodiscard]] const std::vector<Symbol>& symbols() const { return exported_symbols_; }
+  // 函数: extern 声明的符号, 按导入序号排列
+  [[nodiscard]] const std::vector<Symbol>& imports() const { return imports_; }
 
  private:
   // 工具: 指令写入与回填
   int emit_instruction(const Instruction& instr);
   void patch(int index, int target);
   // 工具: 各种节点生成例程
-  void emit_block(const Block& block);
+  void emit_block(const Block& block, const ProcedureDecl* routine = nullptr);
   void emit_statement(const Statement& stmt);
   void emit_statements(const std::vector<StmtPtr>& stmts);
   void emit_assignment(const AssignmentStmt& stmt, const SourceRange& range);
   void emit_call(const std::string& callee,
                  const std::vector<ExprPtr>& arguments,
-                 const SourceRange& range);
+                 const SourceRange& range, bool want_value);
   void emit_if(const IfStmt& stmt);
   void emit_while(const WhileStmt& stmt);
   void emit_repeat(const RepeatStmt& stmt);
   void emit_read(const ReadStmt& stmt, const SourceRange& range);
   void emit_write(const WriteStmt& stmt);
-  void emit_expression(const Expression& expr);
-  void emit_binary(const BinaryExpr& expr);
-  void emit_unary(const UnaryExpr& expr);
+  void emit_expression(const Expression& root);
+  void finish_expression(const Expression& expr, const Symbol* symbol);
   void emit_identifier(const IdentifierExpr& expr, const SourceRange& range);
-  void emit_array_access(const ArrayAccessExpr& expr, const SourceRange& range,
-                         bool load_value);
+  void emit_element_address(const Symbol& array);
+  void emit_call_instruction(const Symbol& symbol, bool want_value);
   void emit_const(const ConstDecl& decl);
   void emit_var(const VarDecl& decl);
+  void emit_extern(const ExternDecl& decl);
+  // 工具: 目标文件模式下记录对全局变量或外部符号的引用
+  void note_reference(int index, const Symbol& symbol);
   void emit_procedure(const ProcedureDecl& decl, Symbol& symbol);
+  void emit_top_level_procedures(const std::vector<ProcedureDecl>& procedures,
+                                 std::size_t workers);
+  // 工具: 在 enclosing 的前 visible 个符号可见时, 把顶层过程生成为独立片段
+  static CodeFragment emit_fragment(const ProcedureDecl& decl, const SymbolTable& enclosing,
+                                    std::size_t visible, const CompilerOptions& options);
 
-  // 工具: 名称查找
+  // 工具: 名称查找; 后两者另外检查符号种类 (及实参个数), 不合法时报告并返回空
   const Symbol* resolve(const std::string& name, const SourceRange& range) const;
+  const Symbol* resolve_array(const std::string& name, const SourceRange& range);
+  const Symbol* resolve_callee(const std::string& callee, std::size_t argument_count,
+                               const SourceRange& range, bool want_value);
+  // 工具: 若当前位于该函数体内, 返回其返回值单元的层差
+  std::optional<int> function_result_level(const Symbol& symbol) const;
+
+  // 结构: 正在生成的函数, 返回值存放在函数体帧的首个局部单元
+  struct FunctionContext {
+    std::string name;
+    int level = 0;
+  };
+
+  // 结构: 表达式生成的待办项; finish 为真时子表达式均已生成, symbol 为已检查的数组或被调过程
+  struct ExpressionTask {
+    const Expression* expr = nullptr;
+    const Symbol* symbol = nullptr;
+    bool finish = false;
+  };
 
   // 成员: 共享状态
   SymbolTable& symbols_;
@@ -61,6 +117,12 @@ class CodeGenerator {
   DiagnosticSink& diagnostics_;
   const CompilerOptions& options_;
   std::vector<Symbol> exported_symbols_;
+  std::vector<FunctionContext> functions_;
+  // 成员: 生成片段或目标文件时记录待重定位的指令, 直接生成整个程序时为空
+  std::vector<Relocation>* relocations_ = nullptr;
+  bool module_ = false;
+  std::vector<Symbol> imports_;
+  std::vector<ExpressionTask> expression_stack_;  // 跨表达式复用, 避免反复分配
 };
 
 }  // namespace pl0
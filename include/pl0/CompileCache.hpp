@@ -0,0 +1,60 @@
+// 文件: CompileCache.hpp
+// 功能: 声明按源码内容寻址的持久化编译缓存
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "pl0/Options.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/SymbolTable.hpp"
+
+namespace pl0 {
+
+// 类: 磁盘编译缓存
+//   键由源码、影响代码生成的编译选项与编译器版本共同哈希得到, 条目以二进制保存指令与符号;
+//   命中时刷新条目修改时间, 写入后按修改时间淘汰最久未用的条目, 使目录总大小不超过上限。
+//   缓存读写失败只会退化为未命中, 不影响编译本身
+class CompileCache {
+ public:
+  // 常量: 编译器版本, 修改代码生成、优化器或条目格式时必须递增以作废旧条目
+  static constexpr std::uint32_t kCompilerVersion = 2;
+  // 常量: 默认容量上限
+  static constexpr std::uintmax_t kDefaultMaxBytes = 64ULL * 1024 * 1024;
+
+  // 结构: 缓存条目内容
+  struct Entry {
+    InstructionSequence code;
+    std::vector<Symbol> symbols;
+  };
+
+  explicit CompileCache(std::filesystem::path directory,
+                        std::uintmax_t max_bytes = kDefaultMaxBytes);
+
+  // 函数: 默认缓存目录: $PL0_CACHE_DIR, 否则 $XDG_CACHE_HOME/pl0 或 ~/.cache/pl0
+  static std::filesystem::path default_directory();
+
+  // 函数: 计算缓存键
+  static std::uint64_t make_key(std::string_view source, const CompilerOptions& options);
+
+  // 函数: 查找条目, 损坏的条目会被删除并视为未命中
+  std::optional<Entry> load(std::uint64_t key);
+
+  // 函数: 写入条目 (先写临时文件再改名, 并发写入同一键也不会读到半个文件), 然后按需淘汰
+  void store(std::uint64_t key, const InstructionSequence& code,
+             const std::vector<Symbol>& symbols);
+
+  [[nodiscard]] const std::filesystem::path& directory() const { return directory_; }
+
+ private:
+  std::filesystem::path entry_path(std::uint64_t key) const;
+  void evict();
+
+  std::filesystem::path directory_;
+  std::uintmax_t max_bytes_;
+};
+
+}  // namespace pl0
@@ -40,12 +40,18 @@ enum class DiagnosticCode : std::uint16_t {
   ExpectedSymbol,
   InvalidAssignmentTarget,
   InvalidArraySubscript,
+  ArgumentCountMismatch,
   StackOverflow,
   StackUnderflow,
   DivisionByZero,
   RuntimeError,
   IOError,
   InternalError,
+  TimeLimitExceeded,
+  InstructionLimitExceeded,
+  LinkError,
+  NestingTooDeep,
+  StackLimitExceeded,
 };
 
 // 结构: 单条诊断信息
@@ -5,15 +5,20 @@
 #include <filesystem>
 #include <iosfwd>
 #include <memory>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "pl0/AST.hpp"
 #include "pl0/Codegen.hpp"
+#include "pl0/CompileCache.hpp"
 #include "pl0/Diagnostics.hpp"
+#include "pl0/Object.hpp"
 #include "pl0/Options.hpp"
 #include "pl0/PCode.hpp"
+#include "pl0/Profiler.hpp"
+#include "pl0/SourceBuffer.hpp"
 #include "pl0/Token.hpp"
 #include "pl0/VM.hpp"
 
@@ -25,6 +30,7 @@ struct DumpOptions {
   bool ast = false;
   bool symbols = false;
   bool pcode = false;
+  bool ir = false;
 };
 
 // 结构: 编译产物集合
@@ -37,17 +43,33 @@ struct CompileResult {
 };
 
 // 函数: 从文件编译并可选输出调试信息
+//   提供缓存时先按源码内容查找, 命中则跳过前端与代码生成 (结果不含 tokens/program);
+//   需要输出 tokens 或 AST 时不使用缓存
 CompileResult compile_file(const std::filesystem::path& input,
                            const CompilerOptions& options,
                            const DumpOptions& dumps,
                            DiagnosticSink& diagnostics,
-                           std::ostream& dump_stream);
+                           std::ostream& dump_stream,
+                           CompileCache* cache = nullptr);
 
-// 函数: 从字符串编译源码
+// 函数: 从字符串编译源码; 提供缓存时命中结果只含 code/symbols
 CompileResult compile_source_text(std::string_view source_name,
                                   const std::string& source,
                                   const CompilerOptions& options,
-                                  DiagnosticSink& diagnostics);
+                                  DiagnosticSink& diagnostics,
+                                  CompileCache* cache = nullptr);
+
+// 函数: 从源码缓冲编译, 词法器直接扫描缓冲 (如映射的文件); 语义同上
+CompileResult compile_source_text(std::string_view source_name,
+                                  const SourceBuffer& source,
+                                  const CompilerOptions& options,
+                                  DiagnosticSink& diagnostics,
+                                  CompileCache* cache = nullptr);
+
+// 函数: 把源码编译为可重定位目标模块 (允许 extern 声明), 出错时返回的模块不含代码;
+//   不使用缓存, 也不做优化 (优化须在链接后进行)
+ObjectModule compile_object(std::string_view source_name, const SourceBuffer& source,
+                            const CompilerOptions& options, DiagnosticSink& diagnostics);
 
 // 函数: 读取 P-Code 文件
 InstructionSequence load_pcode_file(const std::filesystem::path& input);
@@ -56,10 +78,28 @@ InstructionSequence load_pcode_file(const std::filesystem::path& input);
 void save_pcode_file(const std::filesystem::path& output,
                      const InstructionSequence& instructions);
 
-// 函数: 执行指令序列
+// 函数: 执行指令序列, 提供剖析器时统计执行情况
 VirtualMachine::Result run_instructions(const InstructionSequence& code,
                                         DiagnosticSink& diagnostics,
-                                        const RunnerOptions& options);
+                                        const RunnerOptions& options,
+                                        Profiler* profiler = nullptr);
+
+// 函数: 以指定的输入输出流执行指令序列, 不触及全局 std::cin / std::cout, 可在多线程中并发调用
+VirtualMachine::Result run_instructions(const InstructionSequence& code,
+                                        DiagnosticSink& diagnostics,
+                                        const RunnerOptions& options,
+                                        std::istream& input,
+                                        std::ostream& output,
+                                        Profiler* profiler = nullptr);
+
+// 函数: 输出剖析报告, 并将 flamegraph 兼容的折叠栈写入文件
+void write_profile(const Profiler& profiler, std::ostream& report,
+                   const std::filesystem::path& folded_output);
+
+// 函数: 解析运行限额选项 (--max-instructions N, --time-limit ms), 返回是否消费了参数;
+//   数值不是完整的无符号十进制整数时向 errors 打印错误并将 valid 置为 false
+bool parse_limit_option(std::span<const std::string> args, std::size_t& i,
+                        RunnerOptions& options, bool& valid, std::ostream& errors);
 
 // 函数: 打印诊断信息
 void print_diagnostics(const DiagnosticSink& diagnostics, std::ostream& out);
@@ -0,0 +1,30 @@
+// 文件: Generator.hpp
+// 功能: 声明合成 PL/0 程序生成器, 用于规模测试与基准
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace pl0 {
+
+// 结构: 生成参数
+//   程序包含 procedures 个顶层过程, 每个过程内再嵌套 depth - 1 层子过程;
+//   每个过程以 expression_terms 项的长表达式更新全局校验和, 最后遍历 array_size 元数组
+struct GeneratorOptions {
+  int procedures = 100;
+  int depth = 3;
+  int array_size = 1000;
+  int expression_terms = 8;
+  std::uint32_t seed = 1;
+};
+
+// 结构: 生成结果, expected_output 为程序运行时应写出的内容
+struct GeneratedProgram {
+  std::string source;
+  std::string expected_output;
+};
+
+// 函数: 按参数生成合法的 PL/0 程序并计算其预期输出, 同一参数结果完全确定
+GeneratedProgram generate_program(const GeneratorOptions& options);
+
+}  // namespace pl0
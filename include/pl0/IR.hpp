@@ -0,0 +1,115 @@
+// 文件: IR.hpp
+// 功能: 定义优化器使用的控制流图中间表示 (SSA 值 + 内存变量)
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pl0/PCode.hpp"
+#include "pl0/SymbolTable.hpp"
+
+namespace pl0::ir {
+
+// 类型: SSA 值编号, 每个值只被定义一次
+using ValueId = int;
+constexpr ValueId kNoValue = -1;
+
+// 枚举: IR 指令种类, 与 P-Code 基本一一对应, 但操作数显式化
+enum class Kind : std::uint8_t {
+  Const,          // %v = lit imm
+  Load,           // %v = lod level imm
+  Store,          // sto level imm, %a
+  Address,        // %v = lda level imm
+  Index,          // %v = idx %base, %offset
+  LoadIndirect,   // %v = ldi %addr
+  StoreIndirect,  // sti %addr, %value
+  Check,          // %v = chk imm, %index
+  Unary,          // %v = opr %a
+  Binary,         // %v = opr %a, %b
+  Read,           // %v = read
+  Write,          // write %a
+  WriteLine,      // writeln
+  Call,           // [%v =] cal level @callee, %args...
+  TailCall,       // tcl level @callee, 复用当前帧, imm 为已存入本帧参数单元的实参个数
+  Alloc,          // int imm
+  Jump,           // jmp target
+  Branch,         // jpc %cond, 真 -> fallthrough, 假 -> target
+  Return,         // opr level ret/retv [%value], level 为需弹出的实参个数
+};
+
+// 结构: 单条 IR 指令
+struct Instr {
+  Kind kind = Kind::Const;
+  Opr opr = Opr::RET;
+  int level = 0;
+  std::int64_t immediate = 0;
+  ValueId result = kNoValue;
+  std::vector<ValueId> operands;
+  int callee = -1;       // Call: 目标函数下标
+  int target = -1;       // Jump/Branch: 跳转块
+  int fallthrough = -1;  // Branch: 条件为真时的后继块
+};
+
+// 结构: 基本块
+struct BasicBlock {
+  int id = 0;
+  int origin = 0;  // 排布顺序键, 初始为原始 P-Code 中的起始地址
+  std::vector<Instr> instrs;
+  std::vector<int> preds;
+  std::vector<int> succs;
+  bool removed = false;
+};
+
+// 结构: 函数 (PL/0 过程或主程序)
+struct Function {
+  int entry_pc = 0;  // 原始 P-Code 入口地址
+  int entry = 0;     // 入口块编号
+  std::string name;
+  std::vector<BasicBlock> blocks;
+  int value_count = 0;
+  int parent = -1;   // 静态外层函数, 未知时为 -1
+  bool parent_known = true;
+  int arity = 0;     // 参数个数, 参数 i 位于本帧偏移 i - arity
+  bool returns_value = false;
+
+  // 函数: 分配新的 SSA 值
+  ValueId new_value() { return value_count++; }
+};
+
+// 结构: 整个程序
+struct Module {
+  std::vector<Function> functions;
+  int main = 0;
+};
+
+// 结构: 降级结果, 记录过程入口的新旧地址映射
+struct LoweredProgram {
+  InstructionSequence code;
+  std::vector<std::pair<int, int>> entry_map;  // (原入口, 新入口)
+};
+
+// 函数: 由 P-Code 构建 IR, 遇到无法识别的代码形态时返回空
+std::optional<Module> build_module(const InstructionSequence& code);
+
+// 函数: 将 IR 重新降级为 P-Code, 仅输出从主程序可达的函数
+LoweredProgram lower_module(const Module& module);
+
+// 函数: 重新计算前驱/后继
+void recompute_edges(Function& function);
+
+// 函数: 结合符号表为函数命名
+void assign_names(Module& module, const std::vector<Symbol>& symbols);
+
+// 函数: 以文本形式打印 IR
+void print_module(const Module& module, std::ostream& out);
+
+// 函数: 指令是否定义值 / 是否为终结指令 / 是否有副作用 / 是否为过程调用
+bool defines_value(const Instr& instr);
+bool is_terminator(const Instr& instr);
+bool has_side_effects(const Instr& instr);
+bool is_call(const Instr& instr);
+
+}  // namespace pl0::ir
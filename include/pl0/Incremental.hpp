@@ -0,0 +1,80 @@
+// 文件: Incremental.hpp
+// 功能: 声明增量前端, 编辑后只重新扫描受影响的 Token 并重解析包含编辑的最小语句或过程
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pl0/AST.hpp"
+#include "pl0/Diagnostics.hpp"
+#include "pl0/Parser.hpp"
+#include "pl0/Token.hpp"
+
+namespace pl0 {
+
+// 结构: 一次文本编辑, 以字节偏移描述被替换的区间
+struct TextEdit {
+  std::size_t offset = 0;
+  std::size_t removed = 0;
+  std::string inserted;
+};
+
+// 结构: 最近一次更新的工作量
+struct IncrementalStats {
+  std::size_t relexed_tokens = 0;   // 重新扫描产生的 Token 数
+  std::size_t reparsed_tokens = 0;  // 重解析覆盖的 Token 数
+  bool full_reparse = false;        // 是否退回整体重解析
+};
+
+// 类: 维护一份源码的 Token 序列、AST 与词法/语法诊断, 并随编辑增量更新;
+//   结果与对新文本整体扫描、解析得到的完全一致, 只做前端检查, 不做语义分析与代码生成
+class IncrementalParser {
+ public:
+  IncrementalParser();
+  ~IncrementalParser();
+
+  // 函数: 以完整源码重建全部状态
+  void reset(std::string source);
+  // 函数: 应用一次编辑, 越界时抛出 std::out_of_range
+  const IncrementalStats& apply(const TextEdit& edit);
+  // 函数: 与当前源码比较公共前后缀得到编辑区间后应用
+  const IncrementalStats& update(std::string_view source);
+
+  [[nodiscard]] const std::string& source() const { return source_; }
+  [[nodiscard]] const std::vector<Token>& tokens() const { return tokens_; }
+  [[nodiscard]] const Program* program() const { return program_.get(); }
+  [[nodiscard]] const IncrementalStats& stats() const { return stats_; }
+  // 函数: 词法与语法诊断, 按位置排序
+  [[nodiscard]] std::vector<Diagnostic> diagnostics() const;
+
+ private:
+  struct Unit;
+
+  void lex_all();
+  void parse_all();
+  bool reparse_unit(const Unit& unit, std::ptrdiff_t delta, const std::vector<Unit>& chain,
+                    std::size_t depth);
+  void collect_block(Block& block, std::size_t first, std::size_t last,
+                     std::vector<Unit>& chain);
+  bool collect_statement(StmtPtr& slot, std::size_t first, std::size_t last,
+                         std::vector<Unit>& chain);
+  void forget_block(const Block& block);
+  void forget_statement(const Statement& stmt);
+
+  std::string source_;
+  // tokens_ 以 EndOfFile 结尾; offsets_[i] 为第 i 个 Token 的扫描起点 (含前导空白), 末尾追加源码长度
+  std::vector<Token> tokens_;
+  std::vector<std::size_t> offsets_;
+  std::vector<Diagnostic> lex_diagnostics_;
+  std::vector<Diagnostic> parse_diagnostics_;
+  std::unique_ptr<Program> program_;
+  ParseSpans spans_;
+  // 整体解析取走的 Token 数, 之后的 Token 不影响 AST
+  std::size_t program_consumed_ = 0;
+  IncrementalStats stats_;
+};
+
+}  // namespace pl0
@@ -3,9 +3,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "pl0/Diagnostics.hpp"
+#include "pl0/SourceBuffer.hpp"
 #include "pl0/Token.hpp"
 
 namespace pl0 {
@@ -15,14 +17,29 @@ class Lexer {
  public:
   // 构造: 收到源码与诊断收集器
   Lexer(std::string source, DiagnosticSink& diagnostics);
+  // 构造: 直接扫描缓冲中的文本 (如映射的文件), 不复制; 缓冲须比词法器活得久
+  Lexer(const SourceBuffer& source, DiagnosticSink& diagnostics);
+  // 构造: 回放已扫描好的 Token 序列 (须以 EndOfFile 结尾), 从 first 处开始, 不再扫描源码
+  Lexer(const std::vector<Token>& tokens, std::size_t first, DiagnosticSink& diagnostics);
+
+  // source_ 可能指向自身持有的字符串, 禁止复制以免视图悬空
+  Lexer(const Lexer&) = delete;
+  Lexer& operator=(const Lexer&) = delete;
 
   // 函数: 预读指定位置的 Token
   [[nodiscard]] const Token& peek(std::size_t lookahead = 0);
   // 函数: 取得下一个 Token
   Token next();
+  // 函数: 回放模式下一次跳过 count 个 Token, 计入 consumed(); 用于接上别处已解析好的片段
+  void skip(std::size_t count);
+
+  // 函数: 重置扫描状态; origin 为源码首字符在原文件中的位置, 扫描源码片段时使用
+  void reset(SourceLoc origin = SourceLoc{1, 1});
 
-  // 函数: 重置扫描状态
-  void reset();
+  // 函数: 已通过 next() 取走的 Token 数
+  [[nodiscard]] std::size_t consumed() const { return consumed_; }
+  // 函数: 已扫描到的字节偏移; 预读缓冲为空时即下一个 Token 的扫描起点
+  [[nodiscard]] std::size_t offset() const { return index_; }
 
  private:
   // 工具: 构造 Token 实例
@@ -46,14 +63,20 @@ class Lexer {
   // 工具: 报告未闭合注释
   void report_unterminated_comment(SourceLoc start);
 
-  // 成员: 源码及扫描状态
-  std::string source_;
+  // 成员: 源码及扫描状态; 按值构造时 source_ 指向 owned_
+  std::string owned_;
+  std::string_view source_;
   DiagnosticSink& diagnostics_;
   std::size_t index_ = 0;
   SourceLoc location_{1, 1};
   SourceLoc token_start_{1, 1};
   std::vector<Token> buffer_;
   bool buffer_valid_ = false;
+  std::size_t consumed_ = 0;
+  // 成员: 回放模式下的 Token 序列与读位置, 为空表示扫描源码
+  const std::vector<Token>* replay_ = nullptr;
+  std::size_t replay_first_ = 0;
+  std::size_t replay_index_ = 0;
 };
 
 }  // namespace pl0
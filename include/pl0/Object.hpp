@@ -0,0 +1,58 @@
+// 文件: Object.hpp
+// 功能: 声明可重定位目标文件 (.pl0o) 及其读写与链接; 各模块单独编译, 由链接器合并为一个程序
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "pl0/Codegen.hpp"
+#include "pl0/Diagnostics.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/SymbolTable.hpp"
+
+namespace pl0 {
+
+// 结构: 目标文件中的导出或导入符号; 导出符号的地址相对本模块 (代码起点或全局区)
+struct ObjectSymbol {
+  std::string name;
+  SymbolKind kind = SymbolKind::Variable;
+  int address = 0;
+  std::size_t size = 1;  // 数组: 元素个数; 过程/函数: 参数个数
+};
+
+// 结构: 单个模块的目标代码; 布局与整程序相同: 首条 JMP 跳过过程体, 主程序以 INT 开帧
+struct ObjectModule {
+  std::string name;
+  InstructionSequence code;
+  std::vector<Relocation> relocations;
+  std::vector<ObjectSymbol> exports;  // 程序级的过程、函数、变量与数组
+  std::vector<ObjectSymbol> imports;  // extern 声明, 按导入序号排列
+};
+
+// 结构: 链接结果, symbols 为全部导出符号的最终地址
+struct LinkedProgram {
+  InstructionSequence code;
+  std::vector<Symbol> symbols;
+};
+
+// 函数: 由代码生成器的产物组装目标模块; symbols 中只取程序级的非 extern 符号导出
+ObjectModule make_object(std::string name, InstructionSequence code,
+                         std::vector<Relocation> relocations, const std::vector<Symbol>& symbols,
+                         const std::vector<Symbol>& imports);
+
+// 函数: 目标模块与二进制编码互转; 解码失败抛出 std::runtime_error
+std::string encode_object(const ObjectModule& module);
+ObjectModule decode_object(std::string_view bytes);
+
+// 函数: 读写目标文件; 失败抛出 std::runtime_error
+void write_object(const std::filesystem::path& output, const ObjectModule& module);
+ObjectModule read_object(const std::filesystem::path& input);
+
+// 函数: 按顺序拼接模块, 首个模块为程序入口, 其余模块的主程序须为空;
+//   全局区依次排布, 重复定义、未定义引用及种类或参数个数不符均报告 LinkError
+LinkedProgram link_objects(const std::vector<ObjectModule>& modules, DiagnosticSink& diagnostics);
+
+}  // namespace pl0
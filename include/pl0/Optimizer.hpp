@@ -0,0 +1,21 @@
+// 文件: Optimizer.hpp
+// 功能: 声明基于 IR 的优化流水线
+#pragma once
+
+#include <vector>
+
+#include "pl0/IR.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/SymbolTable.hpp"
+
+namespace pl0 {
+
+// 函数: 在 IR 上执行全部优化 pass
+//   全局值编号 (含常量折叠与访存前推)、死存储消除、不可达块删除、CFG 简化
+void optimize_module(ir::Module& module);
+
+// 函数: 优化 P-Code 并同步过程符号地址, 未被调用的过程从结果中剥离
+//   代码形态无法识别时保持原样并返回 false
+bool optimize_program(InstructionSequence& code, std::vector<Symbol>& symbols);
+
+}  // namespace pl0
@@ -2,12 +2,19 @@
 // 功能: 定义编译器与运行时配置项
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
 #include <optional>
 #include <string>
 
 namespace pl0 {
 
+// 常量: 默认的嵌套深度上限, 计入语句与过程体的嵌套层数; 足够任何手写程序,
+//   又使递归解析、代码生成与析构在线程默认栈上都不会溢出
+constexpr std::size_t kDefaultNestingLimit = 256;
+
 // 结构: 编译阶段选项
 struct CompilerOptions {
   bool dump_tokens = false;
@@ -15,12 +22,23 @@ struct CompilerOptions {
   bool dump_symbols = false;
   bool dump_pcode = false;
   bool enable_bounds_check = false;
+  bool optimize = false;
+  // 单个程序内部可并行阶段 (顶层过程的语法分析与代码生成) 使用的线程数, 0 表示硬件并发数;
+  //   只影响编译速度, 不影响结果, 因此不计入编译缓存的键
+  std::size_t threads = 1;
+  // 语句与过程体的嵌套深度上限, 超出时报告 NestingTooDeep 并放弃编译; 表达式不受限
+  std::size_t max_nesting = kDefaultNestingLimit;
 };
 
 // 结构: 运行阶段选项
+//   各开关在执行开始时选定虚拟机的一个特化版本, 关闭的功能不产生逐指令开销
 struct RunnerOptions {
   bool trace_vm = false;
-  bool enable_bounds_check = false;
+  bool enable_bounds_check = false;   // 校验间接访问与变量访问落在已分配的栈内
+  bool count_instructions = false;    // 在 Result::instructions 中报告执行的指令数
+  std::chrono::milliseconds time_limit{0};  // 墙钟时间上限, 0 表示不限; 仅在回跳与调用处检查
+  std::uint64_t instruction_limit = 0;      // 指令预算, 0 表示不限; 检查点同上, 超出量不超过一段直线代码
+  std::size_t stack_limit = 0;              // 运行栈单元数上限, 0 表示不限; 栈需要增长到超出时终止程序
 };
 
 // 结构: CLI 解析后的参数
@@ -2,6 +2,7 @@
 // 功能: 定义 P-Code 指令集及读写工具
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 #include <string>
@@ -26,10 +27,12 @@ enum class Op : std::uint8_t {
   STI,
   CHK,
   DUP,
+  TCL,
   NOP,
+  LDC,
 };
 
-// 枚举: OPR 子操作码
+// 枚举: OPR 子操作码, RET/RETV 的层次字段为需要弹出的实参个数
 enum class Opr : std::uint8_t {
   RET = 0,
   NEG = 1,
@@ -51,9 +54,10 @@ enum class Opr : std::uint8_t {
   AND = 17,
   OR = 18,
   NOT = 19,
+  RETV = 20,
 };
 
-// 结构: 指令实体
+// 结构: 指令实体; LDC 的 64 位常量按高、低 32 位分别存放在 level 与 argument 中
 struct Instruction {
   Op op = Op::NOP;
   std::int32_t level = 0;
@@ -62,6 +66,38 @@ struct Instruction {
 
 using InstructionSequence = std::vector<Instruction>;
 
+// 结构: 虚拟机内部使用的 8 字节紧凑指令; head 低 8 位为操作码, 高 24 位为层次字段
+struct PackedInstruction {
+  std::uint32_t head = 0;
+  std::int32_t argument = 0;
+
+  Op op() const { return static_cast<Op>(head & 0xFFu); }
+  std::int32_t level() const { return static_cast<std::int32_t>(head >> 8); }
+};
+
+static_assert(sizeof(PackedInstruction) == 8);
+
+using PackedSequence = std::vector<PackedInstruction>;
+
+// 结构: 紧凑编码的程序; LDC 的参数为常量池下标, 相同的常量只存一份
+struct PackedProgram {
+  PackedSequence code;
+  std::vector<std::int64_t> constants;
+};
+
+// 常量: 紧凑编码可表示的最大层次字段
+constexpr std::int32_t kMaxPackedLevel = (1 << 24) - 1;
+
+// 函数: 前端指令序列与紧凑编码互转; 层次字段为负或超过 kMaxPackedLevel 时抛出 std::runtime_error
+PackedProgram pack_instructions(const InstructionSequence& instructions);
+Instruction unpack_instruction(const PackedProgram& program, std::size_t index);
+
+// 函数: 压入整数常量的指令, 32 位立即数放不下时生成 LDC
+Instruction load_constant(std::int64_t value);
+
+// 函数: LIT/LDC 指令压入的常量值
+std::int64_t literal_value(const Instruction& instr);
+
 // 函数: 指令/操作码转字符串
 std::string to_string(Op op);
 std::string to_string(Opr opr);
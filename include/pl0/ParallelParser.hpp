@@ -0,0 +1,27 @@
+// 文件: ParallelParser.hpp
+// 功能: 声明并行语法分析: 顶层过程体分到线程池上各自解析, 再由顺序解析按 Token 位置拼接
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "pl0/AST.hpp"
+#include "pl0/Diagnostics.hpp"
+#include "pl0/Parser.hpp"
+#include "pl0/Token.hpp"
+
+namespace pl0 {
+
+// 函数: 预扫描 Token 序列, 找出可能是顶层过程声明开头的 procedure/function 位置;
+//   只依据 begin/end 配对估计, 猜错仅浪费一次预解析, 不影响结果
+std::vector<std::size_t> find_top_level_procedures(const std::vector<Token>& tokens);
+
+// 函数: 解析完整程序, 顶层过程声明用至多 threads 个线程预先并行解析 (0 表示硬件并发数);
+//   tokens 须以 EndOfFile 结尾; AST 与诊断 (内容与顺序) 均与顺序解析同一序列完全相同
+std::unique_ptr<Program> parse_program_parallel(const std::vector<Token>& tokens,
+                                                DiagnosticSink& diagnostics,
+                                                std::size_t threads = 0,
+                                                std::size_t nesting_limit = kDefaultNestingLimit);
+
+}  // namespace pl0
@@ -2,16 +2,44 @@
 // 功能: 声明语法分析器, 将 Token 构造为 AST
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <unordered_map>
 
 #include "pl0/AST.hpp"
 #include "pl0/Diagnostics.hpp"
 #include "pl0/Lexer.hpp"
+#include "pl0/Options.hpp"
 #include "pl0/SymbolTable.hpp"
 
 namespace pl0 {
 
-// 类: 递归下降解析 Token 并生成 AST
+// 结构: 语法单元占据的 Token 半开区间 [first, last), 以词法器取走的 Token 计数表示
+struct TokenSpan {
+  std::size_t first = 0;
+  std::size_t last = 0;
+};
+
+// 结构: 解析时记录的语句与过程声明区间, 供增量重解析定位可独立替换的子树;
+//   过程声明以过程体 Block 的地址为键, 因为 ProcedureDecl 本身存放在会扩容的 vector 中
+struct ParseSpans {
+  std::unordered_map<const Statement*, TokenSpan> statements;
+  std::unordered_map<const Block*, TokenSpan> procedures;
+};
+
+// 结构: 预先单独解析好的过程声明; 顺序解析恰好在 first 处遇到过程声明时直接取用,
+//   诊断按原顺序转交, 词法器跳过 consumed 个 Token, 结果与当场解析完全相同
+struct PreparsedProcedure {
+  std::size_t first = 0;
+  std::size_t consumed = 0;
+  std::optional<ProcedureDecl> decl;
+  std::vector<Diagnostic> diagnostics;
+};
+
+// 类: 解析 Token 并生成 AST; 语句与声明递归下降, 深度受嵌套上限约束;
+//   表达式用显式栈解析, 任意长的运算链与任意深的括号都不占用调用栈
 class Parser {
  public:
   // 构造: 绑定词法器与诊断收集器
@@ -20,6 +48,18 @@ class Parser {
   // 函数: 解析完整程序
   std::unique_ptr<Program> parse_program();
 
+  // 函数: 只解析一条语句 / 一个过程声明, 供增量重解析使用;
+  //   当前 Token 不能开始该语法单元时返回空
+  StmtPtr parse_statement_unit();
+  std::optional<ProcedureDecl> parse_procedure_unit();
+
+  // 函数: 设置区间记录器, 为空时不记录
+  void record_spans(ParseSpans* spans) { spans_ = spans; }
+  // 函数: 设置预解析的过程声明表 (按 first 升序), 为空时不使用; 需配合从第 0 个 Token 开始回放的词法器
+  void use_preparsed(std::vector<PreparsedProcedure>* preparsed) { preparsed_ = preparsed; }
+  // 函数: 设置嵌套深度上限; 超出时报告一条诊断并放弃解析 (parse_program 返回空)
+  void set_nesting_limit(std::size_t limit) { nesting_limit_ = limit; }
+
  private:
   // 工具: 预读/匹配/期望指定 Token
   const Token& peek(std::size_t lookahead = 0);
@@ -33,9 +73,14 @@ class Parser {
   // 语法子程序: 解析块/声明/语句/表达式
   std::unique_ptr<Block> parse_block();
   void parse_const_declarations(Block& block);
+  void parse_extern_declarations(Block& block);
   void parse_var_declarations(Block& block);
+  VarDecl parse_variable(std::string_view missing_name);
   void parse_procedure_declarations(Block& block);
+  ProcedureDecl parse_procedure_declaration();
+  PreparsedProcedure* find_preparsed();
   StmtPtr parse_statement();
+  StmtPtr parse_statement_body();
   StmtPtr parse_assignment();
   StmtPtr parse_call();
   StmtPtr parse_begin_end();
@@ -45,14 +90,28 @@ class Parser {
   StmtPtr parse_read();
   StmtPtr parse_write(bool newline);
 
-  // 语法子程序: 表达式层级解析
+  // 语法子程序: 表达式解析, 以显式栈模拟 或 > 与 > 比较 > 加减 > 一元/乘除 > 原子 的逐层下降
   ExprPtr parse_expression();
-  ExprPtr parse_logic_term();
-  ExprPtr parse_logic_factor();
-  ExprPtr parse_relation();
-  ExprPtr parse_term();
-  ExprPtr parse_factor();
-  ExprPtr parse_primary();
+
+  // 工具: 即将进入新一层语句或过程体时检查嵌套上限, 超出时抛出内部异常, 由解析入口转为诊断
+  void check_nesting();
+  void report_nesting(const SourceRange& range);
+
+  // 结构: 表达式解析栈帧, 对应逐层下降中的一层调用, stage 记录该层执行到的位置
+  struct ExpressionFrame {
+    enum class Rule : std::uint8_t {
+      Or, And, Relation, Additive, Factor, Primary, Arguments, Subscript, Group
+    };
+    enum class Stage : std::uint8_t { Start, Operand, Rest, Unary };
+    Rule rule = Rule::Or;
+    Stage stage = Stage::Start;
+    BinaryOp binary = BinaryOp::Add;
+    UnaryOp unary = UnaryOp::Positive;
+    SourceRange range;  // Factor: 起始 Token; Arguments/Subscript: 标识符; Group: 左括号
+    SourceLoc end;      // Arguments: 已解析部分的终点
+    ExprPtr expr;       // 已归约的左操作数
+    CallExpr call;      // Arguments: 收集中的调用; Subscript: 只用 callee 存放数组名
+  };
 
   // 工具: 解析逗号分隔标识符列表
   std::vector<std::string> parse_identifier_list();
@@ -61,6 +120,11 @@ class Parser {
   Lexer& lexer_;
   DiagnosticSink& diagnostics_;
   bool panic_mode_ = false;
+  ParseSpans* spans_ = nullptr;
+  std::vector<PreparsedProcedure>* preparsed_ = nullptr;
+  std::size_t nesting_limit_ = kDefaultNestingLimit;
+  std::size_t nesting_ = 0;
+  std::vector<ExpressionFrame> expression_stack_;  // 跨表达式复用, 避免反复分配
 };
 
 }  // namespace pl0
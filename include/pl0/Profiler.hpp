@@ -0,0 +1,89 @@
+// 文件: Profiler.hpp
+// 功能: 声明虚拟机执行剖析器, 统计指令/操作码/过程计数并采样估计耗时
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "pl0/PCode.hpp"
+#include "pl0/SymbolTable.hpp"
+
+namespace pl0 {
+
+// 类: 执行剖析器
+//   每条指令只做两次计数自增; 每执行 sample_interval 条指令读取一次时钟,
+//   将间隔耗时记到当时的调用栈上 (栈顶计入自身时间, 栈上各过程计入包含时间)
+class Profiler {
+ public:
+  // 常量: 默认采样间隔 (指令条数)
+  static constexpr std::uint32_t kDefaultSampleInterval = 4096;
+
+  // 结构: 单个过程的统计
+  struct ProcedureStats {
+    int entry = 0;
+    std::string name;
+    std::uint64_t calls = 0;
+    std::uint64_t instructions = 0;  // 自身执行的指令数
+    std::uint64_t samples = 0;       // 位于栈顶的采样数
+    std::chrono::nanoseconds self_time{0};
+    std::chrono::nanoseconds total_time{0};
+  };
+
+  explicit Profiler(std::uint32_t sample_interval = kDefaultSampleInterval);
+
+  // 函数: 按符号表为过程入口命名, 未命名的入口显示为 proc@地址
+  void name_procedures(const std::vector<Symbol>& symbols);
+
+  // 函数: 开始/结束一次执行
+  void begin(const InstructionSequence& code);
+  void end();
+
+  // 函数: 虚拟机钩子, 在执行每条指令前以及 CAL/TCL/返回时调用
+  void on_instruction(int pc) {
+    ++instruction_counts_[static_cast<std::size_t>(pc)];
+    ++procedures_[static_cast<std::size_t>(stack_.back())].instructions;
+    if (--countdown_ == 0) {
+      sample();
+    }
+  }
+  void on_call(int target);
+  void on_tail_call(int target);
+  void on_return();
+
+  // 函数: 输出文本报告 / flamegraph 兼容的折叠栈
+  void write_report(std::ostream& out) const;
+  void write_folded(std::ostream& out) const;
+
+  [[nodiscard]] const std::vector<ProcedureStats>& procedures() const { return procedures_; }
+  [[nodiscard]] const std::vector<std::uint64_t>& instruction_counts() const {
+    return instruction_counts_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  int procedure_for(int entry);
+  int register_procedure(int entry);
+  void sample();
+
+  std::uint32_t sample_interval_;
+  std::uint32_t countdown_ = 0;
+  const InstructionSequence* code_ = nullptr;
+  std::vector<std::uint64_t> instruction_counts_;
+  std::vector<int> procedure_of_entry_;
+  std::vector<ProcedureStats> procedures_;
+  std::vector<int> active_;  // 各过程在调用栈上的层数, 递归只计一次包含时间
+  std::vector<int> stack_;
+  std::map<std::vector<int>, std::uint64_t> folded_;
+  std::map<int, std::string> names_;
+  Clock::time_point started_;
+  Clock::time_point last_sample_;
+  std::chrono::nanoseconds elapsed_{0};
+  std::uint64_t sample_count_ = 0;
+};
+
+}  // namespace pl0
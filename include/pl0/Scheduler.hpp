@@ -0,0 +1,57 @@
+// 文件: Scheduler.hpp
+// 功能: 声明多程序调度器, 在线程池上并发运行互相独立的 P-Code 程序
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pl0/Diagnostics.hpp"
+#include "pl0/Options.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/VM.hpp"
+
+namespace pl0 {
+
+// 结构: 一个待运行的程序; options 中的 instruction_limit / time_limit 即该程序独立的预算
+struct ProgramJob {
+  InstructionSequence code;
+  std::string input;
+  RunnerOptions options;
+};
+
+// 结构: 程序的运行结果, 输出与诊断各自独立收集
+struct ProgramOutcome {
+  VirtualMachine::Result result;
+  std::string output;
+  DiagnosticSink diagnostics;
+};
+
+// 类: 多程序调度器
+//   每个程序使用独立的虚拟机 (自有栈与输入输出流), 程序之间不共享可变状态,
+//   因此可以铺满全部核心. 程序按 quantum 条指令分片轮转 (VirtualMachine::run_for),
+//   长程序不会让排在后面的短程序饿死; 超出预算的程序被终止, 不会长期占用工作线程
+class Scheduler {
+ public:
+  // 常量: 默认分片长度
+  static constexpr std::uint64_t kDefaultQuantum = 1 << 16;
+
+  // 构造: workers 为 0 时使用硬件并发数
+  explicit Scheduler(std::size_t workers = 0, std::uint64_t quantum = kDefaultQuantum);
+
+  // 函数: 登记程序, 返回其在结果中的下标
+  std::size_t submit(ProgramJob job);
+
+  // 函数: 并发运行已登记的全部程序, 按登记顺序返回结果并清空队列
+  std::vector<ProgramOutcome> run();
+
+  [[nodiscard]] std::size_t pending() const { return jobs_.size(); }
+
+ private:
+  std::size_t workers_;
+  std::uint64_t quantum_;
+  std::vector<ProgramJob> jobs_;
+};
+
+}  // namespace pl0
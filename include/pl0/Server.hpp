@@ -0,0 +1,56 @@
+// 文件: Server.hpp
+// 功能: 声明常驻编译/运行服务, 以 JSON Lines 协议经标准输入输出或 Unix 域套接字收发请求
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+
+#include "pl0/CompileCache.hpp"
+
+namespace pl0 {
+
+// 结构: 服务配置
+struct ServerOptions {
+  std::size_t workers = 0;                          // 工作线程数, 0 表示硬件并发数
+  std::chrono::milliseconds default_timeout{5000};  // 请求未指定 timeout_ms 时的运行时限
+  std::chrono::milliseconds max_timeout{60000};     // 请求可指定的最大运行时限
+  // 以下上限使单个请求的编译耗时与内存有界, 时限只约束运行阶段
+  std::size_t max_source_bytes = std::size_t{1} << 20;    // source 或 pcode 的最大字节数
+  std::size_t max_optimize_bytes = std::size_t{64} << 10; // 允许 "optimize" 的最大源码字节数
+  std::size_t stack_limit = std::size_t{1} << 24;         // 运行栈单元数上限 (每单元 8 字节), 0 表示不限
+  CompileCache* cache = nullptr;                    // 跨请求共享的编译缓存, 可为空
+};
+
+// 类: 编译/运行服务
+//   每行一个 JSON 对象请求, 每个请求得到一行 JSON 响应 (带回请求的 id, 并发处理时响应可能乱序):
+//     {"id":1,"op":"compile","source":"...","optimize":true,"bounds_check":false}
+//       -> {"id":1,"ok":true,"pcode":"...","diagnostics":[]}
+//     {"id":2,"op":"run","source":"..." | "pcode":"...","input":"1 2","timeout_ms":100}
+//       -> {"id":2,"ok":true,"status":"finished","output":"...","diagnostics":[]}
+//     {"op":"shutdown"} 停止接收新请求
+//   超出 ServerOptions 中源码大小上限的请求直接拒绝, 超出栈上限的程序以 stack_limit 状态终止
+//   进程内的关键字表、编译缓存与线程池在请求之间复用
+class Server {
+ public:
+  explicit Server(ServerOptions options);
+
+  // 函数: 同步处理单行请求并返回响应行 (不含换行), 可在多个线程中并发调用
+  std::string handle(std::string_view request);
+
+  // 函数: 从 input 逐行读取请求, 在线程池上并发处理, 响应写入 output; 读到 EOF 或 shutdown 后返回
+  void serve_stream(std::istream& input, std::ostream& output);
+
+  // 函数: 在 Unix 域套接字上接受连接, 每个连接按同样的协议收发; 返回进程退出码
+  int serve_unix_socket(const std::filesystem::path& path);
+
+ private:
+  ServerOptions options_;
+  std::atomic<bool> stopping_{false};
+};
+
+}  // namespace pl0
@@ -0,0 +1,46 @@
+// 文件: SourceBuffer.hpp
+// 功能: 声明只读源码缓冲, 普通文件以内存映射读入, 管道等不可映射的输入分块读入
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace pl0 {
+
+// 类: 一段只读源码文本; 可以持有映射区域或字符串, 也可以借用外部文本 (调用方保证其有效)
+class SourceBuffer {
+ public:
+  SourceBuffer() = default;
+  // 构造: 借用外部文本, 不复制
+  explicit SourceBuffer(std::string_view borrowed) : view_(borrowed) {}
+  ~SourceBuffer();
+
+  SourceBuffer(SourceBuffer&& other) noexcept;
+  SourceBuffer& operator=(SourceBuffer&& other) noexcept;
+  SourceBuffer(const SourceBuffer&) = delete;
+  SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+  // 函数: 取得字符串的所有权
+  static SourceBuffer from_string(std::string text);
+  // 函数: 打开文件; 普通文件映射到内存, 其余 (管道、设备、映射失败) 分块读入; 打开失败抛出 std::runtime_error
+  static SourceBuffer open(const std::filesystem::path& path);
+
+  [[nodiscard]] std::string_view view() const { return view_; }
+  [[nodiscard]] std::size_t size() const { return view_.size(); }
+  // 函数: 文本是否直接来自内存映射
+  [[nodiscard]] bool mapped() const { return mapping_ != nullptr; }
+  // 函数: 取出文本; 持有字符串时直接移出, 映射或借用的文本复制一份
+  [[nodiscard]] std::string take_string() &&;
+
+ private:
+  void release();
+
+  std::string owned_;
+  void* mapping_ = nullptr;
+  std::size_t mapping_size_ = 0;
+  std::string_view view_;
+};
+
+}  // namespace pl0
@@ -22,6 +22,7 @@ enum class Keyword : std::uint16_t {
   If,
   Odd,
   Procedure,
+  Function,
   Then,
   Var,
   While,
@@ -35,6 +36,7 @@ enum class Keyword : std::uint16_t {
   And,
   Or,
   Not,
+  Extern,
 };
 
 // 函数: 获取关键字映射表
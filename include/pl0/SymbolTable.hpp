@@ -18,6 +18,7 @@ enum class SymbolKind {
   Procedure,
   Parameter,
   Array,
+  Function,
 };
 
 // 结构: 符号信息记录
@@ -27,9 +28,10 @@ struct Symbol {
   VarType type = VarType::Integer;
   int level = 0;
   int address = 0;
-  std::size_t size = 1;
+  std::size_t size = 1;  // 数组: 元素个数; 过程/函数: 参数个数
   bool by_value = true;
   std::int64_t constant_value = 0;
+  int import = -1;  // extern 声明: 导入表中的序号, 此时 address 同为该序号, 链接时换成实际地址
 };
 
 // 类: 层级化符号表管理
@@ -42,6 +44,9 @@ class SymbolTable {
   };
 
   SymbolTable();
+  // 构造: 以 enclosing 的前 visible 个符号为只读外层, 不复制; 作用域层级接续 enclosing 的当前层级,
+  //   供多个线程各自生成过程体时共享全局符号, 期间 enclosing 不得修改
+  SymbolTable(const SymbolTable& enclosing, std::size_t visible);
 
   // 函数: 进入/离开作用域
   void enter_scope();
@@ -59,6 +64,10 @@ class SymbolTable {
   [[nodiscard]] const Symbol* lookup_in_current_scope(const std::string& name) const;
 
   [[nodiscard]] const std::vector<Symbol>& symbols() const { return symbols_; }
+  // 函数: 按下标修改本表中的符号, 用于链接后回填过程入口
+  [[nodiscard]] Symbol& symbol_at(std::size_t index) { return symbols_[index]; }
+  // 函数: 符号是否来自外层表
+  [[nodiscard]] bool inherited(const Symbol* symbol) const;
 
  private:
   // 结构: 作用域栈帧信息
@@ -69,6 +78,8 @@ class SymbolTable {
 
   std::vector<Symbol> symbols_;
   std::vector<ScopeFrame> scopes_;
+  const SymbolTable* enclosing_ = nullptr;
+  std::size_t enclosing_visible_ = 0;
 };
 
 }  // namespace pl0
@@ -0,0 +1,60 @@
+// 文件: ThreadPool.hpp
+// 功能: 声明工作窃取线程池, 供批量编译等粗粒度并行任务使用
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pl0 {
+
+// 类: 工作窃取线程池
+//   每个工作线程拥有一个双端队列: 自己从队尾取任务 (后进先出, 缓存友好),
+//   空闲时从其他线程的队首窃取; 外部提交的任务轮流分配到各队列, 工作线程内提交的任务进入自身队列
+class ThreadPool {
+ public:
+  // 构造: threads 为 0 时使用硬件并发数
+  explicit ThreadPool(std::size_t threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // 函数: 提交任务
+  void submit(std::function<void()> task);
+
+  // 函数: 等待已提交任务全部完成; 若有任务抛出异常, 重新抛出第一个
+  void wait();
+
+  [[nodiscard]] std::size_t size() const { return workers_.size(); }
+
+ private:
+  // 结构: 单个工作线程的任务队列
+  struct Queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void worker_loop(std::size_t index);
+  bool try_take(std::size_t index, std::function<void()>& task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  std::mutex state_mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  std::size_t queued_ = 0;   // 仍在队列中的任务
+  std::size_t pending_ = 0;  // 已提交但未完成的任务
+  bool stopping_ = false;
+  std::exception_ptr first_error_;
+  std::atomic<std::size_t> next_queue_{0};
+};
+
+}  // namespace pl0
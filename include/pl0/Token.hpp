@@ -52,6 +52,7 @@ enum class TokenKind : std::uint16_t {
   If,
   Odd,
   Procedure,
+  Function,
   Then,
   Var,
   While,
@@ -65,6 +66,7 @@ enum class TokenKind : std::uint16_t {
   And,
   Or,
   Not,
+  Extern,
 };
 
 // 结构: 词法单元信息
@@ -2,7 +2,10 @@
 // 功能: 声明通用工具函数
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -18,4 +21,83 @@ namespace pl0 {
 // 函数: 去除行尾回车
 void trim_trailing_cr(std::string& line);
 
+// 函数: 将完整的十进制文本解析为无符号整数; 空串、符号、尾随字符或溢出时返回空
+[[nodiscard]] std::optional<std::uint64_t> parse_unsigned(std::string_view text);
+
+// 常量: FNV-1a 64 位参数
+inline constexpr std::uint64_t kFnvOffset = 14695981039346656037ULL;
+inline constexpr std::uint64_t kFnvPrime = 1099511628211ULL;
+
+// 函数: FNV-1a 累加
+[[nodiscard]] std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes);
+
+// 类: 小端序字节写入器, 用于编译缓存、快照等二进制格式
+class ByteWriter {
+ public:
+  template <typename T>
+  void put(T value) {
+    auto bits = static_cast<std::uint64_t>(value);
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      bytes_.push_back(static_cast<char>((bits >> (8 * i)) & 0xFF));
+    }
+  }
+  void put_string(std::string_view text) {
+    put(static_cast<std::uint32_t>(text.size()));
+    bytes_.append(text);
+  }
+  void put_raw(const char* data, std::size_t size) { bytes_.append(data, size); }
+  [[nodiscard]] const std::string& bytes() const { return bytes_; }
+
+ private:
+  std::string bytes_;
+};
+
+// 类: 小端序字节读取器, 越界时置失败标志
+class ByteReader {
+ public:
+  explicit ByteReader(std::string_view bytes) : bytes_(bytes) {}
+
+  template <typename T>
+  T get() {
+    if (bytes_.size() - offset_ < sizeof(T)) {
+      ok_ = false;
+      return T{};
+    }
+    std::uint64_t bits = 0;
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(bytes_[offset_ + i]))
+              << (8 * i);
+    }
+    offset_ += sizeof(T);
+    return static_cast<T>(bits);
+  }
+  std::string get_string() {
+    auto size = get<std::uint32_t>();
+    if (!ok_ || bytes_.size() - offset_ < size) {
+      ok_ = false;
+      return {};
+    }
+    std::string text(bytes_.substr(offset_, size));
+    offset_ += size;
+    return text;
+  }
+  bool expect_raw(const char* data, std::size_t size) {
+    if (bytes_.size() - offset_ < size ||
+        bytes_.substr(offset_, size) != std::string_view(data, size)) {
+      ok_ = false;
+      return false;
+    }
+    offset_ += size;
+    return true;
+  }
+  [[nodiscard]] bool ok() const { return ok_; }
+  [[nodiscard]] bool at_end() const { return offset_ == bytes_.size(); }
+  [[nodiscard]] std::size_t remaining() const { return bytes_.size() - offset_; }
+
+ private:
+  std::string_view bytes_;
+  std::size_t offset_ = 0;
+  bool ok_ = true;
+};
+
 }  // namespace pl0
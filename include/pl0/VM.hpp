@@ -2,7 +2,9 @@
 // 功能: 声明基于栈的 P-Code 虚拟机
 #pragma once
 
+#include <chrono>
 #include <cstdint>
+#include <iosfwd>
 #include <vector>
 
 #include "pl0/Diagnostics.hpp"
@@ -11,23 +13,70 @@
 
 namespace pl0 {
 
+class Profiler;
+
 // 类: 执行 P-Code 指令的虚拟机
 class VirtualMachine {
  public:
   // 结构: 运行结果描述
   struct Result {
+    // 枚举: 执行状态; Suspended 表示分片用完, 可继续 run_for
+    enum class Status { Finished, Suspended, Failed };
+
+    Status status = Status::Finished;
     bool success = true;
     std::int64_t last_value = 0;
+    std::uint64_t instructions = 0;  // 在 count_instructions、设置 instruction_limit 或经 run_for 分片执行时统计
   };
 
   // 构造: 绑定诊断与运行选项
   VirtualMachine(DiagnosticSink& diagnostics, const RunnerOptions& options);
 
-  // 函数: 执行指令序列
+  // 函数: 执行指令序列直至结束, 按运行选项与剖析器选定一次特化的分派循环
   Result execute(const InstructionSequence& code);
 
+  // 函数: 准备分片执行, 把 code 转为紧凑编码供分派循环使用; code 在执行结束前须保持有效.
+  //   层次字段无法编码时报告 RuntimeError, 之后的 run_for 直接返回失败结果
+  void start(const InstructionSequence& code);
+
+  // 函数: 从上次挂起处继续执行约 slice 条指令 (在回跳与调用处才检查, 可能略有超出);
+  //   程序未结束时返回 Status::Suspended, 已结束后再次调用直接返回最终结果.
+  //   instruction_limit 与 time_limit 按整个程序累计, 挂起期间不计时
+  Result run_for(std::uint64_t slice);
+
+  // 函数: 下一次执行到 READ 时先挂起 (只生效一次), 便于在读取输入前保存热启动快照
+  void pause_before_read() { pause_before_read_ = true; }
+
+  // 函数: 将完整执行状态 (栈、寄存器、累计结果与已用时间) 写成紧凑的二进制快照;
+  //   输入输出流与剖析器不属于快照, 恢复方自行重新绑定
+  void save_snapshot(std::ostream& out) const;
+
+  // 函数: 从快照恢复状态, 之后可用 run_for 续跑; code 须与保存时为同一程序 (按指纹校验),
+  //   格式不符或数据损坏时抛出 std::runtime_error
+  void restore_snapshot(std::istream& in, const InstructionSequence& code);
+
+  // 函数: 挂接剖析器, 为空时不剖析
+  void set_profiler(Profiler* profiler) { profiler_ = profiler; }
+
+  // 函数: 指定程序的输入输出流 (默认 std::cin / std::cout), 跟踪输出同样写入 output
+  void set_io(std::istream& input, std::ostream& output) {
+    input_ = &input;
+    output_ = &output;
+  }
+
  private:
-  // 工具: 栈操作与静态链定位
+  // 函数: 分派循环, Policy 在编译期决定是否跟踪/剖析/检查/计数
+  template <typename Policy>
+  void run(const PackedProgram& program, std::uint64_t slice_end);
+
+  // 函数: 选定特化版本继续执行, slice 为本次分片的指令数
+  Result resume(std::uint64_t slice);
+
+  // 函数: 计算程序指纹
+  static std::uint64_t fingerprint(const InstructionSequence& code);
+
+  // 工具: 栈操作与静态链定位; grow 把栈扩到至少 cells 个单元, 超出 stack_limit 时抛出异常
+  void grow(std::size_t cells);
   void push(std::int64_t value);
   std::int64_t pop();
   std::int64_t& at(int index);
@@ -36,6 +85,14 @@ class VirtualMachine {
   // 成员: 运行时状态
   DiagnosticSink& diagnostics_;
   const RunnerOptions& options_;
+  Profiler* profiler_ = nullptr;
+  std::istream* input_;
+  std::ostream* output_;
+  const InstructionSequence* code_ = nullptr;
+  PackedProgram packed_;               // code_ 的紧凑编码与常量池, 分派循环只读取它
+  Result result_;                      // 当前程序的累计结果与状态
+  std::chrono::nanoseconds elapsed_{}; // 已挂起分片消耗的执行时间
+  bool pause_before_read_ = false;
   std::vector<std::int64_t> stack_;
   int stack_top_ = 0;
   int base_pointer_ = 0;
@@ -0,0 +1,31 @@
+// 文件: AST.cpp
+// 功能: 实现表达式节点的非递归析构
+#include "pl0/AST.hpp"
+
+namespace pl0 {
+
+// 析构: 有后代的子节点先移入显式栈, 逐个释放时再摘下它们的子节点, 调用栈深度恒定;
+//   叶子直接随父节点释放, 只有两层以上的树才分配栈
+Expression::~Expression() {
+  std::vector<ExprPtr> pending;
+  auto detach = [&pending](ExprPtr& child) {
+    if (!child) {
+      return;
+    }
+    bool has_children = false;
+    for_each_child(std::as_const(*child), [&has_children](const ExprPtr& grandchild) {
+      has_children = has_children || grandchild != nullptr;
+    });
+    if (has_children) {
+      pending.push_back(std::move(child));
+    }
+  };
+  for_each_child(*this, detach);
+  while (!pending.empty()) {
+    ExprPtr node = std::move(pending.back());
+    pending.pop_back();
+    for_each_child(*node, detach);
+  }
+}
+
+}  // namespace pl0
@@ -2,14 +2,28 @@
 // 功能: 实现 AST 到 P-Code 的指令生成
 #include "pl0/Codegen.hpp"
 
+#include <algorithm>
 #include <optional>
+#include <string>
+#include <thread>
 #include <utility>
 #include <variant>
 
+#include "pl0/ThreadPool.hpp"
+
 namespace pl0 {
 
 namespace {
 
+// 常量: 函数返回值单元, 即函数体帧的首个局部单元
+constexpr int kFunctionResultSlot = 3;
+
+// 常量: 全局符号所在层级; 符号表根作用域为第 0 层, 程序块进入后为第 1 层
+constexpr int kGlobalLevel = 1;
+
+// 常量: 并行生成顶层过程所需的最少源码行数, 更小的程序建线程池得不偿失
+constexpr std::size_t kParallelCodegenMinLines = 4096;
+
 // 结构: 多重访问器用于 visit
 template <typename... Ts>
 struct Overloaded : Ts... {
@@ -38,6 +52,65 @@ std::optional<Opr> operation_for_assignment(AssignmentOperator op) {
   return std::nullopt;
 }
 
+// 函数: 二元运算对应的 OPR 操作码
+Opr binary_operation(BinaryOp op) {
+  switch (op) {
+    case BinaryOp::Add:
+      return Opr::ADD;
+    case BinaryOp::Subtract:
+      return Opr::SUB;
+    case BinaryOp::Multiply:
+      return Opr::MUL;
+    case BinaryOp::Divide:
+      return Opr::DIV;
+    case BinaryOp::Modulo:
+      return Opr::MOD;
+    case BinaryOp::Equal:
+      return Opr::EQ;
+    case BinaryOp::NotEqual:
+      return Opr::NE;
+    case BinaryOp::Less:
+      return Opr::LT;
+    case BinaryOp::LessEqual:
+      return Opr::LE;
+    case BinaryOp::Greater:
+      return Opr::GT;
+    case BinaryOp::GreaterEqual:
+      return Opr::GE;
+    case BinaryOp::And:
+      return Opr::AND;
+    case BinaryOp::Or:
+      return Opr::OR;
+  }
+  return Opr::ADD;
+}
+
+// 函数: 一元运算对应的 OPR 操作码; 正号不生成指令, 不会查询
+Opr unary_operation(UnaryOp op) {
+  switch (op) {
+    case UnaryOp::Positive:
+    case UnaryOp::Negative:
+      return Opr::NEG;
+    case UnaryOp::Not:
+      return Opr::NOT;
+    case UnaryOp::Odd:
+      return Opr::ODD;
+  }
+  return Opr::NEG;
+}
+
+// 函数: 并行生成顶层过程所用的线程数; 程序太小或只允许单线程时返回 1, 此时就地逐个生成
+std::size_t parallel_workers(const std::vector<ProcedureDecl>& procedures,
+                             const CompilerOptions& options) {
+  if (options.threads == 1 || procedures.size() < 2 ||
+      procedures.back().range.end.line <
+          procedures.front().range.begin.line + kParallelCodegenMinLines) {
+    return 1;
+  }
+  return options.threads == 0 ? std::max(1u, std::thread::hardware_concurrency())
+                              : options.threads;
+}
+
 }  // namespace
 
 // 构造: 绑定符号表、输出缓冲与诊断器
@@ -51,9 +124,21 @@ void CodeGenerator::emit_program(const Program& program) {
   emit_block(program.block);
 }
 
+// 函数: 生成目标文件代码, 地址均相对本模块, 由链接器按 relocations 修正
+void CodeGenerator::emit_module(const Program& program, std::vector<Relocation>& relocations) {
+  module_ = true;
+  relocations_ = &relocations;
+  emit_block(program.block);
+  relocations_ = nullptr;
+  module_ = false;
+}
+
 // 函数: 写入单条指令并返回索引
 int CodeGenerator::emit_instruction(const Instruction& instr) {
   output_.push_back(instr);
+  if (relocations_ && (instr.op == Op::JMP || instr.op == Op::JPC)) {
+    relocations_->push_back({Relocation::Kind::Local, output_.size() - 1});
+  }
   return static_cast<int>(output_.size()) - 1;
 }
 
@@ -65,10 +150,34 @@ void CodeGenerator::patch(int index, int target) {
 }
 
 // 函数: 生成块级代码, 包含声明与语句
-void CodeGenerator::emit_block(const Block& block) {
+//   调用约定: 调用者依次压入实参后 CAL, 实参紧贴被调帧之下, 无需再拷贝;
+//   n 个参数中的第 i 个位于偏移 i - n, 返回时由 OPR n RET/RETV 一并弹出
+void CodeGenerator::emit_block(const Block& block, const ProcedureDecl* routine) {
   symbols_.enter_scope();
-  auto& scope = symbols_.current_scope();
-  scope.data_offset = 3;
+  symbols_.current_scope().data_offset = 3;
+
+  const int arity = routine ? static_cast<int>(routine->parameters.size()) : 0;
+  const bool returns_value = routine && routine->is_function;
+  for (int i = 0; i < arity; ++i) {
+    const auto& param = routine->parameters[static_cast<std::size_t>(i)];
+    if (symbols_.lookup_in_current_scope(param.name)) {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::Redeclaration,
+                           "redeclaration of parameter '" + param.name + "'",
+                           param.range});
+      continue;
+    }
+    Symbol symbol;
+    symbol.name = param.name;
+    symbol.kind = SymbolKind::Parameter;
+    symbol.address = i - arity;
+    symbol.size = 1;
+    symbol.by_value = true;
+    exported_symbols_.push_back(symbols_.add_symbol(std::move(symbol)));
+  }
+  if (returns_value) {
+    functions_.push_back({routine->name, symbols_.current_scope().level});
+    symbols_.current_scope().data_offset = kFunctionResultSlot + 1;
+  }
 
   int jump_index = emit_instruction({Op::JMP, 0, 0});
 
@@ -76,43 +185,59 @@ void CodeGenerator::emit_block(const Block& block) {
     emit_const(decl);
   }
 
+  for (const auto& decl : block.externs) {
+    if (routine || !module_) {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
+                           routine ? "extern declarations are only allowed at program level"
+                                   : "extern '" + decl.name +
+                                         "' requires separate compilation (pl0c -c)",
+                           decl.range});
+    }
+    // 出错时仍登记, 避免后续引用再报未声明
+    emit_extern(decl);
+  }
+
   for (const auto& decl : block.vars) {
     emit_var(decl);
   }
 
-  struct ProcedureContext {
-    const ProcedureDecl* decl;
-    Symbol* symbol;
-  };
-
-  std::vector<ProcedureContext> procedures;
-  procedures.reserve(block.procedures.size());
-
-  for (const auto& proc : block.procedures) {
-    if (symbols_.lookup_in_current_scope(proc.name)) {
-      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::Redeclaration,
-                           "redeclaration of procedure '" + proc.name + "'",
-                           proc.range});
-      continue;
+  // 过程按声明顺序登记并立即生成, 以便调用点取得确定的入口地址;
+  // 大程序的顶层过程改为并行生成片段后按同一顺序链接, 结果相同
+  const std::size_t workers =
+      routine || module_ ? 1 : parallel_workers(block.procedures, options_);
+  if (workers > 1) {
+    emit_top_level_procedures(block.procedures, workers);
+  } else {
+    for (const auto& proc : block.procedures) {
+      if (symbols_.lookup_in_current_scope(proc.name)) {
+        diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::Redeclaration,
+                             "redeclaration of procedure '" + proc.name + "'",
+                             proc.range});
+        continue;
+      }
+      Symbol symbol;
+      symbol.name = proc.name;
+      symbol.kind = proc.is_function ? SymbolKind::Function : SymbolKind::Procedure;
+      symbol.address = 0;
+      symbol.size = proc.parameters.size();
+      emit_procedure(proc, symbols_.add_symbol(std::move(symbol)));
     }
-    Symbol symbol;
-    symbol.name = proc.name;
-    symbol.kind = SymbolKind::Procedure;
-    symbol.address = 0;
-    symbol.size = 0;
-    auto& entry = symbols_.add_symbol(std::move(symbol));
-    procedures.push_back({&proc, &entry});
-  }
-
-  for (auto& proc : procedures) {
-    emit_procedure(*proc.decl, *proc.symbol);
   }
 
   patch(jump_index, static_cast<int>(output_.size()));
 
-  emit_instruction({Op::INT, 0, scope.data_offset});
+  const int frame = emit_instruction({Op::INT, 0, symbols_.current_scope().data_offset});
+  if (module_ && !routine) {
+    relocations_->push_back({Relocation::Kind::FrameSize, static_cast<std::size_t>(frame)});
+  }
   emit_statements(block.statements);
-  emit_instruction({Op::OPR, 0, static_cast<int>(Opr::RET)});
+  if (returns_value) {
+    emit_instruction({Op::LOD, 0, kFunctionResultSlot});
+    emit_instruction({Op::OPR, arity, static_cast<int>(Opr::RETV)});
+    functions_.pop_back();
+  } else {
+    emit_instruction({Op::OPR, arity, static_cast<int>(Opr::RET)});
+  }
 
   symbols_.leave_scope();
 }
@@ -124,7 +249,9 @@ void CodeGenerator::emit_statement(const Statement& stmt) {
           [&](const AssignmentStmt& assignment) {
             emit_assignment(assignment, stmt.range);
           },
-          [&](const CallStmt& call) { emit_call(call.callee, call.arguments, stmt.range); },
+          [&](const CallStmt& call) {
+            emit_call(call.callee, call.arguments, stmt.range, false);
+          },
           [&](const IfStmt& conditional) { emit_if(conditional); },
           [&](const WhileStmt& loop) { emit_while(loop); },
           [&](const RepeatStmt& loop) { emit_repeat(loop); },
@@ -158,6 +285,19 @@ void CodeGenerator::emit_assignment(const AssignmentStmt& stmt,
   }
 
   int level_diff = symbols_.current_scope().level - symbol->level;
+  int address = symbol->address;
+  if (symbol->kind == SymbolKind::Function || symbol->kind == SymbolKind::Procedure) {
+    // 在函数体内给函数名赋值即设置返回值
+    auto result_level = function_result_level(*symbol);
+    if (!result_level || stmt.index) {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
+                           "cannot assign to '" + stmt.target + "' outside its function body",
+                           range});
+      return;
+    }
+    level_diff = *result_level;
+    address = kFunctionResultSlot;
+  }
   auto compound = operation_for_assignment(stmt.op);
   if (stmt.index) {
     if (symbol->kind != SymbolKind::Array) {
@@ -166,12 +306,9 @@ void CodeGenerator::emit_assignment(const AssignmentStmt& stmt,
                            range});
       return;
     }
-    emit_instruction({Op::LDA, level_diff, symbol->address});
+    note_reference(emit_instruction({Op::LDA, level_diff, symbol->address}), *symbol);
     emit_expression(*stmt.index);
-    if (options_.enable_bounds_check && symbol->size > 0) {
-      emit_instruction({Op::CHK, 0, static_cast<int>(symbol->size)});
-    }
-    emit_instruction({Op::IDX, 0, 0});
+    emit_element_address(*symbol);
     if (!compound) {
       emit_expression(*stmt.value);
     } else {
@@ -185,34 +322,83 @@ void CodeGenerator::emit_assignment(const AssignmentStmt& stmt,
     if (!compound) {
       emit_expression(*stmt.value);
     } else {
-      emit_instruction({Op::LOD, level_diff, symbol->address});
+      const int load = emit_instruction({Op::LOD, level_diff, address});
+      if (address == symbol->address) {
+        note_reference(load, *symbol);
+      }
       emit_expression(*stmt.value);
       emit_instruction({Op::OPR, 0, static_cast<int>(*compound)});
     }
-    emit_instruction({Op::STO, level_diff, symbol->address});
+    const int store = emit_instruction({Op::STO, level_diff, address});
+    if (address == symbol->address) {
+      note_reference(store, *symbol);
+    }
   }
 }
 
-// 函数: 生成过程调用指令
+// 函数: 生成过程/函数调用, 实参按顺序求值压栈后 CAL
+//   作为语句调用函数时丢弃返回值
 void CodeGenerator::emit_call(const std::string& callee,
                               const std::vector<ExprPtr>& arguments,
-                              const SourceRange& range) {
-  const Symbol* symbol = resolve(callee, range);
+                              const SourceRange& range, bool want_value) {
+  const Symbol* symbol = resolve_callee(callee, arguments.size(), range, want_value);
   if (!symbol) {
     return;
   }
-  if (symbol->kind != SymbolKind::Procedure) {
+  for (const auto& argument : arguments) {
+    if (argument) {
+      emit_expression(*argument);
+    }
+  }
+  emit_call_instruction(*symbol, want_value);
+}
+
+// 函数: 查找被调过程并检查种类与实参个数, 不合法时报告并返回空
+const Symbol* CodeGenerator::resolve_callee(const std::string& callee,
+                                            std::size_t argument_count,
+                                            const SourceRange& range, bool want_value) {
+  const Symbol* symbol = resolve(callee, range);
+  if (!symbol) {
+    return nullptr;
+  }
+  if (symbol->kind != SymbolKind::Procedure && symbol->kind != SymbolKind::Function) {
     diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
                          "identifier '" + callee + "' is not a procedure",
                          range});
-    return;
+    return nullptr;
   }
-  if (!arguments.empty()) {
-    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::UnexpectedToken,
-                         "procedure parameters are not supported yet", range});
+  if (want_value && symbol->kind != SymbolKind::Function) {
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
+                         "procedure '" + callee + "' does not return a value", range});
+    return nullptr;
+  }
+  if (argument_count != symbol->size) {
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::ArgumentCountMismatch,
+                         "'" + callee + "' expects " + std::to_string(symbol->size) +
+                             " argument(s) but got " + std::to_string(argument_count),
+                         range});
+    return nullptr;
+  }
+  return symbol;
+}
+
+// 函数: 实参已入栈后生成 CAL, 作为语句调用函数时丢弃返回值
+void CodeGenerator::emit_call_instruction(const Symbol& symbol, bool want_value) {
+  const int level_diff = symbols_.current_scope().level - symbol.level;
+  const int call = emit_instruction({Op::CAL, level_diff, symbol.address});
+  if (relocations_) {
+    // 外层的顶层过程在片段生成时尚无入口地址, address 为其过程编号; extern 过程为导入序号
+    auto kind = Relocation::Kind::Local;
+    if (symbol.import >= 0) {
+      kind = Relocation::Kind::Import;
+    } else if (symbols_.inherited(&symbol)) {
+      kind = Relocation::Kind::Procedure;
+    }
+    relocations_->push_back({kind, static_cast<std::size_t>(call)});
+  }
+  if (symbol.kind == SymbolKind::Function && !want_value) {
+    emit_instruction({Op::INT, 0, -1});
   }
-  int level_diff = symbols_.current_scope().level - symbol->level;
-  emit_instruction({Op::CAL, level_diff, symbol->address});
 }
 
 // 函数: 生成 if/else 控制流
@@ -263,9 +449,14 @@ void CodeGenerator::emit_read(const ReadStmt& stmt, const SourceRange& range) {
                            "cannot read into constant '" + name + "'", range});
       continue;
     }
+    if (symbol->kind == SymbolKind::Procedure || symbol->kind == SymbolKind::Function) {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
+                           "cannot read into '" + name + "'", range});
+      continue;
+    }
     int level_diff = symbols_.current_scope().level - symbol->level;
     emit_instruction({Op::OPR, 0, static_cast<int>(Opr::READ)});
-    emit_instruction({Op::STO, level_diff, symbol->address});
+    note_reference(emit_instruction({Op::STO, level_diff, symbol->address}), *symbol);
   }
 }
 
@@ -281,97 +472,79 @@ void CodeGenerator::emit_write(const WriteStmt& stmt) {
 }
 
 // 函数: 遍历表达式节点生成指令
-void CodeGenerator::emit_expression(const Expression& expr) {
-  std::visit(
-      Overloaded{
-          [&](const NumberLiteral& literal) {
-            emit_instruction({Op::LIT, 0, static_cast<int>(literal.value)});
-          },
-          [&](const BooleanLiteral& literal) {
-            emit_instruction({Op::LIT, 0, literal.value ? 1 : 0});
-          },
-          [&](const IdentifierExpr& ident) { emit_identifier(ident, expr.range); },
-          [&](const ArrayAccessExpr& access) {
-            emit_array_access(access, expr.range, true);
-          },
-          [&](const BinaryExpr& binary) { emit_binary(binary); },
-          [&](const UnaryExpr& unary) { emit_unary(unary); },
-          [&](const CallExpr&) {
-            diagnostics_.report({DiagnosticLevel::Error,
-                                 DiagnosticCode::UnexpectedToken,
-                                 "procedure call cannot be used as expression",
-                                 expr.range});
-          }},
-      expr.value);
-}
-
-// 函数: 对二元运算生成对应 OPR
-void CodeGenerator::emit_binary(const BinaryExpr& expr) {
-  emit_expression(*expr.lhs);
-  emit_expression(*expr.rhs);
-  Opr operation;
-  switch (expr.op) {
-    case BinaryOp::Add:
-      operation = Opr::ADD;
-      break;
-    case BinaryOp::Subtract:
-      operation = Opr::SUB;
-      break;
-    case BinaryOp::Multiply:
-      operation = Opr::MUL;
-      break;
-    case BinaryOp::Divide:
-      operation = Opr::DIV;
-      break;
-    case BinaryOp::Modulo:
-      operation = Opr::MOD;
-      break;
-    case BinaryOp::Equal:
-      operation = Opr::EQ;
-      break;
-    case BinaryOp::NotEqual:
-      operation = Opr::NE;
-      break;
-    case BinaryOp::Less:
-      operation = Opr::LT;
-      break;
-    case BinaryOp::LessEqual:
-      operation = Opr::LE;
-      break;
-    case BinaryOp::Greater:
-      operation = Opr::GT;
-      break;
-    case BinaryOp::GreaterEqual:
-      operation = Opr::GE;
-      break;
-    case BinaryOp::And:
-      operation = Opr::AND;
-      break;
-    case BinaryOp::Or:
-      operation = Opr::OR;
-      break;
+//   显式栈后序遍历: 先做名称检查并压入收尾项, 再逆序压入子表达式, 深层表达式不占用调用栈;
+//   检查失败的数组访问与调用不生成其子表达式, 与逐层递归生成的指令和诊断完全相同
+void CodeGenerator::emit_expression(const Expression& root) {
+  auto& stack = expression_stack_;
+  const std::size_t base = stack.size();
+  stack.push_back({&root, nullptr, false});
+  while (stack.size() > base) {
+    const ExpressionTask task = stack.back();
+    stack.pop_back();
+    const Expression& expr = *task.expr;
+    if (task.finish) {
+      finish_expression(expr, task.symbol);
+      continue;
+    }
+    std::visit(
+        Overloaded{
+            [&](const NumberLiteral& literal) {
+              emit_instruction(load_constant(literal.value));
+            },
+            [&](const BooleanLiteral& literal) {
+              emit_instruction({Op::LIT, 0, literal.value ? 1 : 0});
+            },
+            [&](const IdentifierExpr& ident) { emit_identifier(ident, expr.range); },
+            [&](const ArrayAccessExpr& access) {
+              const Symbol* symbol = resolve_array(access.name, expr.range);
+              if (!symbol) {
+                return;
+              }
+              const int level_diff = symbols_.current_scope().level - symbol->level;
+              note_reference(emit_instruction({Op::LDA, level_diff, symbol->address}), *symbol);
+              stack.push_back({&expr, symbol, true});
+              stack.push_back({access.index.get(), nullptr, false});
+            },
+            [&](const BinaryExpr& binary) {
+              stack.push_back({&expr, nullptr, true});
+              stack.push_back({binary.rhs.get(), nullptr, false});
+              stack.push_back({binary.lhs.get(), nullptr, false});
+            },
+            [&](const UnaryExpr& unary) {
+              stack.push_back({&expr, nullptr, true});
+              stack.push_back({unary.operand.get(), nullptr, false});
+            },
+            [&](const CallExpr& call) {
+              const Symbol* symbol =
+                  resolve_callee(call.callee, call.arguments.size(), expr.range, true);
+              if (!symbol) {
+                return;
+              }
+              stack.push_back({&expr, symbol, true});
+              for (auto it = call.arguments.rbegin(); it != call.arguments.rend(); ++it) {
+                if (*it) {
+                  stack.push_back({it->get(), nullptr, false});
+                }
+              }
+            }},
+        expr.value);
   }
-  emit_instruction({Op::OPR, 0, static_cast<int>(operation)});
 }
 
-// 函数: 对一元运算生成对应 OPR
-void CodeGenerator::emit_unary(const UnaryExpr& expr) {
-  emit_expression(*expr.operand);
-  Opr operation;
-  switch (expr.op) {
-    case UnaryOp::Positive:
-      return;
-    case UnaryOp::Negative:
-      operation = Opr::NEG;
-      break;
-    case UnaryOp::Not:
-      operation = Opr::NOT;
-      break;
-    case UnaryOp::Odd:
-      operation = Opr::ODD;
-      break;
+// 函数: 子表达式均已生成后, 补上运算、下标或调用指令
+void CodeGenerator::finish_expression(const Expression& expr, const Symbol* symbol) {
+  if (const auto* binary = std::get_if<BinaryExpr>(&expr.value)) {
+    emit_instruction({Op::OPR, 0, static_cast<int>(binary_operation(binary->op))});
+  } else if (const auto* unary = std::get_if<UnaryExpr>(&expr.value)) {
+    if (unary->op != UnaryOp::Positive) {
+      emit_instruction({Op::OPR, 0, static_cast<int>(unary_operation(unary->op))});
+    }
+  } else if (std::holds_alternative<ArrayAccessExpr>(expr.value)) {
+    emit_element_address(*symbol);
+    emit_instruction({Op::LDI, 0, 0});
+  } else if (std::holds_alternative<CallExpr>(expr.value)) {
+    emit_call_instruction(*symbol, true);
   }
-  emit_instruction({Op::OPR, 0, static_cast<int>(operation)});
 }
 
 // 函数: 按标识符种类加载值
@@ -384,11 +557,11 @@ void CodeGenerator::emit_identifier(const IdentifierExpr& expr,
   int level_diff = symbols_.current_scope().level - symbol->level;
   switch (symbol->kind) {
     case SymbolKind::Constant:
-      emit_instruction({Op::LIT, 0, static_cast<int>(symbol->constant_value)});
+      emit_instruction(load_constant(symbol->constant_value));
       break;
     case SymbolKind::Variable:
     case SymbolKind::Parameter:
-      emit_instruction({Op::LOD, level_diff, symbol->address});
+      note_reference(emit_instruction({Op::LOD, level_diff, symbol->address}), *symbol);
       break;
     case SymbolKind::Array:
       diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidArraySubscript,
@@ -399,31 +572,34 @@ void CodeGenerator::emit_identifier(const IdentifierExpr& expr,
                            "procedure '" + expr.name + "' cannot be used as value",
                            range});
       break;
+    case SymbolKind::Function:
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidAssignmentTarget,
+                           "function '" + expr.name + "' must be called with '()'",
+                           range});
+      break;
   }
 }
 
-// 函数: 数组访问生成地址与可选加载
-void CodeGenerator::emit_array_access(const ArrayAccessExpr& expr,
-                                      const SourceRange& range, bool load_value) {
-  const Symbol* symbol = resolve(expr.name, range);
+// 函数: 查找下标访问的数组, 不是数组时报告并返回空
+const Symbol* CodeGenerator::resolve_array(const std::string& name, const SourceRange& range) {
+  const Symbol* symbol = resolve(name, range);
   if (!symbol) {
-    return;
+    return nullptr;
   }
   if (symbol->kind != SymbolKind::Array) {
     diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidArraySubscript,
-                         "identifier '" + expr.name + "' is not an array", range});
-    return;
+                         "identifier '" + name + "' is not an array", range});
+    return nullptr;
   }
-  int level_diff = symbols_.current_scope().level - symbol->level;
-  emit_instruction({Op::LDA, level_diff, symbol->address});
-  emit_expression(*expr.index);
-  if (options_.enable_bounds_check && symbol->size > 0) {
-    emit_instruction({Op::CHK, 0, static_cast<int>(symbol->size)});
+  return symbol;
+}
+
+// 函数: 数组基址与下标已入栈后, 生成可选的越界检查与元素地址计算
+void CodeGenerator::emit_element_address(const Symbol& array) {
+  if (options_.enable_bounds_check && array.size > 0) {
+    emit_instruction({Op::CHK, 0, static_cast<int>(array.size)});
   }
   emit_instruction({Op::IDX, 0, 0});
-  if (load_value) {
-    emit_instruction({Op::LDI, 0, 0});
-  }
 }
 
 // 函数: 记录常量并检测重定义
@@ -468,13 +644,127 @@ void CodeGenerator::emit_var(const VarDecl& decl) {
   scope.data_offset += static_cast<int>(size);
 }
 
+// 函数: 登记 extern 声明, 地址暂为导入序号
+void CodeGenerator::emit_extern(const ExternDecl& decl) {
+  if (symbols_.lookup_in_current_scope(decl.name)) {
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::Redeclaration,
+                         "redeclaration of '" + decl.name + "'", decl.range});
+    return;
+  }
+  Symbol symbol;
+  symbol.name = decl.name;
+  switch (decl.kind) {
+    case ExternDecl::Kind::Variable:
+      symbol.kind = decl.array_size ? SymbolKind::Array : SymbolKind::Variable;
+      symbol.size = std::max<std::size_t>(decl.array_size.value_or(1), 1);
+      break;
+    case ExternDecl::Kind::Procedure:
+      symbol.kind = SymbolKind::Procedure;
+      symbol.size = decl.arity;
+      break;
+    case ExternDecl::Kind::Function:
+      symbol.kind = SymbolKind::Function;
+      symbol.size = decl.arity;
+      break;
+  }
+  symbol.import = static_cast<int>(imports_.size());
+  symbol.address = symbol.import;
+  imports_.push_back(symbols_.add_symbol(std::move(symbol)));
+}
+
+// 函数: 记录需要链接时修正的全局变量或外部符号引用
+void CodeGenerator::note_reference(int index, const Symbol& symbol) {
+  if (!module_) {
+    return;
+  }
+  if (symbol.import >= 0) {
+    relocations_->push_back({Relocation::Kind::Import, static_cast<std::size_t>(index)});
+  } else if (symbol.level == kGlobalLevel &&
+             (symbol.kind == SymbolKind::Variable || symbol.kind == SymbolKind::Array)) {
+    relocations_->push_back({Relocation::Kind::Data, static_cast<std::size_t>(index)});
+  }
+}
+
 // 函数: 为过程分配入口并生成函数体
 void CodeGenerator::emit_procedure(const ProcedureDecl& decl, Symbol& symbol) {
   symbol.address = static_cast<int>(output_.size());
   exported_symbols_.push_back(symbol);
+  // 注意: 生成函数体会向符号表追加符号, 此后 symbol 引用可能失效
+  if (decl.body) {
+    emit_block(*decl.body, &decl);
+  }
+}
+
+// 函数: 登记全部顶层过程, 在线程池上各自生成可重定位片段, 再按声明顺序链接
+//   诊断与导出符号按声明顺序合并, 结果与逐个就地生成完全相同
+void CodeGenerator::emit_top_level_procedures(const std::vector<ProcedureDecl>& procedures,
+                                              std::size_t workers) {
+  const std::size_t count = procedures.size();
+  std::vector<CodeFragment> fragments(count);
+  std::vector<std::optional<std::size_t>> symbol_indices(count);
+  std::vector<std::size_t> visible(count, 0);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto& proc = procedures[i];
+    if (symbols_.lookup_in_current_scope(proc.name)) {
+      fragments[i].diagnostics.push_back({DiagnosticLevel::Error, DiagnosticCode::Redeclaration,
+                                          "redeclaration of procedure '" + proc.name + "'",
+                                          proc.range});
+      continue;
+    }
+    Symbol symbol;
+    symbol.name = proc.name;
+    symbol.kind = proc.is_function ? SymbolKind::Function : SymbolKind::Procedure;
+    symbol.address = static_cast<int>(i);  // 链接前以过程编号代替入口地址
+    symbol.size = proc.parameters.size();
+    symbols_.add_symbol(std::move(symbol));
+    symbol_indices[i] = symbols_.symbols().size() - 1;
+    // 过程只能看到自身及先前声明的过程
+    visible[i] = symbols_.symbols().size();
+  }
+
+  // 过程大小不一, 切成线程数数倍的连续分段交给工作窃取调度
+  const std::size_t tasks = std::min(count, workers * 4);
+  ThreadPool pool(std::min(workers, tasks));
+  for (std::size_t task = 0; task < tasks; ++task) {
+    pool.submit([&, task] {
+      for (std::size_t i = count * task / tasks; i < count * (task + 1) / tasks; ++i) {
+        if (symbol_indices[i]) {
+          fragments[i] = emit_fragment(procedures[i], symbols_, visible[i], options_);
+        }
+      }
+    });
+  }
+  pool.wait();
+
+  std::vector<int> addresses(count, 0);
+  for (std::size_t i = 0; i < count; ++i) {
+    for (auto& diagnostic : fragments[i].diagnostics) {
+      diagnostics_.report(std::move(diagnostic));
+    }
+    if (!symbol_indices[i]) {
+      continue;
+    }
+    Symbol& symbol = symbols_.symbol_at(*symbol_indices[i]);
+    symbol.address = addresses[i] = static_cast<int>(output_.size());
+    exported_symbols_.push_back(symbol);
+    link_fragment(fragments[i], addresses, output_, exported_symbols_);
+  }
+}
+
+// 函数: 以外层表为只读全局作用域, 用独立的生成器输出单个顶层过程
+CodeFragment CodeGenerator::emit_fragment(const ProcedureDecl& decl, const SymbolTable& enclosing,
+                                          std::size_t visible, const CompilerOptions& options) {
+  CodeFragment fragment;
+  SymbolTable symbols(enclosing, visible);
+  DiagnosticSink diagnostics;
+  CodeGenerator generator(symbols, fragment.code, diagnostics, options);
+  generator.relocations_ = &fragment.relocations;
   if (decl.body) {
-    emit_block(*decl.body);
+    generator.emit_block(*decl.body, &decl);
   }
+  fragment.symbols = std::move(generator.exported_symbols_);
+  fragment.diagnostics = diagnostics.diagnostics();
+  return fragment;
 }
 
 // 函数: 查找符号并在缺失时报告错误
@@ -488,4 +778,39 @@ const Symbol* CodeGenerator::resolve(const std::string& name,
   return symbol;
 }
 
+// 函数: 查找正在生成的同名函数, 返回当前作用域到其函数体帧的层差
+std::optional<int> CodeGenerator::function_result_level(const Symbol& symbol) const {
+  if (symbol.kind != SymbolKind::Function) {
+    return std::nullopt;
+  }
+  for (auto it = functions_.rbegin(); it != functions_.rend(); ++it) {
+    if (it->name == symbol.name && it->level == symbol.level + 1) {
+      return symbols_.current_scope().level - it->level;
+    }
+  }
+  return std::nullopt;
+}
+
+// 函数: 追加片段并修正片段内地址与过程引用
+int link_fragment(const CodeFragment& fragment, const std::vector<int>& procedure_addresses,
+                  InstructionSequence& output, std::vector<Symbol>& symbols) {
+  const int base = static_cast<int>(output.size());
+  output.insert(output.end(), fragment.code.begin(), fragment.code.end());
+  for (const auto& relocation : fragment.relocations) {
+    auto& instr = output[static_cast<std::size_t>(base) + relocation.index];
+    if (relocation.kind == Relocation::Kind::Local) {
+      instr.argument += base;
+    } else {
+      instr.argument = procedure_addresses.at(static_cast<std::size_t>(instr.argument));
+    }
+  }
+  for (auto symbol : fragment.symbols) {
+    if (symbol.kind == SymbolKind::Procedure || symbol.kind == SymbolKind::Function) {
+      symbol.address += base;
+    }
+    symbols.push_back(std::move(symbol));
+  }
+  return base;
+}
+
 }  // namespace pl0
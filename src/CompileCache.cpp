@@ -0,0 +1,238 @@
+// 文件: CompileCache.cpp
+// 功能: 实现编译缓存的键计算、二进制条目读写与 LRU 淘汰
+#include "pl0/CompileCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include "pl0/Utility.hpp"
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 条目文件魔数与扩展名
+constexpr char kEntryMagic[8] = {'P', 'L', '0', 'C', 'A', 'C', 'H', 'E'};
+constexpr std::string_view kEntryExtension = ".pl0c";
+
+// 函数: 编码条目
+std::string encode_entry(std::uint64_t key, const InstructionSequence& code,
+                         const std::vector<Symbol>& symbols) {
+  ByteWriter writer;
+  writer.put_raw(kEntryMagic, sizeof(kEntryMagic));
+  writer.put(CompileCache::kCompilerVersion);
+  writer.put(key);
+  writer.put(static_cast<std::uint32_t>(code.size()));
+  for (const auto& instr : code) {
+    writer.put(static_cast<std::uint8_t>(instr.op));
+    writer.put(instr.level);
+    writer.put(instr.argument);
+  }
+  writer.put(static_cast<std::uint32_t>(symbols.size()));
+  for (const auto& symbol : symbols) {
+    writer.put_string(symbol.name);
+    writer.put(static_cast<std::uint8_t>(symbol.kind));
+    writer.put(static_cast<std::uint8_t>(symbol.type));
+    writer.put(static_cast<std::int32_t>(symbol.level));
+    writer.put(static_cast<std::int32_t>(symbol.address));
+    writer.put(static_cast<std::uint64_t>(symbol.size));
+    writer.put(static_cast<std::uint8_t>(symbol.by_value ? 1 : 0));
+    writer.put(symbol.constant_value);
+  }
+  return writer.bytes();
+}
+
+// 函数: 解码条目, 任何字段不合法都返回空
+std::optional<CompileCache::Entry> decode_entry(std::string_view bytes, std::uint64_t key) {
+  ByteReader reader(bytes);
+  if (!reader.expect_raw(kEntryMagic, sizeof(kEntryMagic)) ||
+      reader.get<std::uint32_t>() != CompileCache::kCompilerVersion ||
+      reader.get<std::uint64_t>() != key) {
+    return std::nullopt;
+  }
+  CompileCache::Entry entry;
+  const auto instruction_count = reader.get<std::uint32_t>();
+  for (std::uint32_t i = 0; i < instruction_count && reader.ok(); ++i) {
+    Instruction instr;
+    const auto op = reader.get<std::uint8_t>();
+    if (op > static_cast<std::uint8_t>(Op::LDC)) {
+      return std::nullopt;
+    }
+    instr.op = static_cast<Op>(op);
+    instr.level = reader.get<std::int32_t>();
+    instr.argument = reader.get<std::int32_t>();
+    entry.code.push_back(instr);
+  }
+  const auto symbol_count = reader.get<std::uint32_t>();
+  for (std::uint32_t i = 0; i < symbol_count && reader.ok(); ++i) {
+    Symbol symbol;
+    symbol.name = reader.get_string();
+    const auto kind = reader.get<std::uint8_t>();
+    const auto type = reader.get<std::uint8_t>();
+    if (kind > static_cast<std::uint8_t>(SymbolKind::Function) ||
+        type > static_cast<std::uint8_t>(VarType::Boolean)) {
+      return std::nullopt;
+    }
+    symbol.kind = static_cast<SymbolKind>(kind);
+    symbol.type = static_cast<VarType>(type);
+    symbol.level = reader.get<std::int32_t>();
+    symbol.address = reader.get<std::int32_t>();
+    symbol.size = static_cast<std::size_t>(reader.get<std::uint64_t>());
+    symbol.by_value = reader.get<std::uint8_t>() != 0;
+    symbol.constant_value = reader.get<std::int64_t>();
+    entry.symbols.push_back(std::move(symbol));
+  }
+  if (!reader.ok() || !reader.at_end()) {
+    return std::nullopt;
+  }
+  return entry;
+}
+
+// 函数: 生成进程内唯一的临时文件后缀
+std::string temporary_suffix() {
+  static std::atomic<std::uint64_t> counter{0};
+  const auto thread_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+  return ".tmp" + std::to_string(thread_hash) + "-" + std::to_string(now) + "-" +
+         std::to_string(counter.fetch_add(1));
+}
+
+}  // namespace
+
+// 构造: 记录目录与容量上限
+CompileCache::CompileCache(std::filesystem::path directory, std::uintmax_t max_bytes)
+    : directory_(std::move(directory)), max_bytes_(max_bytes) {}
+
+// 函数: 按环境变量选择缓存目录
+std::filesystem::path CompileCache::default_directory() {
+  if (const char* explicit_dir = std::getenv("PL0_CACHE_DIR"); explicit_dir && *explicit_dir) {
+    return explicit_dir;
+  }
+  if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+    return std::filesystem::path(xdg) / "pl0";
+  }
+  if (const char* home = std::getenv("HOME"); home && *home) {
+    return std::filesystem::path(home) / ".cache" / "pl0";
+  }
+  std::error_code ec;
+  auto temp = std::filesystem::temp_directory_path(ec);
+  return (ec ? std::filesystem::path(".") : temp) / "pl0-cache";
+}
+
+// 函数: 只有影响生成代码的选项参与哈希, 调试输出开关不影响命中
+std::uint64_t CompileCache::make_key(std::string_view source, const CompilerOptions& options) {
+  std::uint64_t hash = kFnvOffset;
+  hash = fnv1a(hash, "pl0-compiler-" + std::to_string(kCompilerVersion));
+  hash = fnv1a(hash, options.optimize ? "O1" : "O0");
+  hash = fnv1a(hash, options.enable_bounds_check ? "B1" : "B0");
+  hash = fnv1a(hash, "N" + std::to_string(options.max_nesting));
+  hash = fnv1a(hash, std::to_string(source.size()) + ":");
+  return fnv1a(hash, source);
+}
+
+// 函数: 条目文件路径
+std::filesystem::path CompileCache::entry_path(std::uint64_t key) const {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string name(16, '0');
+  for (std::size_t i = 0; i < 16; ++i) {
+    name[15 - i] = kHex[(key >> (4 * i)) & 0xF];
+  }
+  return directory_ / (name + std::string(kEntryExtension));
+}
+
+// 函数: 读取条目并刷新其最近使用时间
+std::optional<CompileCache::Entry> CompileCache::load(std::uint64_t key) {
+  const auto path = entry_path(key);
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  file.close();
+  auto entry = decode_entry(bytes, key);
+  std::error_code ec;
+  if (!entry) {
+    std::filesystem::remove(path, ec);
+    return std::nullopt;
+  }
+  std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+  return entry;
+}
+
+// 函数: 写入条目并淘汰超限部分
+void CompileCache::store(std::uint64_t key, const InstructionSequence& code,
+                         const std::vector<Symbol>& symbols) {
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) {
+    return;
+  }
+  const auto path = entry_path(key);
+  auto temporary = path;
+  temporary += temporary_suffix();
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file) {
+      return;
+    }
+    const auto bytes = encode_entry(key, code, symbols);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+      file.close();
+      std::filesystem::remove(temporary, ec);
+      return;
+    }
+  }
+  std::filesystem::rename(temporary, path, ec);
+  if (ec) {
+    std::filesystem::remove(temporary, ec);
+    return;
+  }
+  evict();
+}
+
+// 函数: 目录总大小超过上限时, 按修改时间从旧到新删除条目
+void CompileCache::evict() {
+  struct Candidate {
+    std::filesystem::path path;
+    std::filesystem::file_time_type time;
+    std::uintmax_t size = 0;
+  };
+  std::vector<Candidate> candidates;
+  std::uintmax_t total = 0;
+  std::error_code ec;
+  for (std::filesystem::directory_iterator it(directory_, ec), end; !ec && it != end;
+       it.increment(ec)) {
+    if (it->path().extension() != kEntryExtension) {
+      continue;
+    }
+    std::error_code entry_ec;
+    Candidate candidate{it->path(), it->last_write_time(entry_ec), it->file_size(entry_ec)};
+    if (!entry_ec) {
+      total += candidate.size;
+      candidates.push_back(std::move(candidate));
+    }
+  }
+  if (total <= max_bytes_) {
+    return;
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate& lhs, const Candidate& rhs) { return lhs.time < rhs.time; });
+  for (const auto& candidate : candidates) {
+    if (total <= max_bytes_) {
+      break;
+    }
+    if (std::filesystem::remove(candidate.path, ec)) {
+      total -= candidate.size;
+    }
+  }
+}
+
+}  // namespace pl0
@@ -2,14 +2,21 @@
 // 功能: 实现编译流程封装与调试输出工具
 #include "pl0/Driver.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "pl0/AST.hpp"
+#include "pl0/IR.hpp"
 #include "pl0/Lexer.hpp"
+#include "pl0/Optimizer.hpp"
+#include "pl0/ParallelParser.hpp"
 #include "pl0/Parser.hpp"
 #include "pl0/Token.hpp"
 #include "pl0/Utility.hpp"
@@ -99,41 +106,40 @@ void dump_statement(const Statement& stmt, std::ostream& out, int level);
 // 函数: 打印块 AST
 void dump_block(const Block& block, std::ostream& out, int level);
 
-void dump_expression(const Expression& expr, std::ostream& out, int level) {
-  std::visit(
-      [&](const auto& node) {
-        using T = std::decay_t<decltype(node)>;
-        if constexpr (std::is_same_v<T, NumberLiteral>) {
-          indent(out, level);
-          out << "Number " << node.value << '\n';
-        } else if constexpr (std::is_same_v<T, BooleanLiteral>) {
-          indent(out, level);
-          out << "Boolean " << (node.value ? "true" : "false") << '\n';
-        } else if constexpr (std::is_same_v<T, IdentifierExpr>) {
-          indent(out, level);
-          out << "Identifier " << node.name << '\n';
-        } else if constexpr (std::is_same_v<T, ArrayAccessExpr>) {
-          indent(out, level);
-          out << "ArrayAccess " << node.name << '\n';
-          dump_expression(*node.index, out, level + 1);
-        } else if constexpr (std::is_same_v<T, BinaryExpr>) {
-          indent(out, level);
-          out << "Binary " << binary_op_name(node.op) << '\n';
-          dump_expression(*node.lhs, out, level + 1);
-          dump_expression(*node.rhs, out, level + 1);
-        } else if constexpr (std::is_same_v<T, UnaryExpr>) {
-          indent(out, level);
-          out << "Unary " << unary_op_name(node.op) << '\n';
-          dump_expression(*node.operand, out, level + 1);
-        } else if constexpr (std::is_same_v<T, CallExpr>) {
-          indent(out, level);
-          out << "CallExpr " << node.callee << '\n';
-          for (const auto& arg : node.arguments) {
-            dump_expression(*arg, out, level + 1);
+// 显式栈先序遍历, 深层表达式不占用调用栈
+void dump_expression(const Expression& root, std::ostream& out, int root_level) {
+  std::vector<std::pair<const Expression*, int>> pending{{&root, root_level}};
+  while (!pending.empty()) {
+    const auto [expr, level] = pending.back();
+    pending.pop_back();
+    indent(out, level);
+    std::visit(
+        [&](const auto& node) {
+          using T = std::decay_t<decltype(node)>;
+          if constexpr (std::is_same_v<T, NumberLiteral>) {
+            out << "Number " << node.value << '\n';
+          } else if constexpr (std::is_same_v<T, BooleanLiteral>) {
+            out << "Boolean " << (node.value ? "true" : "false") << '\n';
+          } else if constexpr (std::is_same_v<T, IdentifierExpr>) {
+            out << "Identifier " << node.name << '\n';
+          } else if constexpr (std::is_same_v<T, ArrayAccessExpr>) {
+            out << "ArrayAccess " << node.name << '\n';
+          } else if constexpr (std::is_same_v<T, BinaryExpr>) {
+            out << "Binary " << binary_op_name(node.op) << '\n';
+          } else if constexpr (std::is_same_v<T, UnaryExpr>) {
+            out << "Unary " << unary_op_name(node.op) << '\n';
+          } else if constexpr (std::is_same_v<T, CallExpr>) {
+            out << "CallExpr " << node.callee << '\n';
           }
-        }
-      },
-      expr.value);
+        },
+        expr->value);
+    // 子节点逆序入栈, 出栈时按原顺序打印
+    const std::size_t first = pending.size();
+    for_each_child(*expr, [&](const ExprPtr& child) {
+      pending.emplace_back(child.get(), level + 1);
+    });
+    std::reverse(pending.begin() + static_cast<std::ptrdiff_t>(first), pending.end());
+  }
 }
 
 void dump_statement(const Statement& stmt, std::ostream& out, int level) {
@@ -223,6 +229,25 @@ void dump_block(const Block& block, std::ostream& out, int level) {
       out << decl.name << " = " << decl.value << '\n';
     }
   }
+  for (const auto& decl : block.externs) {
+    indent(out, level + 1);
+    out << "Extern ";
+    switch (decl.kind) {
+      case ExternDecl::Kind::Variable:
+        out << "var " << decl.name;
+        if (decl.array_size) {
+          out << "[" << *decl.array_size << "]";
+        }
+        break;
+      case ExternDecl::Kind::Procedure:
+        out << "procedure " << decl.name << "/" << decl.arity;
+        break;
+      case ExternDecl::Kind::Function:
+        out << "function " << decl.name << "/" << decl.arity;
+        break;
+    }
+    out << '\n';
+  }
   if (!block.vars.empty()) {
     indent(out, level + 1);
     out << "Vars" << '\n';
@@ -237,7 +262,15 @@ void dump_block(const Block& block, std::ostream& out, int level) {
   }
   for (const auto& proc : block.procedures) {
     indent(out, level + 1);
-    out << "Procedure " << proc.name << '\n';
+    out << (proc.is_function ? "Function " : "Procedure ") << proc.name;
+    if (!proc.parameters.empty()) {
+      out << '(';
+      for (std::size_t i = 0; i < proc.parameters.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << proc.parameters[i].name;
+      }
+      out << ')';
+    }
+    out << '\n';
     if (proc.body) {
       dump_block(*proc.body, out, level + 2);
     }
@@ -283,6 +316,9 @@ void dump_symbols(const std::vector<Symbol>& symbols, std::ostream& out) {
       case SymbolKind::Procedure:
         out << "proc " << symbol.name << " -> " << symbol.address;
         break;
+      case SymbolKind::Function:
+        out << "func " << symbol.name << " -> " << symbol.address;
+        break;
       case SymbolKind::Parameter:
         out << "param " << symbol.name << " @" << symbol.address;
         break;
@@ -291,9 +327,11 @@ void dump_symbols(const std::vector<Symbol>& symbols, std::ostream& out) {
   }
 }
 
+// 常量: 启用并行语法分析的最小源码字节数, 更小的程序建线程池的开销超过收益
+constexpr std::size_t kParallelParseMinBytes = 1 << 18;
+
 // 函数: 重新扫描源码并收集 Token
-std::vector<Token> collect_tokens(const std::string& source) {
-  DiagnosticSink sink;
+std::vector<Token> collect_tokens(const SourceBuffer& source, DiagnosticSink& sink) {
   Lexer lexer(source, sink);
   std::vector<Token> tokens;
   while (true) {
@@ -306,6 +344,11 @@ std::vector<Token> collect_tokens(const std::string& source) {
   return tokens;
 }
 
+std::vector<Token> collect_tokens(const SourceBuffer& source) {
+  DiagnosticSink sink;
+  return collect_tokens(source, sink);
+}
+
 }  // namespace
 
 }  // namespace pl0
@@ -314,15 +357,56 @@ std::vector<Token> collect_tokens(const std::string& source) {
 pl0::CompileResult pl0::compile_source_text(std::string_view source_name,
                                             const std::string& source,
                                             const pl0::CompilerOptions& options,
-                                            pl0::DiagnosticSink& diagnostics) {
+                                            pl0::DiagnosticSink& diagnostics,
+                                            pl0::CompileCache* cache) {
+  return pl0::compile_source_text(source_name, pl0::SourceBuffer(std::string_view(source)),
+                                  options, diagnostics, cache);
+}
+
+// 函数: 编译缓冲中的源码, 词法器直接扫描缓冲, 不复制源码
+pl0::CompileResult pl0::compile_source_text(std::string_view source_name,
+                                            const pl0::SourceBuffer& source,
+                                            const pl0::CompilerOptions& options,
+                                            pl0::DiagnosticSink& diagnostics,
+                                            pl0::CompileCache* cache) {
   pl0::CompileResult result;
   result.source_name = std::string(source_name);
 
-  pl0::Lexer lexer(source, diagnostics);
-  pl0::Parser parser(lexer, diagnostics);
-  auto program = parser.parse_program();
+  std::uint64_t key = 0;
+  if (cache) {
+    key = pl0::CompileCache::make_key(source.view(), options);
+    if (auto cached = cache->load(key)) {
+      result.code = std::move(cached->code);
+      result.symbols = std::move(cached->symbols);
+      return result;
+    }
+  }
+
+  // 大程序先整体扫描, 再并行解析各顶层过程; 有词法诊断时退回边扫描边解析,
+  // 以保持词法与语法诊断原有的交错顺序
+  std::vector<pl0::Token> tokens;
+  std::unique_ptr<pl0::Program> program;
+  bool parsed = false;
+  if (options.threads != 1 && source.size() >= pl0::kParallelParseMinBytes) {
+    pl0::DiagnosticSink lex_diagnostics;
+    tokens = pl0::collect_tokens(source, lex_diagnostics);
+    if (lex_diagnostics.diagnostics().empty()) {
+      program = pl0::parse_program_parallel(tokens, diagnostics, options.threads,
+                                            options.max_nesting);
+      parsed = true;
+    }
+  }
+  if (!parsed) {
+    pl0::Lexer lexer(source, diagnostics);
+    pl0::Parser parser(lexer, diagnostics);
+    parser.set_nesting_limit(options.max_nesting);
+    program = parser.parse_program();
+  }
+  auto take_tokens = [&] {
+    return parsed ? std::move(tokens) : pl0::collect_tokens(source);
+  };
   if (!program || diagnostics.has_errors()) {
-    result.tokens = collect_tokens(source);
+    result.tokens = take_tokens();
     return result;
   }
 
@@ -331,7 +415,7 @@ pl0::CompileResult pl0::compile_source_text(std::string_view source_name,
   pl0::CodeGenerator generator(symbols, instructions, diagnostics, options);
   generator.emit_program(*program);
 
-  result.tokens = collect_tokens(source);
+  result.tokens = take_tokens();
 
   if (diagnostics.has_errors()) {
     return result;
@@ -339,19 +423,56 @@ pl0::CompileResult pl0::compile_source_text(std::string_view source_name,
 
   result.code = std::move(instructions);
   result.symbols = generator.symbols();
+  if (options.optimize) {
+    pl0::optimize_program(result.code, result.symbols);
+  }
   result.program = std::move(program);
+  if (cache) {
+    cache->store(key, result.code, result.symbols);
+  }
   return result;
 }
 
+// 函数: 按目标文件方式编译, 全程顺序进行
+pl0::ObjectModule pl0::compile_object(std::string_view source_name,
+                                      const pl0::SourceBuffer& source,
+                                      const pl0::CompilerOptions& options,
+                                      pl0::DiagnosticSink& diagnostics) {
+  pl0::Lexer lexer(source, diagnostics);
+  pl0::Parser parser(lexer, diagnostics);
+  parser.set_nesting_limit(options.max_nesting);
+  const auto program = parser.parse_program();
+  if (!program || diagnostics.has_errors()) {
+    return {};
+  }
+
+  pl0::SymbolTable symbols;
+  pl0::InstructionSequence instructions;
+  std::vector<pl0::Relocation> relocations;
+  pl0::CodeGenerator generator(symbols, instructions, diagnostics, options);
+  generator.emit_module(*program, relocations);
+  if (diagnostics.has_errors()) {
+    return {};
+  }
+  return pl0::make_object(std::string(source_name), std::move(instructions),
+                          std::move(relocations), generator.symbols(), generator.imports());
+}
+
 // 函数: 从文件加载并编译源码
 pl0::CompileResult pl0::compile_file(const std::filesystem::path& input,
                                      const pl0::CompilerOptions& options,
                                      const pl0::DumpOptions& dumps,
                                      pl0::DiagnosticSink& diagnostics,
-                                     std::ostream& dump_stream) {
-  std::string source = pl0::read_file_utf8(input);
+                                     std::ostream& dump_stream,
+                                     pl0::CompileCache* cache) {
+  // 普通文件映射到内存后直接交给词法器, 上百 MB 的生成源码也不会整份复制
+  const pl0::SourceBuffer source = pl0::SourceBuffer::open(input);
+  if (dumps.tokens || dumps.ast) {
+    cache = nullptr;
+  }
+
   pl0::CompileResult result =
-      pl0::compile_source_text(input.string(), source, options, diagnostics);
+      pl0::compile_source_text(input.string(), source, options, diagnostics, cache);
 
   if (dumps.tokens && !result.tokens.empty()) {
     pl0::dump_tokens(result.tokens, dump_stream);
@@ -366,6 +487,14 @@ pl0::CompileResult pl0::compile_file(const std::filesystem::path& input,
     pl0::serialize_instructions(result.code, dump_stream);
     dump_stream << '\n';
   }
+  if (dumps.ir && !result.code.empty()) {
+    if (auto module = pl0::ir::build_module(result.code)) {
+      pl0::ir::assign_names(*module, result.symbols);
+      pl0::ir::print_module(*module, dump_stream);
+    } else {
+      dump_stream << "; IR unavailable for this code shape\n";
+    }
+  }
 
   return result;
 }
@@ -390,12 +519,62 @@ void pl0::save_pcode_file(const std::filesystem::path& output,
   pl0::serialize_instructions(instructions, file);
 }
 
-// 函数: 执行编译结果
+// 函数: 以标准输入输出执行编译结果, 可选挂接剖析器
+pl0::VirtualMachine::Result pl0::run_instructions(
+    const pl0::InstructionSequence& code, pl0::DiagnosticSink& diagnostics,
+    const pl0::RunnerOptions& options, pl0::Profiler* profiler) {
+  return run_instructions(code, diagnostics, options, std::cin, std::cout, profiler);
+}
+
+// 函数: 以指定流执行指令序列
 pl0::VirtualMachine::Result pl0::run_instructions(
     const pl0::InstructionSequence& code, pl0::DiagnosticSink& diagnostics,
-    const pl0::RunnerOptions& options) {
+    const pl0::RunnerOptions& options, std::istream& input, std::ostream& output,
+    pl0::Profiler* profiler) {
   pl0::VirtualMachine vm(diagnostics, options);
-  return vm.execute(code);
+  vm.set_io(input, output);
+  if (!profiler) {
+    return vm.execute(code);
+  }
+  vm.set_profiler(profiler);
+  profiler->begin(code);
+  auto result = vm.execute(code);
+  profiler->end();
+  return result;
+}
+
+// 函数: 输出剖析报告并写出折叠栈文件
+void pl0::write_profile(const pl0::Profiler& profiler, std::ostream& report,
+                        const std::filesystem::path& folded_output) {
+  profiler.write_report(report);
+  std::ofstream file(folded_output);
+  if (!file) {
+    throw std::runtime_error("failed to open " + folded_output.string());
+  }
+  profiler.write_folded(file);
+  report << "folded stacks written to " << folded_output.string() << '\n';
+}
+
+// 函数: 解析运行限额选项, 供 pl0c 与 pl0run 共用
+bool pl0::parse_limit_option(std::span<const std::string> args, std::size_t& i,
+                             pl0::RunnerOptions& options, bool& valid,
+                             std::ostream& errors) {
+  const auto& arg = args[i];
+  if ((arg != "--max-instructions" && arg != "--time-limit") || i + 1 >= args.size()) {
+    return false;
+  }
+  auto value = pl0::parse_unsigned(args[++i]);
+  if (!value) {
+    errors << "Invalid value for " << arg << ": " << args[i] << '\n';
+    valid = false;
+    return true;
+  }
+  if (arg == "--max-instructions") {
+    options.instruction_limit = *value;
+  } else {
+    options.time_limit = std::chrono::milliseconds(*value);
+  }
+  return true;
 }
 
 // 函数: 输出全部诊断
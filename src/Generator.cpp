@@ -0,0 +1,258 @@
+// 文件: Generator.cpp
+// 功能: 生成可伸缩的合成 PL/0 程序, 并在生成时模拟执行得到预期输出
+#include "pl0/Generator.hpp"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 校验和取模, 保证所有中间值远小于 int64 范围
+constexpr std::int64_t kModulus = 1000003;
+
+// 枚举: 表达式项的形态
+enum class TermKind {
+  Constant,    // c
+  Variable,    // x
+  Product,     // (x * c % 1000)
+  Quotient,    // (x / c)
+  Difference,  // (c1 - c2), c1 >= c2
+};
+
+// 结构: 表达式中的一项; variable 为 -1 表示 checksum, 否则为外层过程的 t<variable>
+struct Term {
+  TermKind kind = TermKind::Constant;
+  int variable = -1;
+  std::int64_t first = 0;
+  std::int64_t second = 0;
+};
+
+// 结构: 一个 (可能嵌套的) 过程及其赋值表达式
+struct Routine {
+  std::string name;
+  std::vector<Term> terms;
+};
+
+// 类: 生成器状态, 持有确定性的随机数引擎
+class ProgramBuilder {
+ public:
+  explicit ProgramBuilder(const GeneratorOptions& options)
+      : options_(options), random_(options.seed) {}
+
+  GeneratedProgram build();
+
+ private:
+  // 工具: 取 [0, bound) 内的随机数; mt19937 的序列由标准规定, 不依赖分布实现
+  std::int64_t pick(std::int64_t bound) {
+    return static_cast<std::int64_t>(random_() % static_cast<std::uint32_t>(bound));
+  }
+
+  std::vector<Term> make_terms(int level);
+  void emit_routine(std::ostringstream& out, int procedure, int level);
+  void simulate_routine(int procedure, int level, std::vector<std::int64_t>& locals);
+
+  std::string variable_name(int variable) const {
+    return variable < 0 ? "checksum" : "t" + std::to_string(variable);
+  }
+  std::int64_t evaluate(const std::vector<Term>& terms,
+                        const std::vector<std::int64_t>& locals) const;
+
+  const GeneratorOptions& options_;
+  std::mt19937 random_;
+  std::vector<std::vector<Routine>> routines_;  // [顶层过程][嵌套层]
+  std::int64_t checksum_ = 0;
+};
+
+// 函数: 为第 level 层过程生成表达式项, 变量只引用 checksum 与外层的 t0..t(level-1)
+std::vector<Term> ProgramBuilder::make_terms(int level) {
+  std::vector<Term> terms(static_cast<std::size_t>(std::max(options_.expression_terms, 1)));
+  for (auto& term : terms) {
+    term.kind = static_cast<TermKind>(pick(5));
+    term.variable = static_cast<int>(pick(level + 1)) - 1;
+    switch (term.kind) {
+      case TermKind::Constant:
+        term.first = pick(1000);
+        break;
+      case TermKind::Variable:
+        break;
+      case TermKind::Product:
+        term.first = 1 + pick(999);
+        break;
+      case TermKind::Quotient:
+        term.first = 1 + pick(9);
+        break;
+      case TermKind::Difference:
+        term.first = pick(1000);
+        term.second = pick(term.first + 1);
+        break;
+    }
+  }
+  return terms;
+}
+
+// 函数: 按 PL/0 语义求值表达式 (各项非负, 整数除法向零截断)
+std::int64_t ProgramBuilder::evaluate(const std::vector<Term>& terms,
+                                      const std::vector<std::int64_t>& locals) const {
+  std::int64_t total = 0;
+  for (const auto& term : terms) {
+    const std::int64_t value =
+        term.variable < 0 ? checksum_ : locals[static_cast<std::size_t>(term.variable)];
+    switch (term.kind) {
+      case TermKind::Constant:
+        total += term.first;
+        break;
+      case TermKind::Variable:
+        total += value;
+        break;
+      case TermKind::Product:
+        total += value * term.first % 1000;
+        break;
+      case TermKind::Quotient:
+        total += value / term.first;
+        break;
+      case TermKind::Difference:
+        total += term.first - term.second;
+        break;
+    }
+  }
+  return total % kModulus;
+}
+
+// 函数: 输出第 procedure 个顶层过程的第 level 层, 子过程先于本层语句声明
+void ProgramBuilder::emit_routine(std::ostringstream& out, int procedure, int level) {
+  const auto& routine =
+      routines_[static_cast<std::size_t>(procedure)][static_cast<std::size_t>(level)];
+  const std::string indent(static_cast<std::size_t>(level) * 2, ' ');
+  out << indent << "procedure " << routine.name << ";\n";
+  out << indent << "  var t" << level << ";\n";
+  if (level + 1 < options_.depth) {
+    emit_routine(out, procedure, level + 1);
+  }
+  out << indent << "begin\n";
+  out << indent << "  t" << level << " := (";
+  for (std::size_t i = 0; i < routine.terms.size(); ++i) {
+    const auto& term = routine.terms[i];
+    if (i > 0) {
+      out << " + ";
+    }
+    switch (term.kind) {
+      case TermKind::Constant:
+        out << term.first;
+        break;
+      case TermKind::Variable:
+        out << variable_name(term.variable);
+        break;
+      case TermKind::Product:
+        out << '(' << variable_name(term.variable) << " * " << term.first << " % 1000)";
+        break;
+      case TermKind::Quotient:
+        out << '(' << variable_name(term.variable) << " / " << term.first << ')';
+        break;
+      case TermKind::Difference:
+        out << '(' << term.first << " - " << term.second << ')';
+        break;
+    }
+  }
+  out << ") % modulus;\n";
+  if (level + 1 < options_.depth) {
+    out << indent << "  call "
+        << routines_[static_cast<std::size_t>(procedure)][static_cast<std::size_t>(level) + 1]
+               .name
+        << ";\n";
+  }
+  out << indent << "  checksum := (checksum + t" << level << ") % modulus\n";
+  out << indent << "end;\n";
+}
+
+// 函数: 按执行顺序模拟过程: 计算 t, 调用子过程, 再累加到校验和
+void ProgramBuilder::simulate_routine(int procedure, int level,
+                                      std::vector<std::int64_t>& locals) {
+  const auto& routine =
+      routines_[static_cast<std::size_t>(procedure)][static_cast<std::size_t>(level)];
+  const std::int64_t value = evaluate(routine.terms, locals);
+  locals.push_back(value);
+  if (level + 1 < options_.depth) {
+    simulate_routine(procedure, level + 1, locals);
+  }
+  locals.pop_back();
+  checksum_ = (checksum_ + value) % kModulus;
+}
+
+// 函数: 生成完整程序并计算预期输出
+GeneratedProgram ProgramBuilder::build() {
+  const int procedures = std::max(options_.procedures, 0);
+  const int array_size = std::max(options_.array_size, 0);
+
+  routines_.resize(static_cast<std::size_t>(procedures));
+  for (int p = 0; p < procedures; ++p) {
+    for (int level = 0; level < options_.depth; ++level) {
+      Routine routine;
+      routine.name = "p" + std::to_string(p) + "_" + std::to_string(level);
+      routine.terms = make_terms(level);
+      routines_[static_cast<std::size_t>(p)].push_back(std::move(routine));
+    }
+  }
+
+  std::ostringstream out;
+  out << "const modulus = " << kModulus << ";\n";
+  out << "var checksum, sum, i";
+  if (array_size > 0) {
+    out << ", a[" << array_size << "]";
+  }
+  out << ";\n";
+  for (int p = 0; p < procedures; ++p) {
+    emit_routine(out, p, 0);
+  }
+  out << "begin\n";
+  out << "  checksum := 0;\n";
+  for (int p = 0; p < procedures; ++p) {
+    out << "  call " << routines_[static_cast<std::size_t>(p)].front().name << ";\n";
+  }
+  if (array_size > 0) {
+    out << "  i := 0;\n"
+        << "  while i < " << array_size << " do\n"
+        << "  begin\n"
+        << "    a[i] := (i * 7 + checksum) % 101;\n"
+        << "    i := i + 1\n"
+        << "  end;\n"
+        << "  i := 0;\n"
+        << "  sum := 0;\n"
+        << "  while i < " << array_size << " do\n"
+        << "  begin\n"
+        << "    sum := sum + a[i];\n"
+        << "    i := i + 1\n"
+        << "  end;\n"
+        << "  checksum := (checksum + sum) % modulus;\n";
+  }
+  out << "  write(checksum)\n";
+  out << "end.\n";
+
+  std::vector<std::int64_t> locals;
+  for (int p = 0; p < procedures; ++p) {
+    simulate_routine(p, 0, locals);
+  }
+  if (array_size > 0) {
+    std::int64_t sum = 0;
+    for (std::int64_t index = 0; index < array_size; ++index) {
+      sum += (index * 7 + checksum_) % 101;
+    }
+    checksum_ = (checksum_ + sum) % kModulus;
+  }
+
+  return {out.str(), std::to_string(checksum_)};
+}
+
+}  // namespace
+
+// 函数: 生成程序
+GeneratedProgram generate_program(const GeneratorOptions& options) {
+  GeneratorOptions normalized = options;
+  normalized.depth = std::max(options.depth, 1);
+  return ProgramBuilder(normalized).build();
+}
+
+}  // namespace pl0
@@ -0,0 +1,1182 @@
+// 文件: IR.cpp
+// 功能: 实现 P-Code 与控制流图 IR 之间的双向转换及打印
+#include "pl0/IR.hpp"
+
+#include <algorithm>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace pl0::ir {
+
+namespace {
+
+// 常量: 栈序模拟在单个基本块上的工作量上限, 以块长的倍数计
+constexpr std::size_t kPlacementWorkFactor = 16;
+
+// 函数: 判断 OPR 子操作是否为一元运算
+bool is_unary_opr(Opr opr) {
+  return opr == Opr::NEG || opr == Opr::ODD || opr == Opr::NOT;
+}
+
+// 函数: 判断 OPR 子操作是否为二元运算
+bool is_binary_opr(Opr opr) {
+  switch (opr) {
+    case Opr::ADD:
+    case Opr::SUB:
+    case Opr::MUL:
+    case Opr::DIV:
+    case Opr::MOD:
+    case Opr::EQ:
+    case Opr::NE:
+    case Opr::LT:
+    case Opr::GE:
+    case Opr::GT:
+    case Opr::LE:
+    case Opr::AND:
+    case Opr::OR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// 类: 从扁平 P-Code 恢复函数与基本块结构
+class ModuleBuilder {
+ public:
+  explicit ModuleBuilder(const InstructionSequence& code) : code_(code) {}
+
+  std::optional<Module> build() {
+    if (code_.empty()) {
+      return std::nullopt;
+    }
+    owner_.assign(code_.size(), -1);
+    leader_.assign(code_.size(), false);
+    if (!discover_functions()) {
+      return std::nullopt;
+    }
+    Module module;
+    module.functions.resize(entries_.size());
+    for (std::size_t index = 0; index < entries_.size(); ++index) {
+      if (!build_function(static_cast<int>(index), module.functions[index])) {
+        return std::nullopt;
+      }
+    }
+    infer_static_parents(module);
+    return module;
+  }
+
+ private:
+  // 函数: 从入口出发标记每个函数拥有的指令与块首
+  bool discover_functions() {
+    register_entry(0);
+    for (std::size_t index = 0; index < entries_.size(); ++index) {
+      const int function = static_cast<int>(index);
+      std::vector<int> worklist{entries_[index]};
+      leader_[static_cast<std::size_t>(entries_[index])] = true;
+      while (!worklist.empty()) {
+        int pc = worklist.back();
+        worklist.pop_back();
+        while (true) {
+          if (pc < 0 || pc >= static_cast<int>(code_.size())) {
+            return false;
+          }
+          auto& owner = owner_[static_cast<std::size_t>(pc)];
+          if (owner == function) {
+            break;
+          }
+          if (owner != -1) {
+            return false;
+          }
+          owner = function;
+          const Instruction& instr = code_[static_cast<std::size_t>(pc)];
+          if (instr.op == Op::JMP || instr.op == Op::JPC) {
+            if (instr.argument < 0 || instr.argument >= static_cast<int>(code_.size())) {
+              return false;
+            }
+            leader_[static_cast<std::size_t>(instr.argument)] = true;
+            worklist.push_back(instr.argument);
+            if (instr.op == Op::JMP) {
+              break;
+            }
+            if (pc + 1 < static_cast<int>(code_.size())) {
+              leader_[static_cast<std::size_t>(pc) + 1] = true;
+            }
+          } else if (instr.op == Op::CAL || instr.op == Op::TCL) {
+            if (instr.argument < 0 || instr.argument >= static_cast<int>(code_.size())) {
+              return false;
+            }
+            int callee = register_entry(instr.argument);
+            if (instr.op == Op::TCL) {
+              tail_edges_.emplace_back(function, callee);
+              break;
+            }
+          } else if (instr.op == Op::OPR && (static_cast<Opr>(instr.argument) == Opr::RET ||
+                                             static_cast<Opr>(instr.argument) == Opr::RETV)) {
+            if (!record_signature(function, instr.level,
+                                  static_cast<Opr>(instr.argument) == Opr::RETV)) {
+              return false;
+            }
+            break;
+          }
+          ++pc;
+        }
+      }
+    }
+    // 仅以 TCL 结束的函数沿用尾调用目标的签名
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (const auto& [function, callee] : tail_edges_) {
+        const auto& target = signatures_[static_cast<std::size_t>(callee)];
+        if (!signatures_[static_cast<std::size_t>(function)] && target) {
+          signatures_[static_cast<std::size_t>(function)] = target;
+          changed = true;
+        }
+      }
+    }
+    return std::all_of(signatures_.begin(), signatures_.end(),
+                       [](const auto& signature) { return signature.has_value(); });
+  }
+
+  // 函数: 登记函数入口, 返回函数下标
+  int register_entry(int pc) {
+    auto it = entry_index_.find(pc);
+    if (it != entry_index_.end()) {
+      return it->second;
+    }
+    int index = static_cast<int>(entries_.size());
+    entries_.push_back(pc);
+    signatures_.emplace_back();
+    entry_index_.emplace(pc, index);
+    return index;
+  }
+
+  // 函数: 由返回指令记录函数签名, 同一函数的各返回点必须一致
+  bool record_signature(int function, int arity, bool returns_value) {
+    auto& signature = signatures_[static_cast<std::size_t>(function)];
+    if (arity < 0) {
+      return false;
+    }
+    if (!signature) {
+      signature = Signature{arity, returns_value};
+      return true;
+    }
+    return signature->arity == arity && signature->returns_value == returns_value;
+  }
+
+  // 函数: 对单个函数做栈模拟, 生成 SSA 形式的基本块
+  bool build_function(int index, Function& function) {
+    function.entry_pc = entries_[static_cast<std::size_t>(index)];
+    function.name = index == 0 ? "main" : "proc@" + std::to_string(function.entry_pc);
+    function.parent = index == 0 ? -1 : -2;
+    const Signature& signature = *signatures_[static_cast<std::size_t>(index)];
+    function.arity = signature.arity;
+    function.returns_value = signature.returns_value;
+
+    std::map<int, int> block_of;
+    for (std::size_t pc = 0; pc < code_.size(); ++pc) {
+      if (owner_[pc] == index && leader_[pc]) {
+        int id = static_cast<int>(function.blocks.size());
+        block_of.emplace(static_cast<int>(pc), id);
+        BasicBlock block;
+        block.id = id;
+        block.origin = static_cast<int>(pc);
+        function.blocks.push_back(std::move(block));
+      }
+    }
+    function.entry = block_of.at(function.entry_pc);
+
+    int alloc_count = 0;
+    for (auto& block : function.blocks) {
+      std::vector<ValueId> stack;
+      auto pop = [&](ValueId& out) {
+        if (stack.empty()) {
+          return false;
+        }
+        out = stack.back();
+        stack.pop_back();
+        return true;
+      };
+      auto define = [&](Instr instr) {
+        instr.result = function.new_value();
+        stack.push_back(instr.result);
+        block.instrs.push_back(std::move(instr));
+      };
+
+      int pc = block.origin;
+      while (true) {
+        const Instruction& code = code_[static_cast<std::size_t>(pc)];
+        Instr instr;
+        instr.level = code.level;
+        instr.immediate = code.argument;
+        bool terminated = false;
+        switch (code.op) {
+          case Op::LIT:
+          case Op::LDC:
+            instr.kind = Kind::Const;
+            instr.level = 0;
+            instr.immediate = literal_value(code);
+            define(std::move(instr));
+            break;
+          case Op::LOD:
+            instr.kind = Kind::Load;
+            define(std::move(instr));
+            break;
+          case Op::LDA:
+            instr.kind = Kind::Address;
+            define(std::move(instr));
+            break;
+          case Op::STO: {
+            ValueId value;
+            if (!pop(value)) {
+              return false;
+            }
+            instr.kind = Kind::Store;
+            instr.operands = {value};
+            block.instrs.push_back(std::move(instr));
+            break;
+          }
+          case Op::IDX: {
+            ValueId offset;
+            ValueId base;
+            if (!pop(offset) || !pop(base)) {
+              return false;
+            }
+            instr.kind = Kind::Index;
+            instr.operands = {base, offset};
+            define(std::move(instr));
+            break;
+          }
+          case Op::LDI: {
+            ValueId address;
+            if (!pop(address)) {
+              return false;
+            }
+            instr.kind = Kind::LoadIndirect;
+            instr.operands = {address};
+            define(std::move(instr));
+            break;
+          }
+          case Op::STI: {
+            ValueId value;
+            ValueId address;
+            if (!pop(value) || !pop(address)) {
+              return false;
+            }
+            instr.kind = Kind::StoreIndirect;
+            instr.operands = {address, value};
+            block.instrs.push_back(std::move(instr));
+            break;
+          }
+          case Op::CHK: {
+            ValueId value;
+            if (!pop(value)) {
+              return false;
+            }
+            instr.kind = Kind::Check;
+            instr.operands = {value};
+            define(std::move(instr));
+            break;
+          }
+          case Op::DUP:
+            if (stack.empty()) {
+              return false;
+            }
+            stack.push_back(stack.back());
+            break;
+          case Op::NOP:
+            break;
+          case Op::OPR: {
+            auto opr = static_cast<Opr>(code.argument);
+            instr.opr = opr;
+            instr.immediate = 0;
+            if (opr == Opr::RET || opr == Opr::RETV) {
+              if (opr == Opr::RETV) {
+                ValueId value;
+                if (!pop(value)) {
+                  return false;
+                }
+                instr.operands = {value};
+              }
+              if (!stack.empty()) {
+                return false;
+              }
+              instr.kind = Kind::Return;
+              block.instrs.push_back(std::move(instr));
+              terminated = true;
+            } else if (opr == Opr::WRITE) {
+              ValueId value;
+              if (!pop(value)) {
+                return false;
+              }
+              instr.kind = Kind::Write;
+              instr.operands = {value};
+              block.instrs.push_back(std::move(instr));
+            } else if (opr == Opr::WRITELN) {
+              instr.kind = Kind::WriteLine;
+              block.instrs.push_back(std::move(instr));
+            } else if (opr == Opr::READ) {
+              instr.kind = Kind::Read;
+              define(std::move(instr));
+            } else if (is_unary_opr(opr)) {
+              ValueId value;
+              if (!pop(value)) {
+                return false;
+              }
+              instr.kind = Kind::Unary;
+              instr.operands = {value};
+              define(std::move(instr));
+            } else if (is_binary_opr(opr)) {
+              ValueId rhs;
+              ValueId lhs;
+              if (!pop(rhs) || !pop(lhs)) {
+                return false;
+              }
+              instr.kind = Kind::Binary;
+              instr.operands = {lhs, rhs};
+              define(std::move(instr));
+            } else {
+              return false;
+            }
+            break;
+          }
+          case Op::CAL: {
+            instr.kind = Kind::Call;
+            instr.callee = entry_index_.at(code.argument);
+            instr.immediate = 0;
+            const Signature& callee = *signatures_[static_cast<std::size_t>(instr.callee)];
+            if (static_cast<int>(stack.size()) < callee.arity) {
+              return false;
+            }
+            instr.operands.assign(stack.end() - callee.arity, stack.end());
+            stack.resize(stack.size() - static_cast<std::size_t>(callee.arity));
+            if (callee.returns_value) {
+              define(std::move(instr));
+            } else {
+              block.instrs.push_back(std::move(instr));
+            }
+            break;
+          }
+          case Op::TCL:
+            if (!stack.empty()) {
+              return false;
+            }
+            instr.kind = Kind::TailCall;
+            instr.callee = entry_index_.at(code.argument);
+            instr.immediate = signatures_[static_cast<std::size_t>(instr.callee)]->arity;
+            block.instrs.push_back(std::move(instr));
+            terminated = true;
+            break;
+          case Op::INT:
+            if (code.argument < 0) {
+              for (int i = 0; i < -code.argument; ++i) {
+                ValueId discarded;
+                if (!pop(discarded)) {
+                  return false;
+                }
+              }
+              break;
+            }
+            if (!stack.empty()) {
+              return false;
+            }
+            instr.kind = Kind::Alloc;
+            instr.level = 0;
+            block.instrs.push_back(std::move(instr));
+            ++alloc_count;
+            break;
+          case Op::JMP:
+            if (!stack.empty()) {
+              return false;
+            }
+            instr.kind = Kind::Jump;
+            instr.level = 0;
+            instr.immediate = 0;
+            instr.target = block_of.at(code.argument);
+            block.instrs.push_back(std::move(instr));
+            terminated = true;
+            break;
+          case Op::JPC: {
+            ValueId condition;
+            if (!pop(condition) || !stack.empty()) {
+              return false;
+            }
+            auto next = block_of.find(pc + 1);
+            if (next == block_of.end()) {
+              return false;
+            }
+            instr.kind = Kind::Branch;
+            instr.level = 0;
+            instr.immediate = 0;
+            instr.operands = {condition};
+            instr.target = block_of.at(code.argument);
+            instr.fallthrough = next->second;
+            block.instrs.push_back(std::move(instr));
+            terminated = true;
+            break;
+          }
+        }
+        if (terminated) {
+          break;
+        }
+        ++pc;
+        if (pc >= static_cast<int>(code_.size()) ||
+            owner_[static_cast<std::size_t>(pc)] != index) {
+          return false;
+        }
+        if (leader_[static_cast<std::size_t>(pc)]) {
+          if (!stack.empty()) {
+            return false;
+          }
+          Instr jump;
+          jump.kind = Kind::Jump;
+          jump.target = block_of.at(pc);
+          block.instrs.push_back(std::move(jump));
+          break;
+        }
+      }
+    }
+
+    if (alloc_count != 1) {
+      return false;
+    }
+    recompute_edges(function);
+    return true;
+  }
+
+  // 函数: 依据 CAL 的层差推断各函数的静态外层
+  void infer_static_parents(Module& module) {
+    auto ancestor = [&](int function, int level) {
+      int current = function;
+      for (int i = 0; i < level; ++i) {
+        const auto& fn = module.functions[static_cast<std::size_t>(current)];
+        if (!fn.parent_known || fn.parent < 0) {
+          return -2;
+        }
+        current = fn.parent;
+      }
+      return current;
+    };
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (std::size_t caller = 0; caller < module.functions.size(); ++caller) {
+        auto& fn = module.functions[caller];
+        if (!fn.parent_known || fn.parent == -2) {
+          continue;
+        }
+        for (const auto& block : fn.blocks) {
+          for (const auto& instr : block.instrs) {
+            if (!is_call(instr)) {
+              continue;
+            }
+            auto& callee = module.functions[static_cast<std::size_t>(instr.callee)];
+            if (!callee.parent_known) {
+              continue;
+            }
+            int parent = ancestor(static_cast<int>(caller), instr.level);
+            if (parent == -2) {
+              callee.parent_known = false;
+              changed = true;
+            } else if (callee.parent == -2) {
+              callee.parent = parent;
+              changed = true;
+            } else if (callee.parent != parent) {
+              callee.parent_known = false;
+              changed = true;
+            }
+          }
+        }
+      }
+    }
+    for (auto& fn : module.functions) {
+      if (fn.parent == -2) {
+        fn.parent_known = false;
+      }
+    }
+  }
+
+  // 结构: 函数签名, 由返回指令的实参个数与 RET/RETV 推得
+  struct Signature {
+    int arity = 0;
+    bool returns_value = false;
+  };
+
+  const InstructionSequence& code_;
+  std::vector<int> owner_;
+  std::vector<bool> leader_;
+  std::vector<int> entries_;
+  std::vector<std::optional<Signature>> signatures_;
+  std::vector<std::pair<int, int>> tail_edges_;
+  std::unordered_map<int, int> entry_index_;
+};
+
+// 枚举: 降级时值的物化方式
+enum class Placement : std::uint8_t {
+  Stack,    // 定义处留在操作数栈上, 多次使用时以 DUP 复制
+  Temp,     // 定义处写入帧内临时单元, 使用处重新加载
+  Remat,    // 常量、地址或未被改写的变量, 使用处重新生成
+  Discard,  // 无使用但有副作用, 计算后弹出
+  Skip,     // 无使用且无副作用, 不生成
+};
+
+// 函数: 指令是否可能改写 (level, address) 单元
+bool clobbers(const Instr& instr, int level, std::int64_t address) {
+  return instr.kind == Kind::Call || instr.kind == Kind::StoreIndirect ||
+         (instr.kind == Kind::Store && instr.level == level && instr.immediate == address);
+}
+
+// 类: 将 IR 降级回 P-Code
+class Lowerer {
+ public:
+  explicit Lowerer(const Module& module) : module_(module) {}
+
+  LoweredProgram lower() {
+    std::vector<int> order = reachable_functions();
+    std::vector<int> address(module_.functions.size(), -1);
+    for (int index : order) {
+      address[static_cast<std::size_t>(index)] = static_cast<int>(output_.code.size());
+      lower_function(module_.functions[static_cast<std::size_t>(index)]);
+    }
+    for (const auto& [at, callee] : call_fixups_) {
+      output_.code[static_cast<std::size_t>(at)].argument =
+          address[static_cast<std::size_t>(callee)];
+    }
+    for (int index : order) {
+      output_.entry_map.emplace_back(
+          module_.functions[static_cast<std::size_t>(index)].entry_pc,
+          address[static_cast<std::size_t>(index)]);
+    }
+    return std::move(output_);
+  }
+
+ private:
+  // 函数: 从主程序出发沿调用边收集可达函数, 主程序排在最前
+  std::vector<int> reachable_functions() const {
+    std::vector<bool> seen(module_.functions.size(), false);
+    std::vector<int> worklist{module_.main};
+    seen[static_cast<std::size_t>(module_.main)] = true;
+    while (!worklist.empty()) {
+      int index = worklist.back();
+      worklist.pop_back();
+      for (const auto& block : module_.functions[static_cast<std::size_t>(index)].blocks) {
+        if (block.removed) {
+          continue;
+        }
+        for (const auto& instr : block.instrs) {
+          if (is_call(instr) && !seen[static_cast<std::size_t>(instr.callee)]) {
+            seen[static_cast<std::size_t>(instr.callee)] = true;
+            worklist.push_back(instr.callee);
+          }
+        }
+      }
+    }
+    std::vector<int> order;
+    for (std::size_t index = 0; index < seen.size(); ++index) {
+      if (seen[index] && static_cast<int>(index) != module_.main) {
+        order.push_back(static_cast<int>(index));
+      }
+    }
+    std::sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+      return module_.functions[static_cast<std::size_t>(lhs)].entry_pc <
+             module_.functions[static_cast<std::size_t>(rhs)].entry_pc;
+    });
+    order.insert(order.begin(), module_.main);
+    return order;
+  }
+
+  // 函数: 决定块的排布顺序, 入口块最先, 其余按原始地址
+  static std::vector<int> layout_blocks(const Function& function) {
+    std::vector<int> order;
+    for (const auto& block : function.blocks) {
+      if (!block.removed && block.id != function.entry) {
+        order.push_back(block.id);
+      }
+    }
+    std::sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+      return function.blocks[static_cast<std::size_t>(lhs)].origin <
+             function.blocks[static_cast<std::size_t>(rhs)].origin;
+    });
+    order.insert(order.begin(), function.entry);
+    return order;
+  }
+
+  // 函数: 为函数内每个值选择物化方式
+  std::vector<Placement> place_values(const Function& function,
+                                      const std::vector<int>& layout) const {
+    const auto count = static_cast<std::size_t>(function.value_count);
+    std::vector<int> def_block(count, -1);
+    std::vector<std::size_t> def_index(count, 0);
+    std::vector<const Instr*> def_instr(count, nullptr);
+    std::vector<int> use_count(count, 0);
+    std::vector<bool> used_elsewhere(count, false);
+    std::vector<std::vector<std::pair<int, std::size_t>>> uses(count);
+    for (int id : layout) {
+      const auto& instrs = function.blocks[static_cast<std::size_t>(id)].instrs;
+      for (std::size_t i = 0; i < instrs.size(); ++i) {
+        if (defines_value(instrs[i])) {
+          def_block[static_cast<std::size_t>(instrs[i].result)] = id;
+          def_index[static_cast<std::size_t>(instrs[i].result)] = i;
+          def_instr[static_cast<std::size_t>(instrs[i].result)] = &instrs[i];
+        }
+      }
+    }
+    for (int id : layout) {
+      const auto& instrs = function.blocks[static_cast<std::size_t>(id)].instrs;
+      for (std::size_t i = 0; i < instrs.size(); ++i) {
+        for (ValueId operand : instrs[i].operands) {
+          auto slot = static_cast<std::size_t>(operand);
+          ++use_count[slot];
+          uses[slot].emplace_back(id, i);
+          if (def_block[slot] != id) {
+            used_elsewhere[slot] = true;
+          }
+        }
+      }
+    }
+
+    // 变量加载仅在定义到每个使用之间都不会被改写时才可重新加载
+    auto clean_range = [&](int block, std::size_t begin, std::size_t end, const Instr& load) {
+      const auto& instrs = function.blocks[static_cast<std::size_t>(block)].instrs;
+      for (std::size_t i = begin; i < end && i < instrs.size(); ++i) {
+        if (clobbers(instrs[i], load.level, load.immediate)) {
+          return false;
+        }
+      }
+      return true;
+    };
+    auto reloadable = [&](std::size_t value) {
+      const Instr& load = *def_instr[value];
+      const int home = def_block[value];
+      const std::size_t after = def_index[value] + 1;
+      for (const auto& [block, index] : uses[value]) {
+        if (block == home) {
+          if (!clean_range(block, after, index, load)) {
+            return false;
+          }
+          continue;
+        }
+        if (!clean_range(home, after, SIZE_MAX, load) || !clean_range(block, 0, index, load)) {
+          return false;
+        }
+        int current = block;
+        for (std::size_t steps = 0;; ++steps) {
+          const auto& preds = function.blocks[static_cast<std::size_t>(current)].preds;
+          if (preds.size() != 1 || steps > function.blocks.size()) {
+            return false;
+          }
+          current = preds.front();
+          if (current == home) {
+            break;
+          }
+          if (!clean_range(current, 0, SIZE_MAX, load)) {
+            return false;
+          }
+        }
+      }
+      return true;
+    };
+    std::vector<bool> rematerializable(count, false);
+    for (std::size_t value = 0; value < count; ++value) {
+      if (!def_instr[value]) {
+        continue;
+      }
+      Kind kind = def_instr[value]->kind;
+      rematerializable[value] = kind == Kind::Const || kind == Kind::Address ||
+                                (kind == Kind::Load && reloadable(value));
+    }
+
+    std::vector<Placement> placement(count, Placement::Skip);
+    auto demote = [&](ValueId value) {
+      auto slot = static_cast<std::size_t>(value);
+      placement[slot] = rematerializable[slot] ? Placement::Remat : Placement::Temp;
+    };
+    for (std::size_t value = 0; value < count; ++value) {
+      if (!def_instr[value]) {
+        continue;
+      }
+      if (use_count[value] == 0) {
+        placement[value] = has_side_effects(*def_instr[value]) ? Placement::Discard
+                                                               : Placement::Skip;
+      } else if (used_elsewhere[value]) {
+        demote(static_cast<ValueId>(value));
+      } else {
+        placement[value] = Placement::Stack;
+      }
+    }
+
+    // 栈序模拟: 若操作数无法按顺序出现在栈顶, 则降级为临时单元, 再从被降级值中最早的定义处续做.
+    //   模拟栈是共享前缀的链表, 每条指令之前的栈顶都留有记录, 续做时直接取回;
+    //   累计模拟的指令数超出块长的 kPlacementWorkFactor 倍时, 块内的值全部降级, 保证线性时间
+    struct StackNode {
+      ValueId value;
+      int below;
+      std::size_t depth;
+    };
+    for (int id : layout) {
+      const auto& instrs = function.blocks[static_cast<std::size_t>(id)].instrs;
+      std::vector<StackNode> nodes;
+      std::vector<int> top_before(instrs.size() + 1, -1);
+      std::size_t budget = kPlacementWorkFactor * (instrs.size() + 1);
+      std::size_t restart = SIZE_MAX;
+      auto demote_stacked = [&](ValueId value) {
+        const auto slot = static_cast<std::size_t>(value);
+        if (placement[slot] != Placement::Stack) {
+          return;
+        }
+        demote(value);
+        restart = std::min(restart, def_block[slot] == id ? def_index[slot] : 0);
+      };
+      auto demote_all = [&](int top) {
+        for (int node = top; node >= 0; node = nodes[static_cast<std::size_t>(node)].below) {
+          demote_stacked(nodes[static_cast<std::size_t>(node)].value);
+        }
+      };
+
+      for (std::size_t position = 0; position <= instrs.size();) {
+        if (budget-- == 0) {
+          for (const auto& instr : instrs) {
+            for (ValueId operand : instr.operands) {
+              demote_stacked(operand);
+            }
+            if (defines_value(instr)) {
+              demote_stacked(instr.result);
+            }
+          }
+          break;
+        }
+        restart = SIZE_MAX;
+        const int top = top_before[position];
+        if (position == instrs.size()) {
+          demote_all(top);
+          if (restart == SIZE_MAX) {
+            break;
+          }
+          position = restart;
+          continue;
+        }
+
+        const auto& instr = instrs[position];
+        const auto& ops = instr.operands;
+        std::size_t leading = 0;
+        while (leading < ops.size() &&
+               placement[static_cast<std::size_t>(ops[leading])] == Placement::Stack) {
+          ++leading;
+        }
+        for (std::size_t i = leading; i < ops.size(); ++i) {
+          demote_stacked(ops[i]);
+        }
+        const std::size_t depth = top < 0 ? 0 : nodes[static_cast<std::size_t>(top)].depth;
+        bool matches = depth >= leading;
+        int rest = top;
+        for (std::size_t i = leading; matches && i-- > 0;) {
+          matches = nodes[static_cast<std::size_t>(rest)].value == ops[i];
+          rest = nodes[static_cast<std::size_t>(rest)].below;
+        }
+        if (!matches) {
+          // 优先降级可重新生成的值, 其余值尽量保留在栈上
+          bool cheap = false;
+          for (std::size_t i = 0; i < leading; ++i) {
+            if (rematerializable[static_cast<std::size_t>(ops[i])]) {
+              demote_stacked(ops[i]);
+              cheap = true;
+            }
+          }
+          for (std::size_t i = 0; i < leading && !cheap; ++i) {
+            demote_stacked(ops[i]);
+          }
+        }
+        if ((instr.kind == Kind::Alloc || is_terminator(instr)) && depth != leading) {
+          demote_all(top);
+        }
+        if (restart != SIZE_MAX) {
+          position = restart;
+          continue;
+        }
+
+        if (defines_value(instr) &&
+            placement[static_cast<std::size_t>(instr.result)] == Placement::Stack) {
+          for (int i = 0; i < use_count[static_cast<std::size_t>(instr.result)]; ++i) {
+            const std::size_t below_depth =
+                rest < 0 ? 0 : nodes[static_cast<std::size_t>(rest)].depth;
+            nodes.push_back({instr.result, rest, below_depth + 1});
+            rest = static_cast<int>(nodes.size()) - 1;
+          }
+        }
+        top_before[++position] = rest;
+      }
+    }
+    return placement;
+  }
+
+  // 函数: 降级单个函数
+  void lower_function(const Function& function) {
+    std::vector<int> layout = layout_blocks(function);
+    std::vector<Placement> placement = place_values(function, layout);
+    std::vector<const Instr*> def_instr(static_cast<std::size_t>(function.value_count), nullptr);
+    std::vector<int> use_count(static_cast<std::size_t>(function.value_count), 0);
+
+    int frame_size = 0;
+    for (int id : layout) {
+      for (const auto& instr : function.blocks[static_cast<std::size_t>(id)].instrs) {
+        if (instr.kind == Kind::Alloc) {
+          frame_size = static_cast<int>(instr.immediate);
+        }
+        if (defines_value(instr)) {
+          def_instr[static_cast<std::size_t>(instr.result)] = &instr;
+        }
+        for (ValueId operand : instr.operands) {
+          ++use_count[static_cast<std::size_t>(operand)];
+        }
+      }
+    }
+    std::vector<int> temp_slot(static_cast<std::size_t>(function.value_count), -1);
+    int temps = 0;
+    for (std::size_t value = 0; value < placement.size(); ++value) {
+      if (placement[value] == Placement::Temp) {
+        temp_slot[value] = frame_size + temps++;
+      }
+    }
+
+    auto& code = output_.code;
+    std::vector<int> block_address(function.blocks.size(), -1);
+    std::vector<std::pair<int, int>> jump_fixups;
+    auto emit = [&](Op op, int level, std::int64_t argument) {
+      code.push_back({op, level, static_cast<std::int32_t>(argument)});
+      return static_cast<int>(code.size()) - 1;
+    };
+
+    for (std::size_t position = 0; position < layout.size(); ++position) {
+      const auto& block = function.blocks[static_cast<std::size_t>(layout[position])];
+      const int next_block = position + 1 < layout.size() ? layout[position + 1] : -1;
+      block_address[static_cast<std::size_t>(block.id)] = static_cast<int>(code.size());
+
+      for (const auto& instr : block.instrs) {
+        if (defines_value(instr)) {
+          auto mode = placement[static_cast<std::size_t>(instr.result)];
+          if (mode == Placement::Remat || mode == Placement::Skip) {
+            continue;
+          }
+        }
+        for (ValueId operand : instr.operands) {
+          auto slot = static_cast<std::size_t>(operand);
+          if (placement[slot] == Placement::Remat) {
+            const Instr& def = *def_instr[slot];
+            if (def.kind == Kind::Const) {
+              code.push_back(load_constant(def.immediate));
+            } else {
+              emit(def.kind == Kind::Load ? Op::LOD : Op::LDA, def.level, def.immediate);
+            }
+          } else if (placement[slot] == Placement::Temp) {
+            emit(Op::LOD, 0, temp_slot[slot]);
+          }
+        }
+        switch (instr.kind) {
+          case Kind::Const:
+            code.push_back(load_constant(instr.immediate));
+            break;
+          case Kind::Load:
+            emit(Op::LOD, instr.level, instr.immediate);
+            break;
+          case Kind::Store:
+            emit(Op::STO, instr.level, instr.immediate);
+            break;
+          case Kind::Address:
+            emit(Op::LDA, instr.level, instr.immediate);
+            break;
+          case Kind::Index:
+            emit(Op::IDX, 0, 0);
+            break;
+          case Kind::LoadIndirect:
+            emit(Op::LDI, 0, 0);
+            break;
+          case Kind::StoreIndirect:
+            emit(Op::STI, 0, 0);
+            break;
+          case Kind::Check:
+            emit(Op::CHK, 0, instr.immediate);
+            break;
+          case Kind::Unary:
+          case Kind::Binary:
+            emit(Op::OPR, 0, static_cast<int>(instr.opr));
+            break;
+          case Kind::Read:
+            emit(Op::OPR, 0, static_cast<int>(Opr::READ));
+            break;
+          case Kind::Write:
+            emit(Op::OPR, 0, static_cast<int>(Opr::WRITE));
+            break;
+          case Kind::WriteLine:
+            emit(Op::OPR, 0, static_cast<int>(Opr::WRITELN));
+            break;
+          case Kind::Call:
+            call_fixups_.emplace_back(emit(Op::CAL, instr.level, 0), instr.callee);
+            break;
+          case Kind::TailCall:
+            call_fixups_.emplace_back(emit(Op::TCL, instr.level, 0), instr.callee);
+            break;
+          case Kind::Alloc:
+            emit(Op::INT, 0, instr.immediate + temps);
+            break;
+          case Kind::Jump:
+            if (instr.target != next_block) {
+              jump_fixups.emplace_back(emit(Op::JMP, 0, 0), instr.target);
+            }
+            break;
+          case Kind::Branch:
+            jump_fixups.emplace_back(emit(Op::JPC, 0, 0), instr.target);
+            if (instr.fallthrough != next_block) {
+              jump_fixups.emplace_back(emit(Op::JMP, 0, 0), instr.fallthrough);
+            }
+            break;
+          case Kind::Return:
+            emit(Op::OPR, instr.level, static_cast<int>(instr.opr));
+            break;
+        }
+        if (!defines_value(instr)) {
+          continue;
+        }
+        auto slot = static_cast<std::size_t>(instr.result);
+        switch (placement[slot]) {
+          case Placement::Stack:
+            for (int i = 1; i < use_count[slot]; ++i) {
+              emit(Op::DUP, 0, 0);
+            }
+            break;
+          case Placement::Temp:
+            emit(Op::STO, 0, temp_slot[slot]);
+            break;
+          case Placement::Discard:
+            emit(Op::INT, 0, -1);
+            break;
+          case Placement::Remat:
+          case Placement::Skip:
+            break;
+        }
+      }
+    }
+
+    for (const auto& [at, target] : jump_fixups) {
+      code[static_cast<std::size_t>(at)].argument =
+          block_address[static_cast<std::size_t>(target)];
+    }
+  }
+
+  const Module& module_;
+  LoweredProgram output_;
+  std::vector<std::pair<int, int>> call_fixups_;
+};
+
+// 函数: 打印单个值引用
+void print_value(std::ostream& out, ValueId value) {
+  out << '%' << value;
+}
+
+// 函数: 打印 IR 指令
+void print_instr(const Module& module, const Instr& instr, std::ostream& out) {
+  out << "    ";
+  if (defines_value(instr)) {
+    print_value(out, instr.result);
+    out << " = ";
+  }
+  auto operands = [&]() {
+    for (std::size_t i = 0; i < instr.operands.size(); ++i) {
+      out << (i == 0 ? " " : ", ");
+      print_value(out, instr.operands[i]);
+    }
+  };
+  switch (instr.kind) {
+    case Kind::Const:
+      out << "lit " << instr.immediate;
+      break;
+    case Kind::Load:
+      out << "lod " << instr.level << ' ' << instr.immediate;
+      break;
+    case Kind::Store:
+      out << "sto " << instr.level << ' ' << instr.immediate << ',';
+      operands();
+      break;
+    case Kind::Address:
+      out << "lda " << instr.level << ' ' << instr.immediate;
+      break;
+    case Kind::Index:
+      out << "idx";
+      operands();
+      break;
+    case Kind::LoadIndirect:
+      out << "ldi";
+      operands();
+      break;
+    case Kind::StoreIndirect:
+      out << "sti";
+      operands();
+      break;
+    case Kind::Check:
+      out << "chk " << instr.immediate << ',';
+      operands();
+      break;
+    case Kind::Unary:
+    case Kind::Binary:
+      out << to_string(instr.opr);
+      operands();
+      break;
+    case Kind::Read:
+      out << "read";
+      break;
+    case Kind::Write:
+      out << "write";
+      operands();
+      break;
+    case Kind::WriteLine:
+      out << "writeln";
+      break;
+    case Kind::Call:
+    case Kind::TailCall:
+      out << (instr.kind == Kind::Call ? "cal " : "tcl ") << instr.level << " @"
+          << module.functions[static_cast<std::size_t>(instr.callee)].name;
+      operands();
+      break;
+    case Kind::Alloc:
+      out << "int " << instr.immediate;
+      break;
+    case Kind::Jump:
+      out << "jmp bb" << instr.target;
+      break;
+    case Kind::Branch:
+      out << "br";
+      operands();
+      out << ", bb" << instr.fallthrough << ", bb" << instr.target;
+      break;
+    case Kind::Return:
+      out << to_string(instr.opr) << ' ' << instr.level;
+      operands();
+      break;
+  }
+  out << '\n';
+}
+
+}  // namespace
+
+// 函数: 由 P-Code 构建 IR
+std::optional<Module> build_module(const InstructionSequence& code) {
+  ModuleBuilder builder(code);
+  return builder.build();
+}
+
+// 函数: 将 IR 降级为 P-Code
+LoweredProgram lower_module(const Module& module) {
+  Lowerer lowerer(module);
+  return lowerer.lower();
+}
+
+// 函数: 根据终结指令重建前驱/后继关系
+void recompute_edges(Function& function) {
+  for (auto& block : function.blocks) {
+    block.preds.clear();
+    block.succs.clear();
+  }
+  for (auto& block : function.blocks) {
+    if (block.removed || block.instrs.empty()) {
+      continue;
+    }
+    const Instr& last = block.instrs.back();
+    if (last.kind == Kind::Jump) {
+      block.succs.push_back(last.target);
+    } else if (last.kind == Kind::Branch) {
+      block.succs.push_back(last.fallthrough);
+      if (last.target != last.fallthrough) {
+        block.succs.push_back(last.target);
+      }
+    }
+    for (int succ : block.succs) {
+      function.blocks[static_cast<std::size_t>(succ)].preds.push_back(block.id);
+    }
+  }
+}
+
+// 函数: 为过程入口匹配符号名
+void assign_names(Module& module, const std::vector<Symbol>& symbols) {
+  for (std::size_t index = 0; index < module.functions.size(); ++index) {
+    auto& function = module.functions[index];
+    if (static_cast<int>(index) == module.main) {
+      function.name = "main";
+      continue;
+    }
+    for (const auto& symbol : symbols) {
+      if ((symbol.kind == SymbolKind::Procedure || symbol.kind == SymbolKind::Function) &&
+          symbol.address == function.entry_pc) {
+        function.name = symbol.name;
+        break;
+      }
+    }
+  }
+}
+
+// 函数: 打印整个模块
+void print_module(const Module& module, std::ostream& out) {
+  for (const auto& function : module.functions) {
+    out << "function " << function.name << " (entry " << function.entry_pc << ")\n";
+    std::vector<const BasicBlock*> blocks;
+    for (const auto& block : function.blocks) {
+      if (!block.removed) {
+        blocks.push_back(&block);
+      }
+    }
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [&](const BasicBlock* lhs, const BasicBlock* rhs) {
+                       if ((lhs->id == function.entry) != (rhs->id == function.entry)) {
+                         return lhs->id == function.entry;
+                       }
+                       return lhs->origin < rhs->origin;
+                     });
+    for (const auto* block : blocks) {
+      out << "  bb" << block->id << ":";
+      if (!block->preds.empty()) {
+        out << "  ; preds";
+        for (int pred : block->preds) {
+          out << " bb" << pred;
+        }
+      }
+      out << '\n';
+      for (const auto& instr : block->instrs) {
+        print_instr(module, instr, out);
+      }
+    }
+  }
+}
+
+// 函数: 指令是否定义 SSA 值
+bool defines_value(const Instr& instr) {
+  return instr.result != kNoValue;
+}
+
+// 函数: 指令是否结束基本块
+bool is_terminator(const Instr& instr) {
+  return instr.kind == Kind::Jump || instr.kind == Kind::Branch ||
+         instr.kind == Kind::Return || instr.kind == Kind::TailCall;
+}
+
+// 函数: 指令是否有不可删除的副作用 (写内存/IO/调用/可能陷入)
+bool has_side_effects(const Instr& instr) {
+  switch (instr.kind) {
+    case Kind::Const:
+    case Kind::Load:
+    case Kind::Address:
+    case Kind::Index:
+    case Kind::LoadIndirect:
+    case Kind::Unary:
+      return false;
+    case Kind::Binary:
+      return instr.opr == Opr::DIV || instr.opr == Opr::MOD;
+    default:
+      return true;
+  }
+}
+
+// 函数: 指令是否转入其他过程 (含尾调用)
+bool is_call(const Instr& instr) {
+  return instr.kind == Kind::Call || instr.kind == Kind::TailCall;
+}
+
+}  // namespace pl0::ir
@@ -0,0 +1,583 @@
+// 文件: Incremental.cpp
+// 功能: 实现增量前端: 局部重扫 Token, 在最内层可独立解析的语句或过程上重解析并复用其余 AST
+#include "pl0/Incremental.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "pl0/Lexer.hpp"
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 局部重扫的初始窗口, Token 触及窗口末尾时按 4 倍扩大后重来
+constexpr std::size_t kInitialWindow = 4096;
+
+bool before(SourceLoc lhs, SourceLoc rhs) {
+  return lhs.line < rhs.line || (lhs.line == rhs.line && lhs.column < rhs.column);
+}
+
+bool same(SourceLoc lhs, SourceLoc rhs) {
+  return lhs.line == rhs.line && lhs.column == rhs.column;
+}
+
+// 结构: 编辑点之后位置的平移; 旧坐标中不早于 from 的位置整体移到以 to 为起点
+struct Shift {
+  SourceLoc from;
+  SourceLoc to;
+
+  SourceLoc operator()(SourceLoc loc) const {
+    if (before(loc, from)) {
+      return loc;
+    }
+    if (loc.line == from.line) {
+      return {to.line, to.column + (loc.column - from.column)};
+    }
+    return {loc.line - from.line + to.line, loc.column};
+  }
+
+  void operator()(SourceRange& range) const {
+    range.begin = (*this)(range.begin);
+    range.end = (*this)(range.end);
+  }
+
+  // 行数不变时只有 from 所在行的位置会移动, 起点在后续行的区间 (及其后的全部兄弟) 保持不变
+  [[nodiscard]] bool unchanged_from(const SourceRange& range) const {
+    return same(from, to) || (from.line == to.line && range.begin.line > from.line);
+  }
+};
+
+void sort_by_position(std::vector<Diagnostic>& diagnostics) {
+  std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                   [](const Diagnostic& lhs, const Diagnostic& rhs) {
+                     return before(lhs.range.begin, rhs.range.begin);
+                   });
+}
+
+// 函数: 以 added 替换 list[first, last), 只搬动一次尾部元素
+template <typename T>
+void replace_range(std::vector<T>& list, std::size_t first, std::size_t last,
+                   std::vector<T>& added) {
+  const std::size_t common = std::min(last - first, added.size());
+  const auto at = list.begin() + static_cast<std::ptrdiff_t>(first);
+  const auto split = added.begin() + static_cast<std::ptrdiff_t>(common);
+  std::move(added.begin(), split, at);
+  const auto rest = at + static_cast<std::ptrdiff_t>(common);
+  if (common < added.size()) {
+    list.insert(rest, std::make_move_iterator(split), std::make_move_iterator(added.end()));
+  } else {
+    list.erase(rest, list.begin() + static_cast<std::ptrdiff_t>(last));
+  }
+}
+
+// 函数: 删除起点落在 [begin, end) 的诊断 (to_end 时删除 begin 之后全部), 平移其余诊断并并入新诊断
+void splice_diagnostics(std::vector<Diagnostic>& list, SourceLoc begin, SourceLoc end,
+                        bool to_end, const Shift* shift, const std::vector<Diagnostic>& added) {
+  std::vector<Diagnostic> result;
+  result.reserve(list.size() + added.size());
+  for (auto& diagnostic : list) {
+    const bool inside = !before(diagnostic.range.begin, begin) &&
+                        (to_end || before(diagnostic.range.begin, end));
+    if (inside) {
+      continue;
+    }
+    if (shift) {
+      (*shift)(diagnostic.range);
+    }
+    result.push_back(std::move(diagnostic));
+  }
+  result.insert(result.end(), added.begin(), added.end());
+  sort_by_position(result);
+  list = std::move(result);
+}
+
+void shift_expression(Expression& root, const Shift& shift) {
+  std::vector<Expression*> pending{&root};
+  while (!pending.empty()) {
+    Expression* expr = pending.back();
+    pending.pop_back();
+    shift(expr->range);
+    for_each_child(*expr, [&pending](ExprPtr& child) {
+      if (child) {
+        pending.push_back(child.get());
+      }
+    });
+  }
+}
+
+void shift_statement(Statement& stmt, const Shift& shift);
+
+void shift_statements(std::vector<StmtPtr>& statements, const Shift& shift) {
+  for (auto& stmt : statements) {
+    if (shift.unchanged_from(stmt->range)) {
+      break;
+    }
+    shift_statement(*stmt, shift);
+  }
+}
+
+// 语句的区间由其 Token 推出, 子结点不会超出父结点的终点, 整体位于平移起点之前的子树可以跳过
+void shift_statement(Statement& stmt, const Shift& shift) {
+  if (before(stmt.range.end, shift.from)) {
+    return;
+  }
+  shift(stmt.range);
+  std::visit(
+      [&](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<T, AssignmentStmt>) {
+          if (node.index) {
+            shift_expression(*node.index, shift);
+          }
+          if (node.value) {
+            shift_expression(*node.value, shift);
+          }
+        } else if constexpr (std::is_same_v<T, CallStmt>) {
+          for (auto& argument : node.arguments) {
+            shift_expression(*argument, shift);
+          }
+        } else if constexpr (std::is_same_v<T, IfStmt>) {
+          shift_expression(*node.condition, shift);
+          shift_statements(node.then_branch, shift);
+          shift_statements(node.else_branch, shift);
+        } else if constexpr (std::is_same_v<T, WhileStmt>) {
+          shift_expression(*node.condition, shift);
+          shift_statements(node.body, shift);
+        } else if constexpr (std::is_same_v<T, RepeatStmt>) {
+          shift_statements(node.body, shift);
+          shift_expression(*node.condition, shift);
+        } else if constexpr (std::is_same_v<T, WriteStmt>) {
+          for (auto& value : node.values) {
+            shift_expression(*value, shift);
+          }
+        } else if constexpr (std::is_same_v<T, std::vector<StmtPtr>>) {
+          shift_statements(node, shift);
+        }
+      },
+      stmt.value);
+}
+
+void shift_block(Block& block, const Shift& shift) {
+  for (auto& decl : block.consts) {
+    shift(decl.range);
+  }
+  for (auto& decl : block.vars) {
+    shift(decl.range);
+  }
+  for (auto& proc : block.procedures) {
+    if (before(proc.range.end, shift.from)) {
+      continue;
+    }
+    if (shift.unchanged_from(proc.range)) {
+      break;
+    }
+    shift(proc.range);
+    for (auto& param : proc.parameters) {
+      shift(param.range);
+    }
+    shift_block(*proc.body, shift);
+  }
+  shift_statements(block.statements, shift);
+}
+
+// 函数: 对语句的直接子语句逐一调用 visit, 直到 visit 返回 true
+template <typename StatementT, typename Visitor>
+bool visit_children(StatementT& stmt, Visitor&& visit) {
+  return std::visit(
+      [&](auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        auto each = [&](auto& list) {
+          return std::any_of(list.begin(), list.end(),
+                             [&](auto& child) { return visit(child); });
+        };
+        if constexpr (std::is_same_v<T, IfStmt>) {
+          return each(node.then_branch) || each(node.else_branch);
+        } else if constexpr (std::is_same_v<T, WhileStmt> || std::is_same_v<T, RepeatStmt>) {
+          return each(node.body);
+        } else if constexpr (std::is_same_v<T, std::vector<StmtPtr>>) {
+          return each(node);
+        } else {
+          return false;
+        }
+      },
+      stmt.value);
+}
+
+}  // namespace
+
+// 结构: 可独立重解析的语法单元及其在 AST 中的位置, statement 与 procedure 二选一
+struct IncrementalParser::Unit {
+  StmtPtr* statement = nullptr;
+  ProcedureDecl* procedure = nullptr;
+  TokenSpan span;
+};
+
+// 构造: 以空源码开始
+IncrementalParser::IncrementalParser() { reset({}); }
+
+IncrementalParser::~IncrementalParser() = default;
+
+// 函数: 整体扫描与解析
+void IncrementalParser::reset(std::string source) {
+  source_ = std::move(source);
+  lex_all();
+  parse_all();
+  stats_ = {tokens_.size(), tokens_.size(), true};
+}
+
+// 函数: 应用编辑, 重扫受影响的 Token 后重解析包含它们的最内层语法单元
+const IncrementalStats& IncrementalParser::apply(const TextEdit& edit) {
+  if (edit.offset > source_.size() || edit.removed > source_.size() - edit.offset) {
+    throw std::out_of_range("edit range exceeds source");
+  }
+  stats_ = {};
+  const std::size_t old_end = edit.offset + edit.removed;
+  const std::size_t new_end = edit.offset + edit.inserted.size();
+  const auto byte_delta = static_cast<std::ptrdiff_t>(edit.inserted.size()) -
+                          static_cast<std::ptrdiff_t>(edit.removed);
+  source_.replace(edit.offset, edit.removed, edit.inserted);
+
+  // 从包含编辑点前一个字节的 Token 开始重扫: 最长匹配可能把它与新文本连成一个 Token
+  std::size_t first = 0;
+  if (edit.offset > 0) {
+    const auto token_starts_end = offsets_.begin() + static_cast<std::ptrdiff_t>(tokens_.size());
+    first = static_cast<std::size_t>(
+                std::upper_bound(offsets_.begin(), token_starts_end, edit.offset - 1) -
+                offsets_.begin()) -
+            1;
+  }
+
+  // 扫描到某个 Token 的终点映射回旧坐标后恰为旧 Token 边界时, 其后的 Token 必然不变
+  std::vector<Token> fresh;
+  std::vector<std::size_t> fresh_offsets;
+  DiagnosticSink lex_sink;
+  std::size_t resync = tokens_.size();
+  const std::size_t start = offsets_[first];
+  std::size_t window = std::max(kInitialWindow, (new_end - start) * 2);
+  while (true) {
+    fresh.clear();
+    fresh_offsets.clear();
+    lex_sink.clear();
+    resync = tokens_.size();
+    const std::size_t length = std::min(window, source_.size() - start);
+    const bool whole = start + length == source_.size();
+    const SourceBuffer slice(std::string_view(source_).substr(start, length));
+    Lexer lexer(slice, lex_sink);
+    lexer.reset(tokens_[first].range.begin);
+    bool truncated = false;
+    std::size_t scan = start;
+    while (true) {
+      Token token = lexer.next();
+      // 词法器最多向后看一个字符, 触及窗口末尾的 Token 可能被截断
+      if (!whole && lexer.offset() + 1 >= length) {
+        truncated = true;
+        break;
+      }
+      const std::size_t end = start + lexer.offset();
+      fresh_offsets.push_back(scan);
+      fresh.push_back(std::move(token));
+      scan = end;
+      if (fresh.back().kind == TokenKind::EndOfFile && end >= source_.size()) {
+        break;
+      }
+      if (end >= new_end) {
+        const std::size_t old_offset = end - new_end + old_end;
+        const auto boundaries_end = offsets_.begin() + static_cast<std::ptrdiff_t>(tokens_.size());
+        auto it = std::lower_bound(
+            offsets_.begin() + static_cast<std::ptrdiff_t>(first) + 1, boundaries_end, old_offset);
+        if (it != boundaries_end && *it == old_offset) {
+          resync = static_cast<std::size_t>(it - offsets_.begin());
+          break;
+        }
+      }
+    }
+    if (!truncated) {
+      break;
+    }
+    window *= 4;
+  }
+
+  const bool reached_end = resync == tokens_.size();
+  const auto delta = static_cast<std::ptrdiff_t>(fresh.size()) -
+                     static_cast<std::ptrdiff_t>(resync - first);
+  const SourceLoc relex_begin = tokens_[first].range.begin;
+  const Shift shift{reached_end ? tokens_.back().range.end : tokens_[resync].range.begin,
+                    fresh.back().range.end};
+  stats_.relexed_tokens = fresh.size();
+
+  // 变化的 Token 全部位于整体解析取走的范围之后时 AST 不受影响
+  const bool beyond_program = first >= program_consumed_;
+  std::vector<Unit> chain;
+  if (!beyond_program && !reached_end) {
+    collect_block(program_->block, first, resync, chain);
+  }
+
+  // 替换 Token 并平移其后的位置与偏移
+  for (std::size_t i = resync; i < tokens_.size(); ++i) {
+    if (shift.unchanged_from(tokens_[i].range)) {
+      break;
+    }
+    shift(tokens_[i].range);
+  }
+  if (byte_delta != 0) {
+    for (std::size_t i = resync; i < offsets_.size(); ++i) {
+      offsets_[i] =
+          static_cast<std::size_t>(static_cast<std::ptrdiff_t>(offsets_[i]) + byte_delta);
+    }
+  }
+  replace_range(tokens_, first, resync, fresh);
+  replace_range(offsets_, first, resync, fresh_offsets);
+  splice_diagnostics(lex_diagnostics_, relex_begin, shift.from, reached_end, &shift,
+                     lex_sink.diagnostics());
+
+  if (beyond_program) {
+    return stats_;
+  }
+  if (chain.empty()) {
+    parse_all();
+    stats_.full_reparse = true;
+    return stats_;
+  }
+
+  // 平移 AST、区间表与语法诊断, 使未改动部分与新文本对齐; Token 数不变时区间表无需改动
+  shift_block(program_->block, shift);
+  if (delta != 0) {
+    auto move_index = [&](std::size_t& index) {
+      if (index >= resync) {
+        index = static_cast<std::size_t>(static_cast<std::ptrdiff_t>(index) + delta);
+      }
+    };
+    for (auto& [node, span] : spans_.statements) {
+      move_index(span.first);
+      move_index(span.last);
+    }
+    for (auto& [node, span] : spans_.procedures) {
+      move_index(span.first);
+      move_index(span.last);
+    }
+    move_index(program_consumed_);
+  }
+  splice_diagnostics(parse_diagnostics_, relex_begin, shift.from, false, &shift, {});
+
+  for (std::size_t depth = chain.size(); depth-- > 0;) {
+    if (reparse_unit(chain[depth], delta, chain, depth)) {
+      return stats_;
+    }
+  }
+  parse_all();
+  stats_.full_reparse = true;
+  return stats_;
+}
+
+// 函数: 比较公共前后缀, 把差异部分作为一次编辑应用
+const IncrementalStats& IncrementalParser::update(std::string_view source) {
+  const std::size_t limit = std::min(source_.size(), source.size());
+  const auto prefix = static_cast<std::size_t>(
+      std::mismatch(source_.begin(), source_.begin() + static_cast<std::ptrdiff_t>(limit),
+                    source.begin())
+          .first -
+      source_.begin());
+  const auto tail = static_cast<std::ptrdiff_t>(limit - prefix);
+  const auto suffix = static_cast<std::size_t>(
+      std::mismatch(source_.rbegin(), source_.rbegin() + tail, source.rbegin()).first -
+      source_.rbegin());
+  if (prefix == source_.size() && prefix == source.size()) {
+    stats_ = {};
+    return stats_;
+  }
+  return apply({prefix, source_.size() - prefix - suffix,
+                std::string(source.substr(prefix, source.size() - prefix - suffix))});
+}
+
+// 函数: 合并词法与语法诊断
+std::vector<Diagnostic> IncrementalParser::diagnostics() const {
+  std::vector<Diagnostic> result = lex_diagnostics_;
+  result.insert(result.end(), parse_diagnostics_.begin(), parse_diagnostics_.end());
+  sort_by_position(result);
+  return result;
+}
+
+// 函数: 整体扫描源码, 记录每个 Token 的扫描起点
+void IncrementalParser::lex_all() {
+  tokens_.clear();
+  offsets_.clear();
+  DiagnosticSink sink;
+  const SourceBuffer text(source_);
+  Lexer lexer(text, sink);
+  while (true) {
+    offsets_.push_back(lexer.offset());
+    tokens_.push_back(lexer.next());
+    // 非法字符也会产生 EndOfFile, 只有扫描到源码末尾的才是真正的结束
+    if (tokens_.back().kind == TokenKind::EndOfFile && lexer.offset() >= source_.size()) {
+      break;
+    }
+  }
+  offsets_.push_back(source_.size());
+  lex_diagnostics_ = sink.diagnostics();
+  sort_by_position(lex_diagnostics_);
+}
+
+// 函数: 在 Token 序列上整体解析并重建区间表
+void IncrementalParser::parse_all() {
+  DiagnosticSink sink;
+  Lexer replay(tokens_, 0, sink);
+  Parser parser(replay, sink);
+  spans_ = ParseSpans{};
+  parser.record_spans(&spans_);
+  program_ = parser.parse_program();
+  program_consumed_ = replay.consumed();
+  parse_diagnostics_ = sink.diagnostics();
+  sort_by_position(parse_diagnostics_);
+  stats_.reparsed_tokens = tokens_.size();
+}
+
+// 函数: 重解析一个语法单元; 只有恰好止于原边界 Token 且诊断不越界时才与整体解析等价
+bool IncrementalParser::reparse_unit(const Unit& unit, std::ptrdiff_t delta,
+                                     const std::vector<Unit>& chain, std::size_t depth) {
+  const std::size_t first = unit.span.first;
+  const auto last =
+      static_cast<std::size_t>(static_cast<std::ptrdiff_t>(unit.span.last) + delta);
+  if (last >= tokens_.size()) {
+    return false;
+  }
+  const SourceLoc region_begin = tokens_[first].range.begin;
+  const SourceLoc region_end = tokens_[last].range.begin;
+
+  DiagnosticSink sink;
+  Lexer replay(tokens_, first, sink);
+  Parser parser(replay, sink);
+  ParseSpans local;
+  parser.record_spans(&local);
+  auto valid = [&] {
+    return first + replay.consumed() == last &&
+           std::all_of(sink.diagnostics().begin(), sink.diagnostics().end(),
+                       [&](const Diagnostic& diagnostic) {
+                         return !before(diagnostic.range.begin, region_begin) &&
+                                before(diagnostic.range.begin, region_end);
+                       });
+  };
+
+  // Token 的终点即下一个 Token 的起点, 祖先端点与单元端点重合时无法区分它取自子结点还是边界 Token;
+  //   只在单元端点与区域边界的重合关系不变时接受, 否则交给外层单元
+  auto consistent = [&](const SourceRange& old_range, const SourceRange& new_range) {
+    return same(old_range.begin, region_begin) == same(new_range.begin, region_begin) &&
+           same(old_range.end, region_end) == same(new_range.end, region_end);
+  };
+
+  SourceRange old_range;
+  SourceRange new_range;
+  if (unit.statement) {
+    auto stmt = parser.parse_statement_unit();
+    if (!stmt || !valid() || !consistent((*unit.statement)->range, stmt->range)) {
+      return false;
+    }
+    old_range = (*unit.statement)->range;
+    new_range = stmt->range;
+    StmtPtr old = std::exchange(*unit.statement, std::move(stmt));
+    forget_statement(*old);
+  } else {
+    auto decl = parser.parse_procedure_unit();
+    if (!decl || !valid() || !consistent(unit.procedure->range, decl->range)) {
+      return false;
+    }
+    old_range = unit.procedure->range;
+    new_range = decl->range;
+    ProcedureDecl old = std::exchange(*unit.procedure, std::move(*decl));
+    spans_.procedures.erase(old.body.get());
+    forget_block(*old.body);
+  }
+  for (const auto& [node, span] : local.statements) {
+    spans_.statements[node] = TokenSpan{span.first + first, span.last + first};
+  }
+  for (const auto& [node, span] : local.procedures) {
+    spans_.procedures[node] = TokenSpan{span.first + first, span.last + first};
+  }
+
+  // 祖先的区间端点取自子结点, 与旧单元重合的端点随新单元更新
+  for (std::size_t i = 0; i < depth; ++i) {
+    SourceRange& range =
+        chain[i].statement ? (*chain[i].statement)->range : chain[i].procedure->range;
+    if (same(range.begin, old_range.begin)) {
+      range.begin = new_range.begin;
+    }
+    if (same(range.end, old_range.end)) {
+      range.end = new_range.end;
+    }
+  }
+  splice_diagnostics(parse_diagnostics_, region_begin, region_end, false, nullptr,
+                     sink.diagnostics());
+  stats_.reparsed_tokens = last - first;
+  return true;
+}
+
+// 函数: 自外向内收集包含 Token 区间 [first, last) 的语法单元
+void IncrementalParser::collect_block(Block& block, std::size_t first, std::size_t last,
+                                      std::vector<Unit>& chain) {
+  // 兄弟单元按源码顺序排列且互不重叠, 二分找到最后一个不晚于 first 开始的单元;
+  //   出错恢复时可能有未登记区间的结点, 视为从 0 开始, 最多让候选退到更靠前的兄弟
+  auto starts_after = [&](const auto& spans, const auto* node) {
+    auto it = spans.find(node);
+    return it != spans.end() && it->second.first > first;
+  };
+  auto proc = std::partition_point(
+      block.procedures.begin(), block.procedures.end(),
+      [&](const ProcedureDecl& decl) { return !starts_after(spans_.procedures, decl.body.get()); });
+  if (proc != block.procedures.begin()) {
+    --proc;
+    auto it = spans_.procedures.find(proc->body.get());
+    if (it != spans_.procedures.end() && it->second.first <= first && last <= it->second.last) {
+      chain.push_back({nullptr, &*proc, it->second});
+      collect_block(*proc->body, first, last, chain);
+      return;
+    }
+  }
+  auto stmt = std::partition_point(
+      block.statements.begin(), block.statements.end(),
+      [&](const StmtPtr& child) { return !starts_after(spans_.statements, child.get()); });
+  if (stmt != block.statements.begin()) {
+    collect_statement(*std::prev(stmt), first, last, chain);
+  }
+}
+
+bool IncrementalParser::collect_statement(StmtPtr& slot, std::size_t first, std::size_t last,
+                                          std::vector<Unit>& chain) {
+  auto it = spans_.statements.find(slot.get());
+  if (it == spans_.statements.end()) {
+    return false;
+  }
+  const TokenSpan span = it->second;
+  if (span.first > first || last > span.last) {
+    return false;
+  }
+  chain.push_back({&slot, nullptr, span});
+  visit_children(*slot, [&](StmtPtr& child) {
+    return collect_statement(child, first, last, chain);
+  });
+  return true;
+}
+
+// 函数: 从区间表中移除即将销毁的子树
+void IncrementalParser::forget_block(const Block& block) {
+  for (const auto& proc : block.procedures) {
+    spans_.procedures.erase(proc.body.get());
+    forget_block(*proc.body);
+  }
+  for (const auto& stmt : block.statements) {
+    forget_statement(*stmt);
+  }
+}
+
+void IncrementalParser::forget_statement(const Statement& stmt) {
+  spans_.statements.erase(&stmt);
+  visit_children(stmt, [&](const StmtPtr& child) {
+    forget_statement(*child);
+    return false;
+  });
+}
+
+}  // namespace pl0
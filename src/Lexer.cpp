@@ -2,8 +2,10 @@
 // 功能: 实现词法分析器, 将源码转化为 Token
 #include "pl0/Lexer.hpp"
 
+#include <algorithm>
 #include <cctype>
 #include <charconv>
+#include <stdexcept>
 #include <system_error>
 
 #include "pl0/Symbol.hpp"
@@ -27,10 +29,22 @@ bool is_identifier_part(char ch) {
 
 // 构造: 保存源码副本并绑定诊断收集器
 Lexer::Lexer(std::string source, DiagnosticSink& diagnostics)
-    : source_(std::move(source)), diagnostics_(diagnostics) {}
+    : owned_(std::move(source)), source_(owned_), diagnostics_(diagnostics) {}
+
+// 构造: 借用缓冲中的文本
+Lexer::Lexer(const SourceBuffer& source, DiagnosticSink& diagnostics)
+    : source_(source.view()), diagnostics_(diagnostics) {}
+
+// 构造: 回放模式, 诊断收集器仅为接口一致而保留
+Lexer::Lexer(const std::vector<Token>& tokens, std::size_t first, DiagnosticSink& diagnostics)
+    : diagnostics_(diagnostics), replay_(&tokens), replay_first_(first), replay_index_(first) {}
 
 // 函数: 预读指定偏移的 Token, 按需填充缓冲
 const Token& Lexer::peek(std::size_t lookahead) {
+  if (replay_) {
+    // 越过末尾时与扫描模式一致, 持续返回最后的 EndOfFile
+    return (*replay_)[std::min(replay_index_ + lookahead, replay_->size() - 1)];
+  }
   if (!buffer_valid_) {
     buffer_.clear();
     buffer_valid_ = true;
@@ -61,6 +75,12 @@ const Token& Lexer::peek(std::size_t lookahead) {
 
 // 函数: 取出下一个 Token
 Token Lexer::next() {
+  ++consumed_;
+  if (replay_) {
+    const Token& token = peek(0);
+    replay_index_ = std::min(replay_index_ + 1, replay_->size() - 1);
+    return token;
+  }
   const Token& token = peek(0);
   Token result = token;
   if (!buffer_.empty()) {
@@ -69,10 +89,21 @@ Token Lexer::next() {
   return result;
 }
 
+// 函数: 回放模式下跳过若干 Token, 与逐个 next() 的效果相同
+void Lexer::skip(std::size_t count) {
+  if (!replay_) {
+    throw std::logic_error("Lexer::skip requires replay mode");
+  }
+  consumed_ += count;
+  replay_index_ = std::min(replay_index_ + count, replay_->size() - 1);
+}
+
 // 函数: 重置扫描状态至起点
-void Lexer::reset() {
+void Lexer::reset(SourceLoc origin) {
+  consumed_ = 0;
+  replay_index_ = replay_first_;
   index_ = 0;
-  location_ = SourceLoc{1, 1};
+  location_ = origin;
   token_start_ = location_;
   buffer_.clear();
   buffer_valid_ = false;
@@ -0,0 +1,316 @@
+// 文件: Object.cpp
+// 功能: 实现目标文件的二进制编码与多模块链接
+#include "pl0/Object.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "pl0/Utility.hpp"
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 目标文件魔数; 格式变化时递增末尾版本号
+constexpr char kObjectMagic[8] = {'P', 'L', '0', 'O', 'B', 'J', '0', '1'};
+
+// 常量: 程序帧中静态链、动态链与返回地址之后才是全局变量
+constexpr int kFrameHeader = 3;
+
+// 函数: 写入符号表
+void put_symbols(ByteWriter& writer, const std::vector<ObjectSymbol>& symbols) {
+  writer.put(static_cast<std::uint32_t>(symbols.size()));
+  for (const auto& symbol : symbols) {
+    writer.put_string(symbol.name);
+    writer.put(static_cast<std::uint8_t>(symbol.kind));
+    writer.put(static_cast<std::int32_t>(symbol.address));
+    writer.put(static_cast<std::uint64_t>(symbol.size));
+  }
+}
+
+// 函数: 读取符号表
+std::vector<ObjectSymbol> get_symbols(ByteReader& reader) {
+  std::vector<ObjectSymbol> symbols;
+  const auto count = reader.get<std::uint32_t>();
+  for (std::uint32_t i = 0; i < count && reader.ok(); ++i) {
+    ObjectSymbol symbol;
+    symbol.name = reader.get_string();
+    const auto kind = reader.get<std::uint8_t>();
+    if (kind > static_cast<std::uint8_t>(SymbolKind::Function)) {
+      throw std::runtime_error("invalid symbol kind in object file");
+    }
+    symbol.kind = static_cast<SymbolKind>(kind);
+    symbol.address = reader.get<std::int32_t>();
+    symbol.size = static_cast<std::size_t>(reader.get<std::uint64_t>());
+    symbols.push_back(std::move(symbol));
+  }
+  return symbols;
+}
+
+// 函数: 符号种类的可读名称, 用于链接诊断
+const char* kind_name(SymbolKind kind) {
+  switch (kind) {
+    case SymbolKind::Constant:
+      return "constant";
+    case SymbolKind::Variable:
+      return "variable";
+    case SymbolKind::Procedure:
+      return "procedure";
+    case SymbolKind::Parameter:
+      return "parameter";
+    case SymbolKind::Array:
+      return "array";
+    case SymbolKind::Function:
+      return "function";
+  }
+  return "symbol";
+}
+
+// 函数: 主程序开帧指令的位置, 模块缺少时为空
+std::optional<std::size_t> frame_instruction(const ObjectModule& module) {
+  for (const auto& relocation : module.relocations) {
+    if (relocation.kind == Relocation::Kind::FrameSize) {
+      return relocation.index;
+    }
+  }
+  return std::nullopt;
+}
+
+// 函数: 报告链接错误
+void link_error(DiagnosticSink& diagnostics, const ObjectModule& module,
+                const std::string& message) {
+  diagnostics.report(
+      {DiagnosticLevel::Error, DiagnosticCode::LinkError, module.name + ": " + message, {}});
+}
+
+}  // namespace
+
+// 函数: 组装目标模块, 过程入口与全局变量地址保持模块内相对值
+ObjectModule make_object(std::string name, InstructionSequence code,
+                         std::vector<Relocation> relocations, const std::vector<Symbol>& symbols,
+                         const std::vector<Symbol>& imports) {
+  ObjectModule module;
+  module.name = std::move(name);
+  module.code = std::move(code);
+  module.relocations = std::move(relocations);
+  for (const auto& symbol : symbols) {
+    // 程序块为符号表的第 1 层
+    if (symbol.level != 1 || symbol.import >= 0 || symbol.kind == SymbolKind::Constant ||
+        symbol.kind == SymbolKind::Parameter) {
+      continue;
+    }
+    module.exports.push_back({symbol.name, symbol.kind, symbol.address, symbol.size});
+  }
+  for (const auto& symbol : imports) {
+    module.imports.push_back({symbol.name, symbol.kind, 0, symbol.size});
+  }
+  return module;
+}
+
+// 函数: 编码目标模块
+std::string encode_object(const ObjectModule& module) {
+  ByteWriter writer;
+  writer.put_raw(kObjectMagic, sizeof(kObjectMagic));
+  writer.put_string(module.name);
+  writer.put(static_cast<std::uint32_t>(module.code.size()));
+  for (const auto& instr : module.code) {
+    writer.put(static_cast<std::uint8_t>(instr.op));
+    writer.put(instr.level);
+    writer.put(instr.argument);
+  }
+  writer.put(static_cast<std::uint32_t>(module.relocations.size()));
+  for (const auto& relocation : module.relocations) {
+    writer.put(static_cast<std::uint8_t>(relocation.kind));
+    writer.put(static_cast<std::uint32_t>(relocation.index));
+  }
+  put_symbols(writer, module.exports);
+  put_symbols(writer, module.imports);
+  return writer.bytes();
+}
+
+// 函数: 解码目标模块, 校验操作码与重定位位置
+ObjectModule decode_object(std::string_view bytes) {
+  ByteReader reader(bytes);
+  if (!reader.expect_raw(kObjectMagic, sizeof(kObjectMagic))) {
+    throw std::runtime_error("not a PL/0 object file");
+  }
+  ObjectModule module;
+  module.name = reader.get_string();
+  const auto instruction_count = reader.get<std::uint32_t>();
+  for (std::uint32_t i = 0; i < instruction_count && reader.ok(); ++i) {
+    Instruction instr;
+    const auto op = reader.get<std::uint8_t>();
+    if (op > static_cast<std::uint8_t>(Op::LDC)) {
+      throw std::runtime_error("invalid opcode in object file");
+    }
+    instr.op = static_cast<Op>(op);
+    instr.level = reader.get<std::int32_t>();
+    instr.argument = reader.get<std::int32_t>();
+    module.code.push_back(instr);
+  }
+  const auto relocation_count = reader.get<std::uint32_t>();
+  for (std::uint32_t i = 0; i < relocation_count && reader.ok(); ++i) {
+    const auto kind = reader.get<std::uint8_t>();
+    const auto index = reader.get<std::uint32_t>();
+    // 过程编号只在单个程序的并行生成中出现, 不会写入目标文件
+    if (kind > static_cast<std::uint8_t>(Relocation::Kind::FrameSize) ||
+        kind == static_cast<std::uint8_t>(Relocation::Kind::Procedure) ||
+        index >= module.code.size()) {
+      throw std::runtime_error("invalid relocation in object file");
+    }
+    module.relocations.push_back({static_cast<Relocation::Kind>(kind), index});
+  }
+  module.exports = get_symbols(reader);
+  module.imports = get_symbols(reader);
+  if (!reader.ok() || !reader.at_end()) {
+    throw std::runtime_error("truncated or corrupt object file");
+  }
+  return module;
+}
+
+// 函数: 写出目标文件
+void write_object(const std::filesystem::path& output, const ObjectModule& module) {
+  std::ofstream file(output, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("failed to open " + output.string());
+  }
+  const auto bytes = encode_object(module);
+  file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    throw std::runtime_error("failed to write " + output.string());
+  }
+}
+
+// 函数: 读取目标文件
+ObjectModule read_object(const std::filesystem::path& input) {
+  std::ifstream file(input, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("failed to open " + input.string());
+  }
+  std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  try {
+    return decode_object(bytes);
+  } catch (const std::runtime_error& ex) {
+    throw std::runtime_error(input.string() + ": " + ex.what());
+  }
+}
+
+// 函数: 链接目标模块
+//   第一遍排布代码与全局区并收集导出符号, 第二遍解析导入并逐条修正重定位;
+//   最终只保留入口模块的开帧指令为程序帧大小, 其余模块的主程序不可达
+LinkedProgram link_objects(const std::vector<ObjectModule>& modules,
+                           DiagnosticSink& diagnostics) {
+  LinkedProgram linked;
+  if (modules.empty()) {
+    diagnostics.report({DiagnosticLevel::Error, DiagnosticCode::LinkError, "no object files", {}});
+    return linked;
+  }
+
+  std::vector<int> code_bases(modules.size(), 0);
+  std::vector<int> data_bases(modules.size(), 0);
+  std::unordered_map<std::string, std::size_t> defined;  // 名称 -> linked.symbols 下标
+  int code_size = 0;
+  int data_size = 0;
+  for (std::size_t m = 0; m < modules.size(); ++m) {
+    const auto& module = modules[m];
+    const auto frame = frame_instruction(module);
+    if (!frame) {
+      link_error(diagnostics, module, "missing program frame");
+      continue;
+    }
+    if (m > 0 && *frame + 2 < module.code.size()) {
+      link_error(diagnostics, module,
+                 "only the first module may have a main program; library bodies must be empty");
+    }
+    code_bases[m] = code_size;
+    data_bases[m] = data_size;
+    code_size += static_cast<int>(module.code.size());
+    data_size += module.code[*frame].argument - kFrameHeader;
+
+    for (const auto& exported : module.exports) {
+      const bool is_code =
+          exported.kind == SymbolKind::Procedure || exported.kind == SymbolKind::Function;
+      Symbol symbol;
+      symbol.name = exported.name;
+      symbol.kind = exported.kind;
+      symbol.level = 1;
+      symbol.address = exported.address + (is_code ? code_bases[m] : data_bases[m]);
+      symbol.size = exported.size;
+      if (const auto it = defined.find(symbol.name); it != defined.end()) {
+        link_error(diagnostics, module, "duplicate definition of '" + symbol.name + "'");
+        continue;
+      }
+      defined.emplace(symbol.name, linked.symbols.size());
+      linked.symbols.push_back(std::move(symbol));
+    }
+  }
+  if (diagnostics.has_errors()) {
+    return linked;
+  }
+
+  linked.code.reserve(static_cast<std::size_t>(code_size));
+  for (std::size_t m = 0; m < modules.size(); ++m) {
+    const auto& module = modules[m];
+    std::vector<int> resolved(module.imports.size(), 0);
+    for (std::size_t i = 0; i < module.imports.size(); ++i) {
+      const auto& imported = module.imports[i];
+      const auto it = defined.find(imported.name);
+      if (it == defined.end()) {
+        link_error(diagnostics, module, "undefined reference to '" + imported.name + "'");
+        continue;
+      }
+      const auto& target = linked.symbols[it->second];
+      if (target.kind != imported.kind) {
+        link_error(diagnostics, module,
+                   "'" + imported.name + "' is declared extern as a " + kind_name(imported.kind) +
+                       " but defined as a " + kind_name(target.kind));
+      } else if (target.size != imported.size) {
+        const bool is_code =
+            target.kind == SymbolKind::Procedure || target.kind == SymbolKind::Function;
+        link_error(diagnostics, module,
+                   "'" + imported.name + "' is declared extern with " +
+                       std::to_string(imported.size) + (is_code ? " parameter(s)" : " element(s)") +
+                       " but defined with " + std::to_string(target.size));
+      }
+      resolved[i] = target.address;
+    }
+
+    const auto base = linked.code.size();
+    linked.code.insert(linked.code.end(), module.code.begin(), module.code.end());
+    for (const auto& relocation : module.relocations) {
+      auto& instr = linked.code[base + relocation.index];
+      switch (relocation.kind) {
+        case Relocation::Kind::Local:
+          instr.argument += code_bases[m];
+          break;
+        case Relocation::Kind::Data:
+          instr.argument += data_bases[m];
+          break;
+        case Relocation::Kind::Import:
+          if (instr.argument < 0 || static_cast<std::size_t>(instr.argument) >= resolved.size()) {
+            link_error(diagnostics, module, "relocation refers to a missing import");
+            break;
+          }
+          instr.argument = resolved[static_cast<std::size_t>(instr.argument)];
+          break;
+        case Relocation::Kind::FrameSize:
+          instr.argument = kFrameHeader + data_size;
+          break;
+        case Relocation::Kind::Procedure:
+          link_error(diagnostics, module, "unexpected procedure relocation");
+          break;
+      }
+    }
+  }
+  if (diagnostics.has_errors()) {
+    linked.code.clear();
+  }
+  return linked;
+}
+
+}  // namespace pl0
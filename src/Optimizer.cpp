@@ -0,0 +1,1359 @@
+// 文件: Optimizer.cpp
+// 功能: 实现基于 SSA 值 IR 的优化 pass
+#include "pl0/Optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <utility>
+
+namespace pl0 {
+
+namespace {
+
+using ir::BasicBlock;
+using ir::Function;
+using ir::Instr;
+using ir::Kind;
+using ir::Module;
+using ir::ValueId;
+
+// 常量: INT 清零后记录为已知 0 的局部单元上限
+constexpr std::int64_t kMaxKnownZeroSlots = 64;
+
+// 常量: 优化流水线迭代次数
+constexpr int kPipelineRounds = 3;
+
+// 常量: 内联启发式参数 (规模以 IR 指令数计)
+constexpr std::size_t kInlineSmallSize = 24;        // 不论调用次数均内联
+constexpr std::size_t kInlineSingleSiteSize = 256;  // 仅有一个调用点时内联
+constexpr std::size_t kInlineMaxCallerSize = 4096;  // 调用者规模上限
+constexpr std::int64_t kInlineMaxFrameGrowth = 256; // 调用者帧增长上限
+constexpr int kInlineRounds = 4;
+
+// 常量: 自递归尾调用改写为循环时允许逐个清零的局部单元上限
+constexpr std::int64_t kTailLoopMaxLocals = 64;
+
+// 常量: 复制到各前驱中的返回块规模上限 (如函数末尾的 "lod 0 3; retv")
+constexpr std::size_t kReturnDuplicateSize = 2;
+
+// 函数: 按补码语义环绕计算, 与虚拟机的 int64 运算保持一致且避免未定义行为
+std::int64_t wrap(std::uint64_t value) {
+  return static_cast<std::int64_t>(value);
+}
+
+// 函数: 折叠一元运算
+std::optional<std::int64_t> fold_unary(Opr opr, std::int64_t value) {
+  switch (opr) {
+    case Opr::NEG:
+      return wrap(0 - static_cast<std::uint64_t>(value));
+    case Opr::ODD:
+      return value % 2 != 0 ? 1 : 0;
+    case Opr::NOT:
+      return value == 0 ? 1 : 0;
+    default:
+      return std::nullopt;
+  }
+}
+
+// 函数: 折叠二元运算, 除零等运行期错误保留给虚拟机报告
+std::optional<std::int64_t> fold_binary(Opr opr, std::int64_t lhs, std::int64_t rhs) {
+  auto ul = static_cast<std::uint64_t>(lhs);
+  auto ur = static_cast<std::uint64_t>(rhs);
+  switch (opr) {
+    case Opr::ADD:
+      return wrap(ul + ur);
+    case Opr::SUB:
+      return wrap(ul - ur);
+    case Opr::MUL:
+      return wrap(ul * ur);
+    case Opr::DIV:
+      if (rhs == 0 || (lhs == INT64_MIN && rhs == -1)) {
+        return std::nullopt;
+      }
+      return lhs / rhs;
+    case Opr::MOD:
+      if (rhs == 0 || (lhs == INT64_MIN && rhs == -1)) {
+        return std::nullopt;
+      }
+      return lhs % rhs;
+    case Opr::EQ:
+      return lhs == rhs ? 1 : 0;
+    case Opr::NE:
+      return lhs != rhs ? 1 : 0;
+    case Opr::LT:
+      return lhs < rhs ? 1 : 0;
+    case Opr::GE:
+      return lhs >= rhs ? 1 : 0;
+    case Opr::GT:
+      return lhs > rhs ? 1 : 0;
+    case Opr::LE:
+      return lhs <= rhs ? 1 : 0;
+    case Opr::AND:
+      return (lhs != 0 && rhs != 0) ? 1 : 0;
+    case Opr::OR:
+      return (lhs != 0 || rhs != 0) ? 1 : 0;
+    default:
+      return std::nullopt;
+  }
+}
+
+// 函数: 运算是否满足交换律
+bool is_commutative(Opr opr) {
+  return opr == Opr::ADD || opr == Opr::MUL || opr == Opr::EQ || opr == Opr::NE ||
+         opr == Opr::AND || opr == Opr::OR;
+}
+
+// 函数: 计算从入口可达块的逆后序
+std::vector<int> reverse_post_order(const Function& function) {
+  std::vector<int> order;
+  std::vector<char> state(function.blocks.size(), 0);
+  std::vector<std::pair<int, std::size_t>> stack{{function.entry, 0}};
+  state[static_cast<std::size_t>(function.entry)] = 1;
+  while (!stack.empty()) {
+    auto& [block, next] = stack.back();
+    const auto& succs = function.blocks[static_cast<std::size_t>(block)].succs;
+    if (next < succs.size()) {
+      int succ = succs[next++];
+      if (state[static_cast<std::size_t>(succ)] == 0) {
+        state[static_cast<std::size_t>(succ)] = 1;
+        stack.emplace_back(succ, 0);
+      }
+      continue;
+    }
+    order.push_back(block);
+    stack.pop_back();
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+// 函数: Cooper-Harvey-Kennedy 迭代法计算直接支配者
+std::vector<int> immediate_dominators(const Function& function,
+                                      const std::vector<int>& rpo) {
+  std::vector<int> position(function.blocks.size(), -1);
+  for (std::size_t i = 0; i < rpo.size(); ++i) {
+    position[static_cast<std::size_t>(rpo[i])] = static_cast<int>(i);
+  }
+  std::vector<int> idom(function.blocks.size(), -1);
+  idom[static_cast<std::size_t>(function.entry)] = function.entry;
+  auto intersect = [&](int lhs, int rhs) {
+    while (lhs != rhs) {
+      while (position[static_cast<std::size_t>(lhs)] > position[static_cast<std::size_t>(rhs)]) {
+        lhs = idom[static_cast<std::size_t>(lhs)];
+      }
+      while (position[static_cast<std::size_t>(rhs)] > position[static_cast<std::size_t>(lhs)]) {
+        rhs = idom[static_cast<std::size_t>(rhs)];
+      }
+    }
+    return lhs;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (std::size_t i = 1; i < rpo.size(); ++i) {
+      int block = rpo[i];
+      int candidate = -1;
+      for (int pred : function.blocks[static_cast<std::size_t>(block)].preds) {
+        if (position[static_cast<std::size_t>(pred)] < 0 ||
+            idom[static_cast<std::size_t>(pred)] < 0) {
+          continue;
+        }
+        candidate = candidate < 0 ? pred : intersect(pred, candidate);
+      }
+      if (candidate >= 0 && idom[static_cast<std::size_t>(block)] != candidate) {
+        idom[static_cast<std::size_t>(block)] = candidate;
+        changed = true;
+      }
+    }
+  }
+  return idom;
+}
+
+// 类: 基于支配树的全局值编号, 同时完成常量折叠、代数化简与访存前推
+class ValueNumbering {
+ public:
+  explicit ValueNumbering(Function& function)
+      : function_(function),
+        replacement_(static_cast<std::size_t>(function.value_count)),
+        constants_(static_cast<std::size_t>(function.value_count)) {
+    for (std::size_t i = 0; i < replacement_.size(); ++i) {
+      replacement_[i] = static_cast<ValueId>(i);
+    }
+  }
+
+  void run() {
+    std::vector<int> rpo = reverse_post_order(function_);
+    std::vector<int> idom = immediate_dominators(function_, rpo);
+    std::vector<std::vector<int>> children(function_.blocks.size());
+    for (int block : rpo) {
+      if (block != function_.entry) {
+        children[static_cast<std::size_t>(idom[static_cast<std::size_t>(block)])].push_back(block);
+      }
+    }
+    exit_memory_.assign(function_.blocks.size(), std::nullopt);
+
+    // 显式栈遍历支配树, 离开子树时撤销作用域内登记的表达式
+    struct Frame {
+      int block;
+      std::size_t undo_mark;
+      bool entered;
+    };
+    std::vector<Frame> stack{{function_.entry, 0, false}};
+    while (!stack.empty()) {
+      Frame& top = stack.back();
+      if (top.entered) {
+        rollback(top.undo_mark);
+        stack.pop_back();
+        continue;
+      }
+      top.entered = true;
+      top.undo_mark = undo_.size();
+      int block = top.block;
+      process_block(function_.blocks[static_cast<std::size_t>(block)]);
+      const auto& kids = children[static_cast<std::size_t>(block)];
+      for (auto it = kids.rbegin(); it != kids.rend(); ++it) {
+        stack.push_back({*it, 0, false});
+      }
+    }
+
+    for (auto& block : function_.blocks) {
+      for (auto& instr : block.instrs) {
+        for (auto& operand : instr.operands) {
+          operand = resolve(operand);
+        }
+      }
+    }
+  }
+
+ private:
+  using Key = std::tuple<Kind, Opr, int, std::int64_t, std::vector<ValueId>>;
+  using Slot = std::pair<int, std::int64_t>;
+  using Memory = std::map<Slot, ValueId>;
+
+  ValueId resolve(ValueId value) {
+    while (replacement_[static_cast<std::size_t>(value)] != value) {
+      value = replacement_[static_cast<std::size_t>(value)];
+    }
+    return value;
+  }
+
+  std::optional<std::int64_t> constant(ValueId value) const {
+    return constants_[static_cast<std::size_t>(value)];
+  }
+
+  void alias(ValueId from, ValueId to) {
+    replacement_[static_cast<std::size_t>(from)] = to;
+  }
+
+  void rollback(std::size_t mark) {
+    while (undo_.size() > mark) {
+      table_.erase(undo_.back());
+      undo_.pop_back();
+    }
+  }
+
+  // 函数: 查找等价表达式, 未找到时登记当前值并返回空
+  std::optional<ValueId> lookup_or_insert(const Instr& instr) {
+    std::vector<ValueId> operands = instr.operands;
+    if (instr.kind == Kind::Binary && is_commutative(instr.opr)) {
+      std::sort(operands.begin(), operands.end());
+    }
+    Key key{instr.kind, instr.opr, instr.level, instr.immediate, std::move(operands)};
+    auto it = table_.find(key);
+    if (it != table_.end()) {
+      return it->second;
+    }
+    table_.emplace(key, instr.result);
+    undo_.push_back(std::move(key));
+    return std::nullopt;
+  }
+
+  // 函数: 将运算指令改写为常量
+  static void make_constant(Instr& instr, std::int64_t value) {
+    instr.kind = Kind::Const;
+    instr.opr = Opr::RET;
+    instr.level = 0;
+    instr.immediate = value;
+    instr.operands.clear();
+  }
+
+  // 函数: 代数恒等式化简, 返回可替代的已有值
+  std::optional<ValueId> simplify(const Instr& instr) const {
+    if (instr.kind != Kind::Binary) {
+      return std::nullopt;
+    }
+    ValueId lhs = instr.operands[0];
+    ValueId rhs = instr.operands[1];
+    auto lc = constant(lhs);
+    auto rc = constant(rhs);
+    switch (instr.opr) {
+      case Opr::ADD:
+        if (rc && *rc == 0) {
+          return lhs;
+        }
+        if (lc && *lc == 0) {
+          return rhs;
+        }
+        break;
+      case Opr::SUB:
+        if (rc && *rc == 0) {
+          return lhs;
+        }
+        break;
+      case Opr::MUL:
+        if (rc && *rc == 1) {
+          return lhs;
+        }
+        if (lc && *lc == 1) {
+          return rhs;
+        }
+        if (rc && *rc == 0) {
+          return rhs;
+        }
+        if (lc && *lc == 0) {
+          return lhs;
+        }
+        break;
+      case Opr::DIV:
+        if (rc && *rc == 1) {
+          return lhs;
+        }
+        break;
+      default:
+        break;
+    }
+    return std::nullopt;
+  }
+
+  void process_block(BasicBlock& block) {
+    Memory memory;
+    if (block.preds.size() == 1 && exit_memory_[static_cast<std::size_t>(block.preds[0])]) {
+      memory = *exit_memory_[static_cast<std::size_t>(block.preds[0])];
+    }
+
+    std::vector<Instr> output;
+    output.reserve(block.instrs.size());
+    for (auto& instr : block.instrs) {
+      for (auto& operand : instr.operands) {
+        operand = resolve(operand);
+      }
+
+      if (instr.kind == Kind::Unary || instr.kind == Kind::Binary) {
+        std::optional<std::int64_t> folded;
+        if (instr.kind == Kind::Unary) {
+          if (auto value = constant(instr.operands[0])) {
+            folded = fold_unary(instr.opr, *value);
+          }
+        } else {
+          auto lhs = constant(instr.operands[0]);
+          auto rhs = constant(instr.operands[1]);
+          if (lhs && rhs) {
+            folded = fold_binary(instr.opr, *lhs, *rhs);
+          }
+        }
+        if (folded) {
+          make_constant(instr, *folded);
+        } else if (auto same = simplify(instr)) {
+          alias(instr.result, *same);
+          continue;
+        }
+      }
+
+      switch (instr.kind) {
+        case Kind::Const:
+          constants_[static_cast<std::size_t>(instr.result)] = instr.immediate;
+          [[fallthrough]];
+        case Kind::Unary:
+        case Kind::Binary:
+        case Kind::Address:
+        case Kind::Index:
+        case Kind::Check:
+          if (auto existing = lookup_or_insert(instr)) {
+            alias(instr.result, *existing);
+            continue;
+          }
+          break;
+        case Kind::Load: {
+          Slot slot{instr.level, instr.immediate};
+          auto it = memory.find(slot);
+          if (it != memory.end()) {
+            alias(instr.result, it->second);
+            continue;
+          }
+          memory[slot] = instr.result;
+          break;
+        }
+        case Kind::Store: {
+          Slot slot{instr.level, instr.immediate};
+          auto it = memory.find(slot);
+          if (it != memory.end() && it->second == instr.operands[0]) {
+            continue;
+          }
+          memory[slot] = instr.operands[0];
+          break;
+        }
+        case Kind::StoreIndirect:
+        case Kind::Call:
+          memory.clear();
+          break;
+        case Kind::Alloc: {
+          // INT 会清零新分配的局部单元, 记录为常量 0 以便后续前推
+          std::int64_t limit = std::min(instr.immediate, 3 + kMaxKnownZeroSlots);
+          output.push_back(std::move(instr));
+          Instr zero;
+          zero.kind = Kind::Const;
+          zero.result = function_.new_value();
+          replacement_.push_back(zero.result);
+          constants_.push_back(0);
+          if (auto existing = lookup_or_insert(zero)) {
+            alias(zero.result, *existing);
+          } else {
+            output.push_back(zero);
+          }
+          ValueId value = resolve(zero.result);
+          for (std::int64_t address = 3; address < limit; ++address) {
+            memory[{0, address}] = value;
+          }
+          continue;
+        }
+        case Kind::Branch:
+          if (auto value = constant(instr.operands[0])) {
+            instr.kind = Kind::Jump;
+            instr.target = *value != 0 ? instr.fallthrough : instr.target;
+            instr.fallthrough = -1;
+            instr.operands.clear();
+          }
+          break;
+        default:
+          break;
+      }
+      output.push_back(std::move(instr));
+    }
+    block.instrs = std::move(output);
+    exit_memory_[static_cast<std::size_t>(block.id)] = std::move(memory);
+  }
+
+  Function& function_;
+  std::vector<ValueId> replacement_;
+  std::vector<std::optional<std::int64_t>> constants_;
+  std::map<Key, ValueId> table_;
+  std::vector<Key> undo_;
+  std::vector<std::optional<Memory>> exit_memory_;
+};
+
+// 函数: 删除不可达块、穿透空跳转块并合并直线块
+void simplify_cfg(Function& function) {
+  ir::recompute_edges(function);
+
+  // 条件两侧相同的分支退化为无条件跳转
+  for (auto& block : function.blocks) {
+    if (block.removed || block.instrs.empty()) {
+      continue;
+    }
+    auto& last = block.instrs.back();
+    if (last.kind == Kind::Branch && last.target == last.fallthrough) {
+      last.kind = Kind::Jump;
+      last.fallthrough = -1;
+      last.operands.clear();
+    }
+  }
+
+  // 穿透仅含跳转的块
+  auto forward = [&](int block) {
+    std::set<int> seen;
+    while (seen.insert(block).second) {
+      const auto& instrs = function.blocks[static_cast<std::size_t>(block)].instrs;
+      if (instrs.size() != 1 || instrs.front().kind != Kind::Jump) {
+        break;
+      }
+      block = instrs.front().target;
+    }
+    return block;
+  };
+  function.entry = forward(function.entry);
+  for (auto& block : function.blocks) {
+    if (block.removed || block.instrs.empty()) {
+      continue;
+    }
+    auto& last = block.instrs.back();
+    if (last.kind == Kind::Jump) {
+      last.target = forward(last.target);
+    } else if (last.kind == Kind::Branch) {
+      last.target = forward(last.target);
+      last.fallthrough = forward(last.fallthrough);
+    }
+  }
+
+  // 跳向短小返回块时就地复制, 使返回值可前推、调用后直接返回以便尾调用消除
+  auto small_return = [&](int id) {
+    const auto& instrs = function.blocks[static_cast<std::size_t>(id)].instrs;
+    if (instrs.empty() || instrs.size() > kReturnDuplicateSize ||
+        instrs.back().kind != Kind::Return) {
+      return false;
+    }
+    return std::all_of(instrs.begin(), instrs.end() - 1, [](const Instr& instr) {
+      return instr.kind == Kind::Load || instr.kind == Kind::Const;
+    });
+  };
+  for (auto& block : function.blocks) {
+    if (block.removed || block.instrs.empty() || block.instrs.back().kind != Kind::Jump) {
+      continue;
+    }
+    int target = block.instrs.back().target;
+    if (target == block.id || !small_return(target)) {
+      continue;
+    }
+    block.instrs.pop_back();
+    std::map<ValueId, ValueId> renamed;
+    for (Instr instr : function.blocks[static_cast<std::size_t>(target)].instrs) {
+      for (auto& operand : instr.operands) {
+        if (auto it = renamed.find(operand); it != renamed.end()) {
+          operand = it->second;
+        }
+      }
+      if (ir::defines_value(instr)) {
+        ValueId fresh = function.new_value();
+        renamed.emplace(instr.result, fresh);
+        instr.result = fresh;
+      }
+      block.instrs.push_back(std::move(instr));
+    }
+  }
+
+  ir::recompute_edges(function);
+  std::vector<int> reachable = reverse_post_order(function);
+  std::vector<bool> live(function.blocks.size(), false);
+  for (int block : reachable) {
+    live[static_cast<std::size_t>(block)] = true;
+  }
+  for (auto& block : function.blocks) {
+    if (!live[static_cast<std::size_t>(block.id)]) {
+      block.removed = true;
+      block.instrs.clear();
+    }
+  }
+  ir::recompute_edges(function);
+
+  // 合并唯一前驱/唯一后继的直线块
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (auto& block : function.blocks) {
+      if (block.removed || block.instrs.empty() ||
+          block.instrs.back().kind != Kind::Jump) {
+        continue;
+      }
+      int next = block.instrs.back().target;
+      auto& successor = function.blocks[static_cast<std::size_t>(next)];
+      if (next == block.id || next == function.entry || successor.preds.size() != 1) {
+        continue;
+      }
+      block.instrs.pop_back();
+      for (auto& instr : successor.instrs) {
+        block.instrs.push_back(std::move(instr));
+      }
+      successor.instrs.clear();
+      successor.removed = true;
+      ir::recompute_edges(function);
+      merged = true;
+    }
+  }
+}
+
+// 结构: 各函数帧的读取情况, 用于全局死存储判定
+struct FrameUsage {
+  std::vector<std::set<std::int64_t>> reads;
+  std::vector<bool> address_taken;
+  std::set<std::int64_t> unknown_reads;
+  bool unknown_address = false;
+};
+
+// 函数: 按静态链回溯祖先函数, 未知时返回 -1
+int ancestor(const Module& module, int function, int level) {
+  int current = function;
+  for (int i = 0; i < level; ++i) {
+    const auto& fn = module.functions[static_cast<std::size_t>(current)];
+    if (!fn.parent_known || fn.parent < 0) {
+      return -1;
+    }
+    current = fn.parent;
+  }
+  return current;
+}
+
+// 函数: 收集所有函数对各帧单元的读取
+FrameUsage collect_frame_usage(const Module& module) {
+  FrameUsage usage;
+  usage.reads.resize(module.functions.size());
+  usage.address_taken.assign(module.functions.size(), false);
+  for (std::size_t index = 0; index < module.functions.size(); ++index) {
+    for (const auto& block : module.functions[index].blocks) {
+      if (block.removed) {
+        continue;
+      }
+      for (const auto& instr : block.instrs) {
+        if (instr.kind == Kind::TailCall) {
+          // 尾调用目标从本帧参数单元读取实参
+          for (std::int64_t slot = -instr.immediate; slot < 0; ++slot) {
+            usage.reads[index].insert(slot);
+          }
+          continue;
+        }
+        if (instr.kind != Kind::Load && instr.kind != Kind::Address) {
+          continue;
+        }
+        int frame = ancestor(module, static_cast<int>(index), instr.level);
+        if (instr.kind == Kind::Load) {
+          if (frame < 0) {
+            usage.unknown_reads.insert(instr.immediate);
+          } else {
+            usage.reads[static_cast<std::size_t>(frame)].insert(instr.immediate);
+          }
+        } else if (frame < 0) {
+          usage.unknown_address = true;
+        } else {
+          usage.address_taken[static_cast<std::size_t>(frame)] = true;
+        }
+      }
+    }
+  }
+  return usage;
+}
+
+// 函数: 死存储消除, 包括从未被读取的单元与块内被覆盖/随帧销毁的写入
+void eliminate_dead_stores(Module& module, int index, const FrameUsage& usage) {
+  auto& function = module.functions[static_cast<std::size_t>(index)];
+  for (auto& block : function.blocks) {
+    if (block.removed) {
+      continue;
+    }
+    std::set<std::pair<int, std::int64_t>> overwritten;
+    std::set<std::int64_t> read_before_return;
+    bool frame_dead = false;
+    std::vector<bool> dead(block.instrs.size(), false);
+    for (std::size_t i = block.instrs.size(); i-- > 0;) {
+      const auto& instr = block.instrs[i];
+      switch (instr.kind) {
+        case Kind::Return:
+          frame_dead = true;
+          read_before_return.clear();
+          break;
+        case Kind::Store: {
+          std::pair<int, std::int64_t> slot{instr.level, instr.immediate};
+          int frame = ancestor(module, index, instr.level);
+          bool never_read = frame >= 0 && !usage.unknown_address &&
+                            !usage.address_taken[static_cast<std::size_t>(frame)] &&
+                            usage.reads[static_cast<std::size_t>(frame)].count(instr.immediate) == 0 &&
+                            usage.unknown_reads.count(instr.immediate) == 0;
+          if (never_read || overwritten.count(slot) != 0 ||
+              (frame_dead && instr.level == 0 &&
+               read_before_return.count(instr.immediate) == 0)) {
+            dead[i] = true;
+          } else {
+            overwritten.insert(slot);
+          }
+          break;
+        }
+        case Kind::Load:
+          overwritten.erase({instr.level, instr.immediate});
+          if (instr.level == 0) {
+            read_before_return.insert(instr.immediate);
+          }
+          break;
+        case Kind::LoadIndirect:
+        case Kind::Call:
+          overwritten.clear();
+          frame_dead = false;
+          break;
+        case Kind::TailCall:
+          // 尾调用复用本帧, 被调者只读取参数单元, 其余只能经静态链读取外层帧
+          overwritten.clear();
+          frame_dead = true;
+          read_before_return.clear();
+          for (std::int64_t slot = -instr.immediate; slot < 0; ++slot) {
+            read_before_return.insert(slot);
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    std::vector<Instr> kept;
+    kept.reserve(block.instrs.size());
+    for (std::size_t i = 0; i < block.instrs.size(); ++i) {
+      if (!dead[i]) {
+        kept.push_back(std::move(block.instrs[i]));
+      }
+    }
+    block.instrs = std::move(kept);
+  }
+}
+
+// 结构: 本帧单元的活跃集合, all 表示任意单元都可能被读取
+struct LiveSlots {
+  std::set<std::int64_t> slots;
+  bool all = false;
+
+  bool operator==(const LiveSlots&) const = default;
+
+  void merge(const LiveSlots& other) {
+    all = all || other.all;
+    if (all) {
+      slots.clear();
+    } else {
+      slots.insert(other.slots.begin(), other.slots.end());
+    }
+  }
+};
+
+// 函数: 逆向执行一条指令对活跃集合的影响, 返回该指令是否为死存储
+bool step_live_slots(const Instr& instr, LiveSlots& live) {
+  switch (instr.kind) {
+    case Kind::Return:
+      live = LiveSlots{};
+      return false;
+    case Kind::TailCall:
+      live = LiveSlots{};
+      for (std::int64_t slot = -instr.immediate; slot < 0; ++slot) {
+        live.slots.insert(slot);
+      }
+      return false;
+    case Kind::Call:
+      // 嵌套过程可经静态链读取本帧
+      live.all = true;
+      live.slots.clear();
+      return false;
+    case Kind::Load:
+      if (instr.level == 0 && !live.all) {
+        live.slots.insert(instr.immediate);
+      }
+      return false;
+    case Kind::Store:
+      if (instr.level != 0 || live.all) {
+        return false;
+      }
+      return live.slots.erase(instr.immediate) == 0;
+    default:
+      return false;
+  }
+}
+
+// 函数: 对未被取地址的本帧单元做跨块活跃分析, 删除之后不再被读取的存储
+void eliminate_dead_frame_stores(Function& function) {
+  std::vector<LiveSlots> live_in(function.blocks.size());
+  auto live_out = [&](const BasicBlock& block) {
+    LiveSlots live;
+    for (int succ : block.succs) {
+      live.merge(live_in[static_cast<std::size_t>(succ)]);
+    }
+    return live;
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = function.blocks.rbegin(); it != function.blocks.rend(); ++it) {
+      if (it->removed) {
+        continue;
+      }
+      LiveSlots live = live_out(*it);
+      for (auto instr = it->instrs.rbegin(); instr != it->instrs.rend(); ++instr) {
+        step_live_slots(*instr, live);
+      }
+      if (!(live == live_in[static_cast<std::size_t>(it->id)])) {
+        live_in[static_cast<std::size_t>(it->id)] = std::move(live);
+        changed = true;
+      }
+    }
+  }
+  for (auto& block : function.blocks) {
+    if (block.removed) {
+      continue;
+    }
+    LiveSlots live = live_out(block);
+    std::vector<bool> dead(block.instrs.size(), false);
+    for (std::size_t i = block.instrs.size(); i-- > 0;) {
+      dead[i] = step_live_slots(block.instrs[i], live);
+    }
+    std::vector<Instr> kept;
+    kept.reserve(block.instrs.size());
+    for (std::size_t i = 0; i < block.instrs.size(); ++i) {
+      if (!dead[i]) {
+        kept.push_back(std::move(block.instrs[i]));
+      }
+    }
+    block.instrs = std::move(kept);
+  }
+}
+
+// 函数: 删除结果未被使用且无副作用的指令
+void eliminate_dead_code(Function& function) {
+  std::vector<std::optional<std::int64_t>> constants(
+      static_cast<std::size_t>(function.value_count));
+  for (const auto& block : function.blocks) {
+    for (const auto& instr : block.instrs) {
+      if (instr.kind == Kind::Const) {
+        constants[static_cast<std::size_t>(instr.result)] = instr.immediate;
+      }
+    }
+  }
+  auto removable = [&](const Instr& instr) {
+    if (!ir::has_side_effects(instr)) {
+      return true;
+    }
+    if (instr.kind == Kind::Binary && (instr.opr == Opr::DIV || instr.opr == Opr::MOD)) {
+      auto divisor = constants[static_cast<std::size_t>(instr.operands[1])];
+      return divisor && *divisor != 0 && *divisor != -1;
+    }
+    return false;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    std::vector<int> uses(static_cast<std::size_t>(function.value_count), 0);
+    for (const auto& block : function.blocks) {
+      for (const auto& instr : block.instrs) {
+        for (ValueId operand : instr.operands) {
+          ++uses[static_cast<std::size_t>(operand)];
+        }
+      }
+    }
+    for (auto& block : function.blocks) {
+      auto it = std::remove_if(block.instrs.begin(), block.instrs.end(), [&](const Instr& instr) {
+        return ir::defines_value(instr) && uses[static_cast<std::size_t>(instr.result)] == 0 &&
+               removable(instr);
+      });
+      if (it != block.instrs.end()) {
+        block.instrs.erase(it, block.instrs.end());
+        changed = true;
+      }
+    }
+  }
+}
+
+// 函数: 统计函数中未删除块的指令数
+std::size_t function_size(const Function& function) {
+  std::size_t size = 0;
+  for (const auto& block : function.blocks) {
+    if (!block.removed) {
+      size += block.instrs.size();
+    }
+  }
+  return size;
+}
+
+// 函数: 查找函数的帧分配指令
+Instr* find_alloc(Function& function) {
+  for (auto& block : function.blocks) {
+    for (auto& instr : block.instrs) {
+      if (!block.removed && instr.kind == Kind::Alloc) {
+        return &instr;
+      }
+    }
+  }
+  return nullptr;
+}
+
+// 函数: 沿调用边判断函数能否再次到达自身
+bool is_recursive(const Module& module, int index) {
+  std::vector<bool> seen(module.functions.size(), false);
+  std::vector<int> worklist{index};
+  while (!worklist.empty()) {
+    int current = worklist.back();
+    worklist.pop_back();
+    for (const auto& block : module.functions[static_cast<std::size_t>(current)].blocks) {
+      if (block.removed) {
+        continue;
+      }
+      for (const auto& instr : block.instrs) {
+        if (!ir::is_call(instr)) {
+          continue;
+        }
+        if (instr.callee == index) {
+          return true;
+        }
+        if (!seen[static_cast<std::size_t>(instr.callee)]) {
+          seen[static_cast<std::size_t>(instr.callee)] = true;
+          worklist.push_back(instr.callee);
+        }
+      }
+    }
+  }
+  return false;
+}
+
+// 函数: 判断过程体能否展开到任意调用者中
+//   调用自身嵌套过程 (CAL 0) 需要真实的帧作为静态链, 这类过程不内联
+bool is_inlinable(const Module& module, int index) {
+  const auto& function = module.functions[static_cast<std::size_t>(index)];
+  if (index == module.main || is_recursive(module, index)) {
+    return false;
+  }
+  int allocs = 0;
+  for (const auto& block : function.blocks) {
+    if (block.removed) {
+      continue;
+    }
+    for (const auto& instr : block.instrs) {
+      switch (instr.kind) {
+        case Kind::Alloc:
+          ++allocs;
+          break;
+        case Kind::Call:
+          if (instr.level == 0) {
+            return false;
+          }
+          break;
+        case Kind::TailCall:
+          return false;
+        case Kind::Load:
+        case Kind::Store:
+        case Kind::Address:
+          // 帧头单元无法映射到调用者帧, 参数单元 (负偏移) 可以
+          if (instr.level == 0 && instr.immediate >= 0 && instr.immediate < 3) {
+            return false;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return allocs == 1;
+}
+
+// 函数: 按 (排布键, 编号) 顺序列出块
+std::vector<int> ordered_blocks(const Function& function) {
+  std::vector<int> order;
+  for (const auto& block : function.blocks) {
+    order.push_back(block.id);
+  }
+  std::sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+    const auto& a = function.blocks[static_cast<std::size_t>(lhs)];
+    const auto& b = function.blocks[static_cast<std::size_t>(rhs)];
+    return std::tie(a.origin, a.id) < std::tie(b.origin, b.id);
+  });
+  return order;
+}
+
+// 函数: 将 block 中第 position 条调用指令替换为被调过程体
+//   被调者的局部单元、参数与返回值依次映射到调用者帧尾新增的单元,
+//   非局部访问按调用层差重定基
+void inline_call(Module& module, int caller_index, int block_id, std::size_t position) {
+  Function& caller = module.functions[static_cast<std::size_t>(caller_index)];
+  const Instr call = caller.blocks[static_cast<std::size_t>(block_id)].instrs[position];
+  const Function& callee = module.functions[static_cast<std::size_t>(call.callee)];
+  const Instr* callee_alloc = find_alloc(module.functions[static_cast<std::size_t>(call.callee)]);
+  Instr* caller_alloc = find_alloc(caller);
+  const std::int64_t base = caller_alloc->immediate;
+  const std::int64_t locals = callee_alloc->immediate - 3;
+  const std::int64_t params = base + locals;
+  const std::int64_t result_slot = params + callee.arity;
+  caller_alloc->immediate += locals + callee.arity + (callee.returns_value ? 1 : 0);
+
+  std::vector<int> layout = ordered_blocks(caller);
+  const int value_offset = caller.value_count;
+  caller.value_count += callee.value_count;
+  const int block_offset = static_cast<int>(caller.blocks.size());
+  const int continuation = block_offset + static_cast<int>(callee.blocks.size());
+
+  auto rebase = [&](Instr& instr) {
+    if (instr.level == 0) {
+      instr.immediate = instr.immediate < 0 ? result_slot + instr.immediate
+                                            : base + instr.immediate - 3;
+    } else {
+      instr.level = instr.level - 1 + call.level;
+    }
+  };
+
+  std::vector<BasicBlock> copies;
+  copies.reserve(callee.blocks.size() + 1);
+  for (const auto& source : callee.blocks) {
+    BasicBlock block;
+    block.id = block_offset + source.id;
+    block.removed = source.removed;
+    for (Instr instr : source.instrs) {
+      if (instr.result != ir::kNoValue) {
+        instr.result += value_offset;
+      }
+      for (auto& operand : instr.operands) {
+        operand += value_offset;
+      }
+      switch (instr.kind) {
+        case Kind::Load:
+        case Kind::Store:
+        case Kind::Address:
+          rebase(instr);
+          break;
+        case Kind::Call:
+          instr.level = instr.level - 1 + call.level;
+          break;
+        case Kind::Jump:
+          instr.target += block_offset;
+          break;
+        case Kind::Branch:
+          instr.target += block_offset;
+          instr.fallthrough += block_offset;
+          break;
+        case Kind::Return:
+          if (!instr.operands.empty()) {
+            Instr store;
+            store.kind = Kind::Store;
+            store.immediate = result_slot;
+            store.operands = instr.operands;
+            block.instrs.push_back(std::move(store));
+          }
+          instr = Instr{};
+          instr.kind = Kind::Jump;
+          instr.target = continuation;
+          break;
+        case Kind::Alloc: {
+          // 每次进入都需重新清零被调者的局部单元
+          Instr zero;
+          zero.kind = Kind::Const;
+          zero.result = caller.new_value();
+          block.instrs.push_back(zero);
+          for (std::int64_t slot = 0; slot < locals; ++slot) {
+            Instr store;
+            store.kind = Kind::Store;
+            store.immediate = base + slot;
+            store.operands = {zero.result};
+            block.instrs.push_back(std::move(store));
+          }
+          continue;
+        }
+        default:
+          break;
+      }
+      block.instrs.push_back(std::move(instr));
+    }
+    copies.push_back(std::move(block));
+  }
+
+  BasicBlock tail;
+  tail.id = continuation;
+  if (call.result != ir::kNoValue) {
+    Instr load;
+    load.kind = Kind::Load;
+    load.immediate = result_slot;
+    load.result = call.result;
+    tail.instrs.push_back(std::move(load));
+  }
+  auto& split = caller.blocks[static_cast<std::size_t>(block_id)].instrs;
+  tail.instrs.insert(tail.instrs.end(),
+                     std::make_move_iterator(split.begin() + static_cast<std::ptrdiff_t>(position) + 1),
+                     std::make_move_iterator(split.end()));
+  split.resize(position);
+  for (std::size_t i = 0; i < call.operands.size(); ++i) {
+    Instr store;
+    store.kind = Kind::Store;
+    store.immediate = params + static_cast<std::int64_t>(i);
+    store.operands = {call.operands[i]};
+    split.push_back(std::move(store));
+  }
+  Instr enter;
+  enter.kind = Kind::Jump;
+  enter.target = block_offset + callee.entry;
+  split.push_back(enter);
+  std::vector<int> callee_layout = ordered_blocks(callee);
+  for (auto& block : copies) {
+    caller.blocks.push_back(std::move(block));
+  }
+  caller.blocks.push_back(std::move(tail));
+
+  // 重排布局键: 内联块紧随调用块, 其后是续延块
+  std::vector<int> order;
+  order.reserve(caller.blocks.size());
+  for (int id : layout) {
+    order.push_back(id);
+    if (id != block_id) {
+      continue;
+    }
+    auto entry = std::find(callee_layout.begin(), callee_layout.end(), callee.entry);
+    std::rotate(callee_layout.begin(), entry, entry + 1);
+    for (int source : callee_layout) {
+      order.push_back(block_offset + source);
+    }
+    order.push_back(continuation);
+  }
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    caller.blocks[static_cast<std::size_t>(order[i])].origin = static_cast<int>(i);
+  }
+  ir::recompute_edges(caller);
+}
+
+// 函数: 按规模与调用次数启发式内联非递归过程
+void inline_procedures(Module& module) {
+  const std::size_t count = module.functions.size();
+  std::vector<std::int64_t> initial_frame(count, 0);
+  for (std::size_t index = 0; index < count; ++index) {
+    if (auto* alloc = find_alloc(module.functions[index])) {
+      initial_frame[index] = alloc->immediate;
+    }
+  }
+  for (int round = 0; round < kInlineRounds; ++round) {
+    // 内联嵌套过程后外层过程可能变为可内联, 每轮重新判定
+    std::vector<bool> inlinable(count, false);
+    for (std::size_t index = 0; index < count; ++index) {
+      inlinable[index] = is_inlinable(module, static_cast<int>(index));
+    }
+    std::vector<int> sites(count, 0);
+    for (const auto& function : module.functions) {
+      for (const auto& block : function.blocks) {
+        for (const auto& instr : block.instrs) {
+          if (!block.removed && ir::is_call(instr)) {
+            ++sites[static_cast<std::size_t>(instr.callee)];
+          }
+        }
+      }
+    }
+
+    bool changed = false;
+    for (std::size_t caller = 0; caller < count; ++caller) {
+      bool rescan = true;
+      while (rescan) {
+        rescan = false;
+        auto& function = module.functions[caller];
+        for (std::size_t b = 0; b < function.blocks.size() && !rescan; ++b) {
+          const auto& block = function.blocks[b];
+          for (std::size_t i = 0; i < block.instrs.size() && !block.removed; ++i) {
+            const auto& instr = block.instrs[i];
+            if (instr.kind != Kind::Call || !inlinable[static_cast<std::size_t>(instr.callee)] ||
+                instr.callee == static_cast<int>(caller)) {
+              continue;
+            }
+            const auto& callee = module.functions[static_cast<std::size_t>(instr.callee)];
+            const std::size_t size = function_size(callee);
+            const bool profitable =
+                size <= kInlineSmallSize ||
+                (sites[static_cast<std::size_t>(instr.callee)] == 1 && size <= kInlineSingleSiteSize);
+            const std::int64_t growth =
+                find_alloc(function)->immediate - initial_frame[caller] +
+                initial_frame[static_cast<std::size_t>(instr.callee)] - 3 + callee.arity +
+                (callee.returns_value ? 1 : 0);
+            if (!profitable || growth > kInlineMaxFrameGrowth ||
+                function_size(function) + size > kInlineMaxCallerSize) {
+              continue;
+            }
+            inline_call(module, static_cast<int>(caller), static_cast<int>(b), i);
+            changed = true;
+            rescan = true;
+            break;
+          }
+        }
+      }
+    }
+    if (!changed) {
+      break;
+    }
+  }
+}
+
+// 函数: 判断块内 position 处的调用之后是否立即返回, 且返回值恰为调用结果
+bool returns_after_call(const Function& function, const BasicBlock& block,
+                        std::size_t position) {
+  if (position + 2 != block.instrs.size()) {
+    return false;
+  }
+  const Instr& call = block.instrs[position];
+  auto returns_result = [&](const Instr& instr) {
+    if (instr.kind != Kind::Return) {
+      return false;
+    }
+    return instr.operands.empty() ? call.result == ir::kNoValue
+                                  : instr.operands.front() == call.result;
+  };
+  const Instr& next = block.instrs.back();
+  if (returns_result(next)) {
+    return true;
+  }
+  if (next.kind != Kind::Jump) {
+    return false;
+  }
+  const auto& target = function.blocks[static_cast<std::size_t>(next.target)].instrs;
+  return target.size() == 1 && returns_result(target.front());
+}
+
+// 函数: 将实参写入本帧参数单元, 供跳回的循环头或 TCL 目标读取
+void store_arguments(std::vector<Instr>& instrs, const Instr& call) {
+  const auto arity = static_cast<std::int64_t>(call.operands.size());
+  for (std::int64_t i = 0; i < arity; ++i) {
+    Instr store;
+    store.kind = Kind::Store;
+    store.immediate = i - arity;
+    store.operands = {call.operands[static_cast<std::size_t>(i)]};
+    instrs.push_back(std::move(store));
+  }
+}
+
+// 函数: 在帧分配之后切分出循环头, 供自递归尾调用跳回
+int split_after_alloc(Function& function) {
+  std::vector<int> layout = ordered_blocks(function);
+  for (auto& block : function.blocks) {
+    if (block.removed) {
+      continue;
+    }
+    auto alloc = std::find_if(block.instrs.begin(), block.instrs.end(),
+                              [](const Instr& instr) { return instr.kind == Kind::Alloc; });
+    if (alloc == block.instrs.end()) {
+      continue;
+    }
+    BasicBlock header;
+    header.id = static_cast<int>(function.blocks.size());
+    header.instrs.assign(std::make_move_iterator(alloc + 1),
+                         std::make_move_iterator(block.instrs.end()));
+    block.instrs.erase(alloc + 1, block.instrs.end());
+    Instr jump;
+    jump.kind = Kind::Jump;
+    jump.target = header.id;
+    block.instrs.push_back(jump);
+
+    std::vector<int> order;
+    for (int id : layout) {
+      order.push_back(id);
+      if (id == block.id) {
+        order.push_back(header.id);
+      }
+    }
+    function.blocks.push_back(std::move(header));
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      function.blocks[static_cast<std::size_t>(order[i])].origin = static_cast<int>(i);
+    }
+    return static_cast<int>(function.blocks.size()) - 1;
+  }
+  return -1;
+}
+
+// 函数: 尾调用消除
+//   自递归尾调用改写为写入实参、清零局部单元后跳回过程体开头;
+//   其余层差 >= 1 且参数个数相同的尾调用改为写入实参后 TCL 复用当前帧
+//   (层差为 0 时被调者以本帧为静态链, 不能复用)
+void eliminate_tail_calls(Module& module) {
+  for (std::size_t index = 0; index < module.functions.size(); ++index) {
+    if (static_cast<int>(index) == module.main) {
+      continue;
+    }
+    auto& function = module.functions[index];
+    ir::recompute_edges(function);
+    Instr* alloc = find_alloc(function);
+    if (!alloc) {
+      continue;
+    }
+    const std::int64_t frame = alloc->immediate;
+    const bool loop_self = frame - 3 <= kTailLoopMaxLocals;
+
+    int header = -1;
+    for (std::size_t b = 0; b < function.blocks.size(); ++b) {
+      for (std::size_t i = 0; i < function.blocks[b].instrs.size(); ++i) {
+        const Instr call = function.blocks[b].instrs[i];
+        if (function.blocks[b].removed || call.kind != Kind::Call || call.level < 1 ||
+            !returns_after_call(function, function.blocks[b], i)) {
+          continue;
+        }
+        const bool self = call.callee == static_cast<int>(index) && call.level == 1;
+        if (!self && module.functions[static_cast<std::size_t>(call.callee)].arity !=
+                         function.arity) {
+          continue;
+        }
+        if (self && loop_self && header < 0) {
+          // 切分可能移动当前调用, 重新扫描
+          header = split_after_alloc(function);
+          b = static_cast<std::size_t>(-1);
+          break;
+        }
+        auto& instrs = function.blocks[b].instrs;
+        instrs.resize(i);
+        store_arguments(instrs, call);
+        if (self && loop_self) {
+          Instr zero;
+          zero.kind = Kind::Const;
+          zero.result = function.new_value();
+          instrs.push_back(zero);
+          for (std::int64_t slot = 3; slot < frame; ++slot) {
+            Instr store;
+            store.kind = Kind::Store;
+            store.immediate = slot;
+            store.operands = {zero.result};
+            instrs.push_back(std::move(store));
+          }
+          Instr jump;
+          jump.kind = Kind::Jump;
+          jump.target = header;
+          instrs.push_back(jump);
+        } else {
+          Instr tail = call;
+          tail.kind = Kind::TailCall;
+          tail.result = ir::kNoValue;
+          tail.immediate = static_cast<std::int64_t>(call.operands.size());
+          tail.operands.clear();
+          instrs.push_back(tail);
+        }
+        break;
+      }
+    }
+    ir::recompute_edges(function);
+  }
+}
+
+}  // namespace
+
+// 函数: 执行完整优化流水线
+void optimize_module(Module& module) {
+  inline_procedures(module);
+  for (auto& function : module.functions) {
+    simplify_cfg(function);
+  }
+  for (int round = 0; round < kPipelineRounds; ++round) {
+    // 首轮值编号与死存储消除之后, 函数结果经返回值单元的中转已被消去, 再识别尾调用
+    if (round == 1) {
+      eliminate_tail_calls(module);
+    }
+    for (auto& function : module.functions) {
+      ir::recompute_edges(function);
+      ValueNumbering numbering(function);
+      numbering.run();
+      simplify_cfg(function);
+    }
+    FrameUsage usage = collect_frame_usage(module);
+    for (std::size_t index = 0; index < module.functions.size(); ++index) {
+      eliminate_dead_stores(module, static_cast<int>(index), usage);
+      if (!usage.unknown_address && !usage.address_taken[index]) {
+        eliminate_dead_frame_stores(module.functions[index]);
+      }
+      eliminate_dead_code(module.functions[index]);
+    }
+  }
+}
+
+// 函数: 优化指令序列并修正过程符号
+bool optimize_program(InstructionSequence& code, std::vector<Symbol>& symbols) {
+  auto module = ir::build_module(code);
+  if (!module) {
+    return false;
+  }
+  optimize_module(*module);
+  ir::LoweredProgram lowered = ir::lower_module(*module);
+
+  std::map<int, int> entries(lowered.entry_map.begin(), lowered.entry_map.end());
+  std::vector<Symbol> remapped;
+  remapped.reserve(symbols.size());
+  for (auto& symbol : symbols) {
+    if (symbol.kind == SymbolKind::Procedure || symbol.kind == SymbolKind::Function) {
+      auto it = entries.find(symbol.address);
+      if (it == entries.end()) {
+        continue;
+      }
+      symbol.address = it->second;
+    }
+    remapped.push_back(std::move(symbol));
+  }
+  symbols = std::move(remapped);
+  code = std::move(lowered.code);
+  return true;
+}
+
+}  // namespace pl0
@@ -3,6 +3,7 @@
 #include "pl0/PCode.hpp"
 
 #include <cctype>
+#include <cstdint>
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
@@ -10,6 +11,17 @@
 
 namespace pl0 {
 
+namespace {
+
+// 函数: 无论大小都以 LDC 表示常量
+Instruction wide_constant(std::int64_t value) {
+  const auto bits = static_cast<std::uint64_t>(value);
+  return {Op::LDC, static_cast<std::int32_t>(bits >> 32),
+          static_cast<std::int32_t>(bits & 0xFFFFFFFFu)};
+}
+
+}  // namespace
+
 // 函数: 将操作码转为文本
 std::string to_string(Op op) {
   switch (op) {
@@ -41,8 +53,12 @@ std::string to_string(Op op) {
       return "chk";
     case Op::DUP:
       return "dup";
+    case Op::TCL:
+      return "tcl";
     case Op::NOP:
       return "nop";
+    case Op::LDC:
+      return "ldc";
   }
   return "unknown";
 }
@@ -90,13 +106,36 @@ std::string to_string(Opr opr) {
       return "or";
     case Opr::NOT:
       return "not";
+    case Opr::RETV:
+      return "retv";
   }
   return "unknown";
 }
 
-// 函数: 文字化单条指令
+// 函数: 生成 LIT 或 LDC
+Instruction load_constant(std::int64_t value) {
+  if (value >= INT32_MIN && value <= INT32_MAX) {
+    return {Op::LIT, 0, static_cast<std::int32_t>(value)};
+  }
+  return wide_constant(value);
+}
+
+// 函数: 取出常量值
+std::int64_t literal_value(const Instruction& instr) {
+  if (instr.op != Op::LDC) {
+    return instr.argument;
+  }
+  const auto high = static_cast<std::uint64_t>(static_cast<std::uint32_t>(instr.level));
+  return static_cast<std::int64_t>(high << 32 | static_cast<std::uint32_t>(instr.argument));
+}
+
+// 函数: 文字化单条指令; LDC 的层次字段记为 0, 参数为完整的 64 位常量
 std::string to_string(const Instruction& instr) {
   std::ostringstream oss;
+  if (instr.op == Op::LDC) {
+    oss << to_string(instr.op) << " 0 " << literal_value(instr);
+    return oss.str();
+  }
   oss << to_string(instr.op) << " " << instr.level << " ";
   if (instr.op == Op::OPR) {
     oss << to_string(static_cast<Opr>(instr.argument));
@@ -106,6 +145,43 @@ std::string to_string(const Instruction& instr) {
   return oss.str();
 }
 
+// 函数: 压缩指令序列供虚拟机执行, LDC 的常量移入去重后的常量池
+PackedProgram pack_instructions(const InstructionSequence& instructions) {
+  PackedProgram program;
+  program.code.reserve(instructions.size());
+  std::unordered_map<std::int64_t, std::int32_t> pool;
+  for (std::size_t i = 0; i < instructions.size(); ++i) {
+    const auto& instr = instructions[i];
+    if (instr.op == Op::LDC) {
+      const auto value = literal_value(instr);
+      const auto [it, inserted] =
+          pool.try_emplace(value, static_cast<std::int32_t>(program.constants.size()));
+      if (inserted) {
+        program.constants.push_back(value);
+      }
+      program.code.push_back({static_cast<std::uint32_t>(Op::LDC), it->second});
+      continue;
+    }
+    if (instr.level < 0 || instr.level > kMaxPackedLevel) {
+      throw std::runtime_error("instruction " + std::to_string(i) + ": level " +
+                              std::to_string(instr.level) + " is out of range");
+    }
+    program.code.push_back({static_cast<std::uint32_t>(instr.level) << 8 |
+                                static_cast<std::uint32_t>(instr.op),
+                            instr.argument});
+  }
+  return program;
+}
+
+// 函数: 还原单条紧凑指令, LDC 从常量池取回常量
+Instruction unpack_instruction(const PackedProgram& program, std::size_t index) {
+  const auto& packed = program.code[index];
+  if (packed.op() == Op::LDC) {
+    return wide_constant(program.constants[static_cast<std::size_t>(packed.argument)]);
+  }
+  return {packed.op(), packed.level(), packed.argument};
+}
+
 // 函数: 从文本解析出指令
 Instruction parse_instruction(const std::string& text) {
   std::istringstream iss(text);
@@ -126,7 +202,8 @@ Instruction parse_instruction(const std::string& text) {
       {"lit", Op::LIT}, {"opr", Op::OPR}, {"lod", Op::LOD}, {"sto", Op::STO},
       {"cal", Op::CAL}, {"int", Op::INT}, {"jmp", Op::JMP}, {"jpc", Op::JPC},
       {"lda", Op::LDA}, {"idx", Op::IDX}, {"ldi", Op::LDI}, {"sti", Op::STI},
-      {"chk", Op::CHK}, {"dup", Op::DUP}, {"nop", Op::NOP},
+      {"chk", Op::CHK}, {"dup", Op::DUP}, {"tcl", Op::TCL},
+      {"nop", Op::NOP}, {"ldc", Op::LDC},
   };
 
   auto op_it = op_map.find(normalize(op_text));
@@ -149,13 +226,19 @@ Instruction parse_instruction(const std::string& text) {
         {"ne", Opr::NE},       {"lt", Opr::LT},       {"ge", Opr::GE},
         {"gt", Opr::GT},       {"le", Opr::LE},       {"write", Opr::WRITE},
         {"writeln", Opr::WRITELN}, {"read", Opr::READ}, {"and", Opr::AND},
-        {"or", Opr::OR},       {"not", Opr::NOT},
+        {"or", Opr::OR},       {"not", Opr::NOT},     {"retv", Opr::RETV},
     };
     auto opr_it = opr_map.find(normalize(opr_text));
     if (opr_it == opr_map.end()) {
       throw std::runtime_error("unknown opr mnemonic: " + opr_text);
     }
     instr.argument = static_cast<std::int32_t>(opr_it->second);
+  } else if (instr.op == Op::LDC) {
+    std::int64_t value = 0;
+    if (!(iss >> value)) {
+      throw std::runtime_error("missing argument");
+    }
+    instr = wide_constant(value);
   } else {
     if (!(iss >> instr.argument)) {
       throw std::runtime_error("missing argument");
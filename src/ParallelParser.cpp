@@ -0,0 +1,108 @@
+// 文件: ParallelParser.cpp
+// 功能: 实现并行语法分析; 解析从任一 Token 开始的过程声明不依赖外层上下文, 预解析结果可原样复用
+#include "pl0/ParallelParser.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "pl0/Lexer.hpp"
+#include "pl0/Parser.hpp"
+#include "pl0/ThreadPool.hpp"
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 单个任务至少覆盖的 Token 数, 小过程合并成一批以摊薄调度开销
+constexpr std::size_t kMinTaskTokens = 4096;
+
+// 函数: 从 first 处单独解析一个过程声明, 诊断留在结果中等待顺序解析转交
+void preparse(const std::vector<Token>& tokens, std::size_t nesting_limit,
+              PreparsedProcedure& entry) {
+  DiagnosticSink sink;
+  Lexer lexer(tokens, entry.first, sink);
+  Parser parser(lexer, sink);
+  parser.set_nesting_limit(nesting_limit);
+  entry.decl = parser.parse_procedure_unit();
+  entry.consumed = lexer.consumed();
+  entry.diagnostics = sink.diagnostics();
+}
+
+}  // namespace
+
+// 函数: 按 begin/end 深度与尚未闭合的过程数寻找顶层过程声明
+std::vector<std::size_t> find_top_level_procedures(const std::vector<Token>& tokens) {
+  std::vector<std::size_t> starts;
+  std::size_t depth = 0;
+  std::size_t open = 0;  // 已出现声明但过程体尚未结束的过程, 含嵌套过程
+  for (std::size_t i = 0; i < tokens.size(); ++i) {
+    switch (tokens[i].kind) {
+      case TokenKind::Procedure:
+      case TokenKind::Function:
+        // extern 声明只有首部, 没有过程体
+        if (depth == 0 && (i == 0 || tokens[i - 1].kind != TokenKind::Extern)) {
+          if (open == 0) {
+            starts.push_back(i);
+          }
+          ++open;
+        }
+        break;
+      case TokenKind::Begin:
+        ++depth;
+        break;
+      case TokenKind::End:
+        if (depth > 0 && --depth == 0 && open > 0) {
+          --open;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return starts;
+}
+
+// 函数: 预解析顶层过程后顺序解析全程序, 遇到预解析过的位置直接拼接
+std::unique_ptr<Program> parse_program_parallel(const std::vector<Token>& tokens,
+                                                DiagnosticSink& diagnostics,
+                                                std::size_t threads,
+                                                std::size_t nesting_limit) {
+  std::vector<PreparsedProcedure> preparsed;
+  const auto starts = find_top_level_procedures(tokens);
+  if (threads != 1 && starts.size() > 1) {
+    preparsed.resize(starts.size());
+    for (std::size_t i = 0; i < starts.size(); ++i) {
+      preparsed[i].first = starts[i];
+    }
+    // 相邻的小过程合并成一批, 线程数不超过批数
+    std::vector<std::pair<std::size_t, std::size_t>> batches;
+    for (std::size_t first = 0; first < starts.size();) {
+      std::size_t last = first + 1;
+      while (last < starts.size() && starts[last] - starts[first] < kMinTaskTokens) {
+        ++last;
+      }
+      batches.emplace_back(first, last);
+      first = last;
+    }
+    const std::size_t workers = threads == 0 ? std::thread::hardware_concurrency() : threads;
+    ThreadPool pool(std::clamp<std::size_t>(workers, 1, batches.size()));
+    for (const auto& [first, last] : batches) {
+      pool.submit([&tokens, &preparsed, first, last, nesting_limit] {
+        for (std::size_t i = first; i < last; ++i) {
+          preparse(tokens, nesting_limit, preparsed[i]);
+        }
+      });
+    }
+    pool.wait();
+  }
+
+  Lexer lexer(tokens, 0, diagnostics);
+  Parser parser(lexer, diagnostics);
+  parser.set_nesting_limit(nesting_limit);
+  parser.use_preparsed(&preparsed);
+  return parser.parse_program();
+}
+
+}  // namespace pl0
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <optional>
 #include <stdexcept>
+#include <string>
 #include <utility>
 
 #include "pl0/Symbol.hpp"
@@ -22,6 +23,23 @@ StmtPtr make_statement(SourceRange range, auto value) {
   return stmt;
 }
 
+// 结构: 嵌套超出上限时抛出, 由解析入口捕获后报告, 已解析的部分随栈展开丢弃
+struct NestingLimitExceeded {
+  SourceRange range;
+};
+
+// 类: 作用域内嵌套层数加一, 离开 (含异常展开) 时恢复
+class NestingGuard {
+ public:
+  explicit NestingGuard(std::size_t& depth) : depth_(depth) { ++depth_; }
+  ~NestingGuard() { --depth_; }
+  NestingGuard(const NestingGuard&) = delete;
+  NestingGuard& operator=(const NestingGuard&) = delete;
+
+ private:
+  std::size_t& depth_;
+};
+
 // 函数: 构造表达式节点包装器
 ExprPtr make_expression(SourceRange range, auto value) {
   auto expr = std::make_unique<Expression>();
@@ -39,7 +57,13 @@ Parser::Parser(Lexer& lexer, DiagnosticSink& diagnostics)
 // 函数: 解析整個程序
 std::unique_ptr<Program> Parser::parse_program() {
   auto program = std::make_unique<Program>();
-  auto block = parse_block();
+  std::unique_ptr<Block> block;
+  try {
+    block = parse_block();
+  } catch (const NestingLimitExceeded& error) {
+    report_nesting(error.range);
+    return nullptr;
+  }
   if (!block) {
     return nullptr;
   }
@@ -49,6 +73,21 @@ std::unique_ptr<Program> Parser::parse_program() {
   return program;
 }
 
+// 函数: 检查嵌套上限
+void Parser::check_nesting() {
+  if (nesting_ >= nesting_limit_) {
+    throw NestingLimitExceeded{peek(0).range};
+  }
+}
+
+// 函数: 报告嵌套超限
+void Parser::report_nesting(const SourceRange& range) {
+  diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::NestingTooDeep,
+                       "nesting exceeds the limit of " + std::to_string(nesting_limit_) +
+                           " levels",
+                       range});
+}
+
 // 函数: 预读指定偏移 Token
 const Token& Parser::peek(std::size_t lookahead) {
   return lexer_.peek(lookahead);
@@ -97,6 +136,7 @@ void Parser::synchronize(const std::vector<TokenKind>& sync_tokens) {
 std::unique_ptr<Block> Parser::parse_block() {
   auto block = std::make_unique<Block>();
   parse_const_declarations(*block);
+  parse_extern_declarations(*block);
   parse_var_declarations(*block);
   parse_procedure_declarations(*block);
 
@@ -150,28 +190,7 @@ void Parser::parse_var_declarations(Block& block) {
     return;
   }
   while (true) {
-    auto name_token = expect(TokenKind::Identifier,
-                             DiagnosticCode::ExpectedIdentifier,
-                             "expected identifier in var declaration");
-    VarDecl decl;
-    decl.range.begin = name_token.range.begin;
-    decl.name = name_token.lexeme;
-    if (match(TokenKind::LBracket)) {
-      auto size_token = expect(TokenKind::Number, DiagnosticCode::ExpectedSymbol,
-                               "expected array size");
-      if (size_token.number && *size_token.number <= 0) {
-        diagnostics_.report({DiagnosticLevel::Error,
-                             DiagnosticCode::InvalidArraySubscript,
-                             "array size must be positive", size_token.range});
-      }
-      decl.array_size = size_token.number.value_or(0);
-      decl.range.end = size_token.range.end;
-      expect(TokenKind::RBracket, DiagnosticCode::ExpectedSymbol,
-             "expected ']' after array size");
-    } else {
-      decl.range.end = name_token.range.end;
-    }
-    block.vars.push_back(std::move(decl));
+    block.vars.push_back(parse_variable("expected identifier in var declaration"));
     if (!match(TokenKind::Comma)) {
       break;
     }
@@ -180,31 +199,188 @@ void Parser::parse_var_declarations(Block& block) {
          "expected ';' after var declarations");
 }
 
-// 函数: 解析 procedure 声明
-void Parser::parse_procedure_declarations(Block& block) {
-  while (match(TokenKind::Procedure)) {
-    auto proc_token = expect(TokenKind::Identifier,
-                             DiagnosticCode::ExpectedIdentifier,
-                             "expected procedure name");
-    ProcedureDecl decl;
-    decl.range.begin = proc_token.range.begin;
-    decl.name = proc_token.lexeme;
-    expect(TokenKind::Semicolon, DiagnosticCode::ExpectedSymbol,
-           "expected ';' before procedure body");
-    auto body = parse_block();
-    if (!body) {
-      body = std::make_unique<Block>();
+// 函数: 解析单个变量名及可选的数组长度
+VarDecl Parser::parse_variable(std::string_view missing_name) {
+  auto name_token = expect(TokenKind::Identifier, DiagnosticCode::ExpectedIdentifier,
+                           missing_name);
+  VarDecl decl;
+  decl.range.begin = name_token.range.begin;
+  decl.name = name_token.lexeme;
+  if (match(TokenKind::LBracket)) {
+    auto size_token = expect(TokenKind::Number, DiagnosticCode::ExpectedSymbol,
+                             "expected array size");
+    if (size_token.number && *size_token.number <= 0) {
+      diagnostics_.report({DiagnosticLevel::Error,
+                           DiagnosticCode::InvalidArraySubscript,
+                           "array size must be positive", size_token.range});
+    }
+    decl.array_size = size_token.number.value_or(0);
+    decl.range.end = size_token.range.end;
+    expect(TokenKind::RBracket, DiagnosticCode::ExpectedSymbol,
+           "expected ']' after array size");
+  } else {
+    decl.range.end = name_token.range.end;
+  }
+  return decl;
+}
+
+// 函数: 解析 extern 声明序列:
+//   extern var a, b[n];  extern procedure p(x, y);  extern function f(n);
+void Parser::parse_extern_declarations(Block& block) {
+  while (match(TokenKind::Extern)) {
+    if (match(TokenKind::Var)) {
+      do {
+        auto variable = parse_variable("expected identifier in extern declaration");
+        ExternDecl decl;
+        decl.kind = ExternDecl::Kind::Variable;
+        decl.range = variable.range;
+        decl.name = std::move(variable.name);
+        decl.array_size = variable.array_size;
+        block.externs.push_back(std::move(decl));
+      } while (match(TokenKind::Comma));
+    } else if (peek(0).kind == TokenKind::Procedure || peek(0).kind == TokenKind::Function) {
+      const bool is_function = lexer_.next().kind == TokenKind::Function;
+      auto name_token = expect(TokenKind::Identifier, DiagnosticCode::ExpectedIdentifier,
+                               is_function ? "expected function name" : "expected procedure name");
+      ExternDecl decl;
+      decl.kind = is_function ? ExternDecl::Kind::Function : ExternDecl::Kind::Procedure;
+      decl.range = name_token.range;
+      decl.name = name_token.lexeme;
+      if (match(TokenKind::LParen)) {
+        if (peek(0).kind != TokenKind::RParen) {
+          do {
+            expect(TokenKind::Identifier, DiagnosticCode::ExpectedIdentifier,
+                   "expected parameter name");
+            ++decl.arity;
+          } while (match(TokenKind::Comma));
+        }
+        decl.range.end = expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
+                                "expected ')' after parameters")
+                             .range.end;
+      }
+      block.externs.push_back(std::move(decl));
+    } else {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::ExpectedSymbol,
+                           "expected 'var', 'procedure' or 'function' after 'extern'",
+                           peek(0).range});
     }
-    decl.body = std::move(body);
-    decl.range.end = peek(0).range.begin;
     expect(TokenKind::Semicolon, DiagnosticCode::ExpectedSymbol,
-           "expected ';' after procedure body");
-    block.procedures.push_back(std::move(decl));
+           "expected ';' after extern declaration");
   }
 }
 
-// 函数: 根据首词选择语句解析路径
+// 函数: 解析 procedure/function 声明序列
+void Parser::parse_procedure_declarations(Block& block) {
+  while (peek(0).kind == TokenKind::Procedure || peek(0).kind == TokenKind::Function) {
+    if (auto* ready = find_preparsed()) {
+      for (auto& diagnostic : ready->diagnostics) {
+        diagnostics_.report(std::move(diagnostic));
+      }
+      lexer_.skip(ready->consumed);
+      block.procedures.push_back(std::move(*ready->decl));
+      ready->decl.reset();
+      continue;
+    }
+    block.procedures.push_back(parse_procedure_declaration());
+  }
+}
+
+// 函数: 查找从当前 Token 开始的预解析过程声明, 每项只取用一次
+PreparsedProcedure* Parser::find_preparsed() {
+  if (!preparsed_ || spans_) {
+    return nullptr;
+  }
+  const std::size_t position = lexer_.consumed();
+  auto it = std::lower_bound(
+      preparsed_->begin(), preparsed_->end(), position,
+      [](const PreparsedProcedure& entry, std::size_t value) { return entry.first < value; });
+  if (it == preparsed_->end() || it->first != position || !it->decl) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+// 函数: 解析单个 procedure/function 声明及其值参数列表
+ProcedureDecl Parser::parse_procedure_declaration() {
+  const std::size_t first = lexer_.consumed();
+  const bool is_function = lexer_.next().kind == TokenKind::Function;
+  auto proc_token = expect(TokenKind::Identifier,
+                           DiagnosticCode::ExpectedIdentifier,
+                           is_function ? "expected function name" : "expected procedure name");
+  ProcedureDecl decl;
+  decl.range.begin = proc_token.range.begin;
+  decl.name = proc_token.lexeme;
+  decl.is_function = is_function;
+  if (match(TokenKind::LParen)) {
+    if (peek(0).kind != TokenKind::RParen) {
+      do {
+        auto param_token = expect(TokenKind::Identifier,
+                                  DiagnosticCode::ExpectedIdentifier,
+                                  "expected parameter name");
+        VarDecl param;
+        param.range = param_token.range;
+        param.name = param_token.lexeme;
+        decl.parameters.push_back(std::move(param));
+      } while (match(TokenKind::Comma));
+    }
+    expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
+           "expected ')' after parameters");
+  }
+  expect(TokenKind::Semicolon, DiagnosticCode::ExpectedSymbol,
+         "expected ';' before procedure body");
+  check_nesting();
+  const NestingGuard guard(nesting_);
+  auto body = parse_block();
+  if (!body) {
+    body = std::make_unique<Block>();
+  }
+  decl.body = std::move(body);
+  decl.range.end = peek(0).range.begin;
+  expect(TokenKind::Semicolon, DiagnosticCode::ExpectedSymbol,
+         "expected ';' after procedure body");
+  if (spans_) {
+    spans_->procedures[decl.body.get()] = TokenSpan{first, lexer_.consumed()};
+  }
+  return decl;
+}
+
+// 函数: 单独解析一个过程声明
+std::optional<ProcedureDecl> Parser::parse_procedure_unit() {
+  if (peek(0).kind != TokenKind::Procedure && peek(0).kind != TokenKind::Function) {
+    return std::nullopt;
+  }
+  try {
+    return parse_procedure_declaration();
+  } catch (const NestingLimitExceeded& error) {
+    report_nesting(error.range);
+    return std::nullopt;
+  }
+}
+
+// 函数: 单独解析一条语句
+StmtPtr Parser::parse_statement_unit() {
+  try {
+    return parse_statement();
+  } catch (const NestingLimitExceeded& error) {
+    report_nesting(error.range);
+    return nullptr;
+  }
+}
+
+// 函数: 解析语句并在记录模式下登记其 Token 区间
 StmtPtr Parser::parse_statement() {
+  const std::size_t first = lexer_.consumed();
+  check_nesting();
+  const NestingGuard guard(nesting_);
+  auto stmt = parse_statement_body();
+  if (stmt && spans_) {
+    spans_->statements[stmt.get()] = TokenSpan{first, lexer_.consumed()};
+  }
+  return stmt;
+}
+
+// 函数: 根据首词选择语句解析路径
+StmtPtr Parser::parse_statement_body() {
   const auto token = peek(0);
   switch (token.kind) {
     case TokenKind::Identifier:
@@ -541,249 +717,319 @@ StmtPtr Parser::parse_write(bool newline) {
   return make_statement(range, std::move(stmt));
 }
 
-// 函数: 解析逻辑或表达式
+// 函数: 解析表达式
+//   每个栈帧对应原先逐层递归的一次调用: 压入子帧即"调用", 弹出并把结果留在 result 即"返回";
+//   文法、出错时的占位节点与诊断顺序都与逐层递归完全一致, 只是栈在堆上
 ExprPtr Parser::parse_expression() {
-  auto expr = parse_logic_term();
-  while (match(TokenKind::Or)) {
-    auto rhs = parse_logic_term();
-    if (!rhs) {
-      rhs = make_expression(expr->range, BooleanLiteral{false});
-    }
-    SourceRange range{expr->range.begin, rhs->range.end};
-    BinaryExpr binary{BinaryOp::Or, std::move(expr), std::move(rhs)};
-    expr = make_expression(range, std::move(binary));
-  }
-  return expr;
-}
-
-// 函数: 解析逻辑与表达式
-ExprPtr Parser::parse_logic_term() {
-  auto expr = parse_logic_factor();
-  while (match(TokenKind::And)) {
-    auto rhs = parse_logic_factor();
-    if (!rhs) {
-      rhs = make_expression(expr->range, BooleanLiteral{false});
-    }
-    SourceRange range{expr->range.begin, rhs->range.end};
-    BinaryExpr binary{BinaryOp::And, std::move(expr), std::move(rhs)};
-    expr = make_expression(range, std::move(binary));
-  }
-  return expr;
-}
-
-// 函数: 解析逻辑因子
-ExprPtr Parser::parse_logic_factor() {
-  auto expr = parse_relation();
-  return expr;
-}
-
-// 函数: 解析比较表达式
-ExprPtr Parser::parse_relation() {
-  auto left = parse_term();
-  const auto op_token = peek(0);
-  BinaryOp op;
-  bool has_op = true;
-  switch (op_token.kind) {
-    case TokenKind::Equal:
-      op = BinaryOp::Equal;
-      break;
-    case TokenKind::NotEqual:
-      op = BinaryOp::NotEqual;
-      break;
-    case TokenKind::Less:
-      op = BinaryOp::Less;
-      break;
-    case TokenKind::LessEqual:
-      op = BinaryOp::LessEqual;
-      break;
-    case TokenKind::Greater:
-      op = BinaryOp::Greater;
-      break;
-    case TokenKind::GreaterEqual:
-      op = BinaryOp::GreaterEqual;
-      break;
-    default:
-      has_op = false;
-      break;
-  }
-  if (!has_op) {
-    return left;
-  }
-  lexer_.next();
-  auto right = parse_term();
-  if (!right) {
-    right = make_expression(op_token.range, NumberLiteral{0});
-  }
-  SourceRange range{left->range.begin, right->range.end};
-  BinaryExpr binary{op, std::move(left), std::move(right)};
-  return make_expression(range, std::move(binary));
-}
+  using Rule = ExpressionFrame::Rule;
+  using Stage = ExpressionFrame::Stage;
+  auto& stack = expression_stack_;
+  const std::size_t base = stack.size();
+  auto push = [&stack](Rule rule) {
+    stack.emplace_back();
+    stack.back().rule = rule;
+  };
+  auto combine = [](ExprPtr lhs, BinaryOp op, ExprPtr rhs) {
+    SourceRange range{lhs->range.begin, rhs->range.end};
+    BinaryExpr binary{op, std::move(lhs), std::move(rhs)};
+    return make_expression(range, std::move(binary));
+  };
 
-// 函数: 解析加减层级
-ExprPtr Parser::parse_term() {
-  auto expr = parse_factor();
+  ExprPtr result;
+  push(Rule::Or);
   while (true) {
-    TokenKind kind = peek(0).kind;
-    BinaryOp op;
-    if (kind == TokenKind::Plus) {
-      op = BinaryOp::Add;
-    } else if (kind == TokenKind::Minus) {
-      op = BinaryOp::Subtract;
-    } else {
-      break;
-    }
-    lexer_.next();
-    auto rhs = parse_factor();
-    if (!rhs) {
-      rhs = make_expression(expr->range, NumberLiteral{0});
-    }
-    SourceRange range{expr->range.begin, rhs->range.end};
-    BinaryExpr binary{op, std::move(expr), std::move(rhs)};
-    expr = make_expression(range, std::move(binary));
-  }
-  return expr;
-}
-
-// 函数: 解析乘除层级
-ExprPtr Parser::parse_factor() {
-  const auto token = peek(0);
-  if (match(TokenKind::Plus)) {
-    auto operand = parse_factor();
-    if (!operand) {
-      operand = make_expression(token.range, NumberLiteral{0});
-    }
-    return operand;
-  }
-  if (match(TokenKind::Minus)) {
-    auto operand = parse_factor();
-    if (!operand) {
-      operand = make_expression(token.range, NumberLiteral{0});
-    }
-    SourceRange range{token.range.begin, operand->range.end};
-    UnaryExpr unary{UnaryOp::Negative, std::move(operand)};
-    return make_expression(range, std::move(unary));
-  }
-  if (match(TokenKind::Not)) {
-    auto operand = parse_factor();
-    if (!operand) {
-      operand = make_expression(token.range, BooleanLiteral{false});
-    }
-    SourceRange range{token.range.begin, operand->range.end};
-    UnaryExpr unary{UnaryOp::Not, std::move(operand)};
-    return make_expression(range, std::move(unary));
-  }
-  if (match(TokenKind::Odd)) {
-    auto operand = parse_factor();
-    if (!operand) {
-      operand = make_expression(token.range, NumberLiteral{0});
-    }
-    SourceRange range{token.range.begin, operand->range.end};
-    UnaryExpr unary{UnaryOp::Odd, std::move(operand)};
-    return make_expression(range, std::move(unary));
-  }
-
-  auto expr = parse_primary();
+    auto& frame = stack.back();
+    bool done = false;
+    switch (frame.rule) {
+      // 或 / 与: 左结合的运算链, 缺失的右操作数以 false 占位
+      case Rule::Or:
+      case Rule::And: {
+        const Rule child = frame.rule == Rule::Or ? Rule::And : Rule::Relation;
+        const TokenKind op = frame.rule == Rule::Or ? TokenKind::Or : TokenKind::And;
+        if (frame.stage == Stage::Start) {
+          frame.stage = Stage::Operand;
+          push(child);
+          continue;
+        }
+        if (frame.stage == Stage::Operand) {
+          frame.expr = std::move(result);
+        } else {
+          if (!result) {
+            result = make_expression(frame.expr->range, BooleanLiteral{false});
+          }
+          frame.expr = combine(std::move(frame.expr),
+                               frame.rule == Rule::Or ? BinaryOp::Or : BinaryOp::And,
+                               std::move(result));
+        }
+        if (match(op)) {
+          frame.stage = Stage::Rest;
+          push(child);
+          continue;
+        }
+        result = std::move(frame.expr);
+        done = true;
+        break;
+      }
 
-  while (true) {
-    TokenKind kind = peek(0).kind;
-    BinaryOp op;
-    if (kind == TokenKind::Star) {
-      op = BinaryOp::Multiply;
-    } else if (kind == TokenKind::Slash) {
-      op = BinaryOp::Divide;
-    } else if (kind == TokenKind::Percent) {
-      op = BinaryOp::Modulo;
-    } else {
-      break;
-    }
-    lexer_.next();
-    auto rhs = parse_primary();
-    if (!rhs) {
-      rhs = make_expression(expr->range, NumberLiteral{1});
-    }
-    SourceRange range{expr->range.begin, rhs->range.end};
-    BinaryExpr binary{op, std::move(expr), std::move(rhs)};
-    expr = make_expression(range, std::move(binary));
-  }
+      // 比较: 至多一个比较运算符, 不结合
+      case Rule::Relation: {
+        if (frame.stage == Stage::Start) {
+          frame.stage = Stage::Operand;
+          push(Rule::Additive);
+          continue;
+        }
+        if (frame.stage == Stage::Rest) {
+          if (!result) {
+            result = make_expression(frame.range, NumberLiteral{0});
+          }
+          result = combine(std::move(frame.expr), frame.binary, std::move(result));
+          done = true;
+          break;
+        }
+        const auto& op_token = peek(0);
+        bool has_op = true;
+        switch (op_token.kind) {
+          case TokenKind::Equal:
+            frame.binary = BinaryOp::Equal;
+            break;
+          case TokenKind::NotEqual:
+            frame.binary = BinaryOp::NotEqual;
+            break;
+          case TokenKind::Less:
+            frame.binary = BinaryOp::Less;
+            break;
+          case TokenKind::LessEqual:
+            frame.binary = BinaryOp::LessEqual;
+            break;
+          case TokenKind::Greater:
+            frame.binary = BinaryOp::Greater;
+            break;
+          case TokenKind::GreaterEqual:
+            frame.binary = BinaryOp::GreaterEqual;
+            break;
+          default:
+            has_op = false;
+            break;
+        }
+        if (!has_op) {
+          done = true;
+          break;
+        }
+        frame.range = op_token.range;
+        lexer_.next();
+        frame.expr = std::move(result);
+        frame.stage = Stage::Rest;
+        push(Rule::Additive);
+        continue;
+      }
 
-  return expr;
-}
+      // 加减: 左结合的运算链
+      case Rule::Additive: {
+        if (frame.stage == Stage::Start) {
+          frame.stage = Stage::Operand;
+          push(Rule::Factor);
+          continue;
+        }
+        if (frame.stage == Stage::Operand) {
+          frame.expr = std::move(result);
+        } else {
+          if (!result) {
+            result = make_expression(frame.expr->range, NumberLiteral{0});
+          }
+          frame.expr = combine(std::move(frame.expr), frame.binary, std::move(result));
+        }
+        const TokenKind kind = peek(0).kind;
+        if (kind == TokenKind::Plus || kind == TokenKind::Minus) {
+          frame.binary = kind == TokenKind::Plus ? BinaryOp::Add : BinaryOp::Subtract;
+          lexer_.next();
+          frame.stage = Stage::Rest;
+          push(Rule::Factor);
+          continue;
+        }
+        result = std::move(frame.expr);
+        done = true;
+        break;
+      }
 
-// 函数: 解析原子表达式
-ExprPtr Parser::parse_primary() {
-  const auto token = peek(0);
-  switch (token.kind) {
-    case TokenKind::Number: {
-      auto number_token = lexer_.next();
-      NumberLiteral literal{number_token.number.value_or(0)};
-      return make_expression(number_token.range, std::move(literal));
-    }
-    case TokenKind::Boolean: {
-      auto bool_token = lexer_.next();
-      BooleanLiteral literal{bool_token.boolean.value_or(false)};
-      return make_expression(bool_token.range, std::move(literal));
-    }
-    case TokenKind::Identifier: {
-      auto ident_token = lexer_.next();
-      if (peek(0).kind == TokenKind::LParen) {
-        CallExpr call;
-        call.callee = ident_token.lexeme;
-        auto lparen = lexer_.next();
-        SourceLoc end = lparen.range.end;
-        if (peek(0).kind == TokenKind::RParen) {
-          auto rparen = lexer_.next();
-          end = rparen.range.end;
+      // 一元运算 (作用于整个因子) 或 原子 { 乘除模 原子 }
+      case Rule::Factor: {
+        if (frame.stage == Stage::Start) {
+          const auto& token = peek(0);
+          frame.range = token.range;
+          switch (token.kind) {
+            case TokenKind::Plus:
+              frame.unary = UnaryOp::Positive;
+              break;
+            case TokenKind::Minus:
+              frame.unary = UnaryOp::Negative;
+              break;
+            case TokenKind::Not:
+              frame.unary = UnaryOp::Not;
+              break;
+            case TokenKind::Odd:
+              frame.unary = UnaryOp::Odd;
+              break;
+            default:
+              frame.stage = Stage::Operand;
+              push(Rule::Primary);
+              continue;
+          }
+          lexer_.next();
+          panic_mode_ = false;
+          frame.stage = Stage::Unary;
+          push(Rule::Factor);
+          continue;
+        }
+        if (frame.stage == Stage::Unary) {
+          if (!result) {
+            result = frame.unary == UnaryOp::Not
+                         ? make_expression(frame.range, BooleanLiteral{false})
+                         : make_expression(frame.range, NumberLiteral{0});
+          }
+          // 正号不产生节点
+          if (frame.unary != UnaryOp::Positive) {
+            SourceRange range{frame.range.begin, result->range.end};
+            UnaryExpr unary{frame.unary, std::move(result)};
+            result = make_expression(range, std::move(unary));
+          }
+          done = true;
+          break;
+        }
+        if (frame.stage == Stage::Operand) {
+          // 出错的原子已报告, 用占位值继续, 保证上层拿到的左操作数非空
+          frame.expr = result ? std::move(result) : make_expression(frame.range, NumberLiteral{0});
         } else {
-          while (true) {
-            auto arg = parse_expression();
-            if (arg) {
-              end = arg->range.end;
-              call.arguments.push_back(std::move(arg));
+          if (!result) {
+            result = make_expression(frame.expr->range, NumberLiteral{1});
+          }
+          frame.expr = combine(std::move(frame.expr), frame.binary, std::move(result));
+        }
+        const TokenKind kind = peek(0).kind;
+        if (kind == TokenKind::Star || kind == TokenKind::Slash || kind == TokenKind::Percent) {
+          frame.binary = kind == TokenKind::Star    ? BinaryOp::Multiply
+                         : kind == TokenKind::Slash ? BinaryOp::Divide
+                                                    : BinaryOp::Modulo;
+          lexer_.next();
+          frame.stage = Stage::Rest;
+          push(Rule::Primary);
+          continue;
+        }
+        result = std::move(frame.expr);
+        done = true;
+        break;
+      }
+
+      // 原子: 字面量与标识符就地归约; 调用实参、下标与括号改写本帧后压入子表达式
+      case Rule::Primary: {
+        const auto& token = peek(0);
+        switch (token.kind) {
+          case TokenKind::Number: {
+            auto number_token = lexer_.next();
+            NumberLiteral literal{number_token.number.value_or(0)};
+            result = make_expression(number_token.range, std::move(literal));
+            break;
+          }
+          case TokenKind::Boolean: {
+            auto bool_token = lexer_.next();
+            BooleanLiteral literal{bool_token.boolean.value_or(false)};
+            result = make_expression(bool_token.range, std::move(literal));
+            break;
+          }
+          case TokenKind::Identifier: {
+            auto ident_token = lexer_.next();
+            if (peek(0).kind == TokenKind::LParen) {
+              frame.call.callee = std::move(ident_token.lexeme);
+              frame.range = ident_token.range;
+              frame.end = lexer_.next().range.end;
+              if (peek(0).kind == TokenKind::RParen) {
+                frame.end = lexer_.next().range.end;
+                result = make_expression(SourceRange{frame.range.begin, frame.end},
+                                         std::move(frame.call));
+                break;
+              }
+              frame.rule = Rule::Arguments;
+              frame.stage = Stage::Operand;
+              push(Rule::Or);
+              continue;
             }
-            if (peek(0).kind == TokenKind::Comma) {
+            if (peek(0).kind == TokenKind::LBracket) {
               lexer_.next();
+              frame.call.callee = std::move(ident_token.lexeme);
+              frame.range = ident_token.range;
+              frame.rule = Rule::Subscript;
+              frame.stage = Stage::Operand;
+              push(Rule::Or);
               continue;
             }
-            auto rparen = expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
-                                 "expected ')' after arguments");
-            end = rparen.range.end;
+            IdentifierExpr ident{std::move(ident_token.lexeme)};
+            result = make_expression(ident_token.range, std::move(ident));
             break;
           }
+          case TokenKind::LParen:
+            frame.range = lexer_.next().range;
+            frame.rule = Rule::Group;
+            frame.stage = Stage::Operand;
+            push(Rule::Or);
+            continue;
+          default:
+            diagnostics_.report({DiagnosticLevel::Error,
+                                 DiagnosticCode::UnexpectedToken,
+                                 "unexpected token in expression", token.range});
+            lexer_.next();
+            result = nullptr;
+            break;
         }
-        SourceRange range{ident_token.range.begin, end};
-        return make_expression(range, std::move(call));
+        done = true;
+        break;
       }
-      if (peek(0).kind == TokenKind::LBracket) {
-        lexer_.next();
-        auto index = parse_expression();
+
+      case Rule::Arguments: {
+        if (result) {
+          frame.end = result->range.end;
+          frame.call.arguments.push_back(std::move(result));
+        }
+        if (peek(0).kind == TokenKind::Comma) {
+          lexer_.next();
+          push(Rule::Or);
+          continue;
+        }
+        frame.end = expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
+                           "expected ')' after arguments")
+                        .range.end;
+        result = make_expression(SourceRange{frame.range.begin, frame.end}, std::move(frame.call));
+        done = true;
+        break;
+      }
+
+      case Rule::Subscript: {
         auto rbracket = expect(TokenKind::RBracket, DiagnosticCode::ExpectedSymbol,
                                "expected ']' after subscript");
-        if (!index) {
-          index = make_expression(ident_token.range, NumberLiteral{0});
+        if (!result) {
+          result = make_expression(frame.range, NumberLiteral{0});
+        }
+        ArrayAccessExpr access{std::move(frame.call.callee), std::move(result)};
+        result = make_expression(SourceRange{frame.range.begin, rbracket.range.end},
+                                 std::move(access));
+        done = true;
+        break;
+      }
+
+      case Rule::Group: {
+        expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
+               "expected ')' after expression");
+        if (!result) {
+          result = make_expression(frame.range, NumberLiteral{0});
         }
-        ArrayAccessExpr access{ident_token.lexeme, std::move(index)};
-        SourceRange range{ident_token.range.begin, rbracket.range.end};
-        return make_expression(range, std::move(access));
+        done = true;
+        break;
       }
-      IdentifierExpr ident{ident_token.lexeme};
-      return make_expression(ident_token.range, std::move(ident));
     }
-    case TokenKind::LParen: {
-      auto lparen = lexer_.next();
-      auto expr = parse_expression();
-      expect(TokenKind::RParen, DiagnosticCode::ExpectedSymbol,
-             "expected ')' after expression");
-      if (!expr) {
-        expr = make_expression(lparen.range, NumberLiteral{0});
+    if (done) {
+      stack.pop_back();
+      if (stack.size() == base) {
+        return result;
       }
-      return expr;
     }
-    default:
-      diagnostics_.report({DiagnosticLevel::Error,
-                           DiagnosticCode::UnexpectedToken,
-                           "unexpected token in expression", token.range});
-      lexer_.next();
-      return nullptr;
   }
 }
 
@@ -0,0 +1,248 @@
+// 文件: Profiler.cpp
+// 功能: 实现执行剖析器的计数、采样与报告输出
+#include "pl0/Profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 折叠栈保留的最大深度, 更深的递归只保留最外层与栈顶
+constexpr std::size_t kMaxFoldedDepth = 128;
+
+// 常量: 报告中列出的热点指令条数
+constexpr std::size_t kHotInstructionCount = 20;
+
+// 常量: 折叠栈中省略中间帧时使用的占位过程
+constexpr int kElidedFrames = -1;
+
+// 函数: 纳秒转毫秒
+double to_milliseconds(std::chrono::nanoseconds duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// 函数: 计算百分比, 分母为 0 时返回 0
+double percent(std::uint64_t part, std::uint64_t whole) {
+  return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+}
+
+}  // namespace
+
+// 构造: 记录采样间隔
+Profiler::Profiler(std::uint32_t sample_interval)
+    : sample_interval_(std::max<std::uint32_t>(sample_interval, 1)) {}
+
+// 函数: 记录过程入口名称
+void Profiler::name_procedures(const std::vector<Symbol>& symbols) {
+  for (const auto& symbol : symbols) {
+    if (symbol.kind == SymbolKind::Procedure || symbol.kind == SymbolKind::Function) {
+      names_[symbol.address] = symbol.name;
+    }
+  }
+}
+
+// 函数: 重置计数并以主程序为栈底开始计时
+void Profiler::begin(const InstructionSequence& code) {
+  code_ = &code;
+  instruction_counts_.assign(code.size(), 0);
+  procedure_of_entry_.assign(code.size(), -1);
+  procedures_.clear();
+  active_.clear();
+  stack_.clear();
+  folded_.clear();
+  elapsed_ = std::chrono::nanoseconds{0};
+  sample_count_ = 0;
+  countdown_ = sample_interval_;
+  stack_.push_back(procedure_for(0));
+  procedures_.front().name = "main";
+  procedures_.front().calls = 1;
+  active_.front() = 1;
+  started_ = last_sample_ = Clock::now();
+}
+
+// 函数: 结束执行, 把最后一段时间记到当前调用栈上
+void Profiler::end() {
+  if (stack_.empty()) {
+    stack_.push_back(0);
+  }
+  sample();
+  elapsed_ = Clock::now() - started_;
+}
+
+// 函数: 进入过程
+void Profiler::on_call(int target) {
+  int procedure = procedure_for(target);
+  ++procedures_[static_cast<std::size_t>(procedure)].calls;
+  ++active_[static_cast<std::size_t>(procedure)];
+  stack_.push_back(procedure);
+}
+
+// 函数: 尾调用复用栈帧, 在剖析视图中以被调者替换栈顶
+void Profiler::on_tail_call(int target) {
+  int procedure = procedure_for(target);
+  ++procedures_[static_cast<std::size_t>(procedure)].calls;
+  --active_[static_cast<std::size_t>(stack_.back())];
+  ++active_[static_cast<std::size_t>(procedure)];
+  stack_.back() = procedure;
+}
+
+// 函数: 过程返回; 主程序返回后仍保留栈底以便结算
+void Profiler::on_return() {
+  if (stack_.size() <= 1) {
+    return;
+  }
+  --active_[static_cast<std::size_t>(stack_.back())];
+  stack_.pop_back();
+}
+
+// 函数: 查找或登记入口对应的过程编号; 代码范围外的入口 (损坏的 .pcode, 虚拟机跳到该处即停止)
+//   不进入下标表, 按入口线性查找后照常登记, 报告中显示为 proc@入口
+int Profiler::procedure_for(int entry) {
+  if (entry < 0 || static_cast<std::size_t>(entry) >= procedure_of_entry_.size()) {
+    const auto it = std::find_if(procedures_.begin(), procedures_.end(),
+                                 [entry](const ProcedureStats& stats) { return stats.entry == entry; });
+    return it != procedures_.end() ? static_cast<int>(it - procedures_.begin())
+                                   : register_procedure(entry);
+  }
+  auto& slot = procedure_of_entry_[static_cast<std::size_t>(entry)];
+  if (slot < 0) {
+    slot = register_procedure(entry);
+  }
+  return slot;
+}
+
+// 函数: 为入口登记新的过程统计项
+int Profiler::register_procedure(int entry) {
+  const int slot = static_cast<int>(procedures_.size());
+  ProcedureStats stats;
+  stats.entry = entry;
+  auto it = names_.find(entry);
+  stats.name = it != names_.end() ? it->second : "proc@" + std::to_string(entry);
+  procedures_.push_back(std::move(stats));
+  active_.push_back(0);
+  return slot;
+}
+
+// 函数: 读取时钟并把间隔耗时记到当前调用栈
+void Profiler::sample() {
+  countdown_ = sample_interval_;
+  auto now = Clock::now();
+  auto delta = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_sample_);
+  last_sample_ = now;
+  ++sample_count_;
+
+  auto& top = procedures_[static_cast<std::size_t>(stack_.back())];
+  top.self_time += delta;
+  ++top.samples;
+  for (std::size_t index = 0; index < procedures_.size(); ++index) {
+    if (active_[index] > 0) {
+      procedures_[index].total_time += delta;
+    }
+  }
+
+  if (stack_.size() <= kMaxFoldedDepth) {
+    ++folded_[stack_];
+  } else {
+    std::vector<int> key(stack_.begin(),
+                         stack_.begin() + static_cast<std::ptrdiff_t>(kMaxFoldedDepth - 2));
+    key.push_back(kElidedFrames);
+    key.push_back(stack_.back());
+    ++folded_[key];
+  }
+}
+
+// 函数: 输出文本报告
+void Profiler::write_report(std::ostream& out) const {
+  const std::uint64_t total = std::accumulate(instruction_counts_.begin(),
+                                              instruction_counts_.end(), std::uint64_t{0});
+  const auto flags = out.flags();
+  const auto precision = out.precision();
+  out << "== profile ==\n";
+  out << "instructions executed: " << total << '\n';
+  out << "elapsed: " << std::fixed << std::setprecision(3) << to_milliseconds(elapsed_)
+      << " ms (" << sample_count_ << " samples, every " << sample_interval_
+      << " instructions)\n";
+
+  out << "\n-- procedures --\n";
+  out << std::left << std::setw(20) << "name" << std::right << std::setw(10) << "calls"
+      << std::setw(14) << "instructions" << std::setw(8) << "self%" << std::setw(12)
+      << "self ms" << std::setw(12) << "total ms" << '\n';
+  std::vector<const ProcedureStats*> procedures;
+  for (const auto& stats : procedures_) {
+    procedures.push_back(&stats);
+  }
+  std::stable_sort(procedures.begin(), procedures.end(),
+                   [](const ProcedureStats* lhs, const ProcedureStats* rhs) {
+                     return lhs->instructions > rhs->instructions;
+                   });
+  for (const auto* stats : procedures) {
+    out << std::left << std::setw(20) << stats->name << std::right << std::setw(10)
+        << stats->calls << std::setw(14) << stats->instructions << std::setw(7)
+        << std::setprecision(1) << percent(stats->instructions, total) << '%'
+        << std::setw(12) << std::setprecision(3) << to_milliseconds(stats->self_time)
+        << std::setw(12) << to_milliseconds(stats->total_time) << '\n';
+  }
+
+  // 操作码计数由逐指令计数汇总, 执行时无需额外开销
+  std::map<std::string, std::uint64_t> opcodes;
+  for (std::size_t pc = 0; pc < instruction_counts_.size(); ++pc) {
+    if (instruction_counts_[pc] == 0) {
+      continue;
+    }
+    const Instruction& instr = (*code_)[pc];
+    std::string key = to_string(instr.op);
+    if (instr.op == Op::OPR) {
+      key += ' ' + to_string(static_cast<Opr>(instr.argument));
+    }
+    opcodes[key] += instruction_counts_[pc];
+  }
+  std::vector<std::pair<std::string, std::uint64_t>> sorted(opcodes.begin(), opcodes.end());
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+  out << "\n-- opcodes --\n";
+  for (const auto& [name, count] : sorted) {
+    out << std::left << std::setw(20) << name << std::right << std::setw(14) << count
+        << std::setw(7) << std::setprecision(1) << percent(count, total) << "%\n";
+  }
+
+  std::vector<std::size_t> hot(instruction_counts_.size());
+  std::iota(hot.begin(), hot.end(), std::size_t{0});
+  std::stable_sort(hot.begin(), hot.end(), [&](std::size_t lhs, std::size_t rhs) {
+    return instruction_counts_[lhs] > instruction_counts_[rhs];
+  });
+  out << "\n-- hot instructions --\n";
+  for (std::size_t i = 0; i < hot.size() && i < kHotInstructionCount; ++i) {
+    const std::size_t pc = hot[i];
+    if (instruction_counts_[pc] == 0) {
+      break;
+    }
+    out << std::setw(6) << pc << ": " << std::left << std::setw(20)
+        << to_string((*code_)[pc]) << std::right << std::setw(14) << instruction_counts_[pc]
+        << std::setw(7) << std::setprecision(1) << percent(instruction_counts_[pc], total)
+        << "%\n";
+  }
+  out.flags(flags);
+  out.precision(precision);
+}
+
+// 函数: 输出折叠栈, 每行 "main;outer;inner 采样数"
+void Profiler::write_folded(std::ostream& out) const {
+  for (const auto& [stack, count] : folded_) {
+    for (std::size_t i = 0; i < stack.size(); ++i) {
+      if (i > 0) {
+        out << ';';
+      }
+      if (stack[i] == kElidedFrames) {
+        out << "[...]";
+      } else {
+        out << procedures_[static_cast<std::size_t>(stack[i])].name;
+      }
+    }
+    out << ' ' << count << '\n';
+  }
+}
+
+}  // namespace pl0
@@ -0,0 +1,88 @@
+// 文件: Scheduler.cpp
+// 功能: 实现多程序调度器
+#include "pl0/Scheduler.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "pl0/ThreadPool.hpp"
+
+namespace pl0 {
+
+// 构造: 记录工作线程数与分片长度
+Scheduler::Scheduler(std::size_t workers, std::uint64_t quantum)
+    : workers_(workers == 0 ? std::max<std::size_t>(std::thread::hardware_concurrency(), 1)
+                            : workers),
+      quantum_(std::max<std::uint64_t>(quantum, 1)) {}
+
+// 函数: 登记程序
+std::size_t Scheduler::submit(ProgramJob job) {
+  jobs_.push_back(std::move(job));
+  return jobs_.size() - 1;
+}
+
+// 函数: 各工作线程从共享就绪队列取程序运行一个分片, 未结束的放回队尾, 直到队列为空
+std::vector<ProgramOutcome> Scheduler::run() {
+  auto jobs = std::move(jobs_);
+  jobs_.clear();
+  std::vector<ProgramOutcome> outcomes(jobs.size());
+  if (jobs.empty()) {
+    return outcomes;
+  }
+
+  // 结构: 运行中的程序; 虚拟机在分片之间保存进度, 可由任意工作线程接续
+  struct Running {
+    std::istringstream input;
+    std::ostringstream output;
+    std::unique_ptr<VirtualMachine> vm;
+  };
+  std::vector<Running> running(jobs.size());
+  std::deque<std::size_t> ready;
+  for (std::size_t i = 0; i < jobs.size(); ++i) {
+    ready.push_back(i);
+  }
+  std::mutex ready_mutex;
+
+  const std::size_t threads = std::min(workers_, jobs.size());
+  ThreadPool pool(threads);
+  for (std::size_t t = 0; t < threads; ++t) {
+    pool.submit([&] {
+      while (true) {
+        std::size_t index = 0;
+        {
+          std::lock_guard lock(ready_mutex);
+          if (ready.empty()) {
+            return;
+          }
+          index = ready.front();
+          ready.pop_front();
+        }
+        auto& state = running[index];
+        auto& outcome = outcomes[index];
+        if (!state.vm) {
+          state.input.str(jobs[index].input);
+          state.vm = std::make_unique<VirtualMachine>(outcome.diagnostics, jobs[index].options);
+          state.vm->set_io(state.input, state.output);
+          state.vm->start(jobs[index].code);
+        }
+        auto result = state.vm->run_for(quantum_);
+        if (result.status == VirtualMachine::Result::Status::Suspended) {
+          std::lock_guard lock(ready_mutex);
+          ready.push_back(index);
+          continue;
+        }
+        outcome.result = result;
+        outcome.output = state.output.str();
+        state.vm.reset();
+      }
+    });
+  }
+  pool.wait();
+  return outcomes;
+}
+
+}  // namespace pl0
@@ -0,0 +1,681 @@
+// 文件: Server.cpp
+// 功能: 实现 JSON Lines 编译/运行服务
+#include "pl0/Server.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "pl0/Driver.hpp"
+#include "pl0/ThreadPool.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#define PL0_HAVE_UNIX_SOCKETS 1
+#endif
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 套接字轮询间隔, 决定 shutdown 后多久退出阻塞等待
+constexpr int kPollIntervalMs = 200;
+
+// 结构: 请求中的一个 JSON 标量; raw 保留原文以便原样回显 id
+struct JsonValue {
+  enum class Type { String, Number, Bool, Null } type = Type::Null;
+  std::string text;  // String: 解码后的内容; Number: 原文
+  bool boolean = false;
+  std::string raw;
+};
+
+// 结构: 解析后的请求对象
+struct Request {
+  std::map<std::string, JsonValue, std::less<>> fields;
+
+  [[nodiscard]] const JsonValue* find(std::string_view key) const {
+    auto it = fields.find(key);
+    return it == fields.end() ? nullptr : &it->second;
+  }
+  [[nodiscard]] std::optional<std::string> string(std::string_view key) const {
+    const auto* value = find(key);
+    if (!value || value->type != JsonValue::Type::String) {
+      return std::nullopt;
+    }
+    return value->text;
+  }
+  [[nodiscard]] bool flag(std::string_view key) const {
+    const auto* value = find(key);
+    return value && value->type == JsonValue::Type::Bool && value->boolean;
+  }
+  [[nodiscard]] std::optional<long long> integer(std::string_view key) const {
+    const auto* value = find(key);
+    if (!value || value->type != JsonValue::Type::Number) {
+      return std::nullopt;
+    }
+    try {
+      return std::stoll(value->text);
+    } catch (const std::exception&) {
+      return std::nullopt;
+    }
+  }
+};
+
+// 类: 只支持单层对象 (值为字符串/数字/布尔/null) 的 JSON 读取器, 足以覆盖请求格式
+class JsonReader {
+ public:
+  explicit JsonReader(std::string_view text) : text_(text) {}
+
+  // 函数: 解析整个请求对象, 失败时返回错误描述
+  std::optional<std::string> parse(Request& request) {
+    skip_space();
+    if (!consume('{')) {
+      return "expected '{'";
+    }
+    skip_space();
+    if (consume('}')) {
+      return finish();
+    }
+    while (true) {
+      skip_space();
+      std::string key;
+      if (!parse_string(key)) {
+        return "expected string key";
+      }
+      skip_space();
+      if (!consume(':')) {
+        return "expected ':'";
+      }
+      skip_space();
+      JsonValue value;
+      const std::size_t start = pos_;
+      if (!parse_value(value)) {
+        return "unsupported or malformed value for '" + key + "'";
+      }
+      value.raw = std::string(text_.substr(start, pos_ - start));
+      request.fields[key] = std::move(value);
+      skip_space();
+      if (consume('}')) {
+        return finish();
+      }
+      if (!consume(',')) {
+        return "expected ',' or '}'";
+      }
+    }
+  }
+
+ private:
+  std::optional<std::string> finish() {
+    skip_space();
+    if (pos_ != text_.size()) {
+      return "trailing characters after object";
+    }
+    return std::nullopt;
+  }
+
+  void skip_space() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\r' ||
+            text_[pos_] == '\n')) {
+      ++pos_;
+    }
+  }
+
+  bool consume(char expected) {
+    if (pos_ < text_.size() && text_[pos_] == expected) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool consume_word(std::string_view word) {
+    if (text_.substr(pos_, word.size()) == word) {
+      pos_ += word.size();
+      return true;
+    }
+    return false;
+  }
+
+  // 函数: 跳过一串数字, 至少要有一位
+  bool consume_digits() {
+    const std::size_t start = pos_;
+    while (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+      ++pos_;
+    }
+    return pos_ > start;
+  }
+
+  // 函数: 按 JSON 数字文法扫描: -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?;
+  //   id 会原样回显, 不合文法的数字必须在这里拒绝
+  bool parse_number() {
+    consume('-');
+    if (consume('0')) {
+      if (pos_ < text_.size() && text_[pos_] >= '0' && text_[pos_] <= '9') {
+        return false;
+      }
+    } else if (!consume_digits()) {
+      return false;
+    }
+    if (consume('.') && !consume_digits()) {
+      return false;
+    }
+    if (consume('e') || consume('E')) {
+      if (!consume('+')) {
+        consume('-');
+      }
+      if (!consume_digits()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool parse_value(JsonValue& value) {
+    if (pos_ >= text_.size()) {
+      return false;
+    }
+    const char ch = text_[pos_];
+    if (ch == '"') {
+      value.type = JsonValue::Type::String;
+      return parse_string(value.text);
+    }
+    if (ch == '-' || (ch >= '0' && ch <= '9')) {
+      const std::size_t start = pos_;
+      if (!parse_number()) {
+        return false;
+      }
+      value.type = JsonValue::Type::Number;
+      value.text = std::string(text_.substr(start, pos_ - start));
+      return true;
+    }
+    if (consume_word("true") || consume_word("false")) {
+      value.type = JsonValue::Type::Bool;
+      value.boolean = text_[pos_ - 1] == 'e' && text_[pos_ - 2] == 'u';
+      return true;
+    }
+    if (consume_word("null")) {
+      value.type = JsonValue::Type::Null;
+      return true;
+    }
+    return false;
+  }
+
+  // 函数: 追加 UTF-8 编码的码点
+  static void append_utf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+      out += static_cast<char>(code);
+    } else if (code < 0x800) {
+      out += static_cast<char>(0xC0 | (code >> 6));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      out += static_cast<char>(0xE0 | (code >> 12));
+      out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+
+  bool parse_string(std::string& out) {
+    if (!consume('"')) {
+      return false;
+    }
+    while (pos_ < text_.size()) {
+      const char ch = text_[pos_++];
+      if (ch == '"') {
+        return true;
+      }
+      if (ch != '\\') {
+        out += ch;
+        continue;
+      }
+      if (pos_ >= text_.size()) {
+        return false;
+      }
+      const char escape = text_[pos_++];
+      switch (escape) {
+        case '"':
+        case '\\':
+        case '/':
+          out += escape;
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          if (pos_ + 4 > text_.size()) {
+            return false;
+          }
+          unsigned code = 0;
+          for (int i = 0; i < 4; ++i) {
+            const char hex = text_[pos_++];
+            code <<= 4;
+            if (hex >= '0' && hex <= '9') {
+              code |= static_cast<unsigned>(hex - '0');
+            } else if (hex >= 'a' && hex <= 'f') {
+              code |= static_cast<unsigned>(hex - 'a' + 10);
+            } else if (hex >= 'A' && hex <= 'F') {
+              code |= static_cast<unsigned>(hex - 'A' + 10);
+            } else {
+              return false;
+            }
+          }
+          append_utf8(out, code);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return false;
+  }
+
+  std::string_view text_;
+  std::size_t pos_ = 0;
+};
+
+// 函数: 输出 JSON 字符串字面量
+std::string quote(std::string_view text) {
+  std::string out = "\"";
+  for (char ch : text) {
+    switch (ch) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(ch) < 0x20) {
+          char buffer[8];
+          std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(ch));
+          out += buffer;
+        } else {
+          out += ch;
+        }
+    }
+  }
+  out += '"';
+  return out;
+}
+
+// 函数: 诊断列表转为 JSON 字符串数组
+std::string diagnostics_json(const DiagnosticSink& diagnostics) {
+  std::string out = "[";
+  bool first = true;
+  for (const auto& diagnostic : diagnostics.diagnostics()) {
+    std::ostringstream text;
+    text << diagnostic;
+    out += (first ? "" : ",") + quote(text.str());
+    first = false;
+  }
+  return out + "]";
+}
+
+// 函数: 错误响应
+std::string error_response(const std::string& id, std::string_view message) {
+  return "{\"id\":" + id + ",\"ok\":false,\"error\":" + quote(message) + "}";
+}
+
+// 函数: 读取请求中的编译选项
+CompilerOptions compiler_options_of(const Request& request) {
+  CompilerOptions options;
+  options.optimize = request.flag("optimize");
+  options.enable_bounds_check = request.flag("bounds_check");
+  return options;
+}
+
+// 函数: 检查请求的源码规模, 超出服务上限时返回拒绝原因
+std::optional<std::string> check_source_size(const std::string& text, const Request& request,
+                                             const ServerOptions& options) {
+  if (text.size() > options.max_source_bytes) {
+    return "request exceeds the limit of " + std::to_string(options.max_source_bytes) + " bytes";
+  }
+  if (request.flag("optimize") && text.size() > options.max_optimize_bytes) {
+    return "optimize is limited to sources of at most " +
+           std::to_string(options.max_optimize_bytes) + " bytes";
+  }
+  return std::nullopt;
+}
+
+// 函数: 处理 compile 请求
+std::string handle_compile(const std::string& id, const Request& request,
+                           const ServerOptions& options) {
+  auto source = request.string("source");
+  if (!source) {
+    return error_response(id, "compile requires a string 'source'");
+  }
+  if (auto rejected = check_source_size(*source, request, options)) {
+    return error_response(id, *rejected);
+  }
+  DiagnosticSink diagnostics;
+  auto result = compile_source_text("<request>", *source, compiler_options_of(request),
+                                    diagnostics, options.cache);
+  const bool ok = !diagnostics.has_errors();
+  std::ostringstream pcode;
+  if (ok) {
+    serialize_instructions(result.code, pcode);
+  }
+  return "{\"id\":" + id + ",\"ok\":" + (ok ? "true" : "false") +
+         ",\"pcode\":" + quote(pcode.str()) + ",\"diagnostics\":" + diagnostics_json(diagnostics) +
+         "}";
+}
+
+// 函数: 处理 run 请求, 源码或 P-Code 二选一
+std::string handle_run(const std::string& id, const Request& request,
+                       const ServerOptions& options) {
+  DiagnosticSink diagnostics;
+  InstructionSequence code;
+  if (auto source = request.string("source")) {
+    if (auto rejected = check_source_size(*source, request, options)) {
+      return error_response(id, *rejected);
+    }
+    auto result = compile_source_text("<request>", *source, compiler_options_of(request),
+                                      diagnostics, options.cache);
+    if (diagnostics.has_errors()) {
+      return "{\"id\":" + id + ",\"ok\":false,\"status\":\"compile_error\",\"output\":\"\"," +
+             "\"diagnostics\":" + diagnostics_json(diagnostics) + "}";
+    }
+    code = std::move(result.code);
+  } else if (auto pcode = request.string("pcode")) {
+    if (auto rejected = check_source_size(*pcode, request, options)) {
+      return error_response(id, *rejected);
+    }
+    try {
+      std::istringstream in(*pcode);
+      code = deserialize_instructions(in);
+    } catch (const std::exception& ex) {
+      return error_response(id, std::string("invalid pcode: ") + ex.what());
+    }
+  } else {
+    return error_response(id, "run requires a string 'source' or 'pcode'");
+  }
+
+  RunnerOptions runner_options;
+  runner_options.enable_bounds_check = request.flag("bounds_check");
+  runner_options.stack_limit = options.stack_limit;
+  auto timeout = options.default_timeout;
+  if (auto requested = request.integer("timeout_ms"); requested && *requested > 0) {
+    timeout = std::chrono::milliseconds(*requested);
+  }
+  runner_options.time_limit = std::clamp(timeout, std::chrono::milliseconds(1), options.max_timeout);
+
+  std::istringstream input(request.string("input").value_or(""));
+  std::ostringstream output;
+  VirtualMachine vm(diagnostics, runner_options);
+  vm.set_io(input, output);
+  const auto result = vm.execute(code);
+
+  const auto reported = [&](DiagnosticCode expected) {
+    return std::any_of(diagnostics.diagnostics().begin(), diagnostics.diagnostics().end(),
+                       [expected](const Diagnostic& d) { return d.code == expected; });
+  };
+  const char* status = reported(DiagnosticCode::TimeLimitExceeded)    ? "timeout"
+                       : reported(DiagnosticCode::StackLimitExceeded) ? "stack_limit"
+                       : result.success                               ? "finished"
+                                                                      : "error";
+  return "{\"id\":" + id + ",\"ok\":" + (result.success ? "true" : "false") + ",\"status\":\"" +
+         status + "\",\"output\":" + quote(output.str()) +
+         ",\"diagnostics\":" + diagnostics_json(diagnostics) + "}";
+}
+
+// 函数: 去掉行尾回车, 判断是否为空行
+bool normalize_line(std::string& line) {
+  if (!line.empty() && line.back() == '\r') {
+    line.pop_back();
+  }
+  return line.find_first_not_of(" \t") != std::string::npos;
+}
+
+// 函数: 判断请求是否为 shutdown; 读取线程据此同步停止, 不再读取其后的请求
+bool is_shutdown(std::string_view line) {
+  Request request;
+  return !JsonReader(line).parse(request) && request.string("op") == "shutdown";
+}
+
+}  // namespace
+
+// 构造: 记录配置
+Server::Server(ServerOptions options) : options_(options) {}
+
+// 函数: 处理单个请求
+std::string Server::handle(std::string_view line) {
+  Request request;
+  if (auto error = JsonReader(line).parse(request)) {
+    return error_response("null", "malformed request: " + *error);
+  }
+  const auto* id_value = request.find("id");
+  const std::string id = id_value ? id_value->raw : "null";
+  const auto op = request.string("op").value_or("");
+  try {
+    if (op == "compile") {
+      return handle_compile(id, request, options_);
+    }
+    if (op == "run") {
+      return handle_run(id, request, options_);
+    }
+    if (op == "ping") {
+      return "{\"id\":" + id + ",\"ok\":true}";
+    }
+    if (op == "shutdown") {
+      stopping_ = true;
+      return "{\"id\":" + id + ",\"ok\":true}";
+    }
+  } catch (const std::exception& ex) {
+    return error_response(id, std::string("internal error: ") + ex.what());
+  }
+  return error_response(id, "unknown op '" + op + "'");
+}
+
+// 函数: 标准流模式
+void Server::serve_stream(std::istream& input, std::ostream& output) {
+  ThreadPool pool(options_.workers);
+  std::mutex output_mutex;
+  std::string line;
+  while (!stopping_ && std::getline(input, line)) {
+    if (!normalize_line(line)) {
+      continue;
+    }
+    if (is_shutdown(line)) {
+      pool.wait();
+      output << handle(line) << '\n' << std::flush;
+      break;
+    }
+    pool.submit([this, &output, &output_mutex, request = std::move(line)] {
+      const auto response = handle(request);
+      std::lock_guard lock(output_mutex);
+      output << response << '\n' << std::flush;
+    });
+    line.clear();
+  }
+  pool.wait();
+}
+
+#ifdef PL0_HAVE_UNIX_SOCKETS
+
+namespace {
+
+// 函数: 完整写出缓冲区, 对端关闭时静默放弃
+void send_all(int fd, const std::string& data) {
+  std::size_t sent = 0;
+  while (sent < data.size()) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    const auto written = ::send(fd, data.data() + sent, data.size() - sent, flags);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    sent += static_cast<std::size_t>(written);
+  }
+}
+
+// 函数: 等待描述符可读, 超时返回 false 以便检查停止标志
+bool wait_readable(int fd) {
+  pollfd descriptor{fd, POLLIN, 0};
+  return ::poll(&descriptor, 1, kPollIntervalMs) > 0;
+}
+
+}  // namespace
+
+// 函数: Unix 域套接字模式
+int Server::serve_unix_socket(const std::filesystem::path& path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  const std::string native = path.string();
+  if (native.size() >= sizeof(address.sun_path)) {
+    std::cerr << "socket path too long: " << native << '\n';
+    return 1;
+  }
+  std::memcpy(address.sun_path, native.c_str(), native.size() + 1);
+
+  const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener < 0) {
+    std::cerr << "socket: " << std::strerror(errno) << '\n';
+    return 1;
+  }
+  ::unlink(native.c_str());
+  if (::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+      ::listen(listener, SOMAXCONN) != 0) {
+    std::cerr << "bind " << native << ": " << std::strerror(errno) << '\n';
+    ::close(listener);
+    return 1;
+  }
+
+  ThreadPool pool(options_.workers);
+  // 结构: 连接的读取线程, finished 在线程退出前置位, 便于及时回收其栈
+  struct Connection {
+    std::atomic<bool> finished{false};
+    std::thread thread;
+  };
+  std::list<Connection> connections;
+  auto reap = [&connections] {
+    connections.remove_if([](Connection& connection) {
+      if (!connection.finished) {
+        return false;
+      }
+      connection.thread.join();
+      return true;
+    });
+  };
+  while (!stopping_) {
+    // 每次等待连接前回收已结束的读取线程, 长期运行时线程数只随并发连接数变化
+    reap();
+    if (!wait_readable(listener)) {
+      continue;
+    }
+    const int fd = ::accept(listener, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+    // 每个连接一个读取线程, 请求交给共享线程池; 连接关闭前等待其全部响应写出
+    auto& connection = connections.emplace_back();
+    connection.thread = std::thread([this, fd, &pool, &finished = connection.finished] {
+      std::mutex mutex;
+      std::condition_variable idle;
+      std::size_t pending = 0;
+      std::string buffer;
+      char chunk[4096];
+      while (!stopping_) {
+        if (!wait_readable(fd)) {
+          continue;
+        }
+        const auto received = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+          break;
+        }
+        buffer.append(chunk, static_cast<std::size_t>(received));
+        std::size_t newline;
+        while ((newline = buffer.find('\n')) != std::string::npos) {
+          std::string line = buffer.substr(0, newline);
+          buffer.erase(0, newline + 1);
+          if (!normalize_line(line)) {
+            continue;
+          }
+          if (is_shutdown(line)) {
+            const auto response = handle(line) + '\n';
+            std::lock_guard lock(mutex);
+            send_all(fd, response);
+            break;
+          }
+          {
+            std::lock_guard lock(mutex);
+            ++pending;
+          }
+          pool.submit([this, fd, &mutex, &idle, &pending, request = std::move(line)] {
+            const auto response = handle(request) + '\n';
+            std::lock_guard lock(mutex);
+            send_all(fd, response);
+            if (--pending == 0) {
+              idle.notify_all();
+            }
+          });
+        }
+      }
+      std::unique_lock lock(mutex);
+      idle.wait(lock, [&] { return pending == 0; });
+      ::close(fd);
+      finished = true;
+    });
+  }
+
+  for (auto& connection : connections) {
+    connection.thread.join();
+  }
+  pool.wait();
+  ::close(listener);
+  ::unlink(native.c_str());
+  return 0;
+}
+
+#else
+
+// 函数: 当前平台不支持 Unix 域套接字
+int Server::serve_unix_socket(const std::filesystem::path&) {
+  std::cerr << "unix domain sockets are not supported on this platform\n";
+  return 1;
+}
+
+#endif
+
+}  // namespace pl0
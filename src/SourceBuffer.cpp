@@ -0,0 +1,160 @@
+// 文件: SourceBuffer.cpp
+// 功能: 实现只读源码缓冲: 普通文件 mmap 映射, 其余输入按块读入同一个字符串
+#include "pl0/SourceBuffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define PL0_HAVE_MMAP 1
+#else
+#include <fstream>
+#endif
+
+namespace pl0 {
+
+namespace {
+
+// 常量: 分块读取的块大小, 缓冲按倍数增长, 总复制量与文件大小成线性
+constexpr std::size_t kReadChunk = 1 << 16;
+
+#ifdef PL0_HAVE_MMAP
+// 类: 作用域结束时关闭文件描述符
+class FileDescriptor {
+ public:
+  explicit FileDescriptor(int fd) : fd_(fd) {}
+  ~FileDescriptor() {
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+  FileDescriptor(const FileDescriptor&) = delete;
+  FileDescriptor& operator=(const FileDescriptor&) = delete;
+  [[nodiscard]] int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+// 函数: 读到输入结束; 管道一次只返回一部分数据, 被信号中断时重试
+std::string read_chunks(int fd, const std::filesystem::path& path) {
+  std::string text;
+  std::size_t used = 0;
+  while (true) {
+    if (text.size() - used < kReadChunk) {
+      text.resize(std::max(text.size() * 2, used + kReadChunk));
+    }
+    const ssize_t count = ::read(fd, text.data() + used, text.size() - used);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::runtime_error("Failed to read file: " + path.string());
+    }
+    if (count == 0) {
+      break;
+    }
+    used += static_cast<std::size_t>(count);
+  }
+  text.resize(used);
+  return text;
+}
+#endif
+
+}  // namespace
+
+SourceBuffer::~SourceBuffer() { release(); }
+
+SourceBuffer::SourceBuffer(SourceBuffer&& other) noexcept { *this = std::move(other); }
+
+SourceBuffer& SourceBuffer::operator=(SourceBuffer&& other) noexcept {
+  if (this == &other) {
+    return *this;
+  }
+  release();
+  // 短字符串存放在对象内部, 移动后须按新地址重建视图
+  const bool in_owned = !other.owned_.empty() && other.view_.data() == other.owned_.data();
+  owned_ = std::move(other.owned_);
+  mapping_ = std::exchange(other.mapping_, nullptr);
+  mapping_size_ = std::exchange(other.mapping_size_, 0);
+  view_ = in_owned ? std::string_view(owned_) : other.view_;
+  other.owned_.clear();
+  other.view_ = {};
+  return *this;
+}
+
+// 函数: 取得字符串的所有权
+SourceBuffer SourceBuffer::from_string(std::string text) {
+  SourceBuffer buffer;
+  buffer.owned_ = std::move(text);
+  buffer.view_ = buffer.owned_;
+  return buffer;
+}
+
+// 函数: 打开文件, 能映射则映射, 否则分块读入
+SourceBuffer SourceBuffer::open(const std::filesystem::path& path) {
+#ifdef PL0_HAVE_MMAP
+  const FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+  if (fd.get() < 0) {
+    throw std::runtime_error("Failed to open file: " + path.string());
+  }
+  struct stat info {};
+  if (::fstat(fd.get(), &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    const auto size = static_cast<std::size_t>(info.st_size);
+    void* region = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    if (region != MAP_FAILED) {
+      // 词法分析自头至尾顺序读取, 提示内核加大预读
+      ::madvise(region, size, MADV_SEQUENTIAL);
+      SourceBuffer buffer;
+      buffer.mapping_ = region;
+      buffer.mapping_size_ = size;
+      buffer.view_ = std::string_view(static_cast<const char*>(region), size);
+      return buffer;
+    }
+  }
+  return from_string(read_chunks(fd.get(), path));
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open file: " + path.string());
+  }
+  std::string text;
+  std::size_t used = 0;
+  while (file) {
+    text.resize(std::max(text.size() * 2, used + kReadChunk));
+    file.read(text.data() + used, static_cast<std::streamsize>(text.size() - used));
+    used += static_cast<std::size_t>(file.gcount());
+  }
+  text.resize(used);
+  return from_string(std::move(text));
+#endif
+}
+
+// 函数: 取出文本为字符串
+std::string SourceBuffer::take_string() && {
+  std::string text = !owned_.empty() && view_.data() == owned_.data() ? std::move(owned_)
+                                                                      : std::string(view_);
+  release();
+  owned_.clear();
+  return text;
+}
+
+void SourceBuffer::release() {
+#ifdef PL0_HAVE_MMAP
+  if (mapping_) {
+    ::munmap(mapping_, mapping_size_);
+  }
+#endif
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  view_ = {};
+}
+
+}  // namespace pl0
@@ -15,14 +15,14 @@ const std::unordered_map<std::string_view, Keyword>& keyword_table() {
       {"const", Keyword::Const},   {"do", Keyword::Do},
       {"else", Keyword::Else},     {"end", Keyword::End},
       {"if", Keyword::If},         {"odd", Keyword::Odd},
-      {"procedure", Keyword::Procedure},
+      {"procedure", Keyword::Procedure}, {"function", Keyword::Function},
       {"then", Keyword::Then},     {"var", Keyword::Var},
       {"while", Keyword::While},   {"repeat", Keyword::Repeat},
       {"until", Keyword::Until},   {"read", Keyword::Read},
       {"write", Keyword::Write},   {"writeln", Keyword::Writeln},
       {"true", Keyword::True},     {"false", Keyword::False},
       {"and", Keyword::And},       {"or", Keyword::Or},
-      {"not", Keyword::Not},
+      {"not", Keyword::Not},       {"extern", Keyword::Extern},
   };
   return table;
 }
@@ -58,6 +58,8 @@ std::optional<TokenKind> keyword_token(Keyword keyword) {
       return TokenKind::Odd;
     case Keyword::Procedure:
       return TokenKind::Procedure;
+    case Keyword::Function:
+      return TokenKind::Function;
     case Keyword::Then:
       return TokenKind::Then;
     case Keyword::Var:
@@ -84,6 +86,8 @@ std::optional<TokenKind> keyword_token(Keyword keyword) {
       return TokenKind::Or;
     case Keyword::Not:
       return TokenKind::Not;
+    case Keyword::Extern:
+      return TokenKind::Extern;
   }
   return std::nullopt;
 }
@@ -3,6 +3,7 @@
 #include "pl0/SymbolTable.hpp"
 
 #include <algorithm>
+#include <functional>
 
 namespace pl0 {
 
@@ -11,6 +12,12 @@ SymbolTable::SymbolTable() {
   scopes_.push_back({0, ScopeInfo{0, 0}});
 }
 
+// 构造: 以外层表的可见前缀为最外层作用域
+SymbolTable::SymbolTable(const SymbolTable& enclosing, std::size_t visible)
+    : enclosing_(&enclosing), enclosing_visible_(std::min(visible, enclosing.symbols_.size())) {
+  scopes_.push_back({0, enclosing.current_scope()});
+}
+
 // 函数: 进入新作用域
 void SymbolTable::enter_scope() {
   ScopeInfo info;
@@ -31,7 +38,7 @@ void SymbolTable::leave_scope() {
   }
   scopes_.pop_back();
   if (scopes_.empty()) {
-    scopes_.push_back({0, ScopeInfo{0, 0}});
+    scopes_.push_back({0, enclosing_ ? enclosing_->current_scope() : ScopeInfo{0, 0}});
   }
 }
 
@@ -59,9 +66,28 @@ const Symbol* SymbolTable::lookup(const std::string& name) const {
       return &*it;
     }
   }
+  if (enclosing_) {
+    for (std::size_t index = enclosing_visible_; index > 0; --index) {
+      const auto& symbol = enclosing_->symbols_[index - 1];
+      if (symbol.name == name) {
+        return &symbol;
+      }
+    }
+  }
   return nullptr;
 }
 
+// 函数: 判断符号是否位于外层表的可见前缀中
+bool SymbolTable::inherited(const Symbol* symbol) const {
+  if (!enclosing_ || enclosing_visible_ == 0) {
+    return false;
+  }
+  // 不同数组间的指针比较须经 std::less 才有全序
+  const Symbol* first = enclosing_->symbols_.data();
+  const std::less<const Symbol*> before;
+  return !before(symbol, first) && before(symbol, first + enclosing_visible_);
+}
+
 // 函数: 仅在当前作用域搜索符号
 const Symbol* SymbolTable::lookup_in_current_scope(const std::string& name) const {
   if (scopes_.empty()) {
@@ -0,0 +1,128 @@
+// 文件: ThreadPool.cpp
+// 功能: 实现工作窃取线程池
+#include "pl0/ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace pl0 {
+
+namespace {
+
+// 当前线程所属的线程池与队列下标, 非工作线程为空
+thread_local const void* current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+}  // namespace
+
+// 构造: 创建队列并启动工作线程
+ThreadPool::ThreadPool(std::size_t threads) {
+  if (threads == 0) {
+    threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+  }
+  for (std::size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  for (std::size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+// 析构: 执行完剩余任务后停止并回收线程
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(state_mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+// 函数: 提交任务到当前工作线程的队列, 外部线程则轮流分配
+void ThreadPool::submit(std::function<void()> task) {
+  const std::size_t index = current_pool == this
+                                ? current_index
+                                : next_queue_.fetch_add(1) % queues_.size();
+  // 先登记计数再入队, 保证取走任务的线程递减计数时不会出现下溢
+  {
+    std::lock_guard lock(state_mutex_);
+    ++queued_;
+    ++pending_;
+  }
+  {
+    std::lock_guard lock(queues_[index]->mutex);
+    queues_[index]->tasks.push_back(std::move(task));
+  }
+  work_available_.notify_one();
+}
+
+// 函数: 等待全部任务完成
+void ThreadPool::wait() {
+  std::unique_lock lock(state_mutex_);
+  all_done_.wait(lock, [&] { return pending_ == 0; });
+  if (first_error_) {
+    auto error = first_error_;
+    first_error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+// 函数: 先取自身队尾, 再依次窃取其他队列的队首
+bool ThreadPool::try_take(std::size_t index, std::function<void()>& task) {
+  {
+    auto& own = *queues_[index];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+  for (std::size_t offset = 1; offset < queues_.size(); ++offset) {
+    auto& victim = *queues_[(index + offset) % queues_.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+// 函数: 工作线程主循环
+void ThreadPool::worker_loop(std::size_t index) {
+  current_pool = this;
+  current_index = index;
+  while (true) {
+    std::function<void()> task;
+    if (try_take(index, task)) {
+      {
+        std::lock_guard lock(state_mutex_);
+        --queued_;
+      }
+      std::exception_ptr error;
+      try {
+        task();
+      } catch (...) {
+        error = std::current_exception();
+      }
+      std::lock_guard lock(state_mutex_);
+      if (error && !first_error_) {
+        first_error_ = error;
+      }
+      if (--pending_ == 0) {
+        all_done_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock lock(state_mutex_);
+    work_available_.wait(lock, [&] { return stopping_ || queued_ > 0; });
+    if (stopping_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+}  // namespace pl0
@@ -90,6 +90,8 @@ std::string to_string(TokenKind kind) {
       return "odd";
     case TokenKind::Procedure:
       return "procedure";
+    case TokenKind::Function:
+      return "function";
     case TokenKind::Then:
       return "then";
     case TokenKind::Var:
@@ -116,6 +118,8 @@ std::string to_string(TokenKind kind) {
       return "or";
     case TokenKind::Not:
       return "not";
+    case TokenKind::Extern:
+      return "extern";
   }
   return "unknown";
 }
@@ -2,21 +2,16 @@
 // 功能: 实现常用工具函数
 #include "pl0/Utility.hpp"
 
-#include <fstream>
-#include <sstream>
-#include <stdexcept>
+#include <charconv>
+#include <system_error>
+
+#include "pl0/SourceBuffer.hpp"
 
 namespace pl0 {
 
-// 函数: 读取 UTF-8 文件内容
+// 函数: 读取 UTF-8 文件内容; 只需视图时应直接使用 SourceBuffer::open, 避免这次复制
 std::string read_file_utf8(const std::filesystem::path& path) {
-  std::ifstream file(path, std::ios::binary);
-  if (!file) {
-    throw std::runtime_error("Failed to open file: " + path.string());
-  }
-  std::ostringstream buffer;
-  buffer << file.rdbuf();
-  return buffer.str();
+  return SourceBuffer::open(path).take_string();
 }
 
 // 函数: 按换行符切分文本
@@ -42,4 +37,24 @@ void trim_trailing_cr(std::string& line) {
   }
 }
 
+// 函数: 解析无符号十进制整数, 要求整段文本都被消费
+std::optional<std::uint64_t> parse_unsigned(std::string_view text) {
+  std::uint64_t value = 0;
+  const char* end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, value);
+  if (text.empty() || ec != std::errc{} || ptr != end) {
+    return std::nullopt;
+  }
+  return value;
+}
+
+// 函数: FNV-1a 累加
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes) {
+  for (char ch : bytes) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
 }  // namespace pl0
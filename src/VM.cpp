@@ -2,8 +2,18 @@
 // 功能: 实现基于栈的 P-Code 虚拟机
 #include "pl0/VM.hpp"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "pl0/Profiler.hpp"
+#include "pl0/Utility.hpp"
 
 namespace pl0 {
 
@@ -12,53 +22,217 @@ namespace {
 // 常量: 初始栈容量
 constexpr std::size_t kInitialStackSize = 1024;
 
+// 常量: 执行策略位, 组合成分派表下标
+constexpr std::size_t kTraceBit = 1;
+constexpr std::size_t kProfileBit = 2;
+constexpr std::size_t kCheckBit = 4;
+constexpr std::size_t kCountBit = 8;
+constexpr std::size_t kLimitBit = 16;
+constexpr std::size_t kPolicyCount = 32;
+
+// 常量: 帧头单元数 (静态链、动态链、返回地址)
+constexpr int kFrameHeader = 3;
+
+// 常量: 快照魔数与格式版本
+constexpr char kSnapshotMagic[8] = {'P', 'L', '0', 'S', 'N', 'A', 'P', 'S'};
+constexpr std::uint32_t kSnapshotVersion = 2;
+
+// 常量: 限时检查点 (回跳与调用) 每经过这么多次才读取一次时钟
+constexpr std::uint32_t kLimitCheckInterval = 256;
+
+// 结构: 栈增长超出 stack_limit, 由分派循环以 StackLimitExceeded 报告
+struct StackLimitExceeded : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// 结构: 由策略位生成的编译期执行策略
+template <std::size_t Mask>
+struct ExecutionPolicy {
+  static constexpr bool trace = (Mask & kTraceBit) != 0;
+  static constexpr bool profile = (Mask & kProfileBit) != 0;
+  static constexpr bool check = (Mask & kCheckBit) != 0;
+  static constexpr bool count = (Mask & kCountBit) != 0;
+  static constexpr bool limit = (Mask & kLimitBit) != 0;
+};
+
 }  // namespace
 
 // 构造: 记录诊断器与运行时选项
 VirtualMachine::VirtualMachine(DiagnosticSink& diagnostics,
                                const RunnerOptions& options)
-    : diagnostics_(diagnostics), options_(options) {}
+    : diagnostics_(diagnostics), options_(options), input_(&std::cin), output_(&std::cout) {}
 
-// 函数: 执行指令序列并返回运行结果
+// 函数: 从头执行到结束
 VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code) {
-  Result result;
-  stack_.assign(kInitialStackSize, 0);
+  start(code);
+  return resume(std::numeric_limits<std::uint64_t>::max());
+}
+
+// 函数: 重置运行状态, 准备从第一条指令开始执行
+void VirtualMachine::start(const InstructionSequence& code) {
+  code_ = &code;
+  result_ = {};
+  result_.status = Result::Status::Suspended;
+  elapsed_ = {};
+  stack_.assign(options_.stack_limit > 0 ? std::min(kInitialStackSize, options_.stack_limit)
+                                         : kInitialStackSize,
+                0);
   stack_top_ = 0;
   base_pointer_ = 0;
   program_counter_ = 0;
-  stack_[0] = stack_[1] = stack_[2] = 0;
+  try {
+    packed_ = pack_instructions(code);
+  } catch (const std::runtime_error& ex) {
+    packed_ = {};
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::RuntimeError, ex.what(), {}});
+    result_.success = false;
+    result_.status = Result::Status::Failed;
+  }
+}
+
+// 函数: 继续执行至多约 slice 条指令
+VirtualMachine::Result VirtualMachine::run_for(std::uint64_t slice) {
+  if (code_ == nullptr) {
+    throw std::logic_error("run_for() called before start()");
+  }
+  return resume(slice);
+}
+
+// 函数: 按选项选定特化版本后继续执行, 分派循环内不再检查运行选项
+VirtualMachine::Result VirtualMachine::resume(std::uint64_t slice) {
+  if (result_.status != Result::Status::Suspended) {
+    return result_;
+  }
+  using Runner = void (VirtualMachine::*)(const PackedProgram&, std::uint64_t);
+  static constexpr auto runners = []<std::size_t... Masks>(std::index_sequence<Masks...>) {
+    return std::array<Runner, kPolicyCount>{&VirtualMachine::run<ExecutionPolicy<Masks>>...};
+  }(std::make_index_sequence<kPolicyCount>{});
+
+  // 分片执行需要逐条计数, 并在检查点判断分片是否用完
+  const bool sliced = slice != std::numeric_limits<std::uint64_t>::max();
+  std::size_t mask = 0;
+  mask |= options_.trace_vm ? kTraceBit : 0;
+  mask |= profiler_ != nullptr ? kProfileBit : 0;
+  mask |= options_.enable_bounds_check ? kCheckBit : 0;
+  mask |= options_.count_instructions || options_.instruction_limit > 0 || sliced ? kCountBit : 0;
+  mask |= options_.time_limit.count() > 0 || options_.instruction_limit > 0 || sliced ? kLimitBit
+                                                                                        : 0;
+  const std::uint64_t slice_end = slice > std::numeric_limits<std::uint64_t>::max() - result_.instructions
+                                      ? std::numeric_limits<std::uint64_t>::max()
+                                      : result_.instructions + slice;
+  result_.status = Result::Status::Finished;
+  (this->*runners[mask])(packed_, slice_end);
+  if (!result_.success) {
+    result_.status = Result::Status::Failed;
+  }
+  return result_;
+}
+
+// 函数: 执行指令序列, 结果与进度保存在 result_ 中; 分片用完时在检查点挂起
+template <typename Policy>
+void VirtualMachine::run(const PackedProgram& program, std::uint64_t slice_end) {
+  Result& result = result_;
+  const PackedSequence& code = program.code;
 
   auto ensure_capacity = [&](int index) {
     if (index >= static_cast<int>(stack_.size())) {
-      stack_.resize(static_cast<std::size_t>(index) + 1024, 0);
+      grow(static_cast<std::size_t>(index) + 1);
     }
   };
 
+  // 检查策略下, 变量与间接访问必须落在已分配的栈内 [0, stack_top_)
+  auto in_bounds = [&](std::int64_t address) {
+    if (address >= 0 && address < stack_top_) {
+      return true;
+    }
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::RuntimeError,
+                         "memory access out of bounds at " + std::to_string(address), {}});
+    result.success = false;
+    return false;
+  };
+
+  // 限额策略下只在回跳与调用处检查, 直线代码长度有限, 不会绕过检查;
+  // 指令预算与分片每个检查点都比较, 墙钟时间每 kLimitCheckInterval 个检查点才读取一次.
+  // 检查点位于跳转/调用完成之后, 挂起时的状态可直接续跑
+  const auto slice_start = std::chrono::steady_clock::now();
+  const auto deadline = slice_start + (options_.time_limit - elapsed_);
+  std::uint32_t limit_countdown = kLimitCheckInterval;
+  auto suspend = [&] {
+    elapsed_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - slice_start);
+    result.status = Result::Status::Suspended;
+  };
+  [[maybe_unused]] auto limit_reached = [&] {
+    if (options_.instruction_limit > 0 && result.instructions > options_.instruction_limit) {
+      diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InstructionLimitExceeded,
+                           "instruction limit of " + std::to_string(options_.instruction_limit) +
+                               " exceeded",
+                           {}});
+      result.success = false;
+      return true;
+    }
+    if (options_.time_limit.count() > 0 && --limit_countdown == 0) {
+      limit_countdown = kLimitCheckInterval;
+      if (std::chrono::steady_clock::now() >= deadline) {
+        diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::TimeLimitExceeded,
+                             "time limit of " + std::to_string(options_.time_limit.count()) +
+                                 " ms exceeded",
+                             {}});
+        result.success = false;
+        return true;
+      }
+    }
+    if (result.instructions >= slice_end) {
+      suspend();
+      return true;
+    }
+    return false;
+  };
+
   try {
     while (program_counter_ >= 0 &&
            program_counter_ < static_cast<int>(code.size())) {
-      const Instruction instr =
-          code[static_cast<std::size_t>(program_counter_++)];
+      const PackedInstruction instr = code[static_cast<std::size_t>(program_counter_++)];
 
-      if (options_.trace_vm) {
-        std::cout << program_counter_ - 1 << ": " << to_string(instr) << '\n';
+      if constexpr (Policy::count) {
+        ++result.instructions;
+      }
+      if constexpr (Policy::profile) {
+        profiler_->on_instruction(program_counter_ - 1);
+      }
+      if constexpr (Policy::trace) {
+        *output_ << program_counter_ - 1 << ": "
+                 << to_string(unpack_instruction(program, static_cast<std::size_t>(program_counter_ - 1)))
+                 << '\n';
       }
 
-      switch (instr.op) {
+      switch (instr.op()) {
       case Op::LIT:
         push(instr.argument);
         break;
+      case Op::LDC:
+        push(program.constants[static_cast<std::size_t>(instr.argument)]);
+        break;
       case Op::OPR: {
         auto operation = static_cast<Opr>(instr.argument);
         switch (operation) {
-          case Opr::RET: {
+          case Opr::RET:
+          case Opr::RETV: {
+            // 返回时连同调用者压入的层次字段个实参一起弹出, RETV 再压回返回值
+            std::int64_t value = operation == Opr::RETV ? pop() : 0;
+            if constexpr (Policy::profile) {
+              profiler_->on_return();
+            }
             int old_base = base_pointer_;
             int return_addr = static_cast<int>(at(base_pointer_ + 2));
             base_pointer_ = static_cast<int>(at(base_pointer_ + 1));
-            stack_top_ = old_base;
+            stack_top_ = old_base - instr.level();
             program_counter_ = return_addr;
+            if (operation == Opr::RETV) {
+              push(value);
+            }
             if (base_pointer_ == 0 && program_counter_ == 0) {
-              return result;
+              return;
             }
             break;
           }
@@ -93,7 +267,7 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
               diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::DivisionByZero,
                                    "division by zero", {}});
               result.success = false;
-              return result;
+              return;
             }
             auto lhs = pop();
             push(lhs / rhs);
@@ -111,7 +285,7 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
               diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::DivisionByZero,
                                    "modulo by zero", {}});
               result.success = false;
-              return result;
+              return;
             }
             auto lhs = pop();
             push(lhs % rhs);
@@ -156,17 +330,27 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
           }
           case Opr::WRITE: {
             auto value = pop();
-            std::cout << value;
+            *output_ << value;
             result.last_value = value;
             break;
           }
           case Opr::WRITELN: {
-            std::cout << '\n';
+            *output_ << '\n';
             break;
           }
           case Opr::READ: {
+            // 热启动: 停在 READ 之前, 续跑时重新执行这条指令
+            if (pause_before_read_) {
+              pause_before_read_ = false;
+              --program_counter_;
+              if constexpr (Policy::count) {
+                --result.instructions;
+              }
+              suspend();
+              return;
+            }
             std::int64_t value = 0;
-            std::cin >> value;
+            *input_ >> value;
             push(value);
             break;
           }
@@ -191,47 +375,96 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
         break;
       }
       case Op::LOD: {
-        ensure_capacity(base(instr.level, base_pointer_) + instr.argument + 1);
-        push(at(base(instr.level, base_pointer_) + instr.argument));
+        int address = base(instr.level(), base_pointer_) + instr.argument;
+        if constexpr (Policy::check) {
+          if (!in_bounds(address)) {
+            return;
+          }
+        }
+        ensure_capacity(address + 1);
+        push(at(address));
         break;
       }
       case Op::STO: {
         auto value = pop();
-        ensure_capacity(base(instr.level, base_pointer_) + instr.argument + 1);
-        at(base(instr.level, base_pointer_) + instr.argument) = value;
+        int address = base(instr.level(), base_pointer_) + instr.argument;
+        if constexpr (Policy::check) {
+          if (!in_bounds(address)) {
+            return;
+          }
+        }
+        ensure_capacity(address + 1);
+        at(address) = value;
         break;
       }
       case Op::CAL: {
         ensure_capacity(stack_top_ + 3);
-        at(stack_top_) = base(instr.level, base_pointer_);
+        at(stack_top_) = base(instr.level(), base_pointer_);
         at(stack_top_ + 1) = base_pointer_;
         at(stack_top_ + 2) = program_counter_;
         base_pointer_ = stack_top_;
         program_counter_ = instr.argument;
+        if constexpr (Policy::profile) {
+          profiler_->on_call(instr.argument);
+        }
+        if constexpr (Policy::limit) {
+          if (limit_reached()) {
+            return;
+          }
+        }
+        break;
+      }
+      case Op::TCL: {
+        // 尾调用: 复用当前帧, 保留动态链与返回地址, 仅重设静态链
+        at(base_pointer_) = base(instr.level(), base_pointer_);
+        stack_top_ = base_pointer_ + 3;
+        program_counter_ = instr.argument;
+        if constexpr (Policy::profile) {
+          profiler_->on_tail_call(instr.argument);
+        }
+        if constexpr (Policy::limit) {
+          if (limit_reached()) {
+            return;
+          }
+        }
         break;
       }
       case Op::INT: {
         ensure_capacity(stack_top_ + instr.argument);
-        for (int i = 0; i < instr.argument; ++i) {
-          at(stack_top_ + i) = 0;
+        // 帧头 (静态链/动态链/返回地址) 由 CAL 写入, 不能被清零
+        for (int i = std::max(stack_top_, base_pointer_ + 3);
+             i < stack_top_ + instr.argument; ++i) {
+          at(i) = 0;
         }
         stack_top_ += instr.argument;
         break;
       }
       case Op::JMP: {
+        const bool backward = instr.argument < program_counter_;
         program_counter_ = instr.argument;
+        if constexpr (Policy::limit) {
+          if (backward && limit_reached()) {
+            return;
+          }
+        }
         break;
       }
       case Op::JPC: {
         auto value = pop();
         if (value == 0) {
+          const bool backward = instr.argument < program_counter_;
           program_counter_ = instr.argument;
+          if constexpr (Policy::limit) {
+            if (backward && limit_reached()) {
+              return;
+            }
+          }
         }
         break;
       }
       case Op::LDA: {
-        ensure_capacity(base(instr.level, base_pointer_) + instr.argument + 1);
-        push(base(instr.level, base_pointer_) + instr.argument);
+        ensure_capacity(base(instr.level(), base_pointer_) + instr.argument + 1);
+        push(base(instr.level(), base_pointer_) + instr.argument);
         break;
       }
       case Op::IDX: {
@@ -242,6 +475,11 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
       }
       case Op::LDI: {
         auto address = pop();
+        if constexpr (Policy::check) {
+          if (!in_bounds(address)) {
+            return;
+          }
+        }
         ensure_capacity(static_cast<int>(address) + 1);
         push(at(static_cast<int>(address)));
         break;
@@ -249,6 +487,11 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
       case Op::STI: {
         auto value = pop();
         auto address = pop();
+        if constexpr (Policy::check) {
+          if (!in_bounds(address)) {
+            return;
+          }
+        }
         ensure_capacity(static_cast<int>(address) + 1);
         at(static_cast<int>(address)) = value;
         break;
@@ -259,7 +502,7 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
           diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::InvalidArraySubscript,
                                "array index out of bounds", {}});
           result.success = false;
-          return result;
+          return;
         }
         push(index);
         break;
@@ -269,7 +512,7 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
           diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::StackUnderflow,
                                "stack underflow on dup", {}});
           result.success = false;
-          return result;
+          return;
         }
         auto value = at(stack_top_ - 1);
         push(value);
@@ -279,19 +522,144 @@ VirtualMachine::Result VirtualMachine::execute(const InstructionSequence& code)
         break;
       }
     }
+  } catch (const StackLimitExceeded& ex) {
+    diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::StackLimitExceeded, ex.what(), {}});
+    result.success = false;
   } catch (const std::exception& ex) {
     diagnostics_.report({DiagnosticLevel::Error, DiagnosticCode::RuntimeError,
                          ex.what(), {}});
     result.success = false;
   }
+}
 
-  return result;
+// 函数: 程序指纹, 快照只能恢复到同一程序上
+std::uint64_t VirtualMachine::fingerprint(const InstructionSequence& code) {
+  ByteWriter writer;
+  writer.put(static_cast<std::uint64_t>(code.size()));
+  for (const auto& instr : code) {
+    writer.put(static_cast<std::uint8_t>(instr.op));
+    writer.put(static_cast<std::int32_t>(instr.level));
+    writer.put(static_cast<std::int64_t>(instr.argument));
+  }
+  return fnv1a(kFnvOffset, writer.bytes());
+}
+
+// 函数: 写出快照; 栈单元以 zigzag 变长整数编码, 大量的零与小整数各占一个字节
+void VirtualMachine::save_snapshot(std::ostream& out) const {
+  if (code_ == nullptr) {
+    throw std::logic_error("save_snapshot() called before start()");
+  }
+  ByteWriter writer;
+  writer.put_raw(kSnapshotMagic, sizeof(kSnapshotMagic));
+  writer.put(kSnapshotVersion);
+  writer.put(fingerprint(*code_));
+  writer.put(static_cast<std::int32_t>(program_counter_));
+  writer.put(static_cast<std::int32_t>(base_pointer_));
+  writer.put(static_cast<std::int32_t>(stack_top_));
+  writer.put(static_cast<std::uint8_t>(result_.status));
+  writer.put(static_cast<std::uint8_t>(result_.success ? 1 : 0));
+  writer.put(result_.last_value);
+  writer.put(result_.instructions);
+  writer.put(static_cast<std::int64_t>(elapsed_.count()));
+  // CAL 写入的帧头在下一条 INT 之前位于栈顶之上, 在调用处挂起时也须保存
+  const auto cells = static_cast<std::size_t>(std::max(stack_top_, base_pointer_ + kFrameHeader));
+  for (std::size_t i = 0; i < cells; ++i) {
+    const auto value = i < stack_.size() ? stack_[i] : 0;
+    auto zigzag = (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+      writer.put(static_cast<std::uint8_t>(zigzag | 0x80));
+      zigzag >>= 7;
+    }
+    writer.put(static_cast<std::uint8_t>(zigzag));
+  }
+  const auto& bytes = writer.bytes();
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+  if (!out) {
+    throw std::runtime_error("failed to write VM snapshot");
+  }
+}
+
+// 函数: 读取快照并替换当前状态, 校验失败时保持原状态不变
+void VirtualMachine::restore_snapshot(std::istream& in, const InstructionSequence& code) {
+  const std::string bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  ByteReader reader(bytes);
+  if (!reader.expect_raw(kSnapshotMagic, sizeof(kSnapshotMagic)) ||
+      reader.get<std::uint32_t>() != kSnapshotVersion) {
+    throw std::runtime_error("not a VM snapshot or unsupported snapshot version");
+  }
+  if (reader.get<std::uint64_t>() != fingerprint(code)) {
+    throw std::runtime_error("VM snapshot was taken from a different program");
+  }
+  const auto program_counter = reader.get<std::int32_t>();
+  const auto base_pointer = reader.get<std::int32_t>();
+  const auto stack_top = reader.get<std::int32_t>();
+  const auto status = reader.get<std::uint8_t>();
+  const auto success = reader.get<std::uint8_t>();
+  Result result;
+  result.last_value = reader.get<std::int64_t>();
+  result.instructions = reader.get<std::uint64_t>();
+  const auto elapsed = reader.get<std::int64_t>();
+  // 当前帧不能在栈顶之上 (CAL 之后、INT 之前两者相等), 帧头单元随栈一起保存
+  if (!reader.ok() || program_counter < 0 ||
+      program_counter > static_cast<std::int32_t>(code.size()) || base_pointer < 0 ||
+      stack_top < 0 || base_pointer > stack_top ||
+      status > static_cast<std::uint8_t>(Result::Status::Failed)) {
+    throw std::runtime_error("corrupt VM snapshot");
+  }
+  const auto cells = static_cast<std::size_t>(
+      std::max<std::int64_t>(stack_top, std::int64_t{base_pointer} + kFrameHeader));
+  if (reader.remaining() < cells) {
+    throw std::runtime_error("corrupt VM snapshot");
+  }
+  std::vector<std::int64_t> stack(std::max(kInitialStackSize, cells + 1024), 0);
+  for (std::size_t i = 0; i < cells; ++i) {
+    std::uint64_t zigzag = 0;
+    for (int shift = 0;; shift += 7) {
+      const auto byte = reader.get<std::uint8_t>();
+      if (!reader.ok() || shift > 63) {
+        throw std::runtime_error("corrupt VM snapshot");
+      }
+      zigzag |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    stack[i] = static_cast<std::int64_t>(zigzag >> 1) ^ -static_cast<std::int64_t>(zigzag & 1);
+  }
+  if (!reader.at_end()) {
+    throw std::runtime_error("corrupt VM snapshot");
+  }
+  auto packed = pack_instructions(code);
+
+  result.status = static_cast<Result::Status>(status);
+  result.success = success != 0;
+  code_ = &code;
+  packed_ = std::move(packed);
+  result_ = result;
+  elapsed_ = std::chrono::nanoseconds(elapsed);
+  stack_ = std::move(stack);
+  stack_top_ = stack_top;
+  base_pointer_ = base_pointer;
+  program_counter_ = program_counter;
+}
+
+// 函数: 扩展运行栈, 多留 1024 个单元减少扩容次数, 但不越过上限
+void VirtualMachine::grow(std::size_t cells) {
+  const auto limit = options_.stack_limit;
+  if (limit > 0 && cells > limit) {
+    throw StackLimitExceeded("stack limit of " + std::to_string(limit) + " cells exceeded");
+  }
+  auto size = cells + 1024;
+  if (limit > 0) {
+    size = std::min(size, limit);
+  }
+  stack_.resize(size, 0);
 }
 
 // 函数: 向栈压入一个值
 void VirtualMachine::push(std::int64_t value) {
   if (stack_top_ >= static_cast<int>(stack_.size())) {
-    stack_.resize(static_cast<std::size_t>(stack_top_) + 1024, 0);
+    grow(static_cast<std::size_t>(stack_top_) + 1);
   }
   stack_[static_cast<std::size_t>(stack_top_++)] = value;
 }
@@ -310,7 +678,7 @@ std::int64_t& VirtualMachine::at(int index) {
     throw std::runtime_error("negative stack access");
   }
   if (index >= static_cast<int>(stack_.size())) {
-    stack_.resize(static_cast<std::size_t>(index) + 1024, 0);
+    grow(static_cast<std::size_t>(index) + 1);
   }
   return stack_[static_cast<std::size_t>(index)];
 }
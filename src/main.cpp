@@ -1,5 +1,8 @@
 // 文件: main.cpp
 // 功能: 实现 CLI 前端命令分发
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <optional>
@@ -8,9 +11,12 @@
 #include <vector>
 
 #include "pl0/Driver.hpp"
+#include "pl0/Server.hpp"
+#include "pl0/Utility.hpp"
 
 namespace {
 
+using pl0::CompileCache;
 using pl0::CompileResult;
 using pl0::CompilerOptions;
 using pl0::DiagnosticSink;
@@ -19,6 +25,7 @@ using pl0::InstructionSequence;
 using pl0::RunnerOptions;
 using pl0::compile_file;
 using pl0::load_pcode_file;
+using pl0::parse_limit_option;
 using pl0::print_diagnostics;
 using pl0::run_instructions;
 using pl0::save_pcode_file;
@@ -26,10 +33,13 @@ using pl0::save_pcode_file;
 // 函数: 打印命令行用法
 void print_usage() {
   std::cout << "Usage:\n"
-            << "  pl0 compile <input.pl0> [-o out.pcode] [--dump-tokens --dump-ast --dump-sym --dump-pcode --bounds-check]\n"
-            << "  pl0 run <input.pcode> [--trace-vm]\n"
+            << "  pl0 compile <input.pl0> [-o out.pcode] [-j N] [--dump-tokens --dump-ast --dump-sym --dump-pcode --dump-ir --bounds-check -O --no-cache]\n"
+            << "  pl0 run <input.pcode> [--trace-vm] [--bounds-check] [--profile [--profile-out out.folded]]\n"
+            << "                        [--max-instructions N] [--time-limit ms]\n"
             << "  pl0 disasm <input.pcode>\n"
-            << "  pl0 <input.pl0> [--trace-vm --bounds-check] [--dump-tokens --dump-ast --dump-sym --dump-pcode]\n";
+            << "  pl0 serve [--socket path] [-j N] [--timeout ms] [--no-cache]\n"
+            << "  pl0 <input.pl0> [--trace-vm --bounds-check -O --no-cache] [--dump-tokens --dump-ast --dump-sym --dump-pcode --dump-ir]\n"
+            << "                  [--profile [--profile-out out.folded]] [--max-instructions N] [--time-limit ms]\n";
 }
 
 // 函数: 根据输入推导默认输出文件
@@ -39,6 +49,53 @@ std::filesystem::path default_output(const std::filesystem::path& input) {
   return output;
 }
 
+// 结构: 剖析相关的命令行选项
+struct ProfileOptions {
+  bool enabled = false;
+  std::optional<std::filesystem::path> output;
+};
+
+// 函数: 解析剖析选项, 返回是否消费了参数
+bool parse_profile_option(std::span<const std::string> args, std::size_t& i,
+                          ProfileOptions& profile) {
+  if (args[i] == "--profile") {
+    profile.enabled = true;
+    return true;
+  }
+  if (args[i] == "--profile-out" && i + 1 < args.size()) {
+    profile.enabled = true;
+    profile.output = std::filesystem::path(args[++i]);
+    return true;
+  }
+  return false;
+}
+
+// 函数: 按需挂接剖析器执行程序, 结束后输出报告与折叠栈
+int run_with_profile(const InstructionSequence& code, const std::vector<pl0::Symbol>& symbols,
+                     const RunnerOptions& runner_options, const ProfileOptions& profile,
+                     const std::filesystem::path& input_path) {
+  DiagnosticSink diagnostics;
+  pl0::Profiler profiler;
+  profiler.name_procedures(symbols);
+  auto result = run_instructions(code, diagnostics, runner_options,
+                                 profile.enabled ? &profiler : nullptr);
+  if (profile.enabled) {
+    auto folded = input_path;
+    try {
+      pl0::write_profile(profiler, std::cerr,
+                         profile.output.value_or(folded.replace_extension(".folded")));
+    } catch (const std::exception& ex) {
+      std::cerr << ex.what() << '\n';
+      return 1;
+    }
+  }
+  if (diagnostics.has_errors()) {
+    print_diagnostics(diagnostics, std::cerr);
+    return 1;
+  }
+  return result.success ? 0 : 1;
+}
+
 // 函数: 处理 compile 子命令
 int handle_compile_command(std::span<const std::string> args) {
   if (args.empty()) {
@@ -48,6 +105,7 @@ int handle_compile_command(std::span<const std::string> args) {
 
   CompilerOptions compiler_options;
   DumpOptions dumps;
+  bool use_cache = true;
   std::optional<std::filesystem::path> output_path;
   std::filesystem::path input_path;
 
@@ -55,6 +113,13 @@ int handle_compile_command(std::span<const std::string> args) {
     const auto& arg = args[i];
     if (arg == "-o" && i + 1 < args.size()) {
       output_path = std::filesystem::path(args[++i]);
+    } else if (arg == "-j" && i + 1 < args.size()) {
+      auto threads = pl0::parse_unsigned(args[++i]);
+      if (!threads) {
+        std::cerr << "Invalid value for -j: " << args[i] << '\n';
+        return 1;
+      }
+      compiler_options.threads = static_cast<std::size_t>(*threads);
     } else if (arg == "--dump-tokens") {
       dumps.tokens = true;
     } else if (arg == "--dump-ast") {
@@ -63,6 +128,12 @@ int handle_compile_command(std::span<const std::string> args) {
       dumps.symbols = true;
     } else if (arg == "--dump-pcode") {
       dumps.pcode = true;
+    } else if (arg == "--dump-ir") {
+      dumps.ir = true;
+    } else if (arg == "-O" || arg == "--optimize") {
+      compiler_options.optimize = true;
+    } else if (arg == "--no-cache") {
+      use_cache = false;
     } else if (arg == "--bounds-check") {
       compiler_options.enable_bounds_check = true;
     } else if (!arg.empty() && arg[0] == '-') {
@@ -87,8 +158,10 @@ int handle_compile_command(std::span<const std::string> args) {
 
   DiagnosticSink diagnostics;
   CompileResult result;
+  CompileCache cache(CompileCache::default_directory());
   try {
-    result = compile_file(input_path, compiler_options, dumps, diagnostics, std::cout);
+    result = compile_file(input_path, compiler_options, dumps, diagnostics, std::cout,
+                          use_cache ? &cache : nullptr);
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << '\n';
     return 1;
@@ -116,12 +189,22 @@ int handle_run_command(std::span<const std::string> args) {
   }
 
   RunnerOptions runner_options;
+  ProfileOptions profile;
+  bool valid_limits = true;
   std::filesystem::path input_path;
 
   for (std::size_t i = 0; i < args.size(); ++i) {
     const auto& arg = args[i];
     if (arg == "--trace-vm") {
       runner_options.trace_vm = true;
+    } else if (arg == "--bounds-check") {
+      runner_options.enable_bounds_check = true;
+    } else if (parse_profile_option(args, i, profile)) {
+      continue;
+    } else if (parse_limit_option(args, i, runner_options, valid_limits, std::cerr)) {
+      if (!valid_limits) {
+        return 1;
+      }
     } else if (!arg.empty() && arg[0] == '-') {
       std::cerr << "Unknown option: " << arg << '\n';
       return 1;
@@ -146,13 +229,7 @@ int handle_run_command(std::span<const std::string> args) {
     return 1;
   }
 
-  DiagnosticSink diagnostics;
-  auto result = run_instructions(code, diagnostics, runner_options);
-  if (diagnostics.has_errors()) {
-    print_diagnostics(diagnostics, std::cerr);
-    return 1;
-  }
-  return result.success ? 0 : 1;
+  return run_with_profile(code, {}, runner_options, profile, input_path);
 }
 
 // 函数: 处理 disasm 子命令
@@ -174,6 +251,48 @@ int handle_disasm_command(std::span<const std::string> args) {
   return 0;
 }
 
+// 函数: 处理 serve 子命令, 默认经标准输入输出收发 JSON Lines 请求
+int handle_serve_command(std::span<const std::string> args) {
+  pl0::ServerOptions options;
+  std::optional<std::filesystem::path> socket_path;
+  bool use_cache = true;
+
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto& arg = args[i];
+    if (arg == "--socket" && i + 1 < args.size()) {
+      socket_path = std::filesystem::path(args[++i]);
+    } else if ((arg == "-j" || arg == "--timeout") && i + 1 < args.size()) {
+      auto value = pl0::parse_unsigned(args[++i]);
+      if (!value) {
+        std::cerr << "Invalid value for " << arg << ": " << args[i] << '\n';
+        return 1;
+      }
+      if (arg == "-j") {
+        options.workers = static_cast<std::size_t>(*value);
+      } else {
+        options.default_timeout = std::chrono::milliseconds(*value);
+        options.max_timeout = std::max(options.max_timeout, options.default_timeout);
+      }
+    } else if (arg == "--no-cache") {
+      use_cache = false;
+    } else {
+      std::cerr << "Unknown option: " << arg << '\n';
+      return 1;
+    }
+  }
+
+  CompileCache cache(CompileCache::default_directory());
+  if (use_cache) {
+    options.cache = &cache;
+  }
+  pl0::Server server(options);
+  if (socket_path) {
+    return server.serve_unix_socket(*socket_path);
+  }
+  server.serve_stream(std::cin, std::cout);
+  return 0;
+}
+
 // 函数: 处理直接输入源文件的便捷模式
 int handle_default_pipeline(std::span<const std::string> args) {
   if (args.empty()) {
@@ -183,7 +302,10 @@ int handle_default_pipeline(std::span<const std::string> args) {
 
   CompilerOptions compiler_options;
   DumpOptions dumps;
+  bool use_cache = true;
   RunnerOptions runner_options;
+  ProfileOptions profile;
+  bool valid_limits = true;
   std::filesystem::path input_path;
 
   for (std::size_t i = 0; i < args.size(); ++i) {
@@ -196,11 +318,23 @@ int handle_default_pipeline(std::span<const std::string> args) {
       dumps.symbols = true;
     } else if (arg == "--dump-pcode") {
       dumps.pcode = true;
+    } else if (arg == "--dump-ir") {
+      dumps.ir = true;
+    } else if (arg == "-O" || arg == "--optimize") {
+      compiler_options.optimize = true;
+    } else if (arg == "--no-cache") {
+      use_cache = false;
     } else if (arg == "--trace-vm") {
       runner_options.trace_vm = true;
     } else if (arg == "--bounds-check") {
       compiler_options.enable_bounds_check = true;
       runner_options.enable_bounds_check = true;
+    } else if (parse_profile_option(args, i, profile)) {
+      continue;
+    } else if (parse_limit_option(args, i, runner_options, valid_limits, std::cerr)) {
+      if (!valid_limits) {
+        return 1;
+      }
     } else if (!arg.empty() && arg[0] == '-') {
       std::cerr << "Unknown option: " << arg << '\n';
       return 1;
@@ -219,8 +353,10 @@ int handle_default_pipeline(std::span<const std::string> args) {
 
   DiagnosticSink diagnostics;
   CompileResult result;
+  CompileCache cache(CompileCache::default_directory());
   try {
-    result = compile_file(input_path, compiler_options, dumps, diagnostics, std::cout);
+    result = compile_file(input_path, compiler_options, dumps, diagnostics, std::cout,
+                          use_cache ? &cache : nullptr);
   } catch (const std::exception& ex) {
     std::cerr << ex.what() << '\n';
     return 1;
@@ -231,12 +367,7 @@ int handle_default_pipeline(std::span<const std::string> args) {
     return 1;
   }
 
-  auto run_result = run_instructions(result.code, diagnostics, runner_options);
-  if (diagnostics.has_errors()) {
-    print_diagnostics(diagnostics, std::cerr);
-    return 1;
-  }
-  return run_result.success ? 0 : 1;
+  return run_with_profile(result.code, result.symbols, runner_options, profile, input_path);
 }
 
 }  // namespace
@@ -261,6 +392,9 @@ int main(int argc, char** argv) {
   if (command == "run") {
     return handle_run_command(std::span<const std::string>(args).subspan(1));
   }
+  if (command == "serve") {
+    return handle_serve_command(std::span<const std::string>(args).subspan(1));
+  }
   if (command == "disasm") {
     return handle_disasm_command(std::span<const std::string>(args).subspan(1));
   }
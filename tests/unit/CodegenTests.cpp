@@ -1,6 +1,41 @@
 #include "catch.hpp"
 
 #include "TestSupport.hpp"
+#include "pl0/Driver.hpp"
+#include "pl0/Generator.hpp"
+
+#include <sstream>
+#include <string>
+
+namespace {
+
+// 函数: 指令、符号与诊断展开成文本
+std::string compile_snapshot(const std::string& source, std::size_t threads) {
+  pl0::CompilerOptions options;
+  options.threads = threads;
+  pl0::DiagnosticSink diagnostics;
+  const auto result = pl0::compile_source_text("test.pl0", source, options, diagnostics, nullptr);
+  std::ostringstream out;
+  pl0::print_diagnostics(diagnostics, out);
+  pl0::serialize_instructions(result.code, out);
+  for (const auto& symbol : result.symbols) {
+    out << '\n' << symbol.name << ' ' << static_cast<int>(symbol.kind) << ' ' << symbol.level
+        << ' ' << symbol.address << ' ' << symbol.size;
+  }
+  return out.str();
+}
+
+// 函数: 在第 occurrence 处出现的 from 替换为 to
+std::string replace_nth(std::string text, const std::string& from, const std::string& to,
+                        int occurrence) {
+  std::size_t offset = text.find(from);
+  for (int i = 0; i < occurrence && offset != std::string::npos; ++i) {
+    offset = text.find(from, offset + 1);
+  }
+  return offset == std::string::npos ? text : text.replace(offset, from.size(), to);
+}
+
+}  // namespace
 
 TEST_CASE("Code generator emits write instruction") {
   pl0::DiagnosticSink diagnostics;
@@ -129,3 +164,84 @@ TEST_CASE("Compound assignments map to arithmetic operators") {
   REQUIRE(saw_div);
   REQUIRE(saw_mod);
 }
+
+TEST_CASE("Arguments are pushed in order and popped by the callee's return") {
+  pl0::DiagnosticSink diagnostics;
+  pl0::CompilerOptions options;
+  auto instructions = pl0::test::compile_source(
+      "var r; function sub(a, b); begin sub := a - b end; begin r := sub(7, 2) end.",
+      options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  bool found_call = false;
+  bool found_retv = false;
+  for (std::size_t i = 0; i < instructions.size(); ++i) {
+    const auto& instr = instructions[i];
+    if (instr.op == pl0::Op::CAL) {
+      found_call = true;
+      REQUIRE(i >= 2);
+      REQUIRE(instructions[i - 2].argument == 7);
+      REQUIRE(instructions[i - 1].argument == 2);
+    }
+    if (instr.op == pl0::Op::LOD && instr.level == 0) {
+      REQUIRE((instr.argument == -2 || instr.argument == -1 || instr.argument == 3));
+    }
+    if (instr.op == pl0::Op::OPR && instr.argument == static_cast<int>(pl0::Opr::RETV)) {
+      found_retv = true;
+      REQUIRE(instr.level == 2);
+    }
+  }
+  REQUIRE(found_call);
+  REQUIRE(found_retv);
+}
+
+TEST_CASE("Call argument count must match the declaration") {
+  pl0::DiagnosticSink diagnostics;
+  pl0::CompilerOptions options;
+  pl0::test::compile_source("procedure p(a); begin end; begin call p(1, 2) end.", options,
+                            diagnostics);
+  REQUIRE(diagnostics.has_errors());
+}
+
+TEST_CASE("Fragments relocate local targets and resolve procedure calls") {
+  pl0::CodeFragment fragment;
+  fragment.code = {{pl0::Op::JMP, 0, 2}, {pl0::Op::CAL, 1, 0}, {pl0::Op::CAL, 0, 0},
+                   {pl0::Op::OPR, 0, static_cast<int>(pl0::Opr::RET)}};
+  fragment.relocations = {{pl0::Relocation::Kind::Local, 0},
+                          {pl0::Relocation::Kind::Procedure, 1},
+                          {pl0::Relocation::Kind::Local, 2}};
+  pl0::Symbol nested;
+  nested.kind = pl0::SymbolKind::Procedure;
+  nested.address = 2;
+  fragment.symbols.push_back(nested);
+
+  pl0::InstructionSequence output(5);
+  std::vector<pl0::Symbol> symbols;
+  REQUIRE(pl0::link_fragment(fragment, {1}, output, symbols) == 5);
+  REQUIRE(output.size() == 9);
+  REQUIRE(output[5].argument == 7);
+  REQUIRE(output[6].argument == 1);
+  REQUIRE(output[7].argument == 5);
+  REQUIRE(symbols.size() == 1);
+  REQUIRE(symbols[0].address == 7);
+}
+
+TEST_CASE("Parallel code generation matches sequential output") {
+  pl0::GeneratorOptions generator;
+  generator.procedures = 240;
+  generator.array_size = 10;
+  const std::string source = pl0::generate_program(generator).source;
+  const auto expected = compile_snapshot(source, 1);
+  REQUIRE(expected.find("error") == std::string::npos);
+  REQUIRE(compile_snapshot(source, 4) == expected);
+
+  // 语义错误分散在各个片段中, 诊断顺序须与逐个生成相同
+  std::string broken = replace_nth(source, "call p3_0;", "call p200_0;", 0);
+  broken = replace_nth(broken, "checksum :=", "nosuch :=", 17);
+  broken = replace_nth(broken, "checksum :=", "modulus :=", 120);
+  broken = replace_nth(broken, "procedure p9_0;", "procedure p8_0;", 0);
+  broken = replace_nth(broken, "call p1_1", "call p1_1(1)", 0);
+  const auto broken_expected = compile_snapshot(broken, 1);
+  REQUIRE(broken_expected.find("error") != std::string::npos);
+  REQUIRE(compile_snapshot(broken, 4) == broken_expected);
+}
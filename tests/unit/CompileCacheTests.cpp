@@ -0,0 +1,88 @@
+#include "catch.hpp"
+
+#include "pl0/CompileCache.hpp"
+#include "pl0/Driver.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+std::filesystem::path fresh_directory(const std::string& name) {
+  auto directory = std::filesystem::temp_directory_path() / name;
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  return directory;
+}
+
+void write_source(const std::filesystem::path& path, const std::string& source) {
+  std::ofstream out(path);
+  out << source;
+}
+
+}  // namespace
+
+TEST_CASE("Compile cache serves repeated compilations of the same source") {
+  auto directory = fresh_directory("pl0_cache_hit_test");
+  auto input = directory / "prog.pl0";
+  write_source(input, "procedure p; begin write(1) end; begin call p end.");
+  pl0::CompileCache cache(directory / "cache");
+  pl0::CompilerOptions options;
+  pl0::DumpOptions dumps;
+  std::ostringstream dump;
+
+  pl0::DiagnosticSink first_diagnostics;
+  auto first = pl0::compile_file(input, options, dumps, first_diagnostics, dump, &cache);
+  REQUIRE(!first_diagnostics.has_errors());
+  REQUIRE(first.program != nullptr);
+
+  pl0::DiagnosticSink second_diagnostics;
+  auto second = pl0::compile_file(input, options, dumps, second_diagnostics, dump, &cache);
+  REQUIRE(!second_diagnostics.has_errors());
+  REQUIRE(second.program == nullptr);
+  REQUIRE(second.code.size() == first.code.size());
+  for (std::size_t i = 0; i < first.code.size(); ++i) {
+    REQUIRE(second.code[i].op == first.code[i].op);
+    REQUIRE(second.code[i].level == first.code[i].level);
+    REQUIRE(second.code[i].argument == first.code[i].argument);
+  }
+  REQUIRE(second.symbols.size() == first.symbols.size());
+  REQUIRE(second.symbols.front().name == first.symbols.front().name);
+
+  // 编译选项或源码不同则不能命中
+  options.optimize = true;
+  pl0::DiagnosticSink optimized_diagnostics;
+  auto optimized = pl0::compile_file(input, options, dumps, optimized_diagnostics, dump, &cache);
+  REQUIRE(optimized.program != nullptr);
+  REQUIRE(pl0::CompileCache::make_key("begin end.", options) !=
+          pl0::CompileCache::make_key("begin  end.", options));
+
+  std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("Compile cache evicts least recently used entries and drops corrupt ones") {
+  auto directory = fresh_directory("pl0_cache_evict_test");
+  pl0::InstructionSequence code(64, pl0::Instruction{pl0::Op::NOP, 0, 0});
+  // 每个条目约 600 字节, 上限只容得下两个
+  pl0::CompileCache cache(directory, 1400);
+  cache.store(1, code, {});
+  cache.store(2, code, {});
+  REQUIRE(cache.load(1).has_value());  // 刷新 1, 使 2 成为最久未用
+  std::filesystem::last_write_time(directory / "0000000000000002.pl0c",
+                                   std::filesystem::file_time_type::clock::now() -
+                                       std::chrono::hours(1));
+  cache.store(3, code, {});
+  REQUIRE(cache.load(1).has_value());
+  REQUIRE(!cache.load(2).has_value());
+  REQUIRE(cache.load(3).has_value());
+
+  {
+    std::ofstream corrupt(directory / "0000000000000003.pl0c", std::ios::trunc);
+    corrupt << "garbage";
+  }
+  REQUIRE(!cache.load(3).has_value());
+  REQUIRE(!std::filesystem::exists(directory / "0000000000000003.pl0c"));
+
+  std::filesystem::remove_all(directory);
+}
@@ -0,0 +1,52 @@
+#include "catch.hpp"
+
+#include "TestSupport.hpp"
+#include "pl0/Driver.hpp"
+#include "pl0/Generator.hpp"
+
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::string run_generated(const std::string& source, bool optimize) {
+  pl0::CompilerOptions compiler_options;
+  compiler_options.optimize = optimize;
+  pl0::DiagnosticSink diagnostics;
+  auto compiled = pl0::compile_source_text("<generated>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream capture;
+  auto result = pl0::run_instructions(compiled.code, diagnostics, runner_options, std::cin, capture);
+  REQUIRE(result.success);
+  return capture.str();
+}
+
+}  // namespace
+
+TEST_CASE("Generated programs compile and print their expected checksum") {
+  pl0::GeneratorOptions options;
+  options.procedures = 12;
+  options.depth = 5;
+  options.array_size = 500;
+  options.expression_terms = 20;
+  for (std::uint32_t seed : {1U, 2U, 3U}) {
+    options.seed = seed;
+    auto program = pl0::generate_program(options);
+    REQUIRE(run_generated(program.source, false) == program.expected_output);
+    REQUIRE(run_generated(program.source, true) == program.expected_output);
+  }
+}
+
+TEST_CASE("Program generator is deterministic for a given seed") {
+  pl0::GeneratorOptions options;
+  options.procedures = 10;
+  auto first = pl0::generate_program(options);
+  auto second = pl0::generate_program(options);
+  REQUIRE(first.source == second.source);
+  REQUIRE(first.expected_output == second.expected_output);
+
+  options.seed = 99;
+  REQUIRE(pl0::generate_program(options).source != first.source);
+}
@@ -0,0 +1,148 @@
+#include "catch.hpp"
+
+#include "TestSupport.hpp"
+#include "pl0/Incremental.hpp"
+
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char* const kProgram =
+    "var x, y, a[4];\n"
+    "procedure p;\n"
+    "  var t;\n"
+    "begin\n"
+    "  x := 1;\n"
+    "  if x > 0 then y := x + 2 else y := 0;\n"
+    "  while y < 10 do begin y += 1; write(y) end\n"
+    "end;\n"
+    "function f(n);\n"
+    "begin\n"
+    "  /* 返回平方 */ f := n * n\n"
+    "end;\n"
+    "begin\n"
+    "  call p;\n"
+    "  repeat x := f(x) until x > 100;\n"
+    "  writeln(a[1])\n"
+    "end.\n";
+
+// 函数: 把增量状态完整展开为文本, 便于与整体解析逐字比较
+std::string snapshot(const pl0::IncrementalParser& parser) {
+  std::ostringstream out;
+  for (const auto& token : parser.tokens()) {
+    out << static_cast<int>(token.kind) << ' ' << token.lexeme << ' ';
+    pl0::test::dump_range(token.range, out);
+    out << '\n';
+  }
+  for (const auto& diagnostic : parser.diagnostics()) {
+    out << diagnostic << '\n';
+  }
+  pl0::test::dump_block(parser.program()->block, out);
+  return out.str();
+}
+
+std::string full_snapshot(const std::string& source) {
+  pl0::IncrementalParser fresh;
+  fresh.reset(source);
+  return snapshot(fresh);
+}
+
+}  // namespace
+
+TEST_CASE("Incremental parser reparses only the edited statement") {
+  pl0::IncrementalParser parser;
+  parser.reset(kProgram);
+  REQUIRE(parser.diagnostics().empty());
+  const auto* untouched = parser.program()->block.procedures[1].body->statements.front().get();
+
+  std::string source = kProgram;
+  const std::size_t offset = source.find("x := 1;") + 5;
+  const auto& stats = parser.apply({offset, 1, "42"});
+  REQUIRE(!stats.full_reparse);
+  REQUIRE(stats.relexed_tokens <= 2);
+  REQUIRE(stats.reparsed_tokens > 0);
+  REQUIRE(stats.reparsed_tokens < parser.tokens().size() / 4);
+  REQUIRE(parser.program()->block.procedures[1].body->statements.front().get() == untouched);
+
+  source.replace(offset, 1, "42");
+  REQUIRE(parser.source() == source);
+  REQUIRE(snapshot(parser) == full_snapshot(source));
+}
+
+TEST_CASE("Incremental parser tracks line shifts and new diagnostics") {
+  pl0::IncrementalParser parser;
+  parser.reset(kProgram);
+  std::string source = kProgram;
+
+  // 插入多行文本后, 其后所有位置整体下移
+  source.insert(source.find("  x := 1;"), "  y := 3;\n  x := y;\n");
+  parser.update(source);
+  REQUIRE(!parser.stats().full_reparse);
+  REQUIRE(snapshot(parser) == full_snapshot(source));
+
+  // 引入语法错误后诊断随之出现, 修正后消失
+  const std::size_t offset = source.find("y := 3");
+  source.replace(offset, 6, "y := ");
+  parser.update(source);
+  REQUIRE(!parser.diagnostics().empty());
+  REQUIRE(snapshot(parser) == full_snapshot(source));
+  source.replace(offset, 5, "y := 3");
+  parser.update(source);
+  REQUIRE(parser.diagnostics().empty());
+  REQUIRE(snapshot(parser) == full_snapshot(source));
+
+  // 未闭合的注释一直影响到文件末尾, 只能整体重解析
+  source.insert(source.find("call p"), "/* ");
+  parser.update(source);
+  REQUIRE(parser.stats().full_reparse);
+  REQUIRE(snapshot(parser) == full_snapshot(source));
+}
+
+TEST_CASE("Incremental parser matches a full parse after random edits") {
+  const char* const snippets[] = {" ",     "x",   "1",     ";",  "+ 2", "begin ", "end",
+                                  "/*",    "*/",  "(",     ")",  ":=",  "\n",     "write(y); ",
+                                  "if x then ", "procedure r; ", "var", "#", "99999999999999999999"};
+  std::mt19937 random(20240611);
+  pl0::IncrementalParser parser;
+  parser.reset(kProgram);
+  std::string source = kProgram;
+  std::size_t partial = 0;
+  for (int step = 0; step < 400; ++step) {
+    // 每隔一段时间恢复原文, 避免源码退化成一片错误
+    if (step % 40 == 0) {
+      source = kProgram;
+      parser.update(source);
+    }
+    const std::size_t offset = random() % (source.size() + 1);
+    pl0::TextEdit edit;
+    edit.offset = offset;
+    if (random() % 3 == 0) {
+      edit.removed = std::min<std::size_t>(random() % 6, source.size() - offset);
+    } else {
+      edit.inserted = snippets[random() % std::size(snippets)];
+    }
+    parser.apply(edit);
+    source.replace(edit.offset, edit.removed, edit.inserted);
+    REQUIRE(parser.source() == source);
+    REQUIRE(snapshot(parser) == full_snapshot(source));
+    partial += parser.stats().full_reparse ? 0 : 1;
+  }
+  // 大多数编辑应当只重解析局部
+  REQUIRE(partial > 200);
+}
+
+TEST_CASE("Incremental parser rejects edits outside the source") {
+  pl0::IncrementalParser parser;
+  parser.reset("begin end.");
+  bool threw = false;
+  try {
+    parser.apply({5, 20, ""});
+  } catch (const std::out_of_range&) {
+    threw = true;
+  }
+  REQUIRE(threw);
+  REQUIRE(parser.update("begin end.").relexed_tokens == 0);
+}
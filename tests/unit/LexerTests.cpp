@@ -1,6 +1,34 @@
 #include "catch.hpp"
 
 #include "pl0/Lexer.hpp"
+#include "pl0/SourceBuffer.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+std::vector<std::string> lex_all(pl0::Lexer& lexer) {
+  std::vector<std::string> lexemes;
+  while (true) {
+    auto token = lexer.next();
+    if (token.kind == pl0::TokenKind::EndOfFile) {
+      return lexemes;
+    }
+    lexemes.push_back(token.lexeme);
+  }
+}
+
+}  // namespace
 
 TEST_CASE("Lexer tokenizes keywords, identifiers, and numbers") {
   pl0::DiagnosticSink diagnostics;
@@ -83,3 +111,61 @@ TEST_CASE("Lexer recognizes compound assignment operators") {
   REQUIRE(lexer.next().kind == pl0::TokenKind::MinusMinus);
   REQUIRE(lexer.next().kind == pl0::TokenKind::Semicolon);
 }
+
+TEST_CASE("Lexer scans mapped files without copying them") {
+  const auto directory = std::filesystem::temp_directory_path() / "pl0_source_buffer_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  const std::string text = "var x;\nbegin x := 7; /* 注释 */ write(x) end.\n";
+  {
+    std::ofstream out(directory / "prog.pl0", std::ios::binary);
+    out << text;
+  }
+  std::ofstream(directory / "empty.pl0").close();
+
+  auto buffer = pl0::SourceBuffer::open(directory / "prog.pl0");
+  REQUIRE(buffer.mapped());
+  REQUIRE(buffer.view() == text);
+  pl0::DiagnosticSink diagnostics;
+  pl0::Lexer mapped(buffer, diagnostics);
+  pl0::Lexer copied(text, diagnostics);
+  REQUIRE(lex_all(mapped) == lex_all(copied));
+
+  // 移动后视图仍然有效, 短字符串也不例外
+  auto moved = std::move(buffer);
+  REQUIRE(moved.view() == text);
+  auto small = pl0::SourceBuffer::from_string("x");
+  auto small_moved = std::move(small);
+  REQUIRE(small_moved.view() == "x");
+
+  auto empty = pl0::SourceBuffer::open(directory / "empty.pl0");
+  REQUIRE(!empty.mapped());
+  REQUIRE(empty.size() == 0);
+
+  bool threw = false;
+  try {
+    (void)pl0::SourceBuffer::open(directory / "missing.pl0");
+  } catch (const std::runtime_error&) {
+    threw = true;
+  }
+  REQUIRE(threw);
+
+#if defined(__unix__) || defined(__APPLE__)
+  // 管道不能映射, 分块读入; 内容超过一个读块以覆盖缓冲增长
+  const auto fifo = directory / "pipe.pl0";
+  REQUIRE(::mkfifo(fifo.c_str(), 0600) == 0);
+  std::string piped;
+  for (int i = 0; i < 20000; ++i) {
+    piped += "x := x + 1;\n";
+  }
+  std::thread writer([&] {
+    std::ofstream out(fifo, std::ios::binary);
+    out << piped;
+  });
+  auto streamed = pl0::SourceBuffer::open(fifo);
+  writer.join();
+  REQUIRE(!streamed.mapped());
+  REQUIRE(streamed.view() == piped);
+#endif
+  std::filesystem::remove_all(directory);
+}
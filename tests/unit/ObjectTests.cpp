@@ -0,0 +1,125 @@
+#include "catch.hpp"
+
+#include "pl0/Driver.hpp"
+#include "pl0/Object.hpp"
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kMainSource =
+    "extern var total, table[4];\n"
+    "extern procedure add(n);\n"
+    "extern function square(n);\n"
+    "var i;\n"
+    "procedure show; begin write(total) end;\n"
+    "begin\n"
+    "  i := 0;\n"
+    "  while i < 4 do begin table[i] := square(i); call add(table[i]); i := i + 1 end;\n"
+    "  call show\n"
+    "end.\n";
+
+const char* const kLibrarySource =
+    "var total, table[4];\n"
+    "procedure add(n); begin total := total + n end;\n"
+    "function square(n); begin square := n * n end;\n"
+    "begin end.\n";
+
+pl0::ObjectModule compile_module(const std::string& name, const std::string& source,
+                                 pl0::DiagnosticSink& diagnostics) {
+  pl0::CompilerOptions options;
+  return pl0::compile_object(name, pl0::SourceBuffer(std::string_view(source)), options,
+                             diagnostics);
+}
+
+// 函数: 链接并运行, 返回输出; 链接失败时返回全部诊断
+std::string link_and_run(const std::vector<std::string>& sources) {
+  pl0::DiagnosticSink diagnostics;
+  std::vector<pl0::ObjectModule> modules;
+  for (std::size_t i = 0; i < sources.size(); ++i) {
+    modules.push_back(compile_module("m" + std::to_string(i), sources[i], diagnostics));
+  }
+  REQUIRE(!diagnostics.has_errors());
+  const auto linked = pl0::link_objects(modules, diagnostics);
+  std::ostringstream out;
+  if (diagnostics.has_errors()) {
+    pl0::print_diagnostics(diagnostics, out);
+    return out.str();
+  }
+  pl0::RunnerOptions runner_options;
+  const auto result = pl0::run_instructions(linked.code, diagnostics, runner_options, std::cin, out);
+  REQUIRE(result.success);
+  return out.str();
+}
+
+}  // namespace
+
+TEST_CASE("Linked modules share globals, procedures and functions") {
+  REQUIRE(link_and_run({kMainSource, kLibrarySource}) == "14");
+
+  // 库在前时只有首个模块的主程序运行, 库的全局区移到入口模块之后
+  const std::string driver =
+      "extern var total; extern procedure add(n); var pad[3];\n"
+      "begin pad[2] := 5; call add(pad[2]); call add(2); write(total); write(pad[2]) end.\n";
+  REQUIRE(link_and_run({driver, kLibrarySource}) == "75");
+}
+
+TEST_CASE("Linker reports unresolved and conflicting symbols") {
+  const auto undefined = link_and_run({kMainSource});
+  REQUIRE(undefined.find("undefined reference to 'total'") != std::string::npos);
+  REQUIRE(undefined.find("undefined reference to 'square'") != std::string::npos);
+
+  const auto duplicate = link_and_run({kMainSource, kLibrarySource, "var total; begin end."});
+  REQUIRE(duplicate.find("duplicate definition of 'total'") != std::string::npos);
+
+  const auto arity = link_and_run(
+      {"extern procedure add(a, b); begin call add(1, 2) end.", kLibrarySource});
+  REQUIRE(arity.find("declared extern with 2 parameter(s)") != std::string::npos);
+
+  const auto kind = link_and_run({"extern var add; begin add := 1 end.", kLibrarySource});
+  REQUIRE(kind.find("as a variable but defined as a procedure") != std::string::npos);
+
+  const auto body = link_and_run({kMainSource, "var total, table[4]; begin total := 1 end."});
+  REQUIRE(body.find("only the first module may have a main program") != std::string::npos);
+}
+
+TEST_CASE("Extern declarations require separate compilation at program level") {
+  pl0::DiagnosticSink whole;
+  pl0::CompilerOptions options;
+  pl0::compile_source_text("main.pl0", std::string(kMainSource), options, whole, nullptr);
+  REQUIRE(whole.has_errors());
+
+  pl0::DiagnosticSink nested;
+  compile_module("nested.pl0", "procedure p; extern var x; begin end; begin end.", nested);
+  REQUIRE(nested.has_errors());
+
+  pl0::DiagnosticSink redeclared;
+  compile_module("dup.pl0", "extern var x; var x; begin end.", redeclared);
+  REQUIRE(redeclared.has_errors());
+}
+
+TEST_CASE("Object modules round-trip through the binary encoding") {
+  pl0::DiagnosticSink diagnostics;
+  const auto module = compile_module("main.pl0", kMainSource, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(module.imports.size() == 4);
+  REQUIRE(module.exports.size() == 2);
+
+  const auto bytes = pl0::encode_object(module);
+  const auto decoded = pl0::decode_object(bytes);
+  REQUIRE(pl0::encode_object(decoded) == bytes);
+  REQUIRE(decoded.name == "main.pl0");
+  REQUIRE(decoded.relocations.size() == module.relocations.size());
+
+  bool rejected = false;
+  try {
+    pl0::decode_object(bytes.substr(0, bytes.size() - 1));
+  } catch (const std::runtime_error&) {
+    rejected = true;
+  }
+  REQUIRE(rejected);
+}
@@ -0,0 +1,212 @@
+#include "catch.hpp"
+
+#include "TestSupport.hpp"
+#include "pl0/Driver.hpp"
+#include "pl0/IR.hpp"
+#include "pl0/Optimizer.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string run_and_capture(const pl0::InstructionSequence& code) {
+  pl0::DiagnosticSink diagnostics;
+  pl0::RunnerOptions runner_options;
+  std::ostringstream capture;
+  auto result = pl0::run_instructions(code, diagnostics, runner_options, std::cin, capture);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(result.success);
+  return capture.str();
+}
+
+bool contains_op(const pl0::InstructionSequence& code, pl0::Op op, std::int32_t argument) {
+  return std::any_of(code.begin(), code.end(), [&](const pl0::Instruction& instr) {
+    return instr.op == op && instr.argument == argument;
+  });
+}
+
+}  // namespace
+
+TEST_CASE("Optimizer folds constant branches and removes dead stores") {
+  const char* source =
+      "const k = 3; var a, c;"
+      "begin a := k * 2 + 0; c := 10; c := 11; if 1 = 2 then write(777); write(a, c) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source(source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  std::string expected = run_and_capture(code);
+
+  std::vector<pl0::Symbol> symbols;
+  REQUIRE(pl0::optimize_program(code, symbols));
+  REQUIRE(run_and_capture(code) == expected);
+  REQUIRE(!contains_op(code, pl0::Op::LIT, 777));
+  REQUIRE(!contains_op(code, pl0::Op::LIT, 10));
+  REQUIRE(!contains_op(code, pl0::Op::OPR, static_cast<std::int32_t>(pl0::Opr::MUL)));
+}
+
+TEST_CASE("Optimizer strips procedures that are never called") {
+  const char* source =
+      "var x;"
+      "procedure unused; begin x := 99 end;"
+      "procedure inc; begin x := x + 1 end;"
+      "begin x := 5; call inc; write(x) end.";
+  pl0::CompilerOptions compiler_options;
+  compiler_options.optimize = true;
+  pl0::DiagnosticSink diagnostics;
+  auto result = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(result.code) == "6");
+  REQUIRE(!contains_op(result.code, pl0::Op::LIT, 99));
+
+  REQUIRE(std::none_of(result.symbols.begin(), result.symbols.end(),
+                       [](const pl0::Symbol& symbol) { return symbol.name == "unused"; }));
+}
+
+TEST_CASE("Optimized programs keep loop and recursion semantics") {
+  const char* source =
+      "var n, acc, i, a[5];"
+      "procedure fact; begin if n > 1 then begin acc := acc * n; n := n - 1; call fact end end;"
+      "begin"
+      "  n := 5; acc := 1; call fact; write(acc);"
+      "  i := 0; while i < 5 do begin a[i] := i * i; i := i + 1 end;"
+      "  repeat i := i - 1; write(a[i]) until i = 0"
+      "end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto plain = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  compiler_options.optimize = true;
+  auto optimized = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(optimized.code) == run_and_capture(plain.code));
+}
+
+TEST_CASE("IR printer names functions from the symbol table") {
+  const char* source = "var x; procedure p; begin x := 1 end; begin call p end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto result = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  auto module = pl0::ir::build_module(result.code);
+  REQUIRE(module.has_value());
+  pl0::ir::assign_names(*module, result.symbols);
+  std::ostringstream out;
+  pl0::ir::print_module(*module, out);
+  REQUIRE(out.str().find("function p") != std::string::npos);
+  REQUIRE(out.str().find("cal 0 @p") != std::string::npos);
+}
+
+TEST_CASE("Inliner splices nested non-recursive procedures into callers") {
+  const char* source =
+      "var g, r;"
+      "procedure outer; var x, y;"
+      "  procedure inner; var z; begin z := x * 2; y := z + g end;"
+      "begin x := g; call inner; r := y end;"
+      "begin g := 1; while g < 60 do begin call outer; write(r); g := g * 3 end end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto plain = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  compiler_options.optimize = true;
+  auto optimized = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(optimized.code) == run_and_capture(plain.code));
+  REQUIRE(std::none_of(optimized.code.begin(), optimized.code.end(),
+                       [](const pl0::Instruction& instr) { return instr.op == pl0::Op::CAL; }));
+}
+
+TEST_CASE("Inliner keeps calls to recursive procedures") {
+  const char* source =
+      "var n;"
+      "procedure down; begin if n > 0 then begin n := n - 1; call down end end;"
+      "begin n := 4; call down; write(n) end.";
+  pl0::CompilerOptions compiler_options;
+  compiler_options.optimize = true;
+  pl0::DiagnosticSink diagnostics;
+  auto result = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(result.code) == "0");
+  REQUIRE(std::any_of(result.code.begin(), result.code.end(),
+                      [](const pl0::Instruction& instr) { return instr.op == pl0::Op::CAL; }));
+}
+
+TEST_CASE("Self-recursive tail calls become loops") {
+  const char* source =
+      "var n, acc;"
+      "procedure fact; begin if n > 1 then begin acc := acc * n; n := n - 1; call fact end end;"
+      "begin n := 10; acc := 1; call fact; write(acc) end.";
+  pl0::CompilerOptions compiler_options;
+  compiler_options.optimize = true;
+  pl0::DiagnosticSink diagnostics;
+  auto result = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(result.code) == "3628800");
+  auto calls = std::count_if(result.code.begin(), result.code.end(),
+                             [](const pl0::Instruction& instr) { return instr.op == pl0::Op::CAL; });
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("Tail calls to enclosing-scope procedures reuse the frame") {
+  const char* source =
+      "var n, acc;"
+      "procedure count;"
+      "  procedure step; begin acc := acc + 1; n := n - 1; call count end;"
+      "begin if n > 0 then call step end;"
+      "begin n := 5000; call count; write(acc) end.";
+  pl0::CompilerOptions compiler_options;
+  compiler_options.optimize = true;
+  pl0::DiagnosticSink diagnostics;
+  auto result = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(result.code) == "5000");
+  REQUIRE(std::any_of(result.code.begin(), result.code.end(),
+                      [](const pl0::Instruction& instr) { return instr.op == pl0::Op::TCL; }));
+}
+
+TEST_CASE("Functions with parameters are inlined and tail-recursive ones become loops") {
+  const char* source =
+      "function square(x); begin square := x * x end;"
+      "function fact(n, acc); begin if n <= 1 then fact := acc else fact := fact(n - 1, acc * n) end;"
+      "begin write(square(7)); write(fact(10, 1)) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto plain = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  compiler_options.optimize = true;
+  auto optimized = pl0::compile_source_text("<test>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(run_and_capture(optimized.code) == run_and_capture(plain.code));
+  REQUIRE(contains_op(optimized.code, pl0::Op::LIT, 49));
+  auto calls = std::count_if(optimized.code.begin(), optimized.code.end(),
+                             [](const pl0::Instruction& instr) { return instr.op == pl0::Op::CAL; });
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("Optimizer handles long single-block programs in linear time") {
+  // 每条语句都让栈序模拟降级一次; 从头重做的模拟在这里是平方级的
+  std::string straight = "var a[4], x; begin x := 1;";
+  for (int i = 0; i < 8000; ++i) {
+    straight += " a[x] := a[x] + 1;";
+  }
+  straight += " write(a[1]) end.";
+
+  std::string nested = "x";
+  for (int i = 0; i < 4000; ++i) {
+    nested = "a[" + nested + "]";
+  }
+  nested = "var a[4], x; begin x := 0; a[0] := 0; write(" + nested + ") end.";
+
+  for (const auto& source : {straight, nested}) {
+    pl0::CompilerOptions compiler_options;
+    pl0::DiagnosticSink diagnostics;
+    auto plain = pl0::compile_source_text("<plain>", source, compiler_options, diagnostics);
+    compiler_options.optimize = true;
+    auto optimized = pl0::compile_source_text("<optimized>", source, compiler_options, diagnostics);
+    REQUIRE(!diagnostics.has_errors());
+    REQUIRE(run_and_capture(optimized.code) == run_and_capture(plain.code));
+  }
+}
@@ -0,0 +1,122 @@
+#include "catch.hpp"
+
+#include "TestSupport.hpp"
+#include "pl0/Driver.hpp"
+#include "pl0/Generator.hpp"
+#include "pl0/Lexer.hpp"
+#include "pl0/PCode.hpp"
+#include "pl0/ParallelParser.hpp"
+#include "pl0/Parser.hpp"
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<pl0::Token> scan(const std::string& source) {
+  pl0::DiagnosticSink sink;
+  pl0::Lexer lexer(source, sink);
+  std::vector<pl0::Token> tokens;
+  do {
+    tokens.push_back(lexer.next());
+  } while (tokens.back().kind != pl0::TokenKind::EndOfFile);
+  return tokens;
+}
+
+// 函数: 解析结果与诊断展开成文本, threads 为 1 时即顺序解析
+std::string parse_snapshot(const std::vector<pl0::Token>& tokens, std::size_t threads) {
+  pl0::DiagnosticSink diagnostics;
+  auto program = pl0::parse_program_parallel(tokens, diagnostics, threads);
+  std::ostringstream out;
+  for (const auto& diagnostic : diagnostics.diagnostics()) {
+    out << diagnostic << '\n';
+  }
+  if (program) {
+    pl0::test::dump_block(program->block, out);
+  }
+  return out.str();
+}
+
+std::string generated_source(int procedures, int terms = 8) {
+  pl0::GeneratorOptions options;
+  options.procedures = procedures;
+  options.depth = 3;
+  options.array_size = 10;
+  options.expression_terms = terms;
+  return pl0::generate_program(options).source;
+}
+
+}  // namespace
+
+TEST_CASE("Parallel parser finds top-level procedures") {
+  const auto tokens = scan(generated_source(12));
+  const auto starts = pl0::find_top_level_procedures(tokens);
+  REQUIRE(starts.size() == 12);
+  for (const auto start : starts) {
+    REQUIRE(tokens[start].kind == pl0::TokenKind::Procedure);
+  }
+
+  // 过程体只有一条语句时无法配对, 后续过程不再视为顶层, 只是少了并行机会
+  const auto plain = scan("procedure p; x := 1; procedure q; begin end; begin end.");
+  REQUIRE(pl0::find_top_level_procedures(plain).size() == 1);
+  REQUIRE(parse_snapshot(plain, 4) == parse_snapshot(plain, 1));
+}
+
+TEST_CASE("Parallel parser matches a sequential parse") {
+  const auto tokens = scan(generated_source(40));
+  const auto expected = parse_snapshot(tokens, 1);
+  REQUIRE(expected.find("error") == std::string::npos);
+  REQUIRE(parse_snapshot(tokens, 4) == expected);
+  REQUIRE(parse_snapshot(tokens, 0) == expected);
+}
+
+TEST_CASE("Parallel parser reports syntax errors in sequential order") {
+  const std::string source = generated_source(30);
+  const char* const damage[] = {"", ";", ")", "begin ", "end; ", "procedure ", ":= +", "1"};
+  std::mt19937 random(4711);
+  for (int round = 0; round < 60; ++round) {
+    std::string broken = source;
+    for (int edit = 0; edit < 3; ++edit) {
+      const std::size_t offset = random() % broken.size();
+      broken.replace(offset, random() % 4, damage[random() % std::size(damage)]);
+    }
+    const auto tokens = scan(broken);
+    REQUIRE(parse_snapshot(tokens, 3) == parse_snapshot(tokens, 1));
+  }
+}
+
+TEST_CASE("Driver parses large programs in parallel with identical results") {
+  const std::string source = generated_source(240, 24);
+  REQUIRE(source.size() >= (1u << 18));
+  pl0::CompilerOptions sequential;
+  pl0::CompilerOptions parallel;
+  parallel.threads = 4;
+  pl0::DiagnosticSink first;
+  pl0::DiagnosticSink second;
+  const auto expected = pl0::compile_source_text("big.pl0", source, sequential, first, nullptr);
+  const auto actual = pl0::compile_source_text("big.pl0", source, parallel, second, nullptr);
+  REQUIRE(!first.has_errors());
+  REQUIRE(!second.has_errors());
+  std::ostringstream expected_code;
+  std::ostringstream actual_code;
+  pl0::serialize_instructions(expected.code, expected_code);
+  pl0::serialize_instructions(actual.code, actual_code);
+  REQUIRE(actual_code.str() == expected_code.str());
+  REQUIRE(actual.tokens.size() == expected.tokens.size());
+
+  // 含非法字符时退回边扫描边解析, 诊断顺序不变
+  const std::string broken = source.substr(0, source.size() / 2) + "?" +
+                             source.substr(source.size() / 2);
+  pl0::DiagnosticSink third;
+  pl0::DiagnosticSink fourth;
+  pl0::compile_source_text("broken.pl0", broken, sequential, third, nullptr);
+  pl0::compile_source_text("broken.pl0", broken, parallel, fourth, nullptr);
+  std::ostringstream lhs;
+  std::ostringstream rhs;
+  pl0::print_diagnostics(third, lhs);
+  pl0::print_diagnostics(fourth, rhs);
+  REQUIRE(!third.diagnostics().empty());
+  REQUIRE(lhs.str() == rhs.str());
+}
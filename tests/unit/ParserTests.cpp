@@ -1,8 +1,13 @@
 #include "catch.hpp"
 
+#include "pl0/Driver.hpp"
 #include "pl0/Lexer.hpp"
 #include "pl0/Parser.hpp"
 
+#include <sstream>
+#include <string>
+#include <utility>
+
 TEST_CASE("Parser handles if-then-else statements") {
   const char* source = "if x then write(1) else write(0).";
   pl0::DiagnosticSink diagnostics;
@@ -72,3 +77,117 @@ TEST_CASE("Parser handles compound assignments and increments") {
     REQUIRE(literal->value == expected_values[i]);
   }
 }
+
+TEST_CASE("Parser records procedure and function parameters") {
+  const char* source =
+      "procedure p(a, b); begin end;"
+      "function f(n); begin f := n end;"
+      "begin call p(1, f(2)) end.";
+  pl0::DiagnosticSink diagnostics;
+  pl0::Lexer lexer(source, diagnostics);
+  pl0::Parser parser(lexer, diagnostics);
+
+  auto program = parser.parse_program();
+  REQUIRE(program != nullptr);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(program->block.procedures.size() == 2);
+  REQUIRE(!program->block.procedures[0].is_function);
+  REQUIRE(program->block.procedures[0].parameters.size() == 2);
+  REQUIRE(program->block.procedures[1].is_function);
+  REQUIRE(program->block.procedures[1].parameters.front().name == "n");
+}
+
+TEST_CASE("Parser recovers from missing operands in expressions") {
+  const char* source = "var x; begin x := ) + 1; x := 2 * ; x := - end.";
+  pl0::DiagnosticSink diagnostics;
+  pl0::Lexer lexer(source, diagnostics);
+  pl0::Parser parser(lexer, diagnostics);
+
+  auto program = parser.parse_program();
+  REQUIRE(program != nullptr);
+  REQUIRE(diagnostics.has_errors());
+}
+
+TEST_CASE("Parser handles very long and deeply parenthesized expressions") {
+  // 左结合长链与深层括号都不占用调用栈; 左侧括号使求值栈深度保持常数
+  constexpr int kTerms = 100000;
+  std::string chain = "var x; begin x := 0";
+  for (int i = 0; i < kTerms; ++i) {
+    chain += " + 1";
+  }
+  chain += "; write(x) end.";
+
+  constexpr int kDepth = 20000;
+  std::string nested = "begin write(" + std::string(kDepth, '(') + "0";
+  for (int i = 0; i < kDepth; ++i) {
+    nested += " - 1)";
+  }
+  nested += ") end.";
+
+  for (const auto& [source, expected] : {std::pair{chain, std::to_string(kTerms)},
+                                         std::pair{nested, std::to_string(-kDepth)}}) {
+    pl0::DiagnosticSink diagnostics;
+    pl0::CompilerOptions options;
+    auto result = pl0::compile_source_text("deep.pl0", source, options, diagnostics);
+    REQUIRE(!diagnostics.has_errors());
+    REQUIRE(result.program != nullptr);
+
+    std::istringstream input;
+    std::ostringstream output;
+    pl0::RunnerOptions runner_options;
+    REQUIRE(pl0::run_instructions(result.code, diagnostics, runner_options, input, output).success);
+    REQUIRE(output.str() == expected);
+  }
+}
+
+TEST_CASE("Parser rejects statements nested beyond the limit") {
+  const auto nested_blocks = [](std::size_t depth) {
+    std::string source;
+    for (std::size_t i = 0; i < depth; ++i) {
+      source += "begin ";
+    }
+    source += "write(1)";
+    for (std::size_t i = 0; i < depth; ++i) {
+      source += " end";
+    }
+    return source + ".";
+  };
+  const auto count_nesting = [](const pl0::DiagnosticSink& diagnostics) {
+    std::size_t count = 0;
+    for (const auto& diagnostic : diagnostics.diagnostics()) {
+      count += diagnostic.code == pl0::DiagnosticCode::NestingTooDeep ? 1 : 0;
+    }
+    return count;
+  };
+
+  pl0::CompilerOptions options;
+  options.max_nesting = 64;
+
+  // 最内层的 write 也算一层
+  pl0::DiagnosticSink within;
+  pl0::compile_source_text("ok.pl0", nested_blocks(63), options, within);
+  REQUIRE(!within.has_errors());
+
+  pl0::DiagnosticSink beyond;
+  auto result = pl0::compile_source_text("deep.pl0", nested_blocks(64), options, beyond);
+  REQUIRE(result.program == nullptr);
+  REQUIRE(count_nesting(beyond) == 1);
+
+  // 默认上限下远超限度的输入也只报告一次, 不会耗尽栈
+  pl0::DiagnosticSink defaults;
+  pl0::CompilerOptions default_options;
+  pl0::compile_source_text("deeper.pl0", nested_blocks(100000), default_options, defaults);
+  REQUIRE(count_nesting(defaults) == 1);
+
+  std::string procedures;
+  for (int i = 0; i < 100; ++i) {
+    procedures += "procedure p" + std::to_string(i) + "; ";
+  }
+  procedures += "begin end";
+  for (int i = 0; i < 100; ++i) {
+    procedures += "; begin end";
+  }
+  pl0::DiagnosticSink nested_procedures;
+  pl0::compile_source_text("procs.pl0", procedures + ".", options, nested_procedures);
+  REQUIRE(count_nesting(nested_procedures) == 1);
+}
@@ -0,0 +1,136 @@
+#include "catch.hpp"
+
+#include "TestSupport.hpp"
+#include "pl0/Driver.hpp"
+#include "pl0/Server.hpp"
+
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace {
+
+bool contains(const std::string& text, const std::string& needle) {
+  return text.find(needle) != std::string::npos;
+}
+
+}  // namespace
+
+TEST_CASE("Virtual machine stops at the time limit and writes to its own streams") {
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source("var x; begin read(x); write(x + 1); while 1 = 1 do x := x + 1 end.",
+                                        compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  runner_options.time_limit = std::chrono::milliseconds(20);
+  std::istringstream input("41");
+  std::ostringstream output;
+  pl0::VirtualMachine vm(diagnostics, runner_options);
+  vm.set_io(input, output);
+  auto result = vm.execute(code);
+  REQUIRE(!result.success);
+  REQUIRE(output.str() == "42");
+  REQUIRE(diagnostics.has_errors());
+  REQUIRE(diagnostics.diagnostics().back().code == pl0::DiagnosticCode::TimeLimitExceeded);
+}
+
+TEST_CASE("Server compiles and runs requests") {
+  pl0::Server server({});
+
+  auto compiled = server.handle(R"({"id":1,"op":"compile","source":"begin write(6 * 7) end.","optimize":true})");
+  REQUIRE(contains(compiled, R"("id":1,"ok":true)"));
+  REQUIRE(contains(compiled, R"("pcode":")"));
+
+  auto ran = server.handle(
+      R"({"id":"a","op":"run","source":"var x; begin read(x); write(x * 2) end.","input":"21"})");
+  REQUIRE(contains(ran, R"("id":"a","ok":true,"status":"finished","output":"42")"));
+
+  auto failed = server.handle(R"({"id":2,"op":"compile","source":"begin x := 1 end."})");
+  REQUIRE(contains(failed, R"("ok":false)"));
+  REQUIRE(!contains(failed, R"("diagnostics":[])"));
+}
+
+TEST_CASE("Server runs precompiled pcode and enforces timeouts") {
+  pl0::Server server({});
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source("begin while 1 = 1 do ; end.", compiler_options, diagnostics);
+  std::ostringstream pcode;
+  pl0::serialize_instructions(code, pcode);
+
+  std::string escaped;
+  for (char ch : pcode.str()) {
+    escaped += ch == '\n' ? std::string("\\n") : std::string(1, ch);
+  }
+  auto response = server.handle(R"({"id":3,"op":"run","timeout_ms":20,"pcode":")" + escaped + "\"}");
+  REQUIRE(contains(response, R"("id":3,"ok":false,"status":"timeout")"));
+}
+
+TEST_CASE("Server bounds request size and program memory") {
+  pl0::ServerOptions options;
+  options.max_source_bytes = 256;
+  options.max_optimize_bytes = 64;
+  options.stack_limit = 4096;
+  pl0::Server server(options);
+
+  const std::string padded = "begin write(1)" + std::string(300, ' ') + "end.";
+  REQUIRE(contains(server.handle(R"({"id":1,"op":"compile","source":")" + padded + "\"}"),
+                   R"("id":1,"ok":false,"error":"request exceeds the limit of 256 bytes")"));
+
+  const std::string medium = "begin write(1)" + std::string(100, ' ') + "end.";
+  REQUIRE(contains(
+      server.handle(R"({"id":2,"op":"run","optimize":true,"source":")" + medium + "\"}"),
+      R"("id":2,"ok":false,"error":"optimize is limited)"));
+  REQUIRE(contains(server.handle(R"({"id":3,"op":"run","source":")" + medium + "\"}"),
+                   R"("status":"finished","output":"1")"));
+
+  auto huge = server.handle(
+      R"({"id":4,"op":"run","source":"var a[400000000]; begin a[0] := 1; write(a[0]) end."})");
+  REQUIRE(contains(huge, R"("id":4,"ok":false,"status":"stack_limit")"));
+  REQUIRE(contains(huge, "stack limit of 4096 cells exceeded"));
+}
+
+TEST_CASE("Server rejects malformed and unknown requests") {
+  pl0::Server server({});
+  REQUIRE(contains(server.handle("{\"id\":1,"), R"("id":null,"ok":false,"error":"malformed request)"));
+  REQUIRE(contains(server.handle(R"({"id":4,"op":"explode"})"), R"("id":4,"ok":false)"));
+  REQUIRE(contains(server.handle(R"({"id":5,"op":"run"})"), R"("id":5,"ok":false)"));
+
+  // id 原样回显, 不合 JSON 数字文法的 id 按请求格式错误处理
+  for (const char* id : {"-", "1e", "01", "1.", "+1", "1-2", "-.5"}) {
+    const auto response = server.handle(std::string(R"({"id":)") + id + R"(,"op":"ping"})");
+    REQUIRE(contains(response, R"("id":null,"ok":false,"error":"malformed request)"));
+  }
+  REQUIRE(server.handle(R"({"id":-0.5e+3,"op":"ping"})") == R"({"id":-0.5e+3,"ok":true})");
+}
+
+TEST_CASE("Server answers every line of a request stream") {
+  pl0::ServerOptions options;
+  options.workers = 3;
+  pl0::Server server(options);
+  std::string requests;
+  for (int i = 0; i < 8; ++i) {
+    requests += R"({"id":)" + std::to_string(i) + R"(,"op":"run","source":"begin write()" +
+                std::to_string(i) + R"() end."})" + "\n";
+  }
+  requests += "\n{\"op\":\"shutdown\"}\n";
+  requests += R"({"id":99,"op":"ping"})";
+  std::istringstream input(requests);
+  std::ostringstream output;
+  server.serve_stream(input, output);
+
+  std::istringstream lines(output.str());
+  std::set<std::string> seen;
+  std::string line;
+  while (std::getline(lines, line)) {
+    seen.insert(line);
+  }
+  for (int i = 0; i < 8; ++i) {
+    const auto index = std::to_string(i);
+    REQUIRE(seen.count(R"({"id":)" + index + R"(,"ok":true,"status":"finished","output":")" + index +
+                       R"(","diagnostics":[]})") == 1);
+  }
+  REQUIRE(!contains(output.str(), R"("id":99)"));
+}
@@ -1,12 +1,115 @@
 #include "TestSupport.hpp"
 
+#include <ostream>
 #include <string>
+#include <type_traits>
+#include <variant>
 
 #include "pl0/Lexer.hpp"
 #include "pl0/Parser.hpp"
 
 namespace pl0::test {
 
+void dump_range(const SourceRange& range, std::ostream& out) {
+  out << '@' << range.begin.line << ':' << range.begin.column << '-' << range.end.line << ':'
+      << range.end.column << ' ';
+}
+
+namespace {
+
+void dump_expression(const Expression& expr, std::ostream& out) {
+  dump_range(expr.range, out);
+  std::visit(
+      [&](const auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<T, NumberLiteral>) {
+          out << "num " << node.value;
+        } else if constexpr (std::is_same_v<T, BooleanLiteral>) {
+          out << "bool " << node.value;
+        } else if constexpr (std::is_same_v<T, IdentifierExpr>) {
+          out << "id " << node.name;
+        } else if constexpr (std::is_same_v<T, ArrayAccessExpr>) {
+          out << "index " << node.name << " (";
+          dump_expression(*node.index, out);
+          out << ')';
+        } else if constexpr (std::is_same_v<T, BinaryExpr>) {
+          out << "bin " << static_cast<int>(node.op) << " (";
+          dump_expression(*node.lhs, out);
+          out << ") (";
+          dump_expression(*node.rhs, out);
+          out << ')';
+        } else if constexpr (std::is_same_v<T, UnaryExpr>) {
+          out << "un " << static_cast<int>(node.op) << " (";
+          dump_expression(*node.operand, out);
+          out << ')';
+        } else if constexpr (std::is_same_v<T, CallExpr>) {
+          out << "call " << node.callee;
+          for (const auto& argument : node.arguments) {
+            out << " (";
+            dump_expression(*argument, out);
+            out << ')';
+          }
+        }
+      },
+      expr.value);
+}
+
+void dump_statement(const Statement& stmt, std::ostream& out) {
+  dump_range(stmt.range, out);
+  auto list = [&](const std::vector<StmtPtr>& statements) {
+    out << '{';
+    for (const auto& child : statements) {
+      dump_statement(*child, out);
+      out << ';';
+    }
+    out << '}';
+  };
+  std::visit(
+      [&](const auto& node) {
+        using T = std::decay_t<decltype(node)>;
+        if constexpr (std::is_same_v<T, AssignmentStmt>) {
+          out << "assign " << node.target << ' ' << static_cast<int>(node.op) << ' ';
+          if (node.index) {
+            dump_expression(*node.index, out);
+          }
+          dump_expression(*node.value, out);
+        } else if constexpr (std::is_same_v<T, CallStmt>) {
+          out << "call " << node.callee;
+          for (const auto& argument : node.arguments) {
+            dump_expression(*argument, out);
+          }
+        } else if constexpr (std::is_same_v<T, IfStmt>) {
+          out << "if ";
+          dump_expression(*node.condition, out);
+          list(node.then_branch);
+          list(node.else_branch);
+        } else if constexpr (std::is_same_v<T, WhileStmt>) {
+          out << "while ";
+          dump_expression(*node.condition, out);
+          list(node.body);
+        } else if constexpr (std::is_same_v<T, RepeatStmt>) {
+          out << "repeat ";
+          list(node.body);
+          dump_expression(*node.condition, out);
+        } else if constexpr (std::is_same_v<T, ReadStmt>) {
+          out << "read";
+          for (const auto& target : node.targets) {
+            out << ' ' << target;
+          }
+        } else if constexpr (std::is_same_v<T, WriteStmt>) {
+          out << (node.newline ? "writeln" : "write");
+          for (const auto& value : node.values) {
+            dump_expression(*value, out);
+          }
+        } else if constexpr (std::is_same_v<T, std::vector<StmtPtr>>) {
+          list(node);
+        }
+      },
+      stmt.value);
+}
+
+}  // namespace
+
 InstructionSequence compile_source(std::string_view source,
                                    const CompilerOptions& options,
                                    DiagnosticSink& diagnostics) {
@@ -29,4 +132,31 @@ InstructionSequence compile_source(std::string_view source,
 
 void initialize_environment() {}
 
+void dump_block(const Block& block, std::ostream& out) {
+  for (const auto& decl : block.consts) {
+    dump_range(decl.range, out);
+    out << "const " << decl.name << '=' << decl.value << '\n';
+  }
+  for (const auto& decl : block.vars) {
+    dump_range(decl.range, out);
+    out << "var " << decl.name << ' ' << decl.array_size.value_or(0) << '\n';
+  }
+  for (const auto& proc : block.procedures) {
+    dump_range(proc.range, out);
+    out << "proc " << proc.name << ' ' << proc.is_function;
+    for (const auto& param : proc.parameters) {
+      dump_range(param.range, out);
+      out << param.name;
+    }
+    out << "\n[";
+    dump_block(*proc.body, out);
+    out << "]\n";
+  }
+  for (const auto& stmt : block.statements) {
+    dump_statement(*stmt, out);
+    out << '\n';
+  }
+}
+
+
 }  // namespace pl0::test
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <ostream>
 #include <string_view>
 
+#include "pl0/AST.hpp"
 #include "pl0/Codegen.hpp"
 #include "pl0/Diagnostics.hpp"
 
@@ -13,5 +15,9 @@ InstructionSequence compile_source(std::string_view source,
 
 void initialize_environment();
 
+// 输出源码区间与带区间的 AST, 便于逐字比较两次解析的结果
+void dump_range(const SourceRange& range, std::ostream& out);
+void dump_block(const Block& block, std::ostream& out);
+
 }  // namespace pl0::test
 
@@ -0,0 +1,46 @@
+#include "catch.hpp"
+
+#include "pl0/ThreadPool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("Thread pool runs submitted and nested tasks to completion") {
+  pl0::ThreadPool pool(4);
+  std::atomic<int> total{0};
+  std::vector<int> slots(200, 0);
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    pool.submit([&, i] {
+      slots[i] = static_cast<int>(i);
+      // 工作线程内提交的任务进入自身队列, 可被其他线程窃取
+      pool.submit([&] { total.fetch_add(1); });
+    });
+  }
+  pool.wait();
+  REQUIRE(total.load() == 200);
+  for (std::size_t i = 0; i < slots.size(); ++i) {
+    REQUIRE(slots[i] == static_cast<int>(i));
+  }
+}
+
+TEST_CASE("Thread pool reports the first task exception from wait") {
+  pl0::ThreadPool pool(2);
+  std::atomic<int> finished{0};
+  pool.submit([] { throw std::runtime_error("task failed"); });
+  for (int i = 0; i < 10; ++i) {
+    pool.submit([&] { finished.fetch_add(1); });
+  }
+  bool thrown = false;
+  try {
+    pool.wait();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  REQUIRE(thrown);
+  REQUIRE(finished.load() == 10);
+
+  pool.submit([&] { finished.fetch_add(1); });
+  pool.wait();
+  REQUIRE(finished.load() == 11);
+}
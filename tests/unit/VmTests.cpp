@@ -2,9 +2,16 @@
 
 #include "TestSupport.hpp"
 #include "pl0/Driver.hpp"
+#include "pl0/Scheduler.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 TEST_CASE("Virtual machine executes program and produces expected output") {
   const char* source = "var x; begin x := 1; x := x + 2; write(x); end.";
@@ -15,9 +22,7 @@ TEST_CASE("Virtual machine executes program and produces expected output") {
 
   pl0::RunnerOptions runner_options;
   std::ostringstream capture;
-  auto* previous_buf = std::cout.rdbuf(capture.rdbuf());
-  auto result = pl0::run_instructions(instructions, diagnostics, runner_options);
-  std::cout.rdbuf(previous_buf);
+  auto result = pl0::run_instructions(instructions, diagnostics, runner_options, std::cin, capture);
   REQUIRE(!diagnostics.has_errors());
   REQUIRE(result.success);
   REQUIRE(result.last_value == 3);
@@ -34,11 +39,415 @@ TEST_CASE("Virtual machine handles compound assignments and increments") {
 
   pl0::RunnerOptions runner_options;
   std::ostringstream capture;
-  auto* previous_buf = std::cout.rdbuf(capture.rdbuf());
-  auto result = pl0::run_instructions(instructions, diagnostics, runner_options);
-  std::cout.rdbuf(previous_buf);
+  auto result = pl0::run_instructions(instructions, diagnostics, runner_options, std::cin, capture);
   REQUIRE(!diagnostics.has_errors());
   REQUIRE(result.success);
   REQUIRE(result.last_value == 2);
   REQUIRE(capture.str() == "2");
 }
+
+TEST_CASE("Virtual machine runs recursive functions with parameters") {
+  const char* source =
+      "function fib(n); begin if n < 2 then fib := n else fib := fib(n - 1) + fib(n - 2) end;"
+      "procedure show(a, b); begin write(a); write(b) end;"
+      "begin call show(fib(10), fib(1)); call fib(3) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto instructions = pl0::test::compile_source(source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream capture;
+  auto result = pl0::run_instructions(instructions, diagnostics, runner_options, std::cin, capture);
+  REQUIRE(!diagnostics.has_errors());
+  REQUIRE(result.success);
+  REQUIRE(capture.str() == "551");
+}
+
+TEST_CASE("Profiler counts instructions and calls per procedure") {
+  const char* source =
+      "function fib(n); begin if n < 2 then fib := n else fib := fib(n - 1) + fib(n - 2) end;"
+      "begin write(fib(10)) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto compiled = pl0::compile_source_text("<profile>", source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  pl0::Profiler profiler(1);
+  profiler.name_procedures(compiled.symbols);
+  std::ostringstream capture;
+  auto result = pl0::run_instructions(compiled.code, diagnostics, runner_options, std::cin, capture,
+                                      &profiler);
+  REQUIRE(result.success);
+  REQUIRE(capture.str() == "55");
+
+  std::uint64_t per_instruction = 0;
+  for (auto count : profiler.instruction_counts()) {
+    per_instruction += count;
+  }
+  std::uint64_t per_procedure = 0;
+  const pl0::Profiler::ProcedureStats* fib = nullptr;
+  for (const auto& stats : profiler.procedures()) {
+    per_procedure += stats.instructions;
+    if (stats.name == "fib") {
+      fib = &stats;
+    }
+  }
+  REQUIRE(per_instruction == per_procedure);
+  REQUIRE(fib != nullptr);
+  REQUIRE(fib->calls == 177);
+
+  std::ostringstream folded;
+  profiler.write_folded(folded);
+  REQUIRE(folded.str().find("main;fib;fib ") != std::string::npos);
+}
+
+TEST_CASE("Profiler tolerates call targets outside the program") {
+  // 损坏的 .pcode 调用越界地址时虚拟机就此停止, 剖析器只需登记该入口而不越界访问
+  const pl0::InstructionSequence code{
+      {pl0::Op::INT, 0, 3}, {pl0::Op::CAL, 0, 999}, {pl0::Op::OPR, 0, static_cast<int>(pl0::Opr::RET)}};
+  pl0::RunnerOptions runner_options;
+  pl0::DiagnosticSink diagnostics;
+  pl0::Profiler profiler(1);
+  std::ostringstream capture;
+  pl0::run_instructions(code, diagnostics, runner_options, std::cin, capture, &profiler);
+  bool registered = false;
+  for (const auto& stats : profiler.procedures()) {
+    registered = registered || (stats.entry == 999 && stats.calls == 1);
+  }
+  REQUIRE(registered);
+
+  pl0::Profiler empty(1);
+  pl0::run_instructions({}, diagnostics, runner_options, std::cin, capture, &empty);
+  REQUIRE(empty.procedures().size() == 1);
+}
+
+TEST_CASE("Runner options select instruction counting and memory checking") {
+  // int 0 4; lit 0 7; sto 0 3; lod 0 3; opr 0 write; opr 0 ret
+  pl0::InstructionSequence code = {
+      {pl0::Op::INT, 0, 4},
+      {pl0::Op::LIT, 0, 7},
+      {pl0::Op::STO, 0, 3},
+      {pl0::Op::LOD, 0, 3},
+      {pl0::Op::OPR, 0, static_cast<int>(pl0::Opr::WRITE)},
+      {pl0::Op::OPR, 0, static_cast<int>(pl0::Opr::RET)},
+  };
+  pl0::DiagnosticSink diagnostics;
+  pl0::RunnerOptions runner_options;
+  runner_options.count_instructions = true;
+  runner_options.enable_bounds_check = true;
+  std::ostringstream capture;
+  auto result = pl0::run_instructions(code, diagnostics, runner_options, std::cin, capture);
+  REQUIRE(result.success);
+  REQUIRE(result.instructions == 6);
+  REQUIRE(capture.str() == "7");
+
+  // 读取未分配的单元只在检查版本中报错
+  code[3].argument = 9;
+  runner_options.count_instructions = false;
+  capture.str("");
+  auto unchecked = pl0::run_instructions(code, diagnostics, {}, std::cin, capture);
+  auto checked = pl0::run_instructions(code, diagnostics, runner_options, std::cin, capture);
+  REQUIRE(unchecked.success);
+  REQUIRE(unchecked.instructions == 0);
+  REQUIRE(!checked.success);
+  REQUIRE(diagnostics.has_errors());
+}
+
+TEST_CASE("Scheduler runs independent programs concurrently with separate budgets") {
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto doubler = pl0::test::compile_source("var x; begin read(x); write(x * 2) end.",
+                                           compiler_options, diagnostics);
+  auto spinner =
+      pl0::test::compile_source("var x; begin while 1 = 1 do x := x + 1 end.", compiler_options,
+                                diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::Scheduler scheduler(4, 1000);
+  for (int i = 0; i < 16; ++i) {
+    pl0::ProgramJob job;
+    job.code = i % 4 == 3 ? spinner : doubler;
+    job.input = std::to_string(i);
+    job.options.instruction_limit = 10000;
+    REQUIRE(scheduler.submit(std::move(job)) == static_cast<std::size_t>(i));
+  }
+  auto outcomes = scheduler.run();
+  REQUIRE(outcomes.size() == 16);
+  REQUIRE(scheduler.pending() == 0);
+  for (int i = 0; i < 16; ++i) {
+    const auto& outcome = outcomes[static_cast<std::size_t>(i)];
+    if (i % 4 == 3) {
+      REQUIRE(!outcome.result.success);
+      REQUIRE(outcome.diagnostics.diagnostics().back().code ==
+              pl0::DiagnosticCode::InstructionLimitExceeded);
+      // 只在回跳处检查, 超出量不超过循环体长度
+      REQUIRE(outcome.result.instructions > 10000);
+      REQUIRE(outcome.result.instructions < 10000 + spinner.size());
+    } else {
+      REQUIRE(outcome.result.success);
+      REQUIRE(outcome.output == std::to_string(i * 2));
+      REQUIRE(!outcome.diagnostics.has_errors());
+    }
+  }
+}
+
+TEST_CASE("Virtual machine suspends and resumes in instruction slices") {
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source(
+      "var i, s; begin i := 0; s := 0; while i < 1000 do begin s := s + i; i := i + 1 end; "
+      "write(s) end.",
+      compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream output;
+  pl0::VirtualMachine vm(diagnostics, runner_options);
+  vm.set_io(std::cin, output);
+  vm.start(code);
+  int slices = 0;
+  pl0::VirtualMachine::Result result;
+  do {
+    result = vm.run_for(500);
+    ++slices;
+  } while (result.status == pl0::VirtualMachine::Result::Status::Suspended);
+  REQUIRE(result.status == pl0::VirtualMachine::Result::Status::Finished);
+  REQUIRE(result.success);
+  REQUIRE(output.str() == "499500");
+  REQUIRE(slices > 10);
+  // 结束后再次调用直接返回最终结果
+  REQUIRE(vm.run_for(500).instructions == result.instructions);
+
+  // 指令预算按整个程序累计, 与分片大小无关
+  pl0::RunnerOptions limited;
+  limited.instruction_limit = 2000;
+  pl0::DiagnosticSink limit_diagnostics;
+  pl0::VirtualMachine bounded(limit_diagnostics, limited);
+  std::ostringstream discarded;
+  bounded.set_io(std::cin, discarded);
+  bounded.start(code);
+  while ((result = bounded.run_for(300)).status ==
+         pl0::VirtualMachine::Result::Status::Suspended) {
+  }
+  REQUIRE(result.status == pl0::VirtualMachine::Result::Status::Failed);
+  REQUIRE(result.instructions > 2000);
+  REQUIRE(limit_diagnostics.diagnostics().back().code ==
+          pl0::DiagnosticCode::InstructionLimitExceeded);
+}
+
+TEST_CASE("Virtual machine snapshots restore into a fresh machine") {
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source(
+      "var i, s, x; begin i := 0; s := 0; while i < 500 do begin s := s + i; i := i + 1 end; "
+      "read(x); write(s + x) end.",
+      compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  const pl0::RunnerOptions runner_options;
+  using Status = pl0::VirtualMachine::Result::Status;
+
+  // 热启动: 初始化完成后停在第一次 READ 前保存快照, 之后以不同输入多次恢复
+  std::ostringstream snapshot;
+  {
+    pl0::VirtualMachine vm(diagnostics, runner_options);
+    vm.start(code);
+    vm.pause_before_read();
+    REQUIRE(vm.run_for(std::numeric_limits<std::uint64_t>::max()).status == Status::Suspended);
+    vm.save_snapshot(snapshot);
+  }
+  for (int input : {1, 1000}) {
+    std::istringstream in(snapshot.str());
+    std::istringstream program_input(std::to_string(input));
+    std::ostringstream output;
+    pl0::VirtualMachine vm(diagnostics, runner_options);
+    vm.set_io(program_input, output);
+    vm.restore_snapshot(in, code);
+    auto result = vm.run_for(std::numeric_limits<std::uint64_t>::max());
+    REQUIRE(result.status == Status::Finished);
+    REQUIRE(output.str() == std::to_string(124750 + input));
+  }
+
+  // 迁移: 一台虚拟机跑一个分片后快照, 另一台接着跑完, 总指令数与一次跑完相同
+  std::istringstream direct_input("7");
+  std::ostringstream direct_output;
+  pl0::VirtualMachine direct(diagnostics, runner_options);
+  direct.set_io(direct_input, direct_output);
+  direct.start(code);
+  const auto expected = direct.run_for(std::numeric_limits<std::uint64_t>::max() - 1);
+
+  pl0::VirtualMachine first(diagnostics, runner_options);
+  first.start(code);
+  REQUIRE(first.run_for(1000).status == Status::Suspended);
+  std::ostringstream checkpoint;
+  first.save_snapshot(checkpoint);
+  std::istringstream checkpoint_in(checkpoint.str());
+  std::istringstream migrated_input("7");
+  std::ostringstream migrated_output;
+  pl0::VirtualMachine second(diagnostics, runner_options);
+  second.set_io(migrated_input, migrated_output);
+  second.restore_snapshot(checkpoint_in, code);
+  const auto migrated = second.run_for(std::numeric_limits<std::uint64_t>::max() - 1);
+  REQUIRE(migrated.status == Status::Finished);
+  REQUIRE(migrated_output.str() == direct_output.str());
+  REQUIRE(migrated.instructions == expected.instructions);
+  REQUIRE(!diagnostics.has_errors());
+
+  // 截断的快照与其他程序的快照都会被拒绝
+  bool truncated_rejected = false;
+  try {
+    std::istringstream truncated(checkpoint.str().substr(0, checkpoint.str().size() - 1));
+    pl0::VirtualMachine vm(diagnostics, runner_options);
+    vm.restore_snapshot(truncated, code);
+  } catch (const std::runtime_error&) {
+    truncated_rejected = true;
+  }
+  REQUIRE(truncated_rejected);
+  bool mismatch_rejected = false;
+  try {
+    auto other = code;
+    other.push_back({pl0::Op::NOP, 0, 0});
+    std::istringstream in(checkpoint.str());
+    pl0::VirtualMachine vm(diagnostics, runner_options);
+    vm.restore_snapshot(in, other);
+  } catch (const std::runtime_error&) {
+    mismatch_rejected = true;
+  }
+  REQUIRE(mismatch_rejected);
+
+  // 基址指针在栈顶之上的快照同样拒绝; 其位置紧随魔数、版本、指纹与程序计数器之后
+  bool base_rejected = false;
+  try {
+    auto patched = checkpoint.str();
+    const std::int32_t base_pointer = 5000000;
+    std::memcpy(patched.data() + 24, &base_pointer, sizeof(base_pointer));
+    std::istringstream in(patched);
+    pl0::VirtualMachine vm(diagnostics, runner_options);
+    vm.restore_snapshot(in, code);
+  } catch (const std::runtime_error&) {
+    base_rejected = true;
+  }
+  REQUIRE(base_rejected);
+}
+
+TEST_CASE("Virtual machine snapshots taken at every slice resume correctly") {
+  // 在调用处挂起时新帧的帧头还在栈顶之上, 快照必须一并保存
+  const char* source =
+      "function f(n); begin if n < 2 then f := n else f := f(n - 1) + f(n - 2) end;"
+      "begin write(f(12)) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto code = pl0::test::compile_source(source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream output;
+  pl0::VirtualMachine vm(diagnostics, runner_options);
+  vm.set_io(std::cin, output);
+  vm.start(code);
+  std::size_t restores = 0;
+  while (vm.run_for(1).status == pl0::VirtualMachine::Result::Status::Suspended) {
+    std::ostringstream snapshot;
+    vm.save_snapshot(snapshot);
+    std::istringstream in(snapshot.str());
+    vm.restore_snapshot(in, code);
+    ++restores;
+  }
+  REQUIRE(restores > 100);
+  REQUIRE(output.str() == "144");
+  REQUIRE(!diagnostics.has_errors());
+}
+
+TEST_CASE("Virtual machine executes the packed instruction encoding") {
+  const char* source =
+      "var n; function fib(k); begin if k < 2 then fib := k else fib := fib(k - 1) + fib(k - 2) end;"
+      "begin n := fib(15); write(n) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto instructions = pl0::test::compile_source(source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  const auto packed = pl0::pack_instructions(instructions);
+  REQUIRE(packed.code.size() == instructions.size());
+  for (std::size_t i = 0; i < packed.code.size(); ++i) {
+    const auto round_trip = pl0::unpack_instruction(packed, i);
+    REQUIRE(round_trip.op == instructions[i].op);
+    REQUIRE(round_trip.level == instructions[i].level);
+    REQUIRE(round_trip.argument == instructions[i].argument);
+  }
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream capture;
+  REQUIRE(pl0::run_instructions(instructions, diagnostics, runner_options, std::cin, capture).success);
+  REQUIRE(capture.str() == "610");
+
+  // 手写的 .pcode 可能带有无法编码的层次字段, 运行前即失败而不是截断
+  pl0::InstructionSequence malformed{{pl0::Op::INT, 0, 3}, {pl0::Op::LOD, -1, 3}};
+  pl0::DiagnosticSink rejected;
+  std::ostringstream ignored;
+  REQUIRE(!pl0::run_instructions(malformed, rejected, runner_options, std::cin, ignored).success);
+  REQUIRE(rejected.has_errors());
+}
+
+TEST_CASE("Wide literals load from a de-duplicated constant pool") {
+  const char* source =
+      "const big = 9000000000000000000; var x;"
+      "begin x := big - 1; write(x); write(-4294967296 + 4294967296 * 2); write(big);"
+      "write(-2147483648); write(2147483647) end.";
+  pl0::CompilerOptions compiler_options;
+  pl0::DiagnosticSink diagnostics;
+  auto instructions = pl0::test::compile_source(source, compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+
+  std::size_t wide = 0;
+  for (const auto& instr : instructions) {
+    wide += instr.op == pl0::Op::LDC ? 1 : 0;
+  }
+  REQUIRE(wide == 5);
+  const auto packed = pl0::pack_instructions(instructions);
+  REQUIRE(packed.constants.size() == 3);
+
+  pl0::RunnerOptions runner_options;
+  std::ostringstream capture;
+  REQUIRE(pl0::run_instructions(instructions, diagnostics, runner_options, std::cin, capture).success);
+  REQUIRE(capture.str() == "899999999999999999942949672969000000000000000000-21474836482147483647");
+
+  // 文本形式以完整常量往返
+  const auto text = pl0::to_string(pl0::load_constant(-9000000000));
+  REQUIRE(text == "ldc 0 -9000000000");
+  REQUIRE(pl0::literal_value(pl0::parse_instruction(text)) == -9000000000);
+
+  // 优化器折叠出的宽常量同样经 LDC 加载
+  compiler_options.optimize = true;
+  auto optimized = pl0::compile_source_text("wide.pl0", std::string(source), compiler_options, diagnostics);
+  REQUIRE(!diagnostics.has_errors());
+  std::ostringstream optimized_capture;
+  REQUIRE(pl0::run_instructions(optimized.code, diagnostics, runner_options, std::cin,
+                                optimized_capture)
+              .success);
+  REQUIRE(optimized_capture.str() == capture.str());
+}
+
+TEST_CASE("Run limit options accept only complete unsigned integers") {
+  auto parse = [](std::string value, pl0::RunnerOptions& options) {
+    std::vector<std::string> args{"--max-instructions", std::move(value)};
+    std::size_t i = 0;
+    bool valid = true;
+    std::ostringstream errors;
+    REQUIRE(pl0::parse_limit_option(args, i, options, valid, errors));
+    REQUIRE(i == 1);
+    REQUIRE(valid == errors.str().empty());
+    return valid;
+  };
+
+  pl0::RunnerOptions options;
+  REQUIRE(parse("10", options));
+  REQUIRE(options.instruction_limit == 10U);
+  REQUIRE(parse("18446744073709551615", options));
+  for (const char* bad : {"-5", "10abc", "", "+3", " 7", "18446744073709551616"}) {
+    pl0::RunnerOptions rejected;
+    REQUIRE(!parse(bad, rejected));
+    REQUIRE(rejected.instruction_limit == 0U);
+  }
+}
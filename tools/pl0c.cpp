@@ -1,15 +1,113 @@
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <map>
 #include <optional>
+#include <sstream>
+#include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 #include "pl0/Driver.hpp"
+#include "pl0/ThreadPool.hpp"
+#include "pl0/Utility.hpp"
+
+namespace {
+
+// 结构: 单个输入的编译任务与结果; 各任务使用独立的诊断收集器与调试输出缓冲
+struct CompileJob {
+  std::filesystem::path input;
+  std::filesystem::path output;
+  pl0::DiagnosticSink diagnostics;
+  std::string dump;
+  std::string error;  // 读写文件等非诊断错误
+};
+
+// 函数: 展开输入参数: 目录取其中的 *.pl0 (按名称排序), @file 为每行一个路径的响应文件
+bool expand_input(const std::string& arg, std::vector<std::filesystem::path>& inputs) {
+  if (arg.size() > 1 && arg[0] == '@') {
+    std::ifstream list(arg.substr(1));
+    if (!list) {
+      std::cerr << "failed to open response file '" << arg.substr(1) << "'\n";
+      return false;
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty() && line[0] != '#' && !expand_input(line, inputs)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  std::filesystem::path path(arg);
+  std::error_code ec;
+  if (std::filesystem::is_directory(path, ec)) {
+    std::vector<std::filesystem::path> sources;
+    for (const auto& entry : std::filesystem::directory_iterator(path, ec)) {
+      if (entry.is_regular_file() && entry.path().extension() == ".pl0") {
+        sources.push_back(entry.path());
+      }
+    }
+    std::sort(sources.begin(), sources.end());
+    inputs.insert(inputs.end(), sources.begin(), sources.end());
+    return true;
+  }
+  inputs.push_back(path);
+  return true;
+}
+
+// 函数: 编译单个输入并写出 P-Code, object 为真时写出目标文件
+void run_job(CompileJob& job, const pl0::CompilerOptions& options, const pl0::DumpOptions& dumps,
+             pl0::CompileCache* cache, bool object) {
+  std::ostringstream dump_stream;
+  pl0::CompileResult result;
+  pl0::ObjectModule module;
+  try {
+    if (object) {
+      const auto source = pl0::SourceBuffer::open(job.input);
+      module = pl0::compile_object(job.input.filename().string(), source, options,
+                                   job.diagnostics);
+    } else {
+      result = pl0::compile_file(job.input, options, dumps, job.diagnostics, dump_stream, cache);
+    }
+  } catch (const std::exception& ex) {
+    job.error = ex.what();
+    return;
+  }
+  job.dump = dump_stream.str();
+  if (job.diagnostics.has_errors()) {
+    return;
+  }
+
+  try {
+    if (job.output.has_parent_path() && !job.output.parent_path().empty()) {
+      std::error_code ec;
+      std::filesystem::create_directories(job.output.parent_path(), ec);
+      if (ec) {
+        job.error = "failed to create output directory '" + job.output.parent_path().string() +
+                    "': " + ec.message();
+        return;
+      }
+    }
+    if (object) {
+      pl0::write_object(job.output, module);
+    } else {
+      pl0::save_pcode_file(job.output, result.code);
+    }
+  } catch (const std::exception& ex) {
+    job.error = ex.what();
+  }
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
-  using pl0::CompileResult;
   using pl0::CompilerOptions;
-  using pl0::DiagnosticSink;
   using pl0::DumpOptions;
 
   std::vector<std::string> args;
@@ -18,19 +116,34 @@ int main(int argc, char** argv) {
   }
 
   if (args.empty()) {
-    std::cerr << "Usage: pl0c <input.pl0> [-o out.pcode] [--dump-tokens --dump-ast --dump-sym --dump-pcode --bounds-check]\n";
+    std::cerr << "Usage: pl0c <input.pl0|dir|@list>... [-c] [-o out.pcode | --out-dir dir] [-j N] [--dump-tokens --dump-ast --dump-sym --dump-pcode --dump-ir --bounds-check -O --no-cache]\n";
     return 1;
   }
 
   CompilerOptions compiler_options;
   DumpOptions dumps;
+  bool use_cache = true;
+  bool object = false;
+  std::size_t jobs = 0;
   std::optional<std::filesystem::path> output_path;
-  std::filesystem::path input_path;
+  std::optional<std::filesystem::path> output_dir;
+  std::vector<std::filesystem::path> inputs;
 
   for (std::size_t i = 0; i < args.size(); ++i) {
     const auto& arg = args[i];
     if (arg == "-o" && i + 1 < args.size()) {
       output_path = std::filesystem::path(args[++i]);
+    } else if (arg == "--out-dir" && i + 1 < args.size()) {
+      output_dir = std::filesystem::path(args[++i]);
+    } else if (arg == "-j" && i + 1 < args.size()) {
+      auto value = pl0::parse_unsigned(args[++i]);
+      if (!value) {
+        std::cerr << "Invalid job count: " << args[i] << '\n';
+        return 1;
+      }
+      jobs = static_cast<std::size_t>(*value);
+    } else if (arg == "-c") {
+      object = true;
     } else if (arg == "--dump-tokens") {
       dumps.tokens = true;
     } else if (arg == "--dump-ast") {
@@ -39,59 +152,101 @@ int main(int argc, char** argv) {
       dumps.symbols = true;
     } else if (arg == "--dump-pcode") {
       dumps.pcode = true;
+    } else if (arg == "--dump-ir") {
+      dumps.ir = true;
+    } else if (arg == "-O" || arg == "--optimize") {
+      compiler_options.optimize = true;
+    } else if (arg == "--no-cache") {
+      use_cache = false;
     } else if (arg == "--bounds-check") {
       compiler_options.enable_bounds_check = true;
     } else if (!arg.empty() && arg[0] == '-') {
       std::cerr << "Unknown option: " << arg << '\n';
       return 1;
-    } else if (input_path.empty()) {
-      input_path = std::filesystem::path(arg);
-    } else {
-      std::cerr << "Unexpected argument: " << arg << '\n';
+    } else if (!expand_input(arg, inputs)) {
       return 1;
     }
   }
 
-  if (input_path.empty()) {
+  if (inputs.empty()) {
     std::cerr << "No input file specified\n";
     return 1;
   }
-
-  if (!output_path) {
-    auto default_output = input_path;
-    default_output.replace_extension(".pcode");
-    output_path = default_output;
+  if (output_path && inputs.size() > 1) {
+    std::cerr << "-o requires a single input; use --out-dir for batches\n";
+    return 1;
   }
 
-  DiagnosticSink diagnostics;
-  CompileResult result;
-  try {
-    result = pl0::compile_file(input_path, compiler_options, dumps, diagnostics, std::cout);
-  } catch (const std::exception& ex) {
-    std::cerr << ex.what() << '\n';
+  if (object && (dumps.tokens || dumps.ast || dumps.symbols || dumps.pcode || dumps.ir ||
+                 compiler_options.optimize)) {
+    std::cerr << "-c cannot be combined with --dump-* or -O; link with pl0ld first\n";
     return 1;
   }
 
-  if (diagnostics.has_errors()) {
-    pl0::print_diagnostics(diagnostics, std::cerr);
-    return 1;
+  std::vector<CompileJob> batch(inputs.size());
+  for (std::size_t i = 0; i < inputs.size(); ++i) {
+    auto& job = batch[i];
+    job.input = inputs[i];
+    if (output_path) {
+      job.output = *output_path;
+    } else {
+      auto name = inputs[i].filename();
+      name.replace_extension(object ? ".pl0o" : ".pcode");
+      job.output = output_dir ? *output_dir / name : inputs[i].parent_path() / name;
+    }
   }
 
-  try {
-    if (output_path->has_parent_path() && !output_path->parent_path().empty()) {
-      std::error_code ec;
-      std::filesystem::create_directories(output_path->parent_path(), ec);
-      if (ec) {
-        std::cerr << "failed to create output directory '" << output_path->parent_path().string()
-                  << "': " << ec.message() << '\n';
-        return 1;
-      }
+  // 并行任务写同一输出会互相覆盖, 调度前拒绝映射到相同路径的输入
+  std::map<std::filesystem::path, const CompileJob*> outputs;
+  for (const auto& job : batch) {
+    auto key = std::filesystem::absolute(job.output).lexically_normal();
+    auto [it, inserted] = outputs.emplace(std::move(key), &job);
+    if (!inserted) {
+      std::cerr << "Inputs " << it->second->input.string() << " and " << job.input.string()
+                << " both write " << job.output.string() << '\n';
+      return 1;
     }
-    pl0::save_pcode_file(*output_path, result.code);
-  } catch (const std::exception& ex) {
-    std::cerr << ex.what() << '\n';
-    return 1;
   }
 
-  return 0;
+  pl0::CompileCache cache(pl0::CompileCache::default_directory());
+  pl0::CompileCache* active_cache = use_cache ? &cache : nullptr;
+  if (batch.size() == 1) {
+    // 单个输入时把线程留给文件内部的并行解析
+    compiler_options.threads = jobs;
+    run_job(batch.front(), compiler_options, dumps, active_cache, object);
+  } else {
+    pl0::ThreadPool pool(std::min(jobs == 0 ? std::thread::hardware_concurrency() : jobs,
+                                  batch.size()));
+    for (auto& job : batch) {
+      pool.submit([&] { run_job(job, compiler_options, dumps, active_cache, object); });
+    }
+    pool.wait();
+  }
+
+  // 按输入顺序汇总输出, 与并行调度无关
+  std::size_t failures = 0;
+  for (const auto& job : batch) {
+    std::cout << job.dump;
+    const bool failed = !job.error.empty() || job.diagnostics.has_errors();
+    if (!failed) {
+      continue;
+    }
+    ++failures;
+    if (batch.size() > 1) {
+      std::cerr << job.input.string() << ":\n";
+    }
+    if (!job.error.empty()) {
+      std::cerr << job.error << '\n';
+    } else {
+      pl0::print_diagnostics(job.diagnostics, std::cerr);
+    }
+  }
+  if (batch.size() > 1) {
+    std::cerr << "compiled " << batch.size() - failures << " of " << batch.size() << " files";
+    if (failures > 0) {
+      std::cerr << ", " << failures << " failed";
+    }
+    std::cerr << '\n';
+  }
+  return failures == 0 ? 0 : 1;
 }
@@ -0,0 +1,93 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pl0/Generator.hpp"
+
+namespace {
+
+// 函数: 解析非负整数参数
+bool parse_count(const std::string& text, int& value) {
+  try {
+    std::size_t used = 0;
+    int parsed = std::stoi(text, &used);
+    if (used != text.size() || parsed < 0) {
+      return false;
+    }
+    value = parsed;
+    return true;
+  } catch (const std::exception&) {
+    return false;
+  }
+}
+
+// 函数: 写出文本文件
+bool write_text(const std::filesystem::path& path, const std::string& text) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out) {
+    std::cerr << "Failed to open file: " << path.string() << '\n';
+    return false;
+  }
+  out << text;
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    args.emplace_back(argv[i]);
+  }
+
+  pl0::GeneratorOptions options;
+  std::optional<std::filesystem::path> output_path;
+  std::optional<std::filesystem::path> expect_path;
+
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto& arg = args[i];
+    const bool has_value = i + 1 < args.size();
+    int seed = 0;
+    if (arg == "--procedures" && has_value && parse_count(args[i + 1], options.procedures)) {
+      ++i;
+    } else if (arg == "--depth" && has_value && parse_count(args[i + 1], options.depth)) {
+      ++i;
+    } else if (arg == "--array-size" && has_value &&
+               parse_count(args[i + 1], options.array_size)) {
+      ++i;
+    } else if (arg == "--terms" && has_value &&
+               parse_count(args[i + 1], options.expression_terms)) {
+      ++i;
+    } else if (arg == "--seed" && has_value && parse_count(args[i + 1], seed)) {
+      options.seed = static_cast<std::uint32_t>(seed);
+      ++i;
+    } else if (arg == "-o" && has_value) {
+      output_path = std::filesystem::path(args[++i]);
+    } else if (arg == "--expect" && has_value) {
+      expect_path = std::filesystem::path(args[++i]);
+    } else {
+      std::cerr << "Usage: pl0gen [--procedures N] [--depth N] [--array-size N] [--terms N] "
+                   "[--seed N] [-o out.pl0] [--expect out.expected]\n";
+      return 1;
+    }
+  }
+
+  const auto program = pl0::generate_program(options);
+  if (output_path) {
+    if (!write_text(*output_path, program.source)) {
+      return 1;
+    }
+  } else {
+    std::cout << program.source;
+  }
+  if (expect_path && !write_text(*expect_path, program.expected_output)) {
+    return 1;
+  }
+  if (!expect_path) {
+    std::cerr << "expected output: " << program.expected_output << '\n';
+  }
+  return 0;
+}
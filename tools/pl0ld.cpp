@@ -0,0 +1,90 @@
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pl0/Driver.hpp"
+#include "pl0/Object.hpp"
+#include "pl0/Optimizer.hpp"
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    args.emplace_back(argv[i]);
+  }
+
+  if (args.empty()) {
+    std::cerr << "Usage: pl0ld <main.pl0o> [lib.pl0o]... [-o out.pcode] [-O] [--dump-sym --dump-pcode]\n";
+    return 1;
+  }
+
+  std::vector<std::filesystem::path> inputs;
+  std::optional<std::filesystem::path> output_path;
+  bool optimize = false;
+  pl0::DumpOptions dumps;
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto& arg = args[i];
+    if (arg == "-o" && i + 1 < args.size()) {
+      output_path = std::filesystem::path(args[++i]);
+    } else if (arg == "-O" || arg == "--optimize") {
+      optimize = true;
+    } else if (arg == "--dump-sym") {
+      dumps.symbols = true;
+    } else if (arg == "--dump-pcode") {
+      dumps.pcode = true;
+    } else if (!arg.empty() && arg[0] == '-') {
+      std::cerr << "Unknown option: " << arg << '\n';
+      return 1;
+    } else {
+      inputs.emplace_back(arg);
+    }
+  }
+
+  if (inputs.empty()) {
+    std::cerr << "No input file specified\n";
+    return 1;
+  }
+
+  std::vector<pl0::ObjectModule> modules;
+  try {
+    for (const auto& input : inputs) {
+      modules.push_back(pl0::read_object(input));
+    }
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << '\n';
+    return 1;
+  }
+
+  pl0::DiagnosticSink diagnostics;
+  auto linked = pl0::link_objects(modules, diagnostics);
+  if (diagnostics.has_errors()) {
+    pl0::print_diagnostics(diagnostics, std::cerr);
+    return 1;
+  }
+  if (optimize) {
+    pl0::optimize_program(linked.code, linked.symbols);
+  }
+
+  if (dumps.symbols) {
+    for (const auto& symbol : linked.symbols) {
+      std::cout << symbol.name << " -> " << symbol.address << '\n';
+    }
+  }
+  if (dumps.pcode) {
+    pl0::serialize_instructions(linked.code, std::cout);
+    std::cout << '\n';
+  }
+
+  auto output = output_path.value_or(inputs.front());
+  if (!output_path) {
+    output.replace_extension(".pcode");
+  }
+  try {
+    pl0::save_pcode_file(output, linked.code);
+  } catch (const std::exception& ex) {
+    std::cerr << ex.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include <filesystem>
 #include <iostream>
+#include <optional>
 #include <vector>
 
 #include "pl0/Driver.hpp"
@@ -11,16 +12,31 @@ int main(int argc, char** argv) {
   }
 
   if (args.empty()) {
-    std::cerr << "Usage: pl0run <input.pcode> [--trace-vm]\n";
+    std::cerr << "Usage: pl0run <input.pcode> [--trace-vm] [--bounds-check] [--profile [--profile-out out.folded]] [--max-instructions N] [--time-limit ms]\n";
     return 1;
   }
 
   pl0::RunnerOptions runner_options;
   std::filesystem::path input_path;
+  bool profile = false;
+  std::optional<std::filesystem::path> profile_output;
+  bool valid_limits = true;
 
-  for (const auto& arg : args) {
+  for (std::size_t i = 0; i < args.size(); ++i) {
+    const auto& arg = args[i];
     if (arg == "--trace-vm") {
       runner_options.trace_vm = true;
+    } else if (arg == "--bounds-check") {
+      runner_options.enable_bounds_check = true;
+    } else if (pl0::parse_limit_option(args, i, runner_options, valid_limits, std::cerr)) {
+      if (!valid_limits) {
+        return 1;
+      }
+    } else if (arg == "--profile") {
+      profile = true;
+    } else if (arg == "--profile-out" && i + 1 < args.size()) {
+      profile = true;
+      profile_output = std::filesystem::path(args[++i]);
     } else if (!arg.empty() && arg[0] == '-') {
       std::cerr << "Unknown option: " << arg << '\n';
       return 1;
@@ -46,7 +62,19 @@ int main(int argc, char** argv) {
   }
 
   pl0::DiagnosticSink diagnostics;
-  auto result = pl0::run_instructions(code, diagnostics, runner_options);
+  pl0::Profiler profiler;
+  auto result = pl0::run_instructions(code, diagnostics, runner_options,
+                                      profile ? &profiler : nullptr);
+  if (profile) {
+    try {
+      auto folded = input_path;
+      pl0::write_profile(profiler, std::cerr,
+                         profile_output.value_or(folded.replace_extension(".folded")));
+    } catch (const std::exception& ex) {
+      std::cerr << ex.what() << '\n';
+      return 1;
+    }
+  }
   if (diagnostics.has_errors()) {
     pl0::print_diagnostics(diagnostics, std::cerr);
     return 1;